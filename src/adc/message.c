@@ -108,6 +108,7 @@ struct adc_message* adc_msg_incref(struct adc_message* msg)
 
 static void adc_msg_set_length(struct adc_message* msg, size_t len)
 {
+	adc_msg_clear_search(msg);
 	msg->length = len;
 }
 
@@ -227,6 +228,7 @@ void adc_msg_free(struct adc_message* msg)
 			msg->cache[0] = '\0';
 #endif
 		msg_free(msg->cache);
+		adc_msg_clear_search(msg);
 
 		if (msg->feature_cast_include)
 		{
@@ -267,6 +269,7 @@ struct adc_message* adc_msg_copy(const struct adc_message* cmd)
 	copy->references           = 1;
 	copy->feature_cast_include = 0;
 	copy->feature_cast_exclude = 0;
+	copy->search               = 0;
 
 	if (!adc_msg_grow(copy, copy->length))
 	{
@@ -753,6 +756,17 @@ int adc_msg_add_named_argument_uint64(struct adc_message* cmd, const char prefix
 	return ret;
 }
 
+int adc_msg_append_message(struct adc_message* cmd, const struct adc_message* other)
+{
+	if (!adc_msg_grow(cmd, cmd->length + other->length))
+		return -1;
+
+	memcpy(cmd->cache + cmd->length, other->cache, other->length);
+	adc_msg_set_length(cmd, cmd->length + other->length);
+	cmd->cache[cmd->length] = 0;
+	return 0;
+}
+
 int adc_msg_add_argument(struct adc_message* cmd, const char* string)
 {
 	ADC_MSG_ASSERT(cmd);
@@ -21,6 +21,7 @@
 #define HAVE_UHUB_COMMAND_H
 
 struct hub_user;
+struct plugin_search;
 
 struct adc_message
 {
@@ -34,6 +35,7 @@ struct adc_message
 	size_t references;
 	struct linked_list*  feature_cast_include;
 	struct linked_list*  feature_cast_exclude;
+	struct plugin_search* search;   /* Parsed search terms, see adc_msg_get_search() */
 };
 
 enum msg_status_level
@@ -163,6 +165,14 @@ extern char* adc_msg_get_argument(struct adc_message* cmd, int offset);
  */
 extern int adc_msg_replace_named_argument(struct adc_message* cmd, const char prefix[2], const char* string);
 
+/**
+ * Append all the lines of another message, so both are sent as one.
+ * The command, source and target of 'cmd' are those of its first line.
+ *
+ * @return  0 if successful, or -1 if an error occurred (out of memory).
+ */
+extern int adc_msg_append_message(struct adc_message* cmd, const struct adc_message* other);
+
 /**
  * Append an argument
  *
@@ -0,0 +1,215 @@
+/*
+ * uhub - A tiny ADC p2p connection hub
+ * Copyright (C) 2007-2014, Jan Vidar Krey
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "uhub.h"
+
+static int is_search(fourcc_t cmd)
+{
+	switch (cmd)
+	{
+		case ADC_CMD_BSCH:
+		case ADC_CMD_DSCH:
+		case ADC_CMD_ESCH:
+		case ADC_CMD_FSCH:
+			return 1;
+	}
+	return 0;
+}
+
+/* Unescape len bytes of str into target, returns the bytes written including the terminator. */
+static size_t search_unescape(const char* str, size_t len, char* target)
+{
+	size_t n;
+	size_t w = 0;
+	int escaped = 0;
+
+	for (n = 0; n < len; n++)
+	{
+		if (escaped)
+		{
+			if (str[n] == 's')
+				target[w++] = ' ';
+			else if (str[n] == 'n')
+				target[w++] = '\n';
+			else
+				target[w++] = str[n];
+			escaped = 0;
+		}
+		else if (str[n] == '\\')
+			escaped = 1;
+		else
+			target[w++] = str[n];
+	}
+	target[w++] = '\0';
+	return w;
+}
+
+static int search_parse_size(const char* str, size_t len, uint64_t* size)
+{
+	uint64_t val = 0;
+	size_t n;
+
+	if (len == 0)
+		return 0;
+
+	for (n = 0; n < len; n++)
+	{
+		if (!is_num(str[n]) || val > (UINT64_MAX - 9) / 10)
+			return 0;
+		val = (val * 10) + (uint64_t) (str[n] - '0');
+	}
+
+	*size = val;
+	return 1;
+}
+
+#define SEARCH_FOREACH_ARG(START, END, ARG, LEN, CODE) \
+	do { \
+		const char* ARG = START; \
+		const char* arg_end_; \
+		size_t LEN; \
+		while (ARG < END) \
+		{ \
+			arg_end_ = memchr(ARG, ' ', END - ARG); \
+			if (!arg_end_) \
+				arg_end_ = END; \
+			LEN = arg_end_ - ARG; \
+			if (LEN >= 2) \
+				CODE \
+			ARG = arg_end_ + 1; \
+		} \
+	} while (0)
+
+#define SEARCH_PREFIX(ARG, A, B) (ARG[0] == A && ARG[1] == B)
+
+const struct plugin_search* adc_msg_get_search(struct adc_message* cmd)
+{
+	struct plugin_search* search;
+	const char* start;
+	const char* end;
+	const char** terms;
+	char* buf;
+	size_t include = 0;
+	size_t exclude = 0;
+	size_t extensions = 0;
+	int offset;
+
+	if (!cmd || !cmd->cache)
+		return NULL;
+
+	if (cmd->search)
+		return cmd->search;
+
+	if (!is_search(cmd->cmd))
+		return NULL;
+
+	offset = adc_msg_get_arg_offset(cmd);
+	if (offset < 0 || (size_t) offset > cmd->length)
+		return NULL;
+
+	start = cmd->cache + offset;
+	end = cmd->cache + cmd->length;
+	if (end > start && end[-1] == '\n')
+		end--;
+
+	SEARCH_FOREACH_ARG(start, end, arg, len,
+	{
+		if (SEARCH_PREFIX(arg, 'A', 'N'))
+			include++;
+		else if (SEARCH_PREFIX(arg, 'N', 'O'))
+			exclude++;
+		else if (SEARCH_PREFIX(arg, 'E', 'X'))
+			extensions++;
+	});
+
+	/* The struct, the term pointers and the unescaped strings share one allocation. */
+	search = hub_malloc_zero(sizeof(struct plugin_search) + ((include + exclude + extensions) * sizeof(const char*)) + (end - start) + 1);
+	if (!search)
+		return NULL;
+
+	terms = (const char**) (search + 1);
+	buf = (char*) (terms + include + exclude + extensions);
+
+	search->include = terms;
+	search->exclude = terms + include;
+	search->extensions = terms + include + exclude;
+
+	SEARCH_FOREACH_ARG(start, end, arg, len,
+	{
+		if (SEARCH_PREFIX(arg, 'A', 'N'))
+		{
+			search->include[search->include_count++] = buf;
+			buf += search_unescape(arg + 2, len - 2, buf);
+		}
+		else if (SEARCH_PREFIX(arg, 'N', 'O'))
+		{
+			search->exclude[search->exclude_count++] = buf;
+			buf += search_unescape(arg + 2, len - 2, buf);
+		}
+		else if (SEARCH_PREFIX(arg, 'E', 'X'))
+		{
+			search->extensions[search->extension_count++] = buf;
+			buf += search_unescape(arg + 2, len - 2, buf);
+		}
+		else if (SEARCH_PREFIX(arg, 'T', 'O'))
+		{
+			search->token = buf;
+			buf += search_unescape(arg + 2, len - 2, buf);
+		}
+		else if (SEARCH_PREFIX(arg, 'T', 'R'))
+		{
+			search->tth = buf;
+			buf += search_unescape(arg + 2, len - 2, buf);
+		}
+		else if (SEARCH_PREFIX(arg, 'G', 'E'))
+		{
+			if (search_parse_size(arg + 2, len - 2, &search->size_min))
+				search->flags |= search_size_min;
+		}
+		else if (SEARCH_PREFIX(arg, 'L', 'E'))
+		{
+			if (search_parse_size(arg + 2, len - 2, &search->size_max))
+				search->flags |= search_size_max;
+		}
+		else if (SEARCH_PREFIX(arg, 'E', 'Q'))
+		{
+			if (search_parse_size(arg + 2, len - 2, &search->size_exact))
+				search->flags |= search_size_exact;
+		}
+		else if (SEARCH_PREFIX(arg, 'T', 'Y') && len == 3)
+		{
+			if (arg[2] == '1')
+				search->type = search_type_file;
+			else if (arg[2] == '2')
+				search->type = search_type_directory;
+		}
+	});
+
+	cmd->search = search;
+	return search;
+}
+
+void adc_msg_clear_search(struct adc_message* cmd)
+{
+	if (cmd->search)
+	{
+		hub_free(cmd->search);
+		cmd->search = 0;
+	}
+}
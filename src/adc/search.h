@@ -0,0 +1,41 @@
+/*
+ * uhub - A tiny ADC p2p connection hub
+ * Copyright (C) 2007-2014, Jan Vidar Krey
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef HAVE_UHUB_ADC_SEARCH_H
+#define HAVE_UHUB_ADC_SEARCH_H
+
+struct adc_message;
+struct plugin_search;
+
+/**
+ * Parse the arguments of a search (SCH) message.
+ * The result is cached on the message, so repeated calls are cheap.
+ *
+ * @return the parsed search, or NULL if the message is not a search or
+ * memory could not be allocated. It is valid until the message is
+ * modified or freed.
+ */
+extern const struct plugin_search* adc_msg_get_search(struct adc_message* cmd);
+
+/**
+ * Release the cached search, if any.
+ */
+extern void adc_msg_clear_search(struct adc_message* cmd);
+
+#endif /* HAVE_UHUB_ADC_SEARCH_H */
@@ -77,46 +77,175 @@ sid_t string_to_sid(const char* sid)
 
 /*
  * Session IDs are heavily reused, since they are a fairly scarce
- * resource. Only one (2^10)-1 exist, since it is a four byte base32-encoded
+ * resource. Only (2^20)-1 exist, since it is a four byte base32-encoded
  * value and 'AAAA' (0) is reserved for the hub.
  *
- * Initialize with sid_initialize(), which sets min and max to one, and count to 0.
- *
- * When allocating a session ID:
- * - If 'count' is less than the pool size (max-min), then allocate within the pool
- * - Increase the pool size (see below)
- * - If unable to do that, hub is really full - don't let anyone in!
- *
- * When freeing a session ID:
- * - If the session ID being freed is 'max', then decrease the pool size by one.
+ * Free session IDs are tracked in a bitmap, with a second bitmap that
+ * tells which words of the first one have a free bit. Allocating
+ * finds the lowest free session ID with two count-trailing-zero
+ * operations, so it does not slow down as the pool fills up.
  *
+ * With a reuse delay, freed session IDs are kept in a FIFO queue until
+ * the delay has passed, so messages still in flight to a user that
+ * left are not delivered to a new user given the same session ID.
+ * If the pool runs out of free session IDs, the oldest delayed one is
+ * reused early rather than turning the user away.
  */
 
+#define SID_WORD_BITS 64
+
+struct sid_delayed
+{
+	sid_t sid;
+	time_t freed;
+};
+
 struct sid_pool
 {
+	sid_t base;                  /* added to the session IDs handed out */
 	sid_t min;
 	sid_t max;
 	sid_t count;
-	struct hub_user** map;
+	struct ptr_table* map;       /* session ID -> user */
+	uint64_t* free_bits;         /* bit set if the session ID is free */
+	uint64_t* free_words;        /* bit set if the free_bits word has a bit set */
+	size_t words;                /* number of free_words */
+	size_t hint;                 /* no free_words below this one has a bit set */
+	time_t reuse_delay;
+	struct sid_delayed* delayed; /* ring buffer, oldest at delayed_first */
+	size_t delayed_first;
+	size_t delayed_count;
+	size_t delayed_max;
 };
 
+static inline unsigned sid_ctz(uint64_t word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return (unsigned) __builtin_ctzll(word);
+#else
+	unsigned n = 0;
+	for (; !(word & 1); word >>= 1)
+		n++;
+	return n;
+#endif
+}
+
+static void sid_mark_free(struct sid_pool* pool, sid_t sid)
+{
+	size_t word = sid / SID_WORD_BITS;
+	size_t summary = word / SID_WORD_BITS;
+
+	pool->free_bits[word] |= (uint64_t) 1 << (sid % SID_WORD_BITS);
+	pool->free_words[summary] |= (uint64_t) 1 << (word % SID_WORD_BITS);
+	if (summary < pool->hint)
+		pool->hint = summary;
+}
+
+static void sid_mark_used(struct sid_pool* pool, sid_t sid)
+{
+	size_t word = sid / SID_WORD_BITS;
+
+	pool->free_bits[word] &= ~((uint64_t) 1 << (sid % SID_WORD_BITS));
+	if (!pool->free_bits[word])
+		pool->free_words[word / SID_WORD_BITS] &= ~((uint64_t) 1 << (word % SID_WORD_BITS));
+}
+
+static sid_t sid_find_free(struct sid_pool* pool)
+{
+	size_t word;
+
+	for (; pool->hint < pool->words; pool->hint++)
+	{
+		if (pool->free_words[pool->hint])
+		{
+			word = pool->hint * SID_WORD_BITS + sid_ctz(pool->free_words[pool->hint]);
+			return (sid_t) (word * SID_WORD_BITS + sid_ctz(pool->free_bits[word]));
+		}
+	}
+	return 0;
+}
+
+static sid_t sid_delayed_pop(struct sid_pool* pool)
+{
+	sid_t sid = pool->delayed[pool->delayed_first].sid;
+	pool->delayed_first = (pool->delayed_first + 1) % pool->delayed_max;
+	pool->delayed_count--;
+	return sid;
+}
+
+static int sid_delayed_push(struct sid_pool* pool, sid_t sid, time_t now)
+{
+	struct sid_delayed* delayed;
+	size_t max;
+	size_t n;
+
+	if (pool->delayed_count == pool->delayed_max)
+	{
+		max = pool->delayed_max ? pool->delayed_max * 2 : 64;
+		delayed = hub_malloc(max * sizeof(struct sid_delayed));
+		if (!delayed)
+			return -1;
+
+		for (n = 0; n < pool->delayed_count; n++)
+			delayed[n] = pool->delayed[(pool->delayed_first + n) % pool->delayed_max];
+
+		hub_free(pool->delayed);
+		pool->delayed = delayed;
+		pool->delayed_first = 0;
+		pool->delayed_max = max;
+	}
+
+	n = (pool->delayed_first + pool->delayed_count) % pool->delayed_max;
+	pool->delayed[n].sid = sid;
+	pool->delayed[n].freed = now;
+	pool->delayed_count++;
+	return 0;
+}
+
+static void sid_delayed_release(struct sid_pool* pool)
+{
+	time_t now;
+
+	if (!pool->delayed_count)
+		return;
+
+	now = net_get_time();
+	while (pool->delayed_count && pool->delayed[pool->delayed_first].freed + pool->reuse_delay <= now)
+		sid_mark_free(pool, sid_delayed_pop(pool));
+}
 
 struct sid_pool* sid_pool_create(sid_t max)
 {
-	struct sid_pool* pool = hub_malloc(sizeof(struct sid_pool));
+	return sid_pool_create_range(0, max);
+}
+
+struct sid_pool* sid_pool_create_range(sid_t base, sid_t max)
+{
+	struct sid_pool* pool = hub_malloc_zero(sizeof(struct sid_pool));
+	size_t bit_words;
+	sid_t sid;
+
 	if (!pool)
 		return 0;
 
+	pool->base = base;
 	pool->min = 1;
 	pool->max = max + 1;
 	pool->count = 0;
-	pool->map = hub_calloc(pool->max, sizeof(struct hub_user*));
-	if (!pool->map)
+
+	bit_words = (pool->max + SID_WORD_BITS - 1) / SID_WORD_BITS;
+	pool->words = (bit_words + SID_WORD_BITS - 1) / SID_WORD_BITS;
+	pool->free_bits = hub_malloc_zero(bit_words * sizeof(uint64_t));
+	pool->free_words = hub_malloc_zero(pool->words * sizeof(uint64_t));
+	pool->map = ptr_table_create(pool->max);
+	if (!pool->free_bits || !pool->free_words || !pool->map || ptr_table_set(pool->map, 0, pool) == -1) /* hack to reserve the first sid. */
 	{
-		hub_free(pool);
+		sid_pool_destroy(pool);
 		return 0;
 	}
-	pool->map[0] = (struct hub_user*) pool; /* hack to reserve the first sid. */
+
+	for (sid = pool->min; sid < pool->max; sid++)
+		sid_mark_free(pool, sid);
 
 #ifdef DEBUG_SID
 	LOG_DUMP("SID_POOL:  max=%d", (int) pool->max);
@@ -129,10 +258,23 @@ void sid_pool_destroy(struct sid_pool* pool)
 #ifdef DEBUG_SID
 	LOG_DUMP("SID_POOL:  destroying, current allocs=%d", (int) pool->count);
 #endif
-	hub_free(pool->map);
+	ptr_table_destroy(pool->map);
+	hub_free(pool->free_bits);
+	hub_free(pool->free_words);
+	hub_free(pool->delayed);
 	hub_free(pool);
 }
 
+void sid_pool_set_reuse_delay(struct sid_pool* pool, time_t seconds)
+{
+	pool->reuse_delay = seconds;
+	if (!seconds)
+	{
+		while (pool->delayed_count)
+			sid_mark_free(pool, sid_delayed_pop(pool));
+	}
+}
+
 sid_t sid_alloc(struct sid_pool* pool, struct hub_user* user)
 {
 	sid_t n;
@@ -144,14 +286,45 @@ sid_t sid_alloc(struct sid_pool* pool, struct hub_user* user)
 		return 0;
 	}
 
-	n = (++pool->count);
-	for (; (pool->map[n % pool->max]); n++) ;
+	sid_delayed_release(pool);
+
+	n = sid_find_free(pool);
+	if (n)
+		sid_mark_used(pool, n);
+	else if (pool->delayed_count)
+		n = sid_delayed_pop(pool);
+	else
+		return 0;
+
+	if (ptr_table_set(pool->map, n, user) == -1)
+	{
+		sid_mark_free(pool, n);
+		return 0;
+	}
+	pool->count++;
 
 #ifdef DEBUG_SID
-	LOG_DUMP("SID_ALLOC: %d, user=%p", (int) n, user);
+	LOG_DUMP("SID_ALLOC: %d, user=%p", (int) (pool->base + n), user);
 #endif
-	pool->map[n] = user;
-	return n;
+	return pool->base + n;
+}
+
+sid_t sid_claim(struct sid_pool* pool, sid_t sid, struct hub_user* user)
+{
+	if (sid < pool->base + pool->min || sid >= pool->base + pool->max)
+		return 0;
+
+	sid -= pool->base;
+
+	if (!(pool->free_bits[sid / SID_WORD_BITS] & ((uint64_t) 1 << (sid % SID_WORD_BITS))))
+		return 0;
+
+	if (ptr_table_set(pool->map, sid, user) == -1)
+		return 0;
+
+	sid_mark_used(pool, sid);
+	pool->count++;
+	return pool->base + sid;
 }
 
 void sid_free(struct sid_pool* pool, sid_t sid)
@@ -159,13 +332,20 @@ void sid_free(struct sid_pool* pool, sid_t sid)
 #ifdef DEBUG_SID
 	LOG_DUMP("SID_FREE:  %d", (int) sid);
 #endif
-	pool->map[sid] = 0;
+	if (sid <= pool->base || sid >= pool->base + pool->max)
+		return;
+
+	sid -= pool->base;
+	ptr_table_set(pool->map, sid, 0);
 	pool->count--;
+
+	if (!pool->reuse_delay || sid_delayed_push(pool, sid, net_get_time()) == -1)
+		sid_mark_free(pool, sid);
 }
 
 struct hub_user* sid_lookup(struct sid_pool* pool, sid_t sid)
 {
-	if (!sid || (sid >= pool->max))
+	if (sid <= pool->base || sid >= pool->base + pool->max)
 		return 0;
-	return pool->map[sid];
+	return (struct hub_user*) ptr_table_get(pool->map, sid - pool->base);
 }
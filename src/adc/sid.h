@@ -29,9 +29,28 @@ extern char* sid_to_string(sid_t sid_);
 extern sid_t string_to_sid(const char* sid);
 
 extern struct sid_pool* sid_pool_create(sid_t max);
+
+/**
+ * Create a pool handing out the session IDs base+1 to base+max, so
+ * several hubs can share one session ID space (see link.h).
+ */
+extern struct sid_pool* sid_pool_create_range(sid_t base, sid_t max);
 extern void sid_pool_destroy(struct sid_pool*);
 
+/**
+ * Do not reuse a freed session ID until 'seconds' have passed,
+ * unless the pool runs out of session IDs. 0 (default) disables the delay.
+ */
+extern void sid_pool_set_reuse_delay(struct sid_pool*, time_t seconds);
+
 extern sid_t sid_alloc(struct sid_pool*, struct hub_user*);
+
+/**
+ * Allocate a specific session ID, for users carried over from a
+ * previous process (see hub_upgrade_restore).
+ * @return the session ID, or 0 if it is out of range or not free.
+ */
+extern sid_t sid_claim(struct sid_pool*, sid_t sid, struct hub_user*);
 extern void sid_free(struct sid_pool*, sid_t);
 extern struct hub_user* sid_lookup(struct sid_pool*, sid_t);
 
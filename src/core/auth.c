@@ -23,11 +23,67 @@
 #define ACL_ADD_BOOL(S, L)    do { ret = check_cmd_bool(S,    L, line, line_count); if (ret != 0) return ret; } while(0)
 #define ACL_ADD_ADDR(S, L)    do { ret = check_cmd_addr(S,    L, line, line_count); if (ret != 0) return ret; } while(0)
 
-static int check_cmd_bool(const char* cmd, struct linked_list* list, char* line, int line_count)
+/*
+ * Nicknames and CIDs are indexed in trees (ordered case insensitive).
+ * The value owns the memory the key points to.
+ */
+static int acl_map_compare(const void* a, const void* b)
+{
+	return strcasecmp((const char*) a, (const char*) b);
+}
+
+static void acl_map_free_value(struct rb_node* node)
+{
+	hub_free((void*) node->value);
+}
+
+static void acl_map_destroy(struct rb_tree* tree, rb_tree_free_node free_node)
+{
+	if (!tree)
+		return;
+
+	while (tree->root)
+		rb_tree_remove_node(tree, tree->root->key, free_node);
+	rb_tree_destroy(tree);
+}
+
+static int acl_map_add_string(struct rb_tree* tree, const char* str)
 {
 	char* data;
 
-	if (!strcmp(line, cmd))
+	if (rb_tree_get(tree, str))
+		return 0;
+
+	data = hub_strdup(str);
+	if (!data)
+	{
+		LOG_ERROR("ACL error: Out of memory!");
+		return -1;
+	}
+
+	if (!rb_tree_insert(tree, data, data))
+	{
+		LOG_ERROR("ACL error: Unable to add '%s'", data);
+		hub_free(data);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * Returns 1 if the line starts with the command followed by white space.
+ */
+static int match_cmd(const char* cmd, const char* line)
+{
+	size_t len = strlen(cmd);
+	return !strncmp(line, cmd, len) && (line[len] == ' ' || line[len] == '\t');
+}
+
+static int check_cmd_bool(const char* cmd, struct rb_tree* tree, char* line, int line_count)
+{
+	char* data;
+
+	if (match_cmd(cmd, line))
 	{
 		data = &line[strlen(cmd)];
 		data[0] = '\0';
@@ -40,20 +96,21 @@ static int check_cmd_bool(const char* cmd, struct linked_list* list, char* line,
 			return -1;
 		}
 
-		list_append(list, hub_strdup(data));
+		if (acl_map_add_string(tree, data) == -1)
+			return -1;
 		LOG_DEBUG("ACL: Deny access for: '%s' (%s)", data, cmd);
 		return 1;
 	}
 	return 0;
 }
 
-static int check_cmd_user(const char* cmd, int status, struct linked_list* list, char* line, int line_count)
+static int check_cmd_user(const char* cmd, int status, struct rb_tree* tree, char* line, int line_count)
 {
 	char* data;
 	char* data_extra;
 	struct auth_info* info = 0;
 
-	if (!strcmp(line, cmd))
+	if (match_cmd(cmd, line))
 	{
 		data = &line[strlen(cmd)];
 		data_extra = 0;
@@ -89,7 +146,12 @@ static int check_cmd_user(const char* cmd, int status, struct linked_list* list,
 		if (data_extra)
 			strlcpy(info->password, data_extra, MAX_PASS_LEN + 1);
 		info->credentials = status;
-		list_append(list, info);
+		if (!rb_tree_insert(tree, info->nickname, info))
+		{
+			LOG_WARN("ACL: Ignoring duplicate user '%s' on line %d", info->nickname, line_count);
+			hub_free(info);
+			return 1;
+		}
 		LOG_DEBUG("ACL: Added user '%s' (%s)", info->nickname, auth_cred_to_string(info->credentials));
 		return 1;
 	}
@@ -97,7 +159,7 @@ static int check_cmd_user(const char* cmd, int status, struct linked_list* list,
 }
 
 
-static void add_ip_range(struct linked_list* list, struct ip_range* info)
+static int add_ip_range(struct ip_trie* trie, struct ip_range* info)
 {
 	char buf1[INET6_ADDRSTRLEN+1];
 	char buf2[INET6_ADDRSTRLEN+1];
@@ -112,18 +174,24 @@ static void add_ip_range(struct linked_list* list, struct ip_range* info)
 		net_address_to_string(AF_INET6, &info->lo.internal_ip_data.in6, buf1, INET6_ADDRSTRLEN);
 		net_address_to_string(AF_INET6, &info->hi.internal_ip_data.in6, buf2, INET6_ADDRSTRLEN);
 	}
-	LOG_DEBUG("ACL: Added ip range: %s-%s", buf1, buf2);
 
-	list_append(list, info);
+	if (ip_trie_insert_range(trie, info, NULL) == -1)
+	{
+		LOG_ERROR("ACL: Unable to add ip range: %s-%s", buf1, buf2);
+		return -1;
+	}
+
+	LOG_DEBUG("ACL: Added ip range: %s-%s", buf1, buf2);
+	return 0;
 }
 
 
-static int check_cmd_addr(const char* cmd, struct linked_list* list, char* line, int line_count)
+static int check_cmd_addr(const char* cmd, struct ip_trie* trie, char* line, int line_count)
 {
 	char* data;
-	struct ip_range* range = 0;
+	struct ip_range range;
 
-	if (!strcmp(line, cmd))
+	if (match_cmd(cmd, line))
 	{
 		data = &line[strlen(cmd)];
 		data[0] = '\0';
@@ -136,20 +204,13 @@ static int check_cmd_addr(const char* cmd, struct linked_list* list, char* line,
 			return -1;
 		}
 
-		range = hub_malloc_zero(sizeof(struct ip_range));
-
-		if (!range)
-		{
-			LOG_ERROR("ACL parse error. Out of memory!");
-			return -1;
-		}
-
-		if (ip_convert_address_to_range(data, range))
+		memset(&range, 0, sizeof(range));
+		if (ip_convert_address_to_range(data, &range))
 		{
-			add_ip_range(list, range);
+			if (add_ip_range(trie, &range) == -1)
+				return -1;
 			return 1;
 		}
-		hub_free(range);
 	}
 	return 0;
 }
@@ -194,23 +255,24 @@ int acl_initialize(struct hub_config* config, struct acl_handle* handle)
 	int ret;
 	memset(handle, 0, sizeof(struct acl_handle));
 
-	handle->users        = list_create();
-	handle->users_denied = list_create();
-	handle->users_banned = list_create();
-	handle->cids         = list_create();
-	handle->networks     = list_create();
-	handle->nat_override = list_create();
+	handle->users        = rb_tree_create(acl_map_compare, NULL, NULL);
+	handle->users_denied = rb_tree_create(acl_map_compare, NULL, NULL);
+	handle->users_banned = rb_tree_create(acl_map_compare, NULL, NULL);
+	handle->cids         = rb_tree_create(acl_map_compare, NULL, NULL);
+	handle->networks     = ip_trie_create();
+	handle->nat_override = ip_trie_create();
 
 	if (!handle->users || !handle->cids || !handle->networks || !handle->users_denied || !handle->users_banned || !handle->nat_override)
 	{
 		LOG_FATAL("acl_initialize: Out of memory");
 
-		list_destroy(handle->users);
-		list_destroy(handle->users_denied);
-		list_destroy(handle->users_banned);
-		list_destroy(handle->cids);
-		list_destroy(handle->networks);
-		list_destroy(handle->nat_override);
+		acl_map_destroy(handle->users, NULL);
+		acl_map_destroy(handle->users_denied, NULL);
+		acl_map_destroy(handle->users_banned, NULL);
+		acl_map_destroy(handle->cids, NULL);
+		ip_trie_destroy(handle->networks);
+		ip_trie_destroy(handle->nat_override);
+		memset(handle, 0, sizeof(struct acl_handle));
 		return -1;
 	}
 
@@ -226,167 +288,284 @@ int acl_initialize(struct hub_config* config, struct acl_handle* handle)
 }
 
 
-static void acl_free_access_info(void* ptr)
+int acl_shutdown(struct acl_handle* handle)
 {
-	struct auth_info* info = (struct auth_info*) ptr;
-	hub_free(info);
-}
-
+	acl_map_destroy(handle->users, &acl_map_free_value);
+	acl_map_destroy(handle->users_denied, &acl_map_free_value);
+	acl_map_destroy(handle->users_banned, &acl_map_free_value);
+	acl_map_destroy(handle->cids, &acl_map_free_value);
+	ip_trie_destroy(handle->networks);
+	ip_trie_destroy(handle->nat_override);
 
-static void acl_free_ip_info(void* ptr)
-{
-	hub_free(ptr);
+	memset(handle, 0, sizeof(struct acl_handle));
+	return 0;
 }
 
-int acl_shutdown(struct acl_handle* handle)
+struct auth_info* acl_get_access_info(struct hub_info* hub, const char* name)
 {
-	if (handle->users)
+	struct auth_info* info = (struct auth_info*) hub_malloc(sizeof(struct auth_info));
+	if (!info)
+		return NULL;
+
+	if (plugin_auth_get_user(hub, name, info) != st_allow)
 	{
-		list_clear(handle->users, &acl_free_access_info);
-		list_destroy(handle->users);
+		hub_free(info);
+		return NULL;
 	}
+	return info;
+}
+
+struct auth_request
+{
+	struct hub_info* hub;
+	struct hub_user* user;          /* NULL if the user left before the lookup completed */
+	struct plugin_handle* plugin;   /* Plugin handling the lookup */
+	plugin_st status;
+	int restart;                    /* The plugin was unloaded, start over with the current plugins */
+	struct auth_info info;
+};
+
+// NOTE: The completed list is filled in by plugin threads,
+// and must only be accessed with the mutex locked!
+struct auth_request_queue
+{
+	struct hub_info* hub;
+	struct linked_list* pending;    /* All requests not yet freed, only accessed by the event loop */
+	struct linked_list* completed;
+	uhub_mutex_t mutex;
+	struct uhub_notify_handle* notify_handle; // used to signal back to the event loop that there is something to process.
+};
+
+/*
+ * Continue the login for a user once a plugin has completed a lookup.
+ * Returns 1 if the request was handed on to another plugin, and must not be freed.
+ */
+static int acl_request_resume(struct auth_request* request)
+{
+	struct hub_user* user = request->user;
+	plugin_st status = request->status;
+
+	if (!user)
+		return 0;
+
+	user->auth_request = NULL;
 
-	if (handle->users_denied)
+	if (request->restart)
 	{
-		list_clear(handle->users_denied, &hub_free);
-		list_destroy(handle->users_denied);
+		request->restart = 0;
+		status = st_default;
 	}
 
-	if (handle->users_banned)
+	if (status == st_default)
 	{
-		list_clear(handle->users_banned, &hub_free);
-		list_destroy(handle->users_banned);
+		/* The plugin did not know the user, ask the remaining ones. */
+		status = plugin_auth_get_user_async(request->hub, (struct plugin_auth_request*) request, user->id.nick, &request->info, &request->plugin);
+		if (status == st_pending)
+		{
+			user->auth_request = request;
+			return 1;
+		}
 	}
 
+	hub_handle_info_login_resume(request->hub, user, status == st_allow ? &request->info : NULL);
+	return 0;
+}
 
-	if (handle->cids)
+static void acl_request_process(struct uhub_notify_handle* handle, void* ptr)
+{
+	struct auth_request_queue* queue = (struct auth_request_queue*) ptr;
+	struct linked_list* completed = list_create();
+	struct auth_request* request;
+
+	if (!completed)
+		return;
+
+	uhub_mutex_lock(&queue->mutex);
+	list_append_list(completed, queue->completed);
+	uhub_mutex_unlock(&queue->mutex);
+
+	while ((request = (struct auth_request*) list_get_first(completed)))
 	{
-		list_clear(handle->cids, &hub_free);
-		list_destroy(handle->cids);
+		list_remove_first(completed, NULL);
+		if (!acl_request_resume(request))
+		{
+			list_remove(queue->pending, request);
+			hub_free(request);
+		}
 	}
+	list_destroy(completed);
+}
+
+struct auth_request_queue* acl_request_queue_create(struct hub_info* hub)
+{
+	struct auth_request_queue* queue = (struct auth_request_queue*) hub_malloc_zero(sizeof(struct auth_request_queue));
+	if (!queue)
+		return NULL;
 
-	if (handle->networks)
+	queue->hub = hub;
+	queue->pending = list_create();
+	queue->completed = list_create();
+	queue->notify_handle = net_notify_create(acl_request_process, queue);
+	if (!queue->pending || !queue->completed || !queue->notify_handle)
 	{
-		list_clear(handle->networks, &acl_free_ip_info);
-		list_destroy(handle->networks);
+		list_destroy(queue->pending);
+		list_destroy(queue->completed);
+		if (queue->notify_handle)
+			net_notify_destroy(queue->notify_handle);
+		hub_free(queue);
+		return NULL;
 	}
+	uhub_mutex_init(&queue->mutex);
+	return queue;
+}
+
+void acl_request_queue_destroy(struct auth_request_queue* queue)
+{
+	if (!queue)
+		return;
+
+	/* Plugins are unloaded at this point, nothing can be added anymore. */
+	list_clear(queue->completed, NULL);
+	list_destroy(queue->completed);
+	list_clear(queue->pending, &hub_free);
+	list_destroy(queue->pending);
+	net_notify_destroy(queue->notify_handle);
+	uhub_mutex_destroy(&queue->mutex);
+	hub_free(queue);
+}
+
+enum acl_access_status acl_request_access_info(struct hub_info* hub, struct hub_user* user, struct auth_info* info)
+{
+	struct auth_request* request;
+	plugin_st status;
 
-	if (handle->nat_override)
+	if (!hub->auth_requests)
+		return plugin_auth_get_user(hub, user->id.nick, info) == st_allow ? acl_access_found : acl_access_unknown;
+
+	request = (struct auth_request*) hub_malloc_zero(sizeof(struct auth_request));
+	if (!request)
+		return acl_access_unknown;
+
+	request->hub = hub;
+	request->user = user;
+
+	status = plugin_auth_get_user_async(hub, (struct plugin_auth_request*) request, user->id.nick, info, &request->plugin);
+	if (status == st_pending)
 	{
-		list_clear(handle->nat_override, &acl_free_ip_info);
-		list_destroy(handle->nat_override);
+		user->auth_request = request;
+		list_append(hub->auth_requests->pending, request);
+		return acl_access_pending;
 	}
 
-	memset(handle, 0, sizeof(struct acl_handle));
-	return 0;
+	hub_free(request);
+	return status == st_allow ? acl_access_found : acl_access_unknown;
 }
 
-struct auth_info* acl_get_access_info(struct hub_info* hub, const char* name)
+void acl_request_complete(struct auth_request* request, int status, struct auth_info* info)
 {
-	struct auth_info* info = (struct auth_info*) hub_malloc(sizeof(struct auth_info));
-	if (!info)
-		return NULL;
+	struct auth_request_queue* queue = request->hub->auth_requests;
 
-	if (plugin_auth_get_user(hub, name, info) != st_allow)
+	request->status = (plugin_st) status;
+	if (status == st_allow && info)
+		memcpy(&request->info, info, sizeof(struct auth_info));
+
+	uhub_mutex_lock(&queue->mutex);
+	list_append(queue->completed, request);
+	net_notify_signal(queue->notify_handle, 1);
+	uhub_mutex_unlock(&queue->mutex);
+}
+
+void acl_request_cancel(struct hub_user* user)
+{
+	if (user->auth_request)
 	{
-		hub_free(info);
-		return NULL;
+		user->auth_request->user = NULL;
+		user->auth_request = NULL;
 	}
-	return info;
 }
 
-#define STR_LIST_CONTAINS(LIST, STR) \
-		LIST_FOREACH(char*, str, LIST, \
-		{ \
-			if (strcasecmp(str, STR) == 0) \
-				return 1; \
-		}); \
-		return 0
+void acl_request_plugin_unload(struct hub_info* hub, struct plugin_handle* plugin)
+{
+	struct auth_request* request;
+
+	if (!hub || !hub->auth_requests)
+		return;
+
+	LIST_FOREACH(struct auth_request*, request, hub->auth_requests->pending,
+	{
+		if (request->plugin == plugin)
+		{
+			request->plugin = NULL;
+			request->restart = 1;
+		}
+	});
+}
+
+size_t acl_request_pending_count(struct hub_info* hub)
+{
+	return hub->auth_requests ? list_size(hub->auth_requests->pending) : 0;
+}
 
 int acl_is_cid_banned(struct acl_handle* handle, const char* data)
 {
-	char* str;
 	if (!handle) return 0;
-	STR_LIST_CONTAINS(handle->cids, data);
+	return rb_tree_get(handle->cids, data) != NULL;
 }
 
 int acl_is_user_banned(struct acl_handle* handle, const char* data)
 {
-	char* str;
 	if (!handle) return 0;
-	STR_LIST_CONTAINS(handle->users_banned, data);
+	return rb_tree_get(handle->users_banned, data) != NULL;
 }
 
 int acl_is_user_denied(struct acl_handle* handle, const char* data)
 {
-	char* str;
 	if (!handle) return 0;
-	STR_LIST_CONTAINS(handle->users_denied, data);
+	return rb_tree_get(handle->users_denied, data) != NULL;
 }
 
 int acl_user_ban_nick(struct acl_handle* handle, const char* nick)
 {
-	char* data = hub_strdup(nick);
-	if (!data)
-	{
-		LOG_ERROR("ACL error: Out of memory!");
-		return -1;
-	}
-
-	list_append(handle->users_banned, data);
-	return 0;
+	return acl_map_add_string(handle->users_banned, nick);
 }
 
 int acl_user_ban_cid(struct acl_handle* handle, const char* cid)
 {
-	char* data = hub_strdup(cid);
-	if (!data)
-	{
-		LOG_ERROR("ACL error: Out of memory!");
-		return -1;
-	}
-
-	list_append(handle->cids, data);
-	return 0;
+	return acl_map_add_string(handle->cids, cid);
 }
 
 int acl_user_unban_nick(struct acl_handle* handle, const char* nick)
 {
-	return -1;
+	return rb_tree_remove_node(handle->users_banned, nick, &acl_map_free_value) ? 0 : -1;
 }
 
 int acl_user_unban_cid(struct acl_handle* handle, const char* cid)
 {
-	return -1;
+	return rb_tree_remove_node(handle->cids, cid, &acl_map_free_value) ? 0 : -1;
 }
 
 
 int acl_is_ip_banned(struct acl_handle* handle, const char* ip_address)
 {
 	struct ip_addr_encap raw;
-	struct ip_range* info;
 
-	ip_convert_to_binary(ip_address, &raw);
-	LIST_FOREACH(struct ip_range*, info, handle->networks,
-	{
-		if (ip_in_range(&raw, info))
-			return 1;
-	});
-	return 0;
+	if (ip_convert_to_binary(ip_address, &raw) == -1)
+		return 0;
+	return acl_is_addr_banned(handle, &raw);
+}
+
+int acl_is_addr_banned(struct acl_handle* handle, struct ip_addr_encap* addr)
+{
+	return ip_trie_lookup(handle->networks, addr, NULL);
 }
 
 int acl_is_ip_nat_override(struct acl_handle* handle, const char* ip_address)
 {
 	struct ip_addr_encap raw;
-	struct ip_range* info;
 
-	ip_convert_to_binary(ip_address, &raw);
-	LIST_FOREACH(struct ip_range*, info, handle->nat_override,
-	{
-		if (ip_in_range(&raw, info))
-			return 1;
-	});
-	return 0;
+	if (ip_convert_to_binary(ip_address, &raw) == -1)
+		return 0;
+	return ip_trie_lookup(handle->nat_override, &raw, NULL);
 }
 
 
@@ -412,39 +591,48 @@ const char* acl_password_generate_challenge(struct hub_info* hub, struct hub_use
 }
 
 
-int acl_password_verify(struct hub_info* hub, struct hub_user* user, const char* password)
+int acl_password_hash(const char* password, const char* challenge, char* password_calc)
 {
 	char buf[1024];
-	struct auth_info* access;
-	const char* challenge;
 	char raw_challenge[64];
-	char password_calc[64];
 	uint64_t tiger_res[3];
-	size_t password_len;
+	size_t password_len = strlen(password);
 
-	if (!password || !user || strlen(password) != MAX_CID_LEN)
+	if (!challenge || strlen(challenge) != MAX_CID_LEN || password_len > sizeof(buf) - TIGERSIZE)
 		return 0;
 
-	access = acl_get_access_info(hub, user->id.nick);
-	if (!access)
-		return 0;
-
-	challenge = acl_password_generate_challenge(hub, user);
-
 	base32_decode(challenge, (unsigned char*) raw_challenge, MAX_CID_LEN);
 
-	password_len = strlen(access->password);
-
-	memcpy(&buf[0], access->password, password_len);
+	memcpy(&buf[0], password, password_len);
 	memcpy(&buf[password_len], raw_challenge, TIGERSIZE);
 
 	tiger((uint64_t*) buf, TIGERSIZE+password_len, (uint64_t*) tiger_res);
 	base32_encode((unsigned char*) tiger_res, TIGERSIZE, password_calc);
 	password_calc[MAX_CID_LEN] = 0;
+	return 1;
+}
+
+int acl_password_verify(struct hub_info* hub, struct hub_user* user, const char* password)
+{
+	struct auth_info* access;
+	char password_calc[MAX_CID_LEN+1];
+	int ok;
+
+	if (!password || !user || strlen(password) != MAX_CID_LEN)
+		return 0;
+
+	/* Use the info looked up at login if available, otherwise ask the plugins again. */
+	access = user->auth_info;
+	user->auth_info = NULL;
+	if (!access)
+		access = acl_get_access_info(hub, user->id.nick);
+	if (!access)
+		return 0;
 
+	ok = acl_password_hash(access->password, acl_password_generate_challenge(hub, user), password_calc);
 	hub_free(access);
 
-	if (strcasecmp(password, password_calc) == 0)
+	if (ok && strcasecmp(password, password_calc) == 0)
 	{
 		return 1;
 	}
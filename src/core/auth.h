@@ -24,15 +24,21 @@ struct hub_config;
 struct hub_info;
 struct hub_user;
 struct ip_addr_encap;
+struct ip_trie;
+struct rb_tree;
+struct auth_info;
+struct auth_request;
+struct auth_request_queue;
+struct plugin_handle;
 
 struct acl_handle
 {
-	struct linked_list* users;          /* Known users. See enum user_status */
-	struct linked_list* cids;           /* Known CIDs */
-	struct linked_list* networks;       /* IP ranges, used for banning */
-	struct linked_list* nat_override;   /* IPs inside these ranges can provide their false IP. Use with care! */
-	struct linked_list* users_banned;   /* Users permanently banned */
-	struct linked_list* users_denied;   /* bad nickname */
+	struct rb_tree* users;              /* Known users (nickname -> struct auth_info). See enum user_status */
+	struct rb_tree* cids;               /* Banned CIDs */
+	struct ip_trie* networks;           /* IP ranges, used for banning */
+	struct ip_trie* nat_override;       /* IPs inside these ranges can provide their false IP. Use with care! */
+	struct rb_tree* users_banned;       /* Users permanently banned */
+	struct rb_tree* users_denied;       /* bad nickname */
 };
 
 
@@ -41,9 +47,53 @@ extern int acl_shutdown(struct acl_handle* handle);
 
 extern struct auth_info* acl_get_access_info(struct hub_info* hub, const char* name);
 
+enum acl_access_status
+{
+	acl_access_unknown = 0, /* User is not registered */
+	acl_access_found = 1,   /* User is registered */
+	acl_access_pending = 2, /* Lookup is in progress */
+};
+
+/**
+ * Look up the access info for a user that is logging in.
+ * Plugins may perform the lookup asynchronously, in which case
+ * hub_handle_info_login_resume() is called from the event loop
+ * once the result is available.
+ *
+ * @return see enum acl_access_status, info is only set if acl_access_found.
+ */
+extern enum acl_access_status acl_request_access_info(struct hub_info* hub, struct hub_user* user, struct auth_info* info);
+
+/**
+ * Complete a pending access info lookup.
+ * This is safe to call from any thread.
+ */
+extern void acl_request_complete(struct auth_request* request, int status, struct auth_info* info);
+
+/**
+ * Detach a pending access info lookup from a user that is going away.
+ */
+extern void acl_request_cancel(struct hub_user* user);
+
+/**
+ * Forget a plugin that is being unloaded (see plugin_unload()).
+ * Requests it handled are looked up again from the first plugin
+ * once they are completed, instead of falling through to a guest login.
+ */
+extern void acl_request_plugin_unload(struct hub_info* hub, struct plugin_handle* plugin);
+
+/**
+ * @return the number of lookups that are pending, or not yet processed.
+ */
+extern size_t acl_request_pending_count(struct hub_info* hub);
+
+extern struct auth_request_queue* acl_request_queue_create(struct hub_info* hub);
+extern void acl_request_queue_destroy(struct auth_request_queue* queue);
+
 
 extern int acl_is_cid_banned(struct acl_handle* handle, const char* cid);
 extern int acl_is_ip_banned(struct acl_handle* handle, const char* ip_address);
+extern int acl_is_addr_banned(struct acl_handle* handle, struct ip_addr_encap* addr);
 extern int acl_is_ip_nat_override(struct acl_handle* handle, const char* ip_address);
 
 extern int acl_is_user_banned(struct acl_handle* handle, const char* name);
@@ -54,6 +104,14 @@ extern int acl_user_ban_cid(struct acl_handle* handle, const char* cid);
 extern int acl_user_unban_nick(struct acl_handle* handle, const char* nick);
 extern int acl_user_unban_cid(struct acl_handle* handle, const char* cid);
 
+/**
+ * Hash a password with a challenge (IGPA), giving the answer (HPAS).
+ *
+ * @param password_calc at least MAX_CID_LEN+1 bytes, set to the answer.
+ * @return 1 on success, or 0 if the challenge or the password is invalid.
+ */
+extern int acl_password_hash(const char* password, const char* challenge, char* password_calc);
+
 /**
  * Verify a password.
  *
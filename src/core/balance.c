@@ -0,0 +1,467 @@
+/*
+ * uhub - A tiny ADC p2p connection hub
+ * Copyright (C) 2007-2014, Jan Vidar Krey
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "uhub.h"
+
+/* Reports older than this (in seconds) are ignored */
+#define BALANCE_REPORT_EXPIRE 5
+
+/* Load in per mille of capacity, a hub at or above this is overloaded */
+#define BALANCE_LOAD_FULL 1000
+
+/* Reported values are capped to this, so that they can be scaled to per mille */
+#define BALANCE_VALUE_MAX (0xffffffffu / BALANCE_LOAD_FULL)
+
+struct balance_load
+{
+	unsigned int users;
+	unsigned int max_users;
+	unsigned int latency;                    /** Longest time between two polls, in milliseconds */
+	unsigned int congested;                  /** Users with more than max_send_buffer_soft queued */
+};
+
+struct balance_peer
+{
+	struct sockaddr_storage addr;
+	socklen_t addr_len;
+	char* name;                              /** IP address:port, as given in balance_peers */
+	char address[256];                       /** Where users are redirected to, empty if none */
+	struct balance_load load;
+	time_t received;                         /** When the last report arrived, 0 if never */
+};
+
+struct balance_manager
+{
+	struct net_connection* con;
+	int af;                                  /** Address family of the socket */
+	struct linked_list* peers;
+	struct balance_load load;                /** The load of this hub, as last reported */
+	size_t redirects;                        /** Users redirected to another hub */
+	struct timeout_evt* timeout;
+};
+
+/*
+ * The load in per mille of the capacity: the largest of the share of
+ * max_users in use, the loop latency compared to balance_max_latency,
+ * and the share of users with congested send queues.
+ */
+static unsigned int balance_get_load(struct hub_info* hub, const struct balance_load* load)
+{
+	unsigned int users = MIN(load->users, BALANCE_VALUE_MAX);
+	unsigned int latency = MIN(load->latency, BALANCE_VALUE_MAX);
+	unsigned int congested = MIN(load->congested, BALANCE_VALUE_MAX);
+	unsigned int result = 0;
+
+	if (load->max_users)
+		result = MAX(result, users * BALANCE_LOAD_FULL / load->max_users);
+
+	if (hub->config->balance_max_latency > 0)
+		result = MAX(result, latency * BALANCE_LOAD_FULL / (unsigned int) hub->config->balance_max_latency);
+
+	if (users)
+		result = MAX(result, congested * BALANCE_LOAD_FULL / users);
+
+	return result;
+}
+
+/* The load of this hub, with the users that logged in since the last report */
+static unsigned int balance_get_local_load(struct hub_info* hub)
+{
+	struct balance_load load = hub->balance->load;
+	load.users = (unsigned int) hub->users->count;
+	return balance_get_load(hub, &load);
+}
+
+static void balance_measure(struct hub_info* hub)
+{
+	struct balance_load* load = &hub->balance->load;
+	struct hub_user* user;
+
+	load->users = (unsigned int) hub->users->count;
+	load->max_users = (unsigned int) MAX(hub->config->max_users, 0);
+	load->latency = (unsigned int) net_backend_get_latency(1);
+	load->congested = 0;
+
+	LIST_FOREACH(struct hub_user*, user, hub->users->list,
+	{
+		if (user->send_queue->size > (size_t) hub->config->max_send_buffer_soft)
+			load->congested++;
+	});
+}
+
+static void balance_send_reports(struct hub_info* hub)
+{
+	struct balance_manager* manager = hub->balance;
+	struct balance_peer* peer;
+	char buf[512];
+	int len;
+	int sd = net_con_get_sd(manager->con);
+
+	len = snprintf(buf, sizeof(buf), "LOAD %u %u %u %u",
+		manager->load.users, manager->load.max_users, manager->load.latency, manager->load.congested);
+	if (len < 0 || (size_t) len >= sizeof(buf))
+		return;
+
+	LIST_FOREACH(struct balance_peer*, peer, manager->peers,
+	{
+		if (net_sendto(sd, buf, (size_t) len, 0, (struct sockaddr*) &peer->addr, peer->addr_len) == -1)
+			LOG_TRACE("Unable to send load report to %s", peer->name);
+	});
+}
+
+static void balance_timer_report(struct timeout_evt* t)
+{
+	struct hub_info* hub = (struct hub_info*) t->ptr;
+	balance_measure(hub);
+	balance_send_reports(hub);
+	timeout_queue_reschedule(net_backend_get_timeout_queue(), hub->balance->timeout, TIMEOUT_BALANCE);
+}
+
+/* Get the IP address (IPv4 as IPv4-mapped IPv6) and port of a socket address */
+static int balance_get_endpoint(const struct sockaddr* addr, uint8_t ip[16], uint16_t* port)
+{
+	if (addr->sa_family == AF_INET6)
+	{
+		const struct sockaddr_in6* addr6 = (const struct sockaddr_in6*) addr;
+		memcpy(ip, &addr6->sin6_addr, 16);
+		*port = addr6->sin6_port;
+		return 0;
+	}
+
+	if (addr->sa_family == AF_INET)
+	{
+		const struct sockaddr_in* addr4 = (const struct sockaddr_in*) addr;
+		memset(ip, 0, 10);
+		ip[10] = 0xff;
+		ip[11] = 0xff;
+		memcpy(ip + 12, &addr4->sin_addr, 4);
+		*port = addr4->sin_port;
+		return 0;
+	}
+	return -1;
+}
+
+static struct balance_peer* balance_get_peer(struct balance_manager* manager, const struct sockaddr* from)
+{
+	struct balance_peer* peer;
+	uint8_t ip[16], peer_ip[16];
+	uint16_t port, peer_port;
+
+	if (balance_get_endpoint(from, ip, &port) == -1)
+		return NULL;
+
+	LIST_FOREACH(struct balance_peer*, peer, manager->peers,
+	{
+		if (balance_get_endpoint((struct sockaddr*) &peer->addr, peer_ip, &peer_port) == 0 && port == peer_port && !memcmp(ip, peer_ip, 16))
+			return peer;
+	});
+	return NULL;
+}
+
+int balance_handle_report(struct hub_info* hub, const struct sockaddr* from, socklen_t from_len, const char* report)
+{
+	struct balance_peer* peer;
+	struct balance_load load;
+
+	if (!hub->balance || !from || !from_len)
+		return -1;
+
+	peer = balance_get_peer(hub->balance, from);
+	if (!peer)
+	{
+		LOG_DEBUG("Ignoring load report from a hub not in balance_peers");
+		return -1;
+	}
+
+	/* Anything after the counters is ignored, the address of the peer is set in balance_peers */
+	if (sscanf(report, "LOAD %u %u %u %u", &load.users, &load.max_users, &load.latency, &load.congested) != 4)
+	{
+		LOG_DEBUG("Ignoring invalid load report from %s", peer->name);
+		return -1;
+	}
+
+	peer->load = load;
+	peer->received = net_get_time();
+	return 0;
+}
+
+static void balance_on_read(struct net_connection* con, int event, void* ptr)
+{
+	struct hub_info* hub = (struct hub_info*) net_con_get_ptr(con);
+	struct sockaddr_storage from;
+	socklen_t from_len;
+	char buf[512];
+	ssize_t len;
+
+	if (!(event & NET_EVENT_READ))
+		return;
+
+	for (;;)
+	{
+		from_len = sizeof(from);
+		len = net_recvfrom(net_con_get_sd(con), buf, sizeof(buf) - 1, 0, (struct sockaddr*) &from, &from_len);
+		if (len < 0)
+			break;
+		buf[len] = '\0';
+		balance_handle_report(hub, (struct sockaddr*) &from, from_len, buf);
+	}
+}
+
+static struct balance_peer* balance_get_target(struct hub_info* hub)
+{
+	struct balance_manager* manager = hub->balance;
+	struct balance_peer* peer;
+	struct balance_peer* best = NULL;
+	unsigned int best_load = balance_get_local_load(hub);
+	unsigned int load;
+	time_t now = net_get_time();
+
+	LIST_FOREACH(struct balance_peer*, peer, manager->peers,
+	{
+		if (!peer->received || now - peer->received > BALANCE_REPORT_EXPIRE || !*peer->address)
+			continue;
+
+		load = balance_get_load(hub, &peer->load);
+		if (load < BALANCE_LOAD_FULL && load < best_load)
+		{
+			best = peer;
+			best_load = load;
+		}
+	});
+	return best;
+}
+
+int balance_should_redirect(struct hub_info* hub)
+{
+	if (!hub->balance || balance_get_local_load(hub) < BALANCE_LOAD_FULL)
+		return 0;
+	return balance_get_target(hub) != NULL;
+}
+
+const char* balance_redirect(struct hub_info* hub)
+{
+	struct balance_peer* peer;
+
+	if (!hub->balance)
+		return NULL;
+
+	peer = balance_get_target(hub);
+	if (!peer)
+		return NULL;
+
+	hub->balance->redirects++;
+	return peer->address;
+}
+
+void balance_format_stats(struct hub_info* hub, struct cbuffer* buf)
+{
+	struct balance_manager* manager = hub->balance;
+	struct balance_peer* peer;
+	time_t now = net_get_time();
+	size_t up = 0;
+
+	if (!manager)
+		return;
+
+	LIST_FOREACH(struct balance_peer*, peer, manager->peers,
+	{
+		if (peer->received && now - peer->received <= BALANCE_REPORT_EXPIRE)
+			up++;
+	});
+
+	cbuf_append_format(buf, "\nLoad: %u/%d (latency=%u ms, congested=%u), redirected=%" PRIsz ", pool=%" PRIsz "/%" PRIsz,
+		balance_get_local_load(hub), BALANCE_LOAD_FULL, manager->load.latency, manager->load.congested,
+		manager->redirects, up, list_size(manager->peers));
+}
+
+static int balance_peer_add(char* line, int count, void* ptr)
+{
+	struct hub_info* hub = (struct hub_info*) ptr;
+	struct balance_manager* manager = hub->balance;
+	struct balance_peer* peer;
+	struct sockaddr_in6* addr6;
+	struct sockaddr_in addr4;
+	char* address = strchr(line, '=');
+	char* port;
+	char* name;
+	int num = 0;
+
+	if (address)
+	{
+		*address++ = '\0';
+		if (!*address || strlen(address) >= sizeof(peer->address))
+		{
+			LOG_ERROR("Invalid balance peer \"%s\", expected IP address:port=address", line);
+			return -1;
+		}
+	}
+
+	port = strrchr(line, ':');
+	name = hub_strdup(line);
+	if (!port || port == line || !is_number(port + 1, &num) || num < 1 || num > 65535)
+	{
+		LOG_ERROR("Invalid balance peer \"%s\", expected IP address:port", line);
+		hub_free(name);
+		return -1;
+	}
+
+	*port = '\0';
+	if (line[0] == '[' && port[-1] == ']')
+	{
+		port[-1] = '\0';
+		line++;
+	}
+
+	peer = hub_malloc_zero(sizeof(struct balance_peer));
+	if (!peer || !name || ip_convert_address(line, num, (struct sockaddr*) &peer->addr, &peer->addr_len) == -1)
+	{
+		LOG_ERROR("Invalid balance peer \"%s\", expected IP address:port", name ? name : line);
+		hub_free(peer);
+		hub_free(name);
+		return -1;
+	}
+	peer->name = name;
+	if (address)
+		strcpy(peer->address, address);
+
+	/* An IPv4 peer is reached through an IPv4-mapped address on a dual stack socket */
+	if (peer->addr.ss_family == AF_INET && manager->af == AF_INET6)
+	{
+		memcpy(&addr4, &peer->addr, sizeof(addr4));
+		memset(&peer->addr, 0, sizeof(peer->addr));
+		addr6 = (struct sockaddr_in6*) &peer->addr;
+		addr6->sin6_family = AF_INET6;
+		addr6->sin6_port = addr4.sin_port;
+		addr6->sin6_addr.s6_addr[10] = 0xff;
+		addr6->sin6_addr.s6_addr[11] = 0xff;
+		memcpy(&addr6->sin6_addr.s6_addr[12], &addr4.sin_addr, 4);
+		peer->addr_len = sizeof(struct sockaddr_in6);
+	}
+	else if (peer->addr.ss_family != manager->af)
+	{
+		LOG_ERROR("Balance peer \"%s\" cannot be reached from server_bind_addr", name);
+		hub_free(name);
+		hub_free(peer);
+		return -1;
+	}
+
+	list_append(manager->peers, peer);
+	return 0;
+}
+
+static void balance_peer_free(void* ptr)
+{
+	struct balance_peer* peer = (struct balance_peer*) ptr;
+	hub_free(peer->name);
+	hub_free(peer);
+}
+
+static int balance_listen(struct hub_info* hub, struct hub_config* config)
+{
+	struct sockaddr_storage addr;
+	socklen_t addr_len;
+	int sd;
+
+	if (ip_convert_address(config->server_bind_addr, config->balance_port, (struct sockaddr*) &addr, &addr_len) == -1)
+		return -1;
+
+	sd = net_socket_create(addr.ss_family, SOCK_DGRAM, IPPROTO_UDP);
+	if (sd == -1)
+		return -1;
+
+	if (net_set_reuseaddress(sd, 1) == -1 || net_set_nonblocking(sd, 1) == -1 || net_bind(sd, (struct sockaddr*) &addr, addr_len) == -1)
+	{
+		LOG_ERROR("Unable to bind to UDP port %d for load reports", config->balance_port);
+		net_close(sd);
+		return -1;
+	}
+
+	hub->balance->af = addr.ss_family;
+	hub->balance->con = net_con_create();
+	if (net_con_initialize(hub->balance->con, sd, balance_on_read, hub, NET_EVENT_READ) == -1)
+	{
+		net_con_destroy(hub->balance->con);
+		hub->balance->con = 0;
+		net_close(sd);
+		return -1;
+	}
+	return 0;
+}
+
+int balance_start(struct hub_info* hub, struct hub_config* config)
+{
+	struct balance_manager* manager;
+
+	if (!config->balance_port)
+		return 0;
+
+	manager = hub_malloc_zero(sizeof(struct balance_manager));
+	if (!manager)
+		return -1;
+
+	hub->balance = manager;
+	manager->peers = list_create();
+	if (!manager->peers || balance_listen(hub, config) == -1)
+	{
+		balance_shutdown(hub);
+		return -1;
+	}
+
+	if (*config->balance_peers && string_split(config->balance_peers, ",", hub, balance_peer_add) == -1)
+	{
+		balance_shutdown(hub);
+		return -1;
+	}
+
+	balance_measure(hub);
+	if (net_backend_get_timeout_queue())
+	{
+		manager->timeout = hub_malloc_zero(sizeof(struct timeout_evt));
+		timeout_evt_initialize(manager->timeout, balance_timer_report, hub);
+		timeout_queue_insert(net_backend_get_timeout_queue(), manager->timeout, TIMEOUT_BALANCE);
+	}
+
+	LOG_INFO("Sending load reports to %d hubs, receiving on UDP port %d", (int) list_size(manager->peers), config->balance_port);
+	return 0;
+}
+
+void balance_shutdown(struct hub_info* hub)
+{
+	struct balance_manager* manager = hub->balance;
+
+	if (!manager)
+		return;
+
+	if (manager->timeout)
+	{
+		timeout_queue_remove(net_backend_get_timeout_queue(), manager->timeout);
+		hub_free(manager->timeout);
+	}
+
+	if (manager->con)
+		net_con_close(manager->con);
+
+	if (manager->peers)
+	{
+		list_clear(manager->peers, balance_peer_free);
+		list_destroy(manager->peers);
+	}
+	hub_free(manager);
+	hub->balance = NULL;
+}
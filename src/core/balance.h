@@ -0,0 +1,74 @@
+/*
+ * uhub - A tiny ADC p2p connection hub
+ * Copyright (C) 2007-2014, Jan Vidar Krey
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef HAVE_UHUB_BALANCE_H
+#define HAVE_UHUB_BALANCE_H
+
+/*
+ * Load balancing across a pool of hubs (see balance_port).
+ *
+ * Every second each hub sends a load report to the other hubs of the pool,
+ * as one UDP datagram:
+ *  LOAD <users> <max users> <loop latency in ms> <congested users>
+ *
+ * The address users are sent to, to reach a hub, is set with its IP address
+ * in balance_peers, and never taken from the reports.
+ * When a hub is full or overloaded, it redirects new users to the least
+ * loaded hub that reported recently, see balance_redirect().
+ */
+
+struct hub_info;
+struct hub_config;
+struct cbuffer;
+
+/**
+ * Start exchanging load reports if balance_port is set.
+ * @return 0 on success, or -1 on error.
+ */
+extern int balance_start(struct hub_info* hub, struct hub_config* config);
+
+/**
+ * Stop exchanging load reports.
+ */
+extern void balance_shutdown(struct hub_info* hub);
+
+/**
+ * Handle a load report received from the given address.
+ * @return 0 if accepted, or -1 if invalid or not sent by a hub of the pool.
+ */
+extern int balance_handle_report(struct hub_info* hub, const struct sockaddr* from, socklen_t from_len, const char* report);
+
+/**
+ * @return 1 if this hub is full or overloaded, and another hub of the pool
+ * can take new users instead.
+ */
+extern int balance_should_redirect(struct hub_info* hub);
+
+/**
+ * Pick the least loaded hub of the pool that is less loaded than this one.
+ * @return its address, or NULL if none.
+ */
+extern const char* balance_redirect(struct hub_info* hub);
+
+/**
+ * Add the load of this hub and the pool to the output of !stats.
+ */
+extern void balance_format_stats(struct hub_info* hub, struct cbuffer* buf);
+
+#endif /* HAVE_UHUB_BALANCE_H */
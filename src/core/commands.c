@@ -459,6 +459,30 @@ static int command_loglevel(struct command_base* cbase, struct hub_user* user, s
 	return command_status(cbase, user, cmd, buf);
 }
 
+static int command_lowbandwidth(struct command_base* cbase, struct hub_user* user, struct hub_command* cmd)
+{
+	struct cbuffer* buf = cbuf_create(128);
+	struct hub_command_arg_data* arg = hub_command_arg_next(cmd, type_string);
+	int enable;
+
+	if (arg && !string_to_boolean(arg->data.string, &enable))
+	{
+		cbuf_append_format(buf, "Unable to set low bandwidth mode to: %s (use on or off)", arg->data.string);
+		return command_status(cbase, user, cmd, buf);
+	}
+
+	if (arg)
+	{
+		if (enable)
+			user_flag_set(user, flag_low_bw);
+		else
+			user_flag_unset(user, flag_low_bw);
+	}
+
+	cbuf_append_format(buf, "Low bandwidth mode is %s. It applies to user info sent from now on.", user_flag_get(user, flag_low_bw) ? "on" : "off");
+	return command_status(cbase, user, cmd, buf);
+}
+
 static int command_myip(struct command_base* cbase, struct hub_user* user, struct hub_command* cmd)
 {
 	struct cbuffer* buf = cbuf_create(128);
@@ -551,7 +575,13 @@ static int command_stats(struct command_base* cbase, struct hub_user* user, stru
 	struct hub_info* hub = cbase->hub;
 	static char rxbuf[64] = { "0 B" };
 	static char txbuf[64] = { "0 B" };
+	struct net_statistics* net_current;
+	struct net_statistics* net_total;
+#ifdef SSL_SUPPORT
+	size_t tls_accept, tls_resumed;
+#endif
 
+	net_stats_get(&net_current, &net_total);
 	cbuf_append(buf, "Hub statistics: ");
 	cbuf_append_format(buf, "%" PRIsz "/%d users (peak %" PRIsz "). ", hub->users->count, hub->config->max_users, hub->users->count_peak);
 
@@ -570,6 +600,27 @@ static int command_stats(struct command_base* cbase, struct hub_user* user, stru
 	format_size(hub->stats.net_tx_total, txbuf, sizeof(txbuf));
 	cbuf_append_format(buf, ", total_tx=%s", txbuf);
 	cbuf_append_format(buf, ", total_rx=%s", rxbuf);
+#ifdef SSL_SUPPORT
+	tls_accept = net_total->tls_accept + net_current->tls_accept;
+	tls_resumed = net_total->tls_resumed + net_current->tls_resumed;
+	cbuf_append_format(buf, "\nTLS: handshakes=%" PRIsz ", resumed=%" PRIsz " (%d%%), kernel offload=%" PRIsz ", user space=%" PRIsz,
+		tls_accept, tls_resumed, tls_accept ? (int) (tls_resumed * 100 / tls_accept) : 0,
+		net_total->tls_ktls + net_current->tls_ktls, net_total->tls_ktls_fallback + net_current->tls_ktls_fallback);
+#endif
+	cbuf_append_format(buf, "\nReads: deferred=%" PRIsz ", paused=%" PRIsz, hub->stats.read_deferred, hub->stats.read_paused);
+	format_size(hub->stats.send_queued, txbuf, sizeof(txbuf));
+	cbuf_append_format(buf, "\nSend queues: queued=%s", txbuf);
+	format_size(hub->stats.send_queued_peak, txbuf, sizeof(txbuf));
+	cbuf_append_format(buf, ", peak=%s", txbuf);
+	format_size(route_get_send_budget(hub), txbuf, sizeof(txbuf));
+	cbuf_append_format(buf, ", limit=%s, dropped=%" PRIsz ", evicted=%" PRIsz, txbuf, hub->stats.send_dropped, hub->stats.send_evicted);
+	if (hub->links)
+		cbuf_append_format(buf, "\nLinks: nodes=%" PRIsz ", users on other nodes=%" PRIsz, link_get_node_count(hub), link_get_user_count(hub));
+	balance_format_stats(hub, buf);
+
+	cbuf_append(buf, "\nMemory pools:\n");
+	mem_pool_format_stats(buf);
+	cbuf_chomp(buf, "\n");
 
 	return command_status(cbase, user, cmd, buf);
 }
@@ -582,7 +633,7 @@ static int send_user_info(struct command_base* cbase, struct hub_user* user, str
 	cbuf_append_format(buf, "Address: %s\n", user_get_address(target));
 
 	if (user_is_tls_connected(target))
-		cbuf_append(buf, "Connected securely with ADCS\n");
+		cbuf_append_format(buf, "Connected securely with ADCS (kernel TLS: %s)\n", user_get_tls_offload(target));
 	else
 		cbuf_append(buf, "Connected with (unencrypted) ADC\n");
 
@@ -668,6 +719,7 @@ void commands_builtin_add(struct command_base* cbase)
 	ADD_COMMAND("info",      "u",   auth_cred_operator, command_user_info,    "Show info about a user."      );
 	ADD_COMMAND("kick",      "u?m", auth_cred_operator, command_kick,         "Kick a user."                 );
 	ADD_COMMAND("loglevel",  "?m",  auth_cred_admin,    command_loglevel,     "Change the hub log level."    );
+	ADD_COMMAND("lowbw",     "?m",  auth_cred_guest,    command_lowbandwidth, "Receive less user info."      );
 	ADD_COMMAND("me",        "",    auth_cred_guest,    command_me,           "Show info about you."         );
 	ADD_COMMAND("myip",      "",    auth_cred_guest,    command_myip,         "Show your own IP."            );
 	ADD_COMMAND("reload",    "",    auth_cred_admin,    command_reload,       "Reload configuration files."  );
@@ -55,6 +55,20 @@ extern void dump_config(const struct hub_config* config, FILE* stream, int ignor
  */
 extern int apply_config(struct hub_config* config, const char* key, const char* data, int line_count);
 
+/**
+ * Called for each setting that differs between two configurations.
+ * restart is non-zero if the setting is only applied on startup.
+ */
+typedef void (*config_changed_handler)(const char* key, int restart, void* ptr);
+
+/**
+ * Compare two configurations, calling handler (if not NULL) for every
+ * setting that differs.
+ *
+ * @return the number of settings that differ.
+ */
+extern int compare_config(const struct hub_config* a, const struct hub_config* b, config_changed_handler handler, void* ptr);
+
 
 #endif /* HAVE_UHUB_CONFIG_H */
 
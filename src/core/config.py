@@ -36,6 +36,7 @@ class Option(object):
 		self.name = self._attr(node, 'name', True)
 		self.default = self._attr(node, 'default', True)
 		self.advanced = self._attr(node, 'advanced', False)
+		self.restart = self._attr(node, 'restart', False) == "true"
 		self.is_string = self.otype in ["string", "message", "file"]
 
 		self._get(node, "alias");
@@ -188,6 +189,19 @@ class CSourceGenerator(SourceGenerator):
 		s += "\t\tfprintf(stream, \"%s = %s\\n\", %s);\n\n" % (option.name, fmt, val)
 		self.f.write(s)
 
+	def _write_compare_impl(self, option):
+		if option.is_string:
+			test = "strcmp(a->%(name)s, b->%(name)s)" % { "name": option.name }
+		else:
+			test = "a->%(name)s != b->%(name)s" % { "name": option.name }
+		s  = "\tif (%s)\n" % test
+		s += "\t{\n"
+		s += "\t\tif (handler)\n"
+		s += "\t\t\thandler(\"%s\", %d, ptr);\n" % (option.name, 1 if option.restart else 0)
+		s += "\t\tchanged++;\n"
+		s += "\t}\n\n"
+		self.f.write(s)
+
 	def write(self, options):
 		self.write_header()
 		self.f.write("void config_defaults(struct hub_config* config)\n{\n")
@@ -211,6 +225,12 @@ class CSourceGenerator(SourceGenerator):
 		for option in options:
 			self._write_dump_impl(option)
 		self.f.write("}\n\n")
+		self.f.write("int compare_config(const struct hub_config* a, const struct hub_config* b, config_changed_handler handler, void* ptr)\n{\n")
+		self.f.write("\tint changed = 0;\n\n")
+		for option in options:
+			self._write_compare_impl(option)
+		self.f.write("\treturn changed;\n")
+		self.f.write("}\n\n")
 
 class SqlWebsiteDocsGenerator(SourceGenerator):
 	def __init__(self, filename, sqlite_support = False):
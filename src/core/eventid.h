@@ -24,6 +24,10 @@
 #define UHUB_EVENT_USER_JOIN         0x1001
 #define UHUB_EVENT_USER_QUIT         0x1002
 #define UHUB_EVENT_USER_DESTROY      0x1003
+#define UHUB_EVENT_LOGIN_VERIFY      0x1004
+#define UHUB_EVENT_QUIT_FLUSH        0x1005
+#define UHUB_EVENT_READ_CONTINUE     0x1006
+#define UHUB_EVENT_SEND_BUDGET       0x1007
 
 /* Send a broadcast message */
 #define UHUB_EVENT_BROADCAST         0x2000
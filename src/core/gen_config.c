@@ -1,9 +1,9 @@
 /*
  * uhub - A tiny ADC p2p connection hub
- * Copyright (C) 2007-2020, Jan Vidar Krey
+ * Copyright (C) 2007-2026, Jan Vidar Krey
  *
  * THIS FILE IS AUTOGENERATED - DO NOT MODIFY
- * Created 2020-10-02 13:30, by config.py
+ * Created 2026-10-19 06:33, by config.py
  */
 
 void config_defaults(struct hub_config* config)
@@ -28,7 +28,13 @@ void config_defaults(struct hub_config* config)
 	config->max_recv_buffer = 4096;
 	config->max_send_buffer = 131072;
 	config->max_send_buffer_soft = 98304;
+	config->max_send_buffer_total = 0;
+	config->read_budget_lines = 100;
+	config->read_budget_bytes = 32768;
+	config->read_pause_congested = 1;
 	config->low_bandwidth_mode = 0;
+	config->pool_prewarm = 0;
+	config->sid_reuse_delay = 30;
 	config->limit_max_hubs_user = 10;
 	config->limit_max_hubs_reg = 10;
 	config->limit_max_hubs_op = 10;
@@ -55,8 +61,22 @@ void config_defaults(struct hub_config* config)
 	config->tls_cipher_list = hub_strdup("DEFAULT:@SECLEVEL=2:!ARIA:!CAMELLIA:!DSS:!MD5:!PSK:!SRP:!aNULL:!eNULL");
 	config->tls_ciphersuites = hub_strdup("");
 	config->tls_version = hub_strdup("1.2");
+	config->tls_sni_name = hub_strdup("");
+	config->tls_ktls = 0;
+	config->tls_session_cache = 20480;
+	config->tls_session_timeout = 7200;
+	config->tls_ticket_key_rotate = 3600;
 	config->file_acl = hub_strdup("");
 	config->file_plugins = hub_strdup("");
+	config->file_virtual_hubs = hub_strdup("");
+	config->link_node_id = 0;
+	config->link_peers = hub_strdup("");
+	config->link_nick = hub_strdup("link");
+	config->link_password = hub_strdup("");
+	config->balance_port = 0;
+	config->balance_peers = hub_strdup("");
+	config->balance_max_latency = 500;
+	config->file_capture = hub_strdup("");
 	config->msg_hub_full = hub_strdup("Hub is full");
 	config->msg_hub_disabled = hub_strdup("Hub is disabled");
 	config->msg_hub_registered_users_only = hub_strdup("Hub is for registered users only");
@@ -329,6 +349,53 @@ int apply_config(struct hub_config* config, const char* key, const char* data, i
 		return 0;
 	}
 
+	if (!strcmp(key, "max_send_buffer_total"))
+	{
+		min = 0;
+		if (!apply_integer(key, data, &config->max_send_buffer_total, &min, 0))
+		{
+			LOG_ERROR("Configuration parse error on line %d", line_count);
+			LOG_ERROR("\"max_send_buffer_total\" (integer), default=0");
+			return -1;
+		}
+		return 0;
+	}
+
+	if (!strcmp(key, "read_budget_lines"))
+	{
+		min = 0;
+		if (!apply_integer(key, data, &config->read_budget_lines, &min, 0))
+		{
+			LOG_ERROR("Configuration parse error on line %d", line_count);
+			LOG_ERROR("\"read_budget_lines\" (integer), default=100");
+			return -1;
+		}
+		return 0;
+	}
+
+	if (!strcmp(key, "read_budget_bytes"))
+	{
+		min = 0;
+		if (!apply_integer(key, data, &config->read_budget_bytes, &min, 0))
+		{
+			LOG_ERROR("Configuration parse error on line %d", line_count);
+			LOG_ERROR("\"read_budget_bytes\" (integer), default=32768");
+			return -1;
+		}
+		return 0;
+	}
+
+	if (!strcmp(key, "read_pause_congested"))
+	{
+		if (!apply_boolean(key, data, &config->read_pause_congested))
+		{
+			LOG_ERROR("Configuration parse error on line %d", line_count);
+			LOG_ERROR("\"read_pause_congested\" (boolean), default=1");
+			return -1;
+		}
+		return 0;
+	}
+
 	if (!strcmp(key, "low_bandwidth_mode"))
 	{
 		if (!apply_boolean(key, data, &config->low_bandwidth_mode))
@@ -340,6 +407,32 @@ int apply_config(struct hub_config* config, const char* key, const char* data, i
 		return 0;
 	}
 
+	if (!strcmp(key, "pool_prewarm"))
+	{
+		min = 0;
+		max = 1048576;
+		if (!apply_integer(key, data, &config->pool_prewarm, &min, &max))
+		{
+			LOG_ERROR("Configuration parse error on line %d", line_count);
+			LOG_ERROR("\"pool_prewarm\" (integer), default=0, max=1048576");
+			return -1;
+		}
+		return 0;
+	}
+
+	if (!strcmp(key, "sid_reuse_delay"))
+	{
+		min = 0;
+		max = 3600;
+		if (!apply_integer(key, data, &config->sid_reuse_delay, &min, &max))
+		{
+			LOG_ERROR("Configuration parse error on line %d", line_count);
+			LOG_ERROR("\"sid_reuse_delay\" (integer), default=30, max=3600");
+			return -1;
+		}
+		return 0;
+	}
+
 	if (!strcmp(key, "limit_max_hubs_user"))
 	{
 		min = 0;
@@ -640,6 +733,67 @@ int apply_config(struct hub_config* config, const char* key, const char* data, i
 		return 0;
 	}
 
+	if (!strcmp(key, "tls_sni_name"))
+	{
+		if (!apply_string(key, data, &config->tls_sni_name, (char*) ""))
+		{
+			LOG_ERROR("Configuration parse error on line %d", line_count);
+			LOG_ERROR("\"tls_sni_name\" (string), default=\"\"");
+			return -1;
+		}
+		return 0;
+	}
+
+	if (!strcmp(key, "tls_ktls"))
+	{
+		if (!apply_boolean(key, data, &config->tls_ktls))
+		{
+			LOG_ERROR("Configuration parse error on line %d", line_count);
+			LOG_ERROR("\"tls_ktls\" (boolean), default=0");
+			return -1;
+		}
+		return 0;
+	}
+
+	if (!strcmp(key, "tls_session_cache"))
+	{
+		min = 0;
+		max = 1048576;
+		if (!apply_integer(key, data, &config->tls_session_cache, &min, &max))
+		{
+			LOG_ERROR("Configuration parse error on line %d", line_count);
+			LOG_ERROR("\"tls_session_cache\" (integer), default=20480, max=1048576");
+			return -1;
+		}
+		return 0;
+	}
+
+	if (!strcmp(key, "tls_session_timeout"))
+	{
+		min = 60;
+		max = 86400;
+		if (!apply_integer(key, data, &config->tls_session_timeout, &min, &max))
+		{
+			LOG_ERROR("Configuration parse error on line %d", line_count);
+			LOG_ERROR("\"tls_session_timeout\" (integer), default=7200, min=60, max=86400");
+			return -1;
+		}
+		return 0;
+	}
+
+	if (!strcmp(key, "tls_ticket_key_rotate"))
+	{
+		min = 0;
+		max = 86400;
+		if (!apply_integer(key, data, &config->tls_ticket_key_rotate, &min, &max))
+		{
+			LOG_ERROR("Configuration parse error on line %d", line_count);
+			LOG_ERROR("\"tls_ticket_key_rotate\" (integer), default=3600, max=86400");
+			return -1;
+		}
+		return 0;
+	}
+
 	if (!strcmp(key, "file_acl"))
 	{
 		if (!apply_string(key, data, &config->file_acl, (char*) ""))
@@ -662,6 +816,110 @@ int apply_config(struct hub_config* config, const char* key, const char* data, i
 		return 0;
 	}
 
+	if (!strcmp(key, "file_virtual_hubs"))
+	{
+		if (!apply_string(key, data, &config->file_virtual_hubs, (char*) ""))
+		{
+			LOG_ERROR("Configuration parse error on line %d", line_count);
+			LOG_ERROR("\"file_virtual_hubs\" (file), default=\"\"");
+			return -1;
+		}
+		return 0;
+	}
+
+	if (!strcmp(key, "link_node_id"))
+	{
+		min = 0;
+		max = 31;
+		if (!apply_integer(key, data, &config->link_node_id, &min, &max))
+		{
+			LOG_ERROR("Configuration parse error on line %d", line_count);
+			LOG_ERROR("\"link_node_id\" (integer), default=0, max=31");
+			return -1;
+		}
+		return 0;
+	}
+
+	if (!strcmp(key, "link_peers"))
+	{
+		if (!apply_string(key, data, &config->link_peers, (char*) ""))
+		{
+			LOG_ERROR("Configuration parse error on line %d", line_count);
+			LOG_ERROR("\"link_peers\" (string), default=\"\"");
+			return -1;
+		}
+		return 0;
+	}
+
+	if (!strcmp(key, "link_nick"))
+	{
+		if (!apply_string(key, data, &config->link_nick, (char*) ""))
+		{
+			LOG_ERROR("Configuration parse error on line %d", line_count);
+			LOG_ERROR("\"link_nick\" (string), default=\"link\"");
+			return -1;
+		}
+		return 0;
+	}
+
+	if (!strcmp(key, "link_password"))
+	{
+		if (!apply_string(key, data, &config->link_password, (char*) ""))
+		{
+			LOG_ERROR("Configuration parse error on line %d", line_count);
+			LOG_ERROR("\"link_password\" (string), default=\"\"");
+			return -1;
+		}
+		return 0;
+	}
+
+	if (!strcmp(key, "balance_port"))
+	{
+		min = 0;
+		max = 65535;
+		if (!apply_integer(key, data, &config->balance_port, &min, &max))
+		{
+			LOG_ERROR("Configuration parse error on line %d", line_count);
+			LOG_ERROR("\"balance_port\" (integer), default=0, max=65535");
+			return -1;
+		}
+		return 0;
+	}
+
+	if (!strcmp(key, "balance_peers"))
+	{
+		if (!apply_string(key, data, &config->balance_peers, (char*) ""))
+		{
+			LOG_ERROR("Configuration parse error on line %d", line_count);
+			LOG_ERROR("\"balance_peers\" (string), default=\"\"");
+			return -1;
+		}
+		return 0;
+	}
+
+	if (!strcmp(key, "balance_max_latency"))
+	{
+		min = 1;
+		if (!apply_integer(key, data, &config->balance_max_latency, &min, 0))
+		{
+			LOG_ERROR("Configuration parse error on line %d", line_count);
+			LOG_ERROR("\"balance_max_latency\" (integer), default=500, min=1");
+			return -1;
+		}
+		return 0;
+	}
+
+	if (!strcmp(key, "file_capture"))
+	{
+		if (!apply_string(key, data, &config->file_capture, (char*) ""))
+		{
+			LOG_ERROR("Configuration parse error on line %d", line_count);
+			LOG_ERROR("\"file_capture\" (file), default=\"\"");
+			return -1;
+		}
+		return 0;
+	}
+
 	if (!strcmp(key, "msg_hub_full"))
 	{
 		if (!apply_string(key, data, &config->msg_hub_full, (char*) ""))
@@ -1107,12 +1365,33 @@ void free_config(struct hub_config* config)
 	hub_free(config->tls_version);
 	config->tls_version = NULL;
 
+	hub_free(config->tls_sni_name);
+	config->tls_sni_name = NULL;
+
 	hub_free(config->file_acl);
 	config->file_acl = NULL;
 
 	hub_free(config->file_plugins);
 	config->file_plugins = NULL;
 
+	hub_free(config->file_virtual_hubs);
+	config->file_virtual_hubs = NULL;
+
+	hub_free(config->link_peers);
+	config->link_peers = NULL;
+
+	hub_free(config->link_nick);
+	config->link_nick = NULL;
+
+	hub_free(config->link_password);
+	config->link_password = NULL;
+
+	hub_free(config->balance_peers);
+	config->balance_peers = NULL;
+
+	hub_free(config->file_capture);
+	config->file_capture = NULL;
+
 	hub_free(config->msg_hub_full);
 	config->msg_hub_full = NULL;
 
@@ -1285,9 +1564,27 @@ void dump_config(const struct hub_config* config, FILE* stream, int ignore_defau
 	if (!ignore_defaults || config->max_send_buffer_soft != 98304)
 		fprintf(stream, "max_send_buffer_soft = %d\n", config->max_send_buffer_soft);
 
+	if (!ignore_defaults || config->max_send_buffer_total != 0)
+		fprintf(stream, "max_send_buffer_total = %d\n", config->max_send_buffer_total);
+
+	if (!ignore_defaults || config->read_budget_lines != 100)
+		fprintf(stream, "read_budget_lines = %d\n", config->read_budget_lines);
+
+	if (!ignore_defaults || config->read_budget_bytes != 32768)
+		fprintf(stream, "read_budget_bytes = %d\n", config->read_budget_bytes);
+
+	if (!ignore_defaults || config->read_pause_congested != 1)
+		fprintf(stream, "read_pause_congested = %s\n", config->read_pause_congested ? "yes" : "no");
+
 	if (!ignore_defaults || config->low_bandwidth_mode != 0)
 		fprintf(stream, "low_bandwidth_mode = %s\n", config->low_bandwidth_mode ? "yes" : "no");
 
+	if (!ignore_defaults || config->pool_prewarm != 0)
+		fprintf(stream, "pool_prewarm = %d\n", config->pool_prewarm);
+
+	if (!ignore_defaults || config->sid_reuse_delay != 30)
+		fprintf(stream, "sid_reuse_delay = %d\n", config->sid_reuse_delay);
+
 	if (!ignore_defaults || config->limit_max_hubs_user != 10)
 		fprintf(stream, "limit_max_hubs_user = %d\n", config->limit_max_hubs_user);
 
@@ -1366,12 +1663,54 @@ void dump_config(const struct hub_config* config, FILE* stream, int ignore_defau
 	if (!ignore_defaults || strcmp(config->tls_version, "1.2") != 0)
 		fprintf(stream, "tls_version = \"%s\"\n", config->tls_version);
 
+	if (!ignore_defaults || strcmp(config->tls_sni_name, "") != 0)
+		fprintf(stream, "tls_sni_name = \"%s\"\n", config->tls_sni_name);
+
+	if (!ignore_defaults || config->tls_ktls != 0)
+		fprintf(stream, "tls_ktls = %s\n", config->tls_ktls ? "yes" : "no");
+
+	if (!ignore_defaults || config->tls_session_cache != 20480)
+		fprintf(stream, "tls_session_cache = %d\n", config->tls_session_cache);
+
+	if (!ignore_defaults || config->tls_session_timeout != 7200)
+		fprintf(stream, "tls_session_timeout = %d\n", config->tls_session_timeout);
+
+	if (!ignore_defaults || config->tls_ticket_key_rotate != 3600)
+		fprintf(stream, "tls_ticket_key_rotate = %d\n", config->tls_ticket_key_rotate);
+
 	if (!ignore_defaults || strcmp(config->file_acl, "") != 0)
 		fprintf(stream, "file_acl = \"%s\"\n", config->file_acl);
 
 	if (!ignore_defaults || strcmp(config->file_plugins, "") != 0)
 		fprintf(stream, "file_plugins = \"%s\"\n", config->file_plugins);
 
+	if (!ignore_defaults || strcmp(config->file_virtual_hubs, "") != 0)
+		fprintf(stream, "file_virtual_hubs = \"%s\"\n", config->file_virtual_hubs);
+
+	if (!ignore_defaults || config->link_node_id != 0)
+		fprintf(stream, "link_node_id = %d\n", config->link_node_id);
+
+	if (!ignore_defaults || strcmp(config->link_peers, "") != 0)
+		fprintf(stream, "link_peers = \"%s\"\n", config->link_peers);
+
+	if (!ignore_defaults || strcmp(config->link_nick, "link") != 0)
+		fprintf(stream, "link_nick = \"%s\"\n", config->link_nick);
+
+	if (!ignore_defaults || strcmp(config->link_password, "") != 0)
+		fprintf(stream, "link_password = \"%s\"\n", config->link_password);
+
+	if (!ignore_defaults || config->balance_port != 0)
+		fprintf(stream, "balance_port = %d\n", config->balance_port);
+
+	if (!ignore_defaults || strcmp(config->balance_peers, "") != 0)
+		fprintf(stream, "balance_peers = \"%s\"\n", config->balance_peers);
+
+	if (!ignore_defaults || config->balance_max_latency != 500)
+		fprintf(stream, "balance_max_latency = %d\n", config->balance_max_latency);
+
+	if (!ignore_defaults || strcmp(config->file_capture, "") != 0)
+		fprintf(stream, "file_capture = \"%s\"\n", config->file_capture);
+
 	if (!ignore_defaults || strcmp(config->msg_hub_full, "Hub is full") != 0)
 		fprintf(stream, "msg_hub_full = \"%s\"\n", config->msg_hub_full);
 
@@ -1482,3 +1821,745 @@ void dump_config(const struct hub_config* config, FILE* stream, int ignore_defau
 
 }
 
+int compare_config(const struct hub_config* a, const struct hub_config* b, config_changed_handler handler, void* ptr)
+{
+	int changed = 0;
+
+	if (a->hub_enabled != b->hub_enabled)
+	{
+		if (handler)
+			handler("hub_enabled", 0, ptr);
+		changed++;
+	}
+
+	if (a->server_port != b->server_port)
+	{
+		if (handler)
+			handler("server_port", 1, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->server_bind_addr, b->server_bind_addr))
+	{
+		if (handler)
+			handler("server_bind_addr", 1, ptr);
+		changed++;
+	}
+
+	if (a->server_listen_backlog != b->server_listen_backlog)
+	{
+		if (handler)
+			handler("server_listen_backlog", 1, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->server_alt_ports, b->server_alt_ports))
+	{
+		if (handler)
+			handler("server_alt_ports", 1, ptr);
+		changed++;
+	}
+
+	if (a->show_banner != b->show_banner)
+	{
+		if (handler)
+			handler("show_banner", 0, ptr);
+		changed++;
+	}
+
+	if (a->show_banner_sys_info != b->show_banner_sys_info)
+	{
+		if (handler)
+			handler("show_banner_sys_info", 0, ptr);
+		changed++;
+	}
+
+	if (a->max_users != b->max_users)
+	{
+		if (handler)
+			handler("max_users", 0, ptr);
+		changed++;
+	}
+
+	if (a->registered_users_only != b->registered_users_only)
+	{
+		if (handler)
+			handler("registered_users_only", 0, ptr);
+		changed++;
+	}
+
+	if (a->obsolete_clients != b->obsolete_clients)
+	{
+		if (handler)
+			handler("obsolete_clients", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->hub_name, b->hub_name))
+	{
+		if (handler)
+			handler("hub_name", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->hub_description, b->hub_description))
+	{
+		if (handler)
+			handler("hub_description", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->redirect_addr, b->redirect_addr))
+	{
+		if (handler)
+			handler("redirect_addr", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->failover_redirect_addr, b->failover_redirect_addr))
+	{
+		if (handler)
+			handler("failover_redirect_addr", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->nmdc_redirect_addr, b->nmdc_redirect_addr))
+	{
+		if (handler)
+			handler("nmdc_redirect_addr", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->http_redirect_addr, b->http_redirect_addr))
+	{
+		if (handler)
+			handler("http_redirect_addr", 0, ptr);
+		changed++;
+	}
+
+	if (a->ignore_http != b->ignore_http)
+	{
+		if (handler)
+			handler("ignore_http", 0, ptr);
+		changed++;
+	}
+
+	if (a->max_recv_buffer != b->max_recv_buffer)
+	{
+		if (handler)
+			handler("max_recv_buffer", 0, ptr);
+		changed++;
+	}
+
+	if (a->max_send_buffer != b->max_send_buffer)
+	{
+		if (handler)
+			handler("max_send_buffer", 0, ptr);
+		changed++;
+	}
+
+	if (a->max_send_buffer_soft != b->max_send_buffer_soft)
+	{
+		if (handler)
+			handler("max_send_buffer_soft", 0, ptr);
+		changed++;
+	}
+
+	if (a->max_send_buffer_total != b->max_send_buffer_total)
+	{
+		if (handler)
+			handler("max_send_buffer_total", 0, ptr);
+		changed++;
+	}
+
+	if (a->read_budget_lines != b->read_budget_lines)
+	{
+		if (handler)
+			handler("read_budget_lines", 0, ptr);
+		changed++;
+	}
+
+	if (a->read_budget_bytes != b->read_budget_bytes)
+	{
+		if (handler)
+			handler("read_budget_bytes", 0, ptr);
+		changed++;
+	}
+
+	if (a->read_pause_congested != b->read_pause_congested)
+	{
+		if (handler)
+			handler("read_pause_congested", 0, ptr);
+		changed++;
+	}
+
+	if (a->low_bandwidth_mode != b->low_bandwidth_mode)
+	{
+		if (handler)
+			handler("low_bandwidth_mode", 0, ptr);
+		changed++;
+	}
+
+	if (a->pool_prewarm != b->pool_prewarm)
+	{
+		if (handler)
+			handler("pool_prewarm", 1, ptr);
+		changed++;
+	}
+
+	if (a->sid_reuse_delay != b->sid_reuse_delay)
+	{
+		if (handler)
+			handler("sid_reuse_delay", 1, ptr);
+		changed++;
+	}
+
+	if (a->limit_max_hubs_user != b->limit_max_hubs_user)
+	{
+		if (handler)
+			handler("limit_max_hubs_user", 0, ptr);
+		changed++;
+	}
+
+	if (a->limit_max_hubs_reg != b->limit_max_hubs_reg)
+	{
+		if (handler)
+			handler("limit_max_hubs_reg", 0, ptr);
+		changed++;
+	}
+
+	if (a->limit_max_hubs_op != b->limit_max_hubs_op)
+	{
+		if (handler)
+			handler("limit_max_hubs_op", 0, ptr);
+		changed++;
+	}
+
+	if (a->limit_max_hubs != b->limit_max_hubs)
+	{
+		if (handler)
+			handler("limit_max_hubs", 0, ptr);
+		changed++;
+	}
+
+	if (a->limit_min_hubs_user != b->limit_min_hubs_user)
+	{
+		if (handler)
+			handler("limit_min_hubs_user", 0, ptr);
+		changed++;
+	}
+
+	if (a->limit_min_hubs_reg != b->limit_min_hubs_reg)
+	{
+		if (handler)
+			handler("limit_min_hubs_reg", 0, ptr);
+		changed++;
+	}
+
+	if (a->limit_min_hubs_op != b->limit_min_hubs_op)
+	{
+		if (handler)
+			handler("limit_min_hubs_op", 0, ptr);
+		changed++;
+	}
+
+	if (a->limit_min_hubs != b->limit_min_hubs)
+	{
+		if (handler)
+			handler("limit_min_hubs", 0, ptr);
+		changed++;
+	}
+
+	if (a->limit_min_share != b->limit_min_share)
+	{
+		if (handler)
+			handler("limit_min_share", 0, ptr);
+		changed++;
+	}
+
+	if (a->limit_max_share != b->limit_max_share)
+	{
+		if (handler)
+			handler("limit_max_share", 0, ptr);
+		changed++;
+	}
+
+	if (a->limit_min_slots != b->limit_min_slots)
+	{
+		if (handler)
+			handler("limit_min_slots", 0, ptr);
+		changed++;
+	}
+
+	if (a->limit_max_slots != b->limit_max_slots)
+	{
+		if (handler)
+			handler("limit_max_slots", 0, ptr);
+		changed++;
+	}
+
+	if (a->flood_ctl_interval != b->flood_ctl_interval)
+	{
+		if (handler)
+			handler("flood_ctl_interval", 0, ptr);
+		changed++;
+	}
+
+	if (a->flood_ctl_chat != b->flood_ctl_chat)
+	{
+		if (handler)
+			handler("flood_ctl_chat", 0, ptr);
+		changed++;
+	}
+
+	if (a->flood_ctl_connect != b->flood_ctl_connect)
+	{
+		if (handler)
+			handler("flood_ctl_connect", 0, ptr);
+		changed++;
+	}
+
+	if (a->flood_ctl_search != b->flood_ctl_search)
+	{
+		if (handler)
+			handler("flood_ctl_search", 0, ptr);
+		changed++;
+	}
+
+	if (a->flood_ctl_update != b->flood_ctl_update)
+	{
+		if (handler)
+			handler("flood_ctl_update", 0, ptr);
+		changed++;
+	}
+
+	if (a->flood_ctl_extras != b->flood_ctl_extras)
+	{
+		if (handler)
+			handler("flood_ctl_extras", 0, ptr);
+		changed++;
+	}
+
+	if (a->tls_enable != b->tls_enable)
+	{
+		if (handler)
+			handler("tls_enable", 1, ptr);
+		changed++;
+	}
+
+	if (a->tls_require != b->tls_require)
+	{
+		if (handler)
+			handler("tls_require", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->tls_require_redirect_addr, b->tls_require_redirect_addr))
+	{
+		if (handler)
+			handler("tls_require_redirect_addr", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->tls_certificate, b->tls_certificate))
+	{
+		if (handler)
+			handler("tls_certificate", 1, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->tls_private_key, b->tls_private_key))
+	{
+		if (handler)
+			handler("tls_private_key", 1, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->tls_cipher_list, b->tls_cipher_list))
+	{
+		if (handler)
+			handler("tls_cipher_list", 1, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->tls_ciphersuites, b->tls_ciphersuites))
+	{
+		if (handler)
+			handler("tls_ciphersuites", 1, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->tls_version, b->tls_version))
+	{
+		if (handler)
+			handler("tls_version", 1, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->tls_sni_name, b->tls_sni_name))
+	{
+		if (handler)
+			handler("tls_sni_name", 1, ptr);
+		changed++;
+	}
+
+	if (a->tls_ktls != b->tls_ktls)
+	{
+		if (handler)
+			handler("tls_ktls", 1, ptr);
+		changed++;
+	}
+
+	if (a->tls_session_cache != b->tls_session_cache)
+	{
+		if (handler)
+			handler("tls_session_cache", 1, ptr);
+		changed++;
+	}
+
+	if (a->tls_session_timeout != b->tls_session_timeout)
+	{
+		if (handler)
+			handler("tls_session_timeout", 1, ptr);
+		changed++;
+	}
+
+	if (a->tls_ticket_key_rotate != b->tls_ticket_key_rotate)
+	{
+		if (handler)
+			handler("tls_ticket_key_rotate", 1, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->file_acl, b->file_acl))
+	{
+		if (handler)
+			handler("file_acl", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->file_plugins, b->file_plugins))
+	{
+		if (handler)
+			handler("file_plugins", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->file_virtual_hubs, b->file_virtual_hubs))
+	{
+		if (handler)
+			handler("file_virtual_hubs", 0, ptr);
+		changed++;
+	}
+
+	if (a->link_node_id != b->link_node_id)
+	{
+		if (handler)
+			handler("link_node_id", 1, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->link_peers, b->link_peers))
+	{
+		if (handler)
+			handler("link_peers", 1, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->link_nick, b->link_nick))
+	{
+		if (handler)
+			handler("link_nick", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->link_password, b->link_password))
+	{
+		if (handler)
+			handler("link_password", 0, ptr);
+		changed++;
+	}
+
+	if (a->balance_port != b->balance_port)
+	{
+		if (handler)
+			handler("balance_port", 1, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->balance_peers, b->balance_peers))
+	{
+		if (handler)
+			handler("balance_peers", 1, ptr);
+		changed++;
+	}
+
+	if (a->balance_max_latency != b->balance_max_latency)
+	{
+		if (handler)
+			handler("balance_max_latency", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->file_capture, b->file_capture))
+	{
+		if (handler)
+			handler("file_capture", 1, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->msg_hub_full, b->msg_hub_full))
+	{
+		if (handler)
+			handler("msg_hub_full", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->msg_hub_disabled, b->msg_hub_disabled))
+	{
+		if (handler)
+			handler("msg_hub_disabled", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->msg_hub_registered_users_only, b->msg_hub_registered_users_only))
+	{
+		if (handler)
+			handler("msg_hub_registered_users_only", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->msg_inf_error_nick_missing, b->msg_inf_error_nick_missing))
+	{
+		if (handler)
+			handler("msg_inf_error_nick_missing", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->msg_inf_error_nick_multiple, b->msg_inf_error_nick_multiple))
+	{
+		if (handler)
+			handler("msg_inf_error_nick_multiple", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->msg_inf_error_nick_invalid, b->msg_inf_error_nick_invalid))
+	{
+		if (handler)
+			handler("msg_inf_error_nick_invalid", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->msg_inf_error_nick_long, b->msg_inf_error_nick_long))
+	{
+		if (handler)
+			handler("msg_inf_error_nick_long", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->msg_inf_error_nick_short, b->msg_inf_error_nick_short))
+	{
+		if (handler)
+			handler("msg_inf_error_nick_short", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->msg_inf_error_nick_spaces, b->msg_inf_error_nick_spaces))
+	{
+		if (handler)
+			handler("msg_inf_error_nick_spaces", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->msg_inf_error_nick_bad_chars, b->msg_inf_error_nick_bad_chars))
+	{
+		if (handler)
+			handler("msg_inf_error_nick_bad_chars", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->msg_inf_error_nick_not_utf8, b->msg_inf_error_nick_not_utf8))
+	{
+		if (handler)
+			handler("msg_inf_error_nick_not_utf8", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->msg_inf_error_nick_taken, b->msg_inf_error_nick_taken))
+	{
+		if (handler)
+			handler("msg_inf_error_nick_taken", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->msg_inf_error_nick_restricted, b->msg_inf_error_nick_restricted))
+	{
+		if (handler)
+			handler("msg_inf_error_nick_restricted", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->msg_inf_error_cid_invalid, b->msg_inf_error_cid_invalid))
+	{
+		if (handler)
+			handler("msg_inf_error_cid_invalid", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->msg_inf_error_cid_missing, b->msg_inf_error_cid_missing))
+	{
+		if (handler)
+			handler("msg_inf_error_cid_missing", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->msg_inf_error_cid_taken, b->msg_inf_error_cid_taken))
+	{
+		if (handler)
+			handler("msg_inf_error_cid_taken", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->msg_inf_error_pid_missing, b->msg_inf_error_pid_missing))
+	{
+		if (handler)
+			handler("msg_inf_error_pid_missing", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->msg_inf_error_pid_invalid, b->msg_inf_error_pid_invalid))
+	{
+		if (handler)
+			handler("msg_inf_error_pid_invalid", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->msg_ban_permanently, b->msg_ban_permanently))
+	{
+		if (handler)
+			handler("msg_ban_permanently", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->msg_ban_temporarily, b->msg_ban_temporarily))
+	{
+		if (handler)
+			handler("msg_ban_temporarily", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->msg_auth_invalid_password, b->msg_auth_invalid_password))
+	{
+		if (handler)
+			handler("msg_auth_invalid_password", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->msg_auth_user_not_found, b->msg_auth_user_not_found))
+	{
+		if (handler)
+			handler("msg_auth_user_not_found", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->msg_error_no_memory, b->msg_error_no_memory))
+	{
+		if (handler)
+			handler("msg_error_no_memory", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->msg_user_share_size_low, b->msg_user_share_size_low))
+	{
+		if (handler)
+			handler("msg_user_share_size_low", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->msg_user_share_size_high, b->msg_user_share_size_high))
+	{
+		if (handler)
+			handler("msg_user_share_size_high", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->msg_user_slots_low, b->msg_user_slots_low))
+	{
+		if (handler)
+			handler("msg_user_slots_low", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->msg_user_slots_high, b->msg_user_slots_high))
+	{
+		if (handler)
+			handler("msg_user_slots_high", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->msg_user_hub_limit_low, b->msg_user_hub_limit_low))
+	{
+		if (handler)
+			handler("msg_user_hub_limit_low", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->msg_user_hub_limit_high, b->msg_user_hub_limit_high))
+	{
+		if (handler)
+			handler("msg_user_hub_limit_high", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->msg_user_flood_chat, b->msg_user_flood_chat))
+	{
+		if (handler)
+			handler("msg_user_flood_chat", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->msg_user_flood_connect, b->msg_user_flood_connect))
+	{
+		if (handler)
+			handler("msg_user_flood_connect", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->msg_user_flood_search, b->msg_user_flood_search))
+	{
+		if (handler)
+			handler("msg_user_flood_search", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->msg_user_flood_update, b->msg_user_flood_update))
+	{
+		if (handler)
+			handler("msg_user_flood_update", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->msg_user_flood_extras, b->msg_user_flood_extras))
+	{
+		if (handler)
+			handler("msg_user_flood_extras", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->msg_proto_no_common_hash, b->msg_proto_no_common_hash))
+	{
+		if (handler)
+			handler("msg_proto_no_common_hash", 0, ptr);
+		changed++;
+	}
+
+	if (strcmp(a->msg_proto_obsolete_adc0, b->msg_proto_obsolete_adc0))
+	{
+		if (handler)
+			handler("msg_proto_obsolete_adc0", 0, ptr);
+		changed++;
+	}
+
+	return changed;
+}
+
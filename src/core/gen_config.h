@@ -1,9 +1,9 @@
 /*
  * uhub - A tiny ADC p2p connection hub
- * Copyright (C) 2007-2020, Jan Vidar Krey
+ * Copyright (C) 2007-2026, Jan Vidar Krey
  *
  * THIS FILE IS AUTOGENERATED - DO NOT MODIFY
- * Created 2020-10-02 13:30, by config.py
+ * Created 2026-10-19 06:33, by config.py
  */
 
 struct hub_config
@@ -28,7 +28,13 @@ struct hub_config
 	int   max_recv_buffer;                 /*<<< Max read buffer before parse, per user (default: 4096) */
 	int   max_send_buffer;                 /*<<< Max send buffer before disconnect, per user (default: 131072) */
 	int   max_send_buffer_soft;            /*<<< Max send buffer before message drops, per user (default: 98304) */
+	int   max_send_buffer_total;           /*<<< Max send buffer of all users together, in megabytes (default: 0) */
+	int   read_budget_lines;               /*<<< Max messages handled from a user at a time (default: 100) */
+	int   read_budget_bytes;               /*<<< Max bytes handled from a user at a time (default: 32768) */
+	int   read_pause_congested;            /*<<< Stop reading from users with a full send queue (default: 1) */
 	int   low_bandwidth_mode;              /*<<< Enable bandwidth saving measures (default: 0) */
+	int   pool_prewarm;                    /*<<< Number of users and connections to preallocate (default: 0) */
+	int   sid_reuse_delay;                 /*<<< Seconds before a session ID is given to another user (default: 30) */
 	int   limit_max_hubs_user;             /*<<< Max concurrent hubs as a guest user (default: 10) */
 	int   limit_max_hubs_reg;              /*<<< Max concurrent hubs as a registered user (default: 10) */
 	int   limit_max_hubs_op;               /*<<< Max concurrent hubs as a operator (or admin) (default: 10) */
@@ -55,8 +61,22 @@ struct hub_config
 	char* tls_cipher_list;                 /*<<< List of TLS ciphers to use with TLSv1.2 and below (default: "DEFAULT:@SECLEVEL=2:!ARIA:!CAMELLIA:!DSS:!MD5:!PSK:!SRP:!aNULL:!eNULL") */
 	char* tls_ciphersuites;                /*<<< List of TLS ciphersuites to use with TLSv1.3+ (default: "") */
 	char* tls_version;                     /*<<< Specify minimum TLS version supported. (default: "1.2") */
+	char* tls_sni_name;                    /*<<< TLS server name of this hub (default: "") */
+	int   tls_ktls;                        /*<<< Let the kernel handle TLS encryption (default: 0) */
+	int   tls_session_cache;               /*<<< Number of TLS sessions to remember (default: 20480) */
+	int   tls_session_timeout;             /*<<< Seconds a TLS session can be resumed (default: 7200) */
+	int   tls_ticket_key_rotate;           /*<<< Seconds between TLS session ticket key changes (default: 3600) */
 	char* file_acl;                        /*<<< File containing access control lists (default: "") */
 	char* file_plugins;                    /*<<< Plugin configuration file (default: "") */
+	char* file_virtual_hubs;               /*<<< Virtual hubs to run in this process (default: "") */
+	int   link_node_id;                    /*<<< Node id of this hub in a group of linked hubs (default: 0) */
+	char* link_peers;                      /*<<< Comma separated list of hubs to link to (default: "") */
+	char* link_nick;                       /*<<< Nickname used when linking to other hubs (default: "link") */
+	char* link_password;                   /*<<< Password used when linking to other hubs (default: "") */
+	int   balance_port;                    /*<<< UDP port for load reports of a pool of hubs (default: 0) */
+	char* balance_peers;                   /*<<< Comma separated list of hubs in the pool (default: "") */
+	int   balance_max_latency;             /*<<< Loop latency in milliseconds above which the hub is overloaded (default: 500) */
+	char* file_capture;                    /*<<< Traffic capture file (default: "") */
 	char* msg_hub_full;                    /*<<< "Hub is full" */
 	char* msg_hub_disabled;                /*<<< "Hub is disabled" */
 	char* msg_hub_registered_users_only;   /*<<< "Hub is for registered users only" */
@@ -18,6 +18,7 @@
  */
 
 #include "uhub.h"
+#include "probe.h"
 
 struct hub_info* g_hub = 0;
 
@@ -52,6 +53,9 @@ int hub_handle_message(struct hub_info* hub, struct hub_user* u, const char* lin
 	if (user_is_disconnecting(u))
 		return -1;
 
+	if (u->link)
+		return link_handle_message(hub, u, line, length);
+
 	cmd = adc_msg_parse_verify(u, line, length);
 	if (cmd)
 	{
@@ -96,7 +100,7 @@ int hub_handle_message(struct hub_info* hub, struct hub_user* u, const char* lin
 			case ADC_CMD_ESCH:
 			case ADC_CMD_FSCH:
 				cmd->priority = -1;
-				if (plugin_handle_search(hub, u, cmd->cache) == st_deny)
+				if (plugin_handle_search(hub, u, cmd) == st_deny)
 					break;
 				CHECK_FLOOD(search, 1);
 				ROUTE_MSG();
@@ -346,7 +350,7 @@ int hub_handle_chat_message(struct hub_info* hub, struct hub_user* u, struct adc
 			struct hub_user* target = uman_get_user_by_sid(hub->users, cmd->target);
 			if (target)
 				status = plugin_handle_private_message(hub, u, target, message_decoded, 0);
-			else
+			else if (!link_has_sid(hub, cmd->target))
 				relay = 0;
 		}
 
@@ -528,12 +532,44 @@ static int check_duplicate_logins_ok(struct hub_info* hub, struct hub_user* user
 	if (lookup2)
 		return status_msg_inf_error_cid_taken;
 
+	if (link_has_nick(hub, user->id.nick))
+		return status_msg_inf_error_nick_taken;
+
+	if (link_has_cid(hub, user->id.cid))
+		return status_msg_inf_error_cid_taken;
+
 	return 0;
 }
 
-static void hub_event_dispatcher(void* callback_data, struct event_data* message)
+void hub_user_join(struct hub_info* hub, struct hub_user* user, int need_auth)
 {
 	int status;
+
+	if (user_is_disconnecting(user))
+		return;
+
+	if (need_auth)
+	{
+		hub_send_password_challenge(hub, user);
+	}
+	else
+	{
+		/* Race condition, we could have two messages for two logins queued up.
+		   So make sure we don't let the second client in. */
+		status = check_duplicate_logins_ok(hub, user);
+		if (!status)
+		{
+			on_login_success(hub, user);
+		}
+		else
+		{
+			on_login_failure(hub, user, (enum status_message) status);
+		}
+	}
+}
+
+static void hub_event_dispatcher(void* callback_data, struct event_data* message)
+{
 	struct hub_info* hub = (struct hub_info*) callback_data;
 	struct hub_user* user = (struct hub_user*) message->ptr;
 	uhub_assert(hub != NULL);
@@ -541,27 +577,7 @@ static void hub_event_dispatcher(void* callback_data, struct event_data* message
 	switch (message->id)
 	{
 		case UHUB_EVENT_USER_JOIN:
-			if (user_is_disconnecting(user))
-				break;
-
-			if (message->flags)
-			{
-				hub_send_password_challenge(hub, user);
-			}
-			else
-			{
-				/* Race condition, we could have two messages for two logins queued up.
-				   So make sure we don't let the second client in. */
-				status = check_duplicate_logins_ok(hub, user);
-				if (!status)
-				{
-					on_login_success(hub, user);
-				}
-				else
-				{
-					on_login_failure(hub, user, (enum status_message) status);
-				}
-			}
+			hub_user_join(hub, user, message->flags);
 			break;
 
 		case UHUB_EVENT_USER_QUIT:
@@ -575,6 +591,22 @@ static void hub_event_dispatcher(void* callback_data, struct event_data* message
 			user_destroy(user);
 			break;
 
+		case UHUB_EVENT_LOGIN_VERIFY:
+			hub_handle_info_login_verify(hub);
+			break;
+
+		case UHUB_EVENT_QUIT_FLUSH:
+			uman_flush_quit_messages(hub, hub->users);
+			break;
+
+		case UHUB_EVENT_READ_CONTINUE:
+			handle_net_read_continue(hub);
+			break;
+
+		case UHUB_EVENT_SEND_BUDGET:
+			route_enforce_send_budget(hub);
+			break;
+
 		case UHUB_EVENT_HUB_SHUTDOWN:
 			user = (struct hub_user*) list_get_first(hub->users->list);
 			while (user)
@@ -598,6 +630,19 @@ static void hub_update_stats(struct hub_info* hub)
 	const int factor = TIMEOUT_STATS;
 	struct net_statistics* total;
 	struct net_statistics* intermediate;
+
+	/* The network is shared by all hubs in the process, only the main hub samples it */
+	if (g_hub && hub != g_hub)
+	{
+		hub->stats.net_tx = g_hub->stats.net_tx;
+		hub->stats.net_rx = g_hub->stats.net_rx;
+		hub->stats.net_tx_peak = g_hub->stats.net_tx_peak;
+		hub->stats.net_rx_peak = g_hub->stats.net_rx_peak;
+		hub->stats.net_tx_total = g_hub->stats.net_tx_total;
+		hub->stats.net_rx_total = g_hub->stats.net_rx_total;
+		return;
+	}
+
 	net_stats_get(&intermediate, &total);
 
 	hub->stats.net_tx = (intermediate->tx / factor);
@@ -629,6 +674,22 @@ static struct net_connection* start_listening_socket(const char* bind_addr, uint
 		return 0;
 	}
 
+#ifndef WIN32
+	/* Keep listening on the socket of the process we are replacing */
+	sd = hub_upgrade_take_listener((struct sockaddr*) &addr, sockaddr_size);
+	if (sd != -1)
+	{
+		server = net_con_create();
+		if (net_con_initialize(server, sd, net_on_accept, hub, NET_EVENT_READ) == -1)
+		{
+			net_con_destroy(server);
+			net_close(sd);
+			return 0;
+		}
+		return server;
+	}
+#endif
+
 	sd = net_socket_create(addr.ss_family, SOCK_STREAM, IPPROTO_TCP);
 	if (sd == -1)
 	{
@@ -658,7 +719,12 @@ static struct net_connection* start_listening_socket(const char* bind_addr, uint
 	}
 
 	server = net_con_create();
-	net_con_initialize(server, sd, net_on_accept, hub, NET_EVENT_READ);
+	if (net_con_initialize(server, sd, net_on_accept, hub, NET_EVENT_READ) == -1)
+	{
+		net_con_destroy(server);
+		net_close(sd);
+		return 0;
+	}
 
 	return server;
 }
@@ -729,6 +795,14 @@ static int load_ssl_certificates(struct hub_info* hub, struct hub_config* config
 	if (!hub->ctx)
 	  return 0;
 
+	if (config->tls_ktls && !net_ssl_context_set_ktls(hub->ctx, 1))
+		LOG_WARN("Kernel TLS is not supported by %s, TLS is handled in user space.", net_ssl_get_provider());
+
+	net_ssl_context_set_session_cache(hub->ctx, config->tls_session_cache, config->tls_session_timeout);
+
+	if (!net_ssl_context_set_tickets(hub->ctx, config->tls_ticket_key_rotate > 0))
+		return 0;
+
 	if (!ssl_load_certificate(hub->ctx, config->tls_certificate))
 		return 0;
 
@@ -747,12 +821,56 @@ static int load_ssl_certificates(struct hub_info* hub, struct hub_config* config
 
 static void unload_ssl_certificates(struct hub_info* hub)
 {
+	if (hub->tls_ticket_timeout)
+	{
+		timeout_queue_remove(net_backend_get_timeout_queue(), hub->tls_ticket_timeout);
+		hub_free(hub->tls_ticket_timeout);
+	}
+
 	if (hub->ctx)
 		net_ssl_context_destroy(hub->ctx);
 }
+
+/*
+ * The timeout queue only spans a couple of minutes, so check the age
+ * of the ticket key periodically rather than waiting for the whole interval.
+ */
+static void hub_timer_tls_ticket_key(struct timeout_evt* t)
+{
+	struct hub_info* hub = (struct hub_info*) t->ptr;
+	time_t now = net_get_time();
+
+	if (now - hub->tls_ticket_rotated >= (time_t) hub->config->tls_ticket_key_rotate && net_ssl_context_rotate_ticket_key(hub->ctx))
+	{
+		hub->tls_ticket_rotated = now;
+		LOG_DEBUG("Rotated TLS session ticket key");
+	}
+	timeout_queue_reschedule(net_backend_get_timeout_queue(), hub->tls_ticket_timeout, MIN(TIMEOUT_TLS_TICKET, hub->config->tls_ticket_key_rotate));
+}
+
+static void start_ssl_ticket_rotation(struct hub_info* hub, struct hub_config* config)
+{
+	if (!hub->ctx || !config->tls_ticket_key_rotate || !net_backend_get_timeout_queue())
+		return;
+
+	hub->tls_ticket_rotated = net_get_time();
+	hub->tls_ticket_timeout = hub_malloc_zero(sizeof(struct timeout_evt));
+	timeout_evt_initialize(hub->tls_ticket_timeout, hub_timer_tls_ticket_key, hub);
+	timeout_queue_insert(net_backend_get_timeout_queue(), hub->tls_ticket_timeout, MIN(TIMEOUT_TLS_TICKET, config->tls_ticket_key_rotate));
+}
 #endif /* SSL_SUPPORT */
 
-struct hub_info* hub_start_service(struct hub_config* config)
+static void hub_close_listener(struct hub_info* hub)
+{
+	if (hub->server)
+		net_con_close(hub->server);
+#ifdef SSL_SUPPORT
+	if (hub->listener && hub->ctx)
+		net_ssl_context_remove_sni(hub->listener->ctx, hub->ctx);
+#endif
+}
+
+static struct hub_info* hub_start(struct hub_config* config, struct hub_info* listener)
 {
 	struct hub_info* hub = 0;
 	int ipv6_supported;
@@ -771,18 +889,35 @@ struct hub_info* hub_start_service(struct hub_config* config)
 	else
 		LOG_DEBUG("IPv6 not supported.");
 
-	hub->server = start_listening_socket(config->server_bind_addr, config->server_port, config->server_listen_backlog, hub);
-	if (!hub->server)
+	if (listener)
 	{
-		hub_free(hub);
-		LOG_FATAL("Unable to start hub service");
-		return 0;
+		hub->listener = listener;
+		LOG_INFO("Starting virtual hub \"%s\", sharing port %d for TLS server name %s...", config->hub_name, config->server_port, config->tls_sni_name);
+	}
+	else
+	{
+		hub->server = start_listening_socket(config->server_bind_addr, config->server_port, config->server_listen_backlog, hub);
+		if (!hub->server)
+		{
+			hub_free(hub);
+			LOG_FATAL("Unable to start hub service");
+			return 0;
+		}
+		LOG_INFO("Starting " PRODUCT "/" VERSION ", listening on %s:%d...", net_get_local_address(hub->server->sd), config->server_port);
 	}
-	LOG_INFO("Starting " PRODUCT "/" VERSION ", listening on %s:%d...", net_get_local_address(hub->server->sd), config->server_port);
 
 #ifdef SSL_SUPPORT
 	if (!load_ssl_certificates(hub, config))
 	{
+		hub_close_listener(hub);
+		hub_free(hub);
+		return 0;
+	}
+
+	if (listener && (!hub->ctx || !listener->ctx || !net_ssl_context_add_sni(listener->ctx, config->tls_sni_name, hub->ctx)))
+	{
+		LOG_ERROR("Unable to share port %d, TLS must be enabled for both hubs.", config->server_port);
+		unload_ssl_certificates(hub);
 		hub_free(hub);
 		return 0;
 	}
@@ -794,14 +929,15 @@ struct hub_info* hub_start_service(struct hub_config* config)
 	hub->users = uman_init();
 	if (!hub->users)
 	{
-		net_con_close(hub->server);
+		hub_close_listener(hub);
 		hub_free(hub);
 		return 0;
 	}
+	sid_pool_set_reuse_delay(hub->users->sids, config->sid_reuse_delay);
 
 	if (event_queue_initialize(&hub->queue, hub_event_dispatcher, (void*) hub) == -1)
 	{
-		net_con_close(hub->server);
+		hub_close_listener(hub);
 		uman_shutdown(hub->users);
 		hub_free(hub);
 		return 0;
@@ -811,7 +947,7 @@ struct hub_info* hub_start_service(struct hub_config* config)
 	hub->sendbuf = hub_malloc(MAX_SEND_BUF);
 	if (!hub->recvbuf || !hub->sendbuf)
 	{
-		net_con_close(hub->server);
+		hub_close_listener(hub);
 		hub_free(hub->recvbuf);
 		hub_free(hub->sendbuf);
 		uman_shutdown(hub->users);
@@ -819,11 +955,22 @@ struct hub_info* hub_start_service(struct hub_config* config)
 		return 0;
 	}
 
-	server_alt_port_start(hub, config);
+	if (!listener)
+		server_alt_port_start(hub, config);
+
+	if (config->pool_prewarm)
+	{
+		net_backend_con_prewarm(config->pool_prewarm);
+		probe_pool_prewarm(config->pool_prewarm);
+		user_pool_prewarm(config->pool_prewarm);
+		ioq_pool_prewarm(config->pool_prewarm);
+	}
 
 	hub->status = hub_status_running;
 
-	g_hub = hub;
+	/* The first hub started is the main hub, see vhub.h */
+	if (!g_hub)
+		g_hub = hub;
 
 	if (net_backend_get_timeout_queue())
 	{
@@ -832,11 +979,55 @@ struct hub_info* hub_start_service(struct hub_config* config)
 		timeout_queue_insert(net_backend_get_timeout_queue(), hub->stats.timeout, TIMEOUT_STATS);
 	}
 
+#ifdef SSL_SUPPORT
+	start_ssl_ticket_rotation(hub, config);
+#endif
+
 	// Start the hub command sub-system
 	hub->commands = command_initialize(hub);
+
+	// Completed asynchronous logins are delivered through this queue
+	hub->auth_requests = acl_request_queue_create(hub);
+
+	// CID checks of users logging in are batched through this queue
+	hub->login_queue = list_create();
+
+	// Users with lines left after using up their read budget
+	hub->read_queue = list_create();
+
+	if (*config->file_capture)
+	{
+		hub->capture = capture_open_write(config->file_capture);
+		if (hub->capture)
+			LOG_INFO("Capturing client traffic to %s", config->file_capture);
+	}
+
+	if (link_start(hub, config) == -1)
+	{
+		LOG_FATAL("Unable to start linking to other hubs");
+		hub_shutdown_service(hub);
+		return 0;
+	}
+
+	if (balance_start(hub, config) == -1)
+	{
+		LOG_FATAL("Unable to start exchanging load reports");
+		hub_shutdown_service(hub);
+		return 0;
+	}
 	return hub;
 }
 
+struct hub_info* hub_start_service(struct hub_config* config)
+{
+	return hub_start(config, NULL);
+}
+
+struct hub_info* hub_start_virtual_service(struct hub_config* config, struct hub_info* listener)
+{
+	return hub_start(config, listener);
+}
+
 
 void hub_shutdown_service(struct hub_info* hub)
 {
@@ -848,21 +1039,31 @@ void hub_shutdown_service(struct hub_info* hub)
 		hub_free(hub->stats.timeout);
 	}
 
+	hub_close_listener(hub);
+	balance_shutdown(hub);
+
 #ifdef SSL_SUPPORT
 	unload_ssl_certificates(hub);
 #endif
 
+	/* Destroy the users of the links closed */
+	if (link_shutdown(hub))
+		event_queue_process(hub->queue);
+
 	event_queue_shutdown(hub->queue);
-	net_con_close(hub->server);
 	server_alt_port_stop(hub);
+	capture_close(hub->capture);
 	uman_shutdown(hub->users);
+	acl_request_queue_destroy(hub->auth_requests);
+	list_destroy(hub->login_queue);
+	list_destroy(hub->read_queue);
 	hub->status = hub_status_stopped;
 	hub_free(hub->sendbuf);
 	hub_free(hub->recvbuf);
 	command_shutdown(hub->commands);
+	if (g_hub == hub)
+		g_hub = 0;
 	hub_free(hub);
-	hub = 0;
-	g_hub = 0;
 }
 
 int hub_plugins_load(struct hub_info* hub)
@@ -893,12 +1094,11 @@ void hub_plugins_unload(struct hub_info* hub)
 	}
 }
 
-void hub_set_variables(struct hub_info* hub, struct acl_handle* acl)
+static void hub_messages_create(struct hub_info* hub)
 {
 	char* tmp;
 	char* server = adc_msg_escape(PRODUCT_STRING); /* FIXME: OOM */
 
-	hub->acl = acl;
 	hub->command_info = adc_msg_construct(ADC_CMD_IINF, 15);
 	if (hub->command_info)
 	{
@@ -931,6 +1131,26 @@ void hub_set_variables(struct hub_info* hub, struct acl_handle* acl)
 		adc_msg_add_argument_string(hub->command_banner, tmp);
 	}
 
+	hub_free(server);
+}
+
+static void hub_messages_free(struct hub_info* hub)
+{
+	adc_msg_free(hub->command_info);
+	adc_msg_free(hub->command_banner);
+	adc_msg_free(hub->command_support);
+	hub->command_info = 0;
+	hub->command_banner = 0;
+	hub->command_support = 0;
+}
+
+void hub_set_variables(struct hub_info* hub, struct acl_handle* acl)
+{
+	hub->acl = acl;
+	file_get_stamp(hub->config->file_acl, &hub->acl_stamp);
+
+	hub_messages_create(hub);
+
 	if (hub_plugins_load(hub) < 0)
 	{
 		LOG_FATAL("Unable to load plugins.");
@@ -940,18 +1160,125 @@ void hub_set_variables(struct hub_info* hub, struct acl_handle* acl)
 	{
 		hub->status = (hub->config->hub_enabled ? hub_status_running : hub_status_disabled);
 	}
+}
 
-	hub_free(server);
+static void hub_config_changed(const char* key, int restart, void* ptr)
+{
+	if (restart)
+		LOG_WARN("Configuration \"%s\" changed, this takes effect when the hub is restarted.", key);
+	else
+		LOG_DEBUG("Configuration \"%s\" changed.", key);
+}
+
+/* Monotonic clock in microseconds, for timing configuration reloads */
+static uint64_t hub_get_time_usec()
+{
+#ifdef WIN32
+	return (uint64_t) GetTickCount64() * 1000;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t) ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+#endif
+}
+
+/* Reload the access control list if its file was changed, returns 1 if reloaded. */
+static int hub_reload_acl(struct hub_info* hub, const struct hub_config* previous)
+{
+	struct acl_handle acl;
+	struct file_stamp stamp;
+
+	file_get_stamp(hub->config->file_acl, &stamp);
+	if (!strcmp(previous->file_acl, hub->config->file_acl) && !memcmp(&stamp, &hub->acl_stamp, sizeof(stamp)))
+		return 0;
+
+	if (acl_initialize(hub->config, &acl) == -1)
+	{
+		LOG_ERROR("Unable to reload access control list, keeping the current one.");
+		acl_shutdown(&acl);
+		return 0;
+	}
+
+	acl_shutdown(hub->acl);
+	memcpy(hub->acl, &acl, sizeof(acl));
+	hub->acl_stamp = stamp;
+	return 1;
+}
+
+static int hub_reload_plugins(struct hub_info* hub, struct plugin_reload_info* info)
+{
+	memset(info, 0, sizeof(struct plugin_reload_info));
+
+	if (!*hub->config->file_plugins)
+	{
+		if (hub->plugins)
+			info->unloaded = list_size(hub->plugins->loaded);
+		hub_plugins_unload(hub);
+		return 0;
+	}
+
+	if (!hub->plugins)
+	{
+		if (hub_plugins_load(hub) < 0)
+			return -1;
+		info->loaded = list_size(hub->plugins->loaded);
+		return 0;
+	}
+
+	return plugin_reconfigure(hub->config, hub, info);
+}
+
+int hub_reconfigure(struct hub_info* hub, struct hub_config* config)
+{
+	struct hub_config previous;
+	struct plugin_reload_info plugins;
+	uint64_t started = hub_get_time_usec();
+	uint64_t elapsed;
+	int changed;
+	int acl_reloaded;
+	int ret = 0;
+
+	memcpy(&previous, hub->config, sizeof(struct hub_config));
+	memcpy(hub->config, config, sizeof(struct hub_config));
+	memset(config, 0, sizeof(struct hub_config));
+
+	changed = compare_config(&previous, hub->config, hub_config_changed, hub);
+	acl_reloaded = hub_reload_acl(hub, &previous);
+
+	if (strcmp(previous.hub_name, hub->config->hub_name) ||
+		strcmp(previous.hub_description, hub->config->hub_description) ||
+		strcmp(previous.failover_redirect_addr, hub->config->failover_redirect_addr) ||
+		previous.show_banner_sys_info != hub->config->show_banner_sys_info)
+	{
+		hub_messages_free(hub);
+		hub_messages_create(hub);
+	}
+
+	if (hub_reload_plugins(hub, &plugins) < 0)
+	{
+		LOG_FATAL("Unable to load plugins.");
+		hub->status = hub_status_shutdown;
+		ret = -1;
+	}
+	else
+	{
+		hub->status = (hub->config->hub_enabled ? hub_status_running : hub_status_disabled);
+	}
+
+	free_config(&previous);
+
+	elapsed = hub_get_time_usec() - started;
+	LOG_INFO("Configuration reloaded in %d.%03d ms: %d settings changed, access control list %s, plugins: %" PRIsz " kept, %" PRIsz " loaded, %" PRIsz " unloaded.",
+		(int) (elapsed / 1000), (int) (elapsed % 1000), changed, (acl_reloaded ? "reloaded" : "unchanged"),
+		plugins.kept, plugins.loaded, plugins.unloaded);
+	return ret;
 }
 
 
 void hub_free_variables(struct hub_info* hub)
 {
 	hub_plugins_unload(hub);
-
-	adc_msg_free(hub->command_info);
-	adc_msg_free(hub->command_banner);
-	adc_msg_free(hub->command_support);
+	hub_messages_free(hub);
 }
 
 static void set_status_code(enum msg_status_level level, int code, char buffer[4])
@@ -977,6 +1304,7 @@ void hub_send_status(struct hub_info* hub, struct hub_user* user, enum status_me
 	char buf[256];
 	const char* text = 0;
 	const char* flag = 0;
+	const char* redirect_addr;
 	char* escaped_text = 0;
 	int reconnect_time = 0;
 	int redirect = 0;
@@ -1050,9 +1378,14 @@ void hub_send_status(struct hub_info* hub, struct hub_user* user, enum status_me
 			adc_msg_add_argument(qui, buf);
 		}
 
-		if (redirect && *hub->config->redirect_addr)
+		/* Send users to a less loaded hub of the pool rather than to redirect_addr */
+		redirect_addr = (msg == status_msg_hub_full) ? balance_redirect(hub) : NULL;
+		if (!redirect_addr)
+			redirect_addr = hub->config->redirect_addr;
+
+		if (redirect && *redirect_addr)
 		{
-			snprintf(buf, 255, "RD%s", hub->config->redirect_addr);
+			snprintf(buf, 255, "RD%s", redirect_addr);
 			adc_msg_add_argument(qui, buf);
 		}
 		route_to_user(hub, user, qui);
@@ -1254,12 +1587,26 @@ void hub_disconnect_all(struct hub_info* hub)
 	event_queue_post(hub->queue, &post);
 }
 
+void hub_capture_message(struct hub_info* hub, struct hub_user* user, const char* message, size_t length)
+{
+	if (!user->capture_id)
+	{
+		const char* address = user_get_address(user);
+		user->capture_id = ++hub->capture_last_id;
+		capture_write(hub->capture, capture_connect, user->capture_id, 0, address, strlen(address));
+	}
+	capture_write(hub->capture, capture_line, user->capture_id, user->id.sid, message, length);
+}
+
 void hub_event_loop(struct hub_info* hub)
 {
+	int pending = 0;
 	do
 	{
-		net_backend_process();
-		event_queue_process(hub->queue);
+		/* Do not wait for network activity if events are waiting to be processed */
+		net_backend_process_timeout(pending ? 0 : -1);
+		pending = event_queue_process(hub->queue);
+		pending += vhub_process(hub);
 	}
 	while (hub->status == hub_status_running || hub->status == hub_status_disabled);
 
@@ -1269,6 +1616,7 @@ void hub_event_loop(struct hub_info* hub)
 		LOG_DEBUG("Removing all users...");
 		event_queue_process(hub->queue);
 		event_queue_process(hub->queue);
+		link_shutdown(hub);
 		hub_disconnect_all(hub);
 		event_queue_process(hub->queue);
 		hub->status = hub_status_stopped;
@@ -1287,6 +1635,13 @@ void hub_disconnect_user(struct hub_info* hub, struct hub_user* user, int reason
 		return;
 	}
 
+	if (hub->capture && user->capture_id)
+		capture_write(hub->capture, capture_disconnect, user->capture_id, user->id.sid, 0, 0);
+
+	hub_handle_info_login_cancel(hub, user);
+	handle_net_read_cancel(hub, user);
+	link_disconnected(hub, user);
+
 	/* stop reading from user */
 	net_shutdown_r(net_con_get_sd(user->connection));
 	net_con_close(user->connection);
@@ -1294,7 +1649,8 @@ void hub_disconnect_user(struct hub_info* hub, struct hub_user* user, int reason
 
 	LOG_TRACE("hub_disconnect_user(), user=%p, reason=%d, state=%d", user, reason, user->state);
 
-	need_notify = user_is_logged_in(user) && hub->status == hub_status_running;
+	/* Users leaving during an upgrade are announced, the send queues with the quit messages are handed over */
+	need_notify = user_is_logged_in(user) && (hub->status == hub_status_running || hub->status == hub_status_upgrade);
 	user->quit_reason = reason;
 	user_set_state(user, state_cleanup);
 
@@ -68,6 +68,7 @@ enum hub_state
 	hub_status_shutdown      = 3, /**<<<"Hub is shutting down, but not yet stopped. */
 	hub_status_stopped       = 4, /**<<<"Hub is stopped (Pretty much the same as initialized) */
 	hub_status_disabled      = 5, /**<<<"Hub is disabled (Running, but not accepting users) */
+	hub_status_upgrade       = 6, /**<<<"Hub is handing over to a new process (see hub_upgrade_start) */
 };
 
 /**
@@ -81,18 +82,26 @@ struct hub_stats
 	size_t net_rx_peak;
 	size_t net_tx_total;
 	size_t net_rx_total;
+	size_t read_deferred;           /**<< "Times a user ran out of read budget" */
+	size_t read_paused;             /**<< "Times reading from a user was paused, send queue congested" */
+	size_t send_queued;             /**<< "Bytes queued for sending to all users" */
+	size_t send_queued_peak;        /**<< "Most bytes queued for sending at once" */
+	size_t send_dropped;            /**<< "Messages discarded, send queue full" */
+	size_t send_evicted;            /**<< "Users disconnected to stay within max_send_buffer_total" */
 	struct timeout_evt* timeout;    /**<< "Timeout handler for statistics" */
 };
 
 struct hub_info
 {
-	struct net_connection* server;
+	struct net_connection* server;       /* NULL if connections are accepted by the listener hub */
+	struct hub_info* listener;           /* Hub sharing its port with this virtual hub, or NULL (see tls_sni_name) */
 	struct linked_list* server_alt_ports;
 	struct hub_stats stats;
 	struct event_queue* queue;
 	struct hub_config* config;
 	struct hub_user_manager* users;
 	struct acl_handle* acl;
+	struct file_stamp acl_stamp;         /* The access control list file, as it was loaded */
 	struct adc_message* command_info;    /* The hub's INF command */
 	struct adc_message* command_support; /* The hub's SUP command */
 	struct adc_message* command_banner;  /* The default welcome message */
@@ -103,9 +112,20 @@ struct hub_info
 
 	struct command_base* commands;       /* Hub command handler */
 	struct uhub_plugins* plugins;        /* Plug-ins loaded for this hub instance. */
+	struct auth_request_queue* auth_requests; /* Completed asynchronous access info lookups */
+	struct linked_list* login_queue;     /* Users waiting for CID verification (see hub_handle_info_login_verify) */
+	struct linked_list* read_queue;      /* Users that ran out of read budget (see handle_net_read_continue) */
+	int send_evict_pending;              /* Disconnecting slow users is scheduled (see route_enforce_send_budget) */
+	struct linked_list* handed_over;     /* Users handed over by the listener hub, not logged in yet (see vhub_select) */
+	struct capture_file* capture;        /* Traffic capture (see file_capture), or NULL */
+	uint32_t capture_last_id;            /* Last connection id given out in the capture */
+	struct link_manager* links;          /* Links to other hubs (see link_node_id), or NULL */
+	struct balance_manager* balance;     /* Load reports of a pool of hubs (see balance_port), or NULL */
 
 #ifdef SSL_SUPPORT
 	struct ssl_context_handle* ctx;
+	struct timeout_evt* tls_ticket_timeout; /* Rotates the session ticket key (see tls_ticket_key_rotate) */
+	time_t tls_ticket_rotated;              /* When the session ticket key was last changed */
 #endif /*  SSL_SUPPORT */
 };
 
@@ -119,6 +139,19 @@ struct hub_info
  */
 extern int hub_handle_message(struct hub_info* hub, struct hub_user* u, const char* message, size_t length);
 
+/**
+ * Record a message received from a user in the traffic capture.
+ * Must only be called if hub->capture is set.
+ */
+extern void hub_capture_message(struct hub_info* hub, struct hub_user* u, const char* message, size_t length);
+
+/**
+ * Let a user in once the login checks have passed, or send a password
+ * challenge if need_auth is set.
+ * This is normally done by posting UHUB_EVENT_USER_JOIN.
+ */
+extern void hub_user_join(struct hub_info* hub, struct hub_user* user, int need_auth);
+
 /**
  * Handle protocol support/subscription messages received clients.
  *
@@ -207,6 +240,13 @@ extern void hub_send_flood_warning(struct hub_info*, struct hub_user* user, cons
  */
 extern struct hub_info* hub_start_service(struct hub_config* config);
 
+/**
+ * Start a virtual hub that does not listen itself, but gets the TLS
+ * clients asking for its tls_sni_name from the listener hub.
+ * Both hubs must have TLS enabled.
+ */
+extern struct hub_info* hub_start_virtual_service(struct hub_config* config, struct hub_info* listener);
+
 /**
  * This shuts down the hub.
  */
@@ -217,6 +257,20 @@ extern void hub_shutdown_service(struct hub_info* hub);
  */
 extern void hub_set_variables(struct hub_info* hub, struct acl_handle* acl);
 
+/**
+ * Apply a newly read configuration to a running hub.
+ * Only what has changed is rebuilt: the access control list is reloaded
+ * if its file changed, and plugins are kept loaded unless their
+ * configuration changed (see plugin_reconfigure()).
+ * Settings that are only used on startup are reported, but not applied.
+ *
+ * The hub takes over the contents of config, the previous configuration
+ * is freed.
+ *
+ * @return 0 on success, -1 if plugins could not be loaded (the hub is then shut down).
+ */
+extern int hub_reconfigure(struct hub_info* hub, struct hub_config* config);
+
 /**
  * This frees the configuration of the hub.
  */
@@ -335,6 +389,11 @@ extern void hub_schedule_destroy_user(struct hub_info* hub, struct hub_user* use
  */
 extern void hub_disconnect_user(struct hub_info* hub, struct hub_user* user, int reason);
 
+/**
+ * Disconnect all logged in users, when the hub shuts down.
+ */
+extern void hub_disconnect_all(struct hub_info* hub);
+
 
 #endif /* HAVE_UHUB_HUB_H */
 
@@ -23,17 +23,36 @@
 /* Notify plugins, etc */
 void on_login_success(struct hub_info* hub, struct hub_user* u)
 {
-	/* Send user list of all existing users */
-	if (!uman_send_user_list(hub, hub->users, u))
+	/* Hub links do not join the hub, see link.h */
+	if (user_flag_get(u, feature_link))
+	{
+		vhub_release(u);
+		link_accept(hub, u);
+		return;
+	}
+
+	/* Send user list of all existing users, including those on linked hubs */
+	if (!uman_send_user_list(hub, hub->users, u) || !link_send_user_list(hub, u))
 		return;
 
+	/* Users that left must be gone before the new user shows up, in case a SID is reused */
+	uman_flush_quit_messages(hub, hub->users);
+
 	/* Mark as being in the normal state, and add user to the user list */
 	user_set_state(u, state_normal);
 	uman_add(hub->users, u);
+	vhub_release(u);
+
+	/* The whole user list is queued, from now on the send queue limits apply once it is sent */
+	if (ioq_send_is_empty(u->send_queue))
+		user_flag_unset(u, flag_user_list);
 
 	/* Announce new user to all connected users */
 	if (user_is_logged_in(u))
+	{
 		route_info_message(hub, u);
+		link_broadcast(hub, user_get_info(u, NULL));
+	}
 
 	plugin_log_user_login_success(hub, u);
 
@@ -87,66 +87,59 @@ static int check_hash_tiger(const char* cid, const char* pid)
 }
 
 
-/*
- * FIXME: Only works for tiger hash. If a client doesn't support tiger we cannot let it in!
- */
-static int check_cid(struct hub_info* hub, struct hub_user* user, struct adc_message* cmd)
+static int check_cid_format(const char* cid, const char* pid)
 {
 	size_t pos;
-	char* cid = adc_msg_get_named_argument(cmd, ADC_INF_FLAG_CLIENT_ID);
-	char* pid = adc_msg_get_named_argument(cmd, ADC_INF_FLAG_PRIVATE_ID);
-
-	if (!cid || !pid)
-	{
-		hub_free(cid);
-		hub_free(pid);
-		return status_msg_error_no_memory;
-	}
 
 	if (strlen(cid) != MAX_CID_LEN)
-	{
-		hub_free(cid);
-		hub_free(pid);
 		return status_msg_inf_error_cid_invalid;
-	}
 
 	if (strlen(pid) != MAX_CID_LEN)
-	{
-		hub_free(cid);
-		hub_free(pid);
 		return status_msg_inf_error_pid_invalid;
-	}
 
 	for (pos = 0; pos < MAX_CID_LEN; pos++)
 	{
 		if (!is_valid_base32_char(cid[pos]))
-		{
-			hub_free(cid);
-			hub_free(pid);
 			return status_msg_inf_error_cid_invalid;
-		}
 
 		if (!is_valid_base32_char(pid[pos]))
-		{
-			hub_free(cid);
-			hub_free(pid);
 			return status_msg_inf_error_pid_invalid;
-		}
 	}
+	return 0;
+}
+
+
+/*
+ * FIXME: Only works for tiger hash. If a client doesn't support tiger we cannot let it in!
+ *
+ * If 'verify' is 0 only the format is checked, and the CID must be
+ * verified later (see hub_handle_info_login_verify).
+ */
+static int check_cid(struct hub_info* hub, struct hub_user* user, struct adc_message* cmd, int verify)
+{
+	int ret;
+	char* cid = adc_msg_get_named_argument(cmd, ADC_INF_FLAG_CLIENT_ID);
+	char* pid = adc_msg_get_named_argument(cmd, ADC_INF_FLAG_PRIVATE_ID);
 
-	if (!check_hash_tiger(cid, pid))
+	if (!cid || !pid)
 	{
 		hub_free(cid);
 		hub_free(pid);
-		return status_msg_inf_error_cid_invalid;
+		return status_msg_error_no_memory;
 	}
 
-	/* Set the cid in the user object (have already validated the length) */
-	memcpy(user->id.cid, cid, MAX_CID_LEN + 1);
+	ret = check_cid_format(cid, pid);
+	if (!ret && verify)
+	{
+		if (!check_hash_tiger(cid, pid))
+			ret = status_msg_inf_error_cid_invalid;
+		else /* Set the cid in the user object (have already validated the length) */
+			memcpy(user->id.cid, cid, MAX_CID_LEN + 1);
+	}
 
 	hub_free(cid);
 	hub_free(pid);
-	return 0;
+	return ret;
 }
 
 
@@ -335,6 +328,18 @@ static int check_logged_in(struct hub_info* hub, struct hub_user* user, struct a
 	if (lookup1 == user)
 		return 0;
 
+	if (link_has_nick(hub, user->id.nick))
+	{
+		LOG_DEBUG("check_logged_in: nickname is in use on a linked hub: %s", user->id.nick);
+		return status_msg_inf_error_nick_taken;
+	}
+
+	if (link_has_cid(hub, user->id.cid))
+	{
+		LOG_DEBUG("check_logged_in: CID is in use on a linked hub: %s", user->id.cid);
+		return status_msg_inf_error_cid_taken;
+	}
+
 	if (!lookup1 && !lookup2)
 		return 0;
 
@@ -574,21 +579,25 @@ static int check_limits(struct hub_info* hub, struct hub_user* user, struct adc_
  * If the hub is configured to allow only registered users and the user
  * is not recognized this will return 1.
  */
-static int set_credentials(struct hub_info* hub, struct hub_user* user, struct adc_message* cmd)
+static int set_credentials(struct hub_info* hub, struct hub_user* user, struct adc_message* cmd, struct auth_info* info)
 {
 	int ret = 0;
-	struct auth_info* info = acl_get_access_info(hub, user->id.nick);
 
 	if (info)
 	{
 		user->credentials = info->credentials;
 		ret = 1;
+
+		/* Keep the info around until the password is verified */
+		hub_free(user->auth_info);
+		user->auth_info = hub_malloc(sizeof(struct auth_info));
+		if (user->auth_info)
+			memcpy(user->auth_info, info, sizeof(struct auth_info));
 	}
 	else
 	{
 		user->credentials = auth_cred_guest;
 	}
-	hub_free(info);
 
 	switch (user->credentials)
 	{
@@ -654,6 +663,16 @@ static int check_is_hub_full(struct hub_info* hub, struct hub_user* user)
 }
 
 
+/*
+ * An overloaded hub sends new users to a less loaded hub of the pool,
+ * if there is one (see balance_port).
+ */
+static int check_is_hub_overloaded(struct hub_info* hub, struct hub_user* user)
+{
+	return !user_is_protected(user) && balance_should_redirect(hub);
+}
+
+
 static int check_registered_users_only(struct hub_info* hub, struct hub_user* user)
 {
 	if (hub->config->registered_users_only && !user_is_registered(user))
@@ -674,28 +693,6 @@ static int hub_handle_info_common(struct hub_user* user, struct adc_message* cmd
 	return 0;
 }
 
-static int hub_handle_info_low_bandwidth(struct hub_info* hub, struct hub_user* user, struct adc_message* cmd)
-{
-	if (hub->config->low_bandwidth_mode)
-	{
-		adc_msg_remove_named_argument(cmd, ADC_INF_FLAG_USER_AGENT_VERSION);
-		adc_msg_remove_named_argument(cmd, ADC_INF_FLAG_USER_AGENT_PRODUCT);
-		adc_msg_remove_named_argument(cmd, ADC_INF_FLAG_SHARED_FILES);
-		adc_msg_remove_named_argument(cmd, ADC_INF_FLAG_COUNT_HUB_NORMAL);
-		adc_msg_remove_named_argument(cmd, ADC_INF_FLAG_COUNT_HUB_REGISTER);
-		adc_msg_remove_named_argument(cmd, ADC_INF_FLAG_COUNT_HUB_OPERATOR);
-		adc_msg_remove_named_argument(cmd, ADC_INF_FLAG_UPLOAD_SPEED);
-		adc_msg_remove_named_argument(cmd, ADC_INF_FLAG_DOWNLOAD_SPEED);
-		adc_msg_remove_named_argument(cmd, ADC_INF_FLAG_AUTO_SLOTS);
-		adc_msg_remove_named_argument(cmd, ADC_INF_FLAG_AUTO_SLOTS_MAX);
-		adc_msg_remove_named_argument(cmd, ADC_INF_FLAG_AWAY);
-		adc_msg_remove_named_argument(cmd, ADC_INF_FLAG_DESCRIPTION);
-		adc_msg_remove_named_argument(cmd, ADC_INF_FLAG_EMAIL);
-	}
-
-	return 0;
-}
-
 #define INF_CHECK(FUNC, HUB, USER, CMD) \
 	do { \
 		int ret = FUNC(HUB, USER, CMD); \
@@ -705,9 +702,7 @@ static int hub_handle_info_low_bandwidth(struct hub_info* hub, struct hub_user*
 
 static int hub_perform_login_checks(struct hub_info* hub, struct hub_user* user, struct adc_message* cmd)
 {
-	/* Make syntax checks.  */
-	INF_CHECK(check_required_login_flags, hub, user, cmd);
-	INF_CHECK(check_cid,                  hub, user, cmd);
+	/* Make syntax checks. The CID has been checked at this point. */
 	INF_CHECK(check_nick,                 hub, user, cmd);
 	INF_CHECK(check_network,              hub, user, cmd);
 	INF_CHECK(check_user_agent,           hub, user, cmd);
@@ -716,24 +711,23 @@ static int hub_perform_login_checks(struct hub_info* hub, struct hub_user* user,
 	return 0;
 }
 
-/**
- * Perform additional INF checks used at time of login.
+/* Returned by hub_handle_info_login() while the access info lookup is in progress */
+#define LOGIN_PENDING 2
+
+/* Max number of CIDs hashed together by hub_handle_info_login_verify() */
+#define LOGIN_VERIFY_BATCH 64
+
+/*
+ * Finish the login checks once the access info (if any) is known.
  *
  * @return 0 if success, <0 if error, >0 if authentication needed.
  */
-int hub_handle_info_login(struct hub_info* hub, struct hub_user* user, struct adc_message* cmd)
+static int hub_handle_info_login_credentials(struct hub_info* hub, struct hub_user* user, struct adc_message* cmd, struct auth_info* info)
 {
-	int code = 0;
-
-	INF_CHECK(hub_perform_login_checks, hub, user, cmd);
-
-	/* Private ID must never be broadcasted - drop it! */
-	adc_msg_remove_named_argument(cmd, ADC_INF_FLAG_PRIVATE_ID);
-
-	code = set_credentials(hub, user, cmd);
+	int code = set_credentials(hub, user, cmd, info);
 
 	/* Note: this must be done *after* set_credentials. */
-	if (check_is_hub_full(hub, user))
+	if (check_is_hub_full(hub, user) || check_is_hub_overloaded(hub, user))
 	{
 		return status_msg_hub_full;
 	}
@@ -745,8 +739,9 @@ int hub_handle_info_login(struct hub_info* hub, struct hub_user* user, struct ad
 
 	INF_CHECK(check_limits, hub, user, cmd);
 
-	/* strip off stuff if low_bandwidth_mode is enabled */
-	hub_handle_info_low_bandwidth(hub, user, cmd);
+	/* users get user info without descriptive fields in low_bandwidth_mode */
+	if (hub->config->low_bandwidth_mode)
+		user_flag_set(user, flag_low_bw);
 
 	/* Set initial user info */
 	user_set_info(user, cmd);
@@ -754,6 +749,211 @@ int hub_handle_info_login(struct hub_info* hub, struct hub_user* user, struct ad
 	return code;
 }
 
+/*
+ * Continue the login checks once the CID has been verified.
+ *
+ * @return see hub_handle_info_login().
+ */
+static int hub_handle_info_login_checked(struct hub_info* hub, struct hub_user* user, struct adc_message* cmd)
+{
+	struct auth_info info;
+
+	INF_CHECK(hub_perform_login_checks, hub, user, cmd);
+
+	/* Private ID must never be broadcasted - drop it! */
+	adc_msg_remove_named_argument(cmd, ADC_INF_FLAG_PRIVATE_ID);
+
+	switch (acl_request_access_info(hub, user, &info))
+	{
+		case acl_access_found:
+			return hub_handle_info_login_credentials(hub, user, cmd, &info);
+
+		case acl_access_pending:
+			/* Hold on to the INF until the lookup is done. */
+			user_set_info(user, cmd);
+			return LOGIN_PENDING;
+
+		default:
+			return hub_handle_info_login_credentials(hub, user, cmd, NULL);
+	}
+}
+
+/**
+ * Perform additional INF checks used at time of login.
+ *
+ * @return 0 if success, <0 if error, >0 if authentication needed,
+ * or LOGIN_PENDING if waiting for an authentication plugin.
+ */
+int hub_handle_info_login(struct hub_info* hub, struct hub_user* user, struct adc_message* cmd)
+{
+	int ret;
+
+	INF_CHECK(check_required_login_flags, hub, user, cmd);
+
+	ret = check_cid(hub, user, cmd, 1);
+	if (ret < 0)
+		return ret;
+
+	return hub_handle_info_login_checked(hub, user, cmd);
+}
+
+static void hub_post_user_join(struct hub_info* hub, struct hub_user* user, int need_auth)
+{
+	/* Post a message, the user has joined */
+	struct event_data post;
+	memset(&post, 0, sizeof(post));
+	post.id    = UHUB_EVENT_USER_JOIN;
+	post.ptr   = user;
+	post.flags = need_auth; /* 0 - all OK, 1 - need authentication */
+	event_queue_post(hub->queue, &post);
+}
+
+void hub_handle_info_login_resume(struct hub_info* hub, struct hub_user* user, struct auth_info* info)
+{
+	int ret;
+	struct adc_message* cmd = user->info;
+
+	if (!user_is_connecting(user) || !cmd)
+		return;
+
+	/* Take over the held INF, it is set again if the login checks pass. */
+	cmd = adc_msg_incref(cmd);
+	user_set_info(user, NULL);
+
+	ret = hub_handle_info_login_credentials(hub, user, cmd, info);
+	if (ret < 0)
+		on_login_failure(hub, user, ret);
+	else
+		hub_post_user_join(hub, user, ret);
+
+	adc_msg_free(cmd);
+}
+
+/*
+ * Queue the INF of a user logging in until hub_handle_info_login_verify()
+ * runs from the event queue, so the CIDs of all users that logged in
+ * during one event loop iteration are hashed together.
+ *
+ * @return <0 if error, or LOGIN_PENDING.
+ */
+static int hub_handle_info_login_queue(struct hub_info* hub, struct hub_user* user, struct adc_message* cmd)
+{
+	struct event_data post;
+	int ret;
+
+	INF_CHECK(check_required_login_flags, hub, user, cmd);
+
+	ret = check_cid(hub, user, cmd, 0);
+	if (ret < 0)
+		return ret;
+
+	/* Hold on to the INF until the CID is verified. */
+	user_set_info(user, cmd);
+	user->login_queued = 1;
+	list_append(hub->login_queue, user);
+
+	if (list_size(hub->login_queue) == 1)
+	{
+		memset(&post, 0, sizeof(post));
+		post.id = UHUB_EVENT_LOGIN_VERIFY;
+		event_queue_post(hub->queue, &post);
+	}
+	return LOGIN_PENDING;
+}
+
+static void hub_handle_info_login_verified(struct hub_info* hub, struct hub_user* user, uint64_t digest[3])
+{
+	int ret;
+	char x_cid[64];
+	char* cid;
+	struct adc_message* cmd = user->info;
+
+	if (!user_is_connecting(user) || !cmd)
+		return;
+
+	/* Take over the held INF, it is set again if the login checks pass. */
+	cmd = adc_msg_incref(cmd);
+	user_set_info(user, NULL);
+
+	base32_encode((unsigned char*) digest, TIGERSIZE, x_cid);
+	x_cid[MAX_CID_LEN] = 0;
+
+	cid = adc_msg_get_named_argument(cmd, ADC_INF_FLAG_CLIENT_ID);
+	if (!cid)
+	{
+		ret = status_msg_error_no_memory;
+	}
+	else if (strncasecmp(x_cid, cid, MAX_CID_LEN) != 0)
+	{
+		ret = status_msg_inf_error_cid_invalid;
+	}
+	else
+	{
+		memcpy(user->id.cid, cid, MAX_CID_LEN + 1);
+		ret = hub_handle_info_login_checked(hub, user, cmd);
+	}
+	hub_free(cid);
+
+	/* Called from the event queue, so there is no need to post a join event. */
+	if (ret < 0)
+		on_login_failure(hub, user, ret);
+	else if (ret != LOGIN_PENDING)
+		hub_user_join(hub, user, ret);
+
+	adc_msg_free(cmd);
+}
+
+void hub_handle_info_login_verify(struct hub_info* hub)
+{
+	struct hub_user* users[LOGIN_VERIFY_BATCH];
+	uint64_t raw_pid[LOGIN_VERIFY_BATCH][8];
+	uint64_t* str[LOGIN_VERIFY_BATCH];
+	uint64_t length[LOGIN_VERIFY_BATCH];
+	uint64_t digest[LOGIN_VERIFY_BATCH][3];
+	struct hub_user* user;
+	size_t count, n;
+	char* pid;
+
+	while (list_size(hub->login_queue))
+	{
+		count = 0;
+		while (count < LOGIN_VERIFY_BATCH && (user = (struct hub_user*) list_get_first(hub->login_queue)))
+		{
+			list_remove_first(hub->login_queue, NULL);
+			user->login_queued = 0;
+
+			pid = adc_msg_get_named_argument(user->info, ADC_INF_FLAG_PRIVATE_ID);
+			if (!pid)
+			{
+				on_login_failure(hub, user, status_msg_error_no_memory);
+				continue;
+			}
+
+			base32_decode(pid, (unsigned char*) raw_pid[count], MAX_CID_LEN);
+			hub_free(pid);
+
+			users[count] = user;
+			str[count] = raw_pid[count];
+			length[count] = TIGERSIZE;
+			count++;
+		}
+
+		tiger_batch(str, length, digest, count);
+
+		for (n = 0; n < count; n++)
+			hub_handle_info_login_verified(hub, users[n], digest[n]);
+	}
+}
+
+void hub_handle_info_login_cancel(struct hub_info* hub, struct hub_user* user)
+{
+	if (user->login_queued)
+	{
+		list_remove(hub->login_queue, user);
+		user->login_queued = 0;
+	}
+}
+
 /*
  * If user is in the connecting state, we need to do fairly
  * strict checking of all arguments.
@@ -792,7 +992,11 @@ int hub_handle_info(struct hub_info* hub, struct hub_user* user, const struct ad
 			return 0;
 		}
 
-		ret = hub_handle_info_login(hub, user, cmd);
+		if (hub->login_queue)
+			ret = hub_handle_info_login_queue(hub, user, cmd);
+		else
+			ret = hub_handle_info_login(hub, user, cmd);
+
 		if (ret < 0)
 		{
 			on_login_failure(hub, user, ret);
@@ -801,13 +1005,8 @@ int hub_handle_info(struct hub_info* hub, struct hub_user* user, const struct ad
 		}
 		else
 		{
-			/* Post a message, the user has joined */
-			struct event_data post;
-			memset(&post, 0, sizeof(post));
-			post.id    = UHUB_EVENT_USER_JOIN;
-			post.ptr   = user;
-			post.flags = ret; /* 0 - all OK, 1 - need authentication */
-			event_queue_post(hub->queue, &post);
+			if (ret != LOGIN_PENDING)
+				hub_post_user_join(hub, user, ret);
 			adc_msg_free(cmd);
 			return 0;
 		}
@@ -839,13 +1038,13 @@ int hub_handle_info(struct hub_info* hub, struct hub_user* user, const struct ad
 		}
 
 		strip_network(user, cmd);
-		hub_handle_info_low_bandwidth(hub, user, cmd);
 
 		user_update_info(user, cmd);
 
 		if (!adc_msg_is_empty(cmd))
 		{
-			route_message(hub, user, cmd);
+			route_info_update(hub, user, cmd);
+			link_broadcast(hub, cmd);
 		}
 
 		adc_msg_free(cmd);
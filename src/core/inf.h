@@ -49,6 +49,26 @@ enum nick_status
  */
 extern int hub_handle_info(struct hub_info* hub, struct hub_user* u, const struct adc_message* cmd);
 
+/**
+ * Continue the login of a user once the access info lookup
+ * started by hub_handle_info() has completed.
+ *
+ * @param info the access info, or NULL if the user is not registered.
+ */
+extern void hub_handle_info_login_resume(struct hub_info* hub, struct hub_user* u, struct auth_info* info);
+
+/**
+ * Verify the CIDs of all users queued by hub_handle_info() since the
+ * last call, and continue their logins.
+ * The hashes are computed in batches using tiger_batch().
+ */
+extern void hub_handle_info_login_verify(struct hub_info* hub);
+
+/**
+ * Remove a user from the CID verification queue, if queued.
+ */
+extern void hub_handle_info_login_cancel(struct hub_info* hub, struct hub_user* u);
+
 
 #endif /* HAVE_UHUB_INF_PARSER_H */
 
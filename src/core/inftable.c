@@ -0,0 +1,349 @@
+/*
+ * uhub - A tiny ADC p2p connection hub
+ * Copyright (C) 2007-2014, Jan Vidar Krey
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "uhub.h"
+
+/* Values longer than this are never interned */
+#define INF_TABLE_INTERN_MAX 64
+
+/* Max number of unchanged fields removed from one update */
+#define INF_TABLE_UPDATE_MAX 32
+
+/* Fields with values that many users share */
+static const char* inf_table_shared_fields = "APVESUCTSLHNHRHOASAMAW";
+
+struct inf_string
+{
+	size_t references;
+	char value[1];
+};
+
+struct inf_field
+{
+	char prefix[2];
+	int interned;                   /** The value is an inf_string */
+	char* value;
+};
+
+struct inf_table
+{
+	sid_t source;
+	size_t count;
+	size_t capacity;
+	size_t length;                  /** Length of the rendered fields */
+	struct inf_field* fields;
+};
+
+static struct rb_tree* g_inf_strings = NULL;
+
+static int inf_string_compare(const void* a, const void* b)
+{
+	return strcmp((const char*) a, (const char*) b);
+}
+
+static char* inf_string_intern(const char* value, size_t length)
+{
+	char key[INF_TABLE_INTERN_MAX + 1];
+	struct inf_string* str;
+
+	memcpy(key, value, length);
+	key[length] = 0;
+
+	if (!g_inf_strings)
+	{
+		g_inf_strings = rb_tree_create(inf_string_compare, NULL, NULL);
+		if (!g_inf_strings)
+			return NULL;
+	}
+
+	str = (struct inf_string*) rb_tree_get(g_inf_strings, key);
+	if (!str)
+	{
+		str = (struct inf_string*) hub_malloc(sizeof(struct inf_string) + length);
+		if (!str)
+			return NULL;
+
+		str->references = 0;
+		memcpy(str->value, key, length + 1);
+		if (!rb_tree_insert(g_inf_strings, str->value, str))
+		{
+			hub_free(str);
+			return NULL;
+		}
+	}
+
+	str->references++;
+	return str->value;
+}
+
+static void inf_string_release(char* value)
+{
+	struct inf_string* str = (struct inf_string*) (value - offsetof(struct inf_string, value));
+
+	if (--str->references)
+		return;
+
+	rb_tree_remove(g_inf_strings, str->value);
+	hub_free(str);
+
+	if (!rb_tree_size(g_inf_strings))
+	{
+		rb_tree_destroy(g_inf_strings);
+		g_inf_strings = NULL;
+	}
+}
+
+static int inf_field_is_shared(const char* prefix)
+{
+	const char* p;
+	for (p = inf_table_shared_fields; *p; p += 2)
+	{
+		if (p[0] == prefix[0] && p[1] == prefix[1])
+			return 1;
+	}
+	return 0;
+}
+
+static void inf_field_clear(struct inf_field* field)
+{
+	if (field->interned)
+		inf_string_release(field->value);
+	else
+		hub_free(field->value);
+	field->value = NULL;
+}
+
+static int inf_field_set(struct inf_field* field, const char* value, size_t length)
+{
+	int interned = length <= INF_TABLE_INTERN_MAX && inf_field_is_shared(field->prefix);
+	char* copy = interned ? inf_string_intern(value, length) : hub_strndup(value, length);
+
+	if (!copy)
+		return -1;
+
+	if (field->value)
+		inf_field_clear(field);
+
+	field->value = copy;
+	field->interned = interned;
+	return 0;
+}
+
+static struct inf_field* inf_table_find(struct inf_table* table, const char* prefix)
+{
+	size_t n;
+	for (n = 0; n < table->count; n++)
+	{
+		if (table->fields[n].prefix[0] == prefix[0] && table->fields[n].prefix[1] == prefix[1])
+			return &table->fields[n];
+	}
+	return NULL;
+}
+
+/*
+ * Set one field from an argument ("NIvalue").
+ *
+ * @return 1 if the field changed, 0 if not, or -1 if out of memory.
+ */
+static int inf_table_set(struct inf_table* table, const char* arg, size_t length)
+{
+	struct inf_field* field = inf_table_find(table, arg);
+	struct inf_field* fields;
+	const char* value = arg + 2;
+	size_t capacity;
+	size_t old;
+
+	length -= 2;
+
+	if (field)
+	{
+		old = strlen(field->value);
+		if (old == length && !memcmp(field->value, value, length))
+			return 0;
+
+		if (!length)
+		{
+			inf_field_clear(field);
+			table->count--;
+			memmove(field, field + 1, (&table->fields[table->count] - field) * sizeof(struct inf_field));
+			table->length -= old + 3;
+			return 1;
+		}
+
+		if (inf_field_set(field, value, length) == -1)
+			return -1;
+		table->length = table->length - old + length;
+		return 1;
+	}
+
+	if (!length)
+		return 0;
+
+	if (table->count == table->capacity)
+	{
+		capacity = table->capacity ? table->capacity * 2 : 16;
+		fields = (struct inf_field*) hub_realloc(table->fields, capacity * sizeof(struct inf_field));
+		if (!fields)
+			return -1;
+		table->fields = fields;
+		table->capacity = capacity;
+	}
+
+	field = &table->fields[table->count];
+	memset(field, 0, sizeof(struct inf_field));
+	field->prefix[0] = arg[0];
+	field->prefix[1] = arg[1];
+	if (inf_field_set(field, value, length) == -1)
+		return -1;
+
+	table->count++;
+	table->length += length + 3;
+	return 1;
+}
+
+static int inf_table_merge(struct inf_table* table, struct adc_message* cmd, int strip)
+{
+	char unchanged[INF_TABLE_UPDATE_MAX][2];
+	size_t count = 0;
+	size_t n;
+	int changed = 0;
+	int ret;
+	int offset = adc_msg_get_arg_offset(cmd);
+	const char* arg;
+	const char* end;
+	const char* next;
+
+	if (offset < 0 || (size_t) offset > cmd->length)
+		return 0;
+
+	arg = &cmd->cache[offset];
+	end = &cmd->cache[cmd->length];
+	if (end > arg && end[-1] == '\n')
+		end--;
+
+	while (arg < end)
+	{
+		next = (const char*) memchr(arg, ' ', end - arg);
+		if (!next)
+			next = end;
+
+		if (next - arg >= 2)
+		{
+			ret = inf_table_set(table, arg, next - arg);
+			if (ret == -1)
+				return -1;
+
+			if (ret)
+				changed++;
+			else if (strip && count < INF_TABLE_UPDATE_MAX)
+				memcpy(unchanged[count++], arg, 2);
+		}
+		arg = next + 1;
+	}
+
+	/* Removing a field removes every occurrence, keep those that are repeated */
+	for (n = 0; n < count; n++)
+	{
+		if (adc_msg_has_named_argument(cmd, unchanged[n]) == 1)
+			adc_msg_remove_named_argument(cmd, unchanged[n]);
+	}
+
+	return changed;
+}
+
+struct inf_table* inf_table_create(struct adc_message* cmd)
+{
+	struct inf_table* table = (struct inf_table*) hub_malloc_zero(sizeof(struct inf_table));
+	if (!table)
+		return NULL;
+
+	table->source = cmd->source;
+	if (inf_table_merge(table, cmd, 0) == -1)
+	{
+		inf_table_destroy(table);
+		return NULL;
+	}
+	return table;
+}
+
+void inf_table_destroy(struct inf_table* table)
+{
+	size_t n;
+
+	if (!table)
+		return;
+
+	for (n = 0; n < table->count; n++)
+		inf_field_clear(&table->fields[n]);
+	hub_free(table->fields);
+	hub_free(table);
+}
+
+int inf_table_update(struct inf_table* table, struct adc_message* cmd)
+{
+	return inf_table_merge(table, cmd, 1);
+}
+
+const char* inf_table_get(struct inf_table* table, const char prefix[2])
+{
+	struct inf_field* field = inf_table_find(table, prefix);
+	return field ? field->value : NULL;
+}
+
+struct adc_message* inf_table_render(struct inf_table* table)
+{
+	struct adc_message* msg = adc_msg_construct_source(ADC_CMD_BINF, table->source, table->length);
+	char* fields;
+	char* p;
+	size_t length;
+	size_t n;
+
+	if (!msg || !table->count)
+		return msg;
+
+	/* Add all fields as one argument, the message is only checked once */
+	fields = (char*) hub_malloc(table->length);
+	if (!fields)
+	{
+		adc_msg_free(msg);
+		return NULL;
+	}
+
+	p = fields;
+	for (n = 0; n < table->count; n++)
+	{
+		length = strlen(table->fields[n].value);
+		if (n)
+			*p++ = ' ';
+		*p++ = table->fields[n].prefix[0];
+		*p++ = table->fields[n].prefix[1];
+		memcpy(p, table->fields[n].value, length);
+		p += length;
+	}
+	*p = 0;
+
+	adc_msg_add_argument(msg, fields);
+	hub_free(fields);
+	return msg;
+}
+
+size_t inf_table_interned()
+{
+	return g_inf_strings ? rb_tree_size(g_inf_strings) : 0;
+}
@@ -0,0 +1,72 @@
+/*
+ * uhub - A tiny ADC p2p connection hub
+ * Copyright (C) 2007-2014, Jan Vidar Krey
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef HAVE_UHUB_INF_TABLE_H
+#define HAVE_UHUB_INF_TABLE_H
+
+/*
+ * The INF of a user kept as a table of fields, instead of as the raw
+ * message. An update only touches the fields it changes, and the message
+ * is rendered from the table when it is needed (see inf_table_render).
+ *
+ * Values that many users share, such as the client version and the
+ * supports list, are interned: all users with the same value point to
+ * one reference counted copy.
+ */
+
+struct adc_message;
+struct inf_table;
+
+/**
+ * Create a table from a full INF message.
+ * @return a table, or NULL if out of memory.
+ */
+extern struct inf_table* inf_table_create(struct adc_message* cmd);
+
+/**
+ * Free the table and release its interned values.
+ */
+extern void inf_table_destroy(struct inf_table* table);
+
+/**
+ * Merge an INF update into the table. An empty value removes the field.
+ * Fields of the update that do not change anything are removed from cmd,
+ * so they are not sent to other users.
+ *
+ * @return the number of fields that changed, or -1 if out of memory.
+ */
+extern int inf_table_update(struct inf_table* table, struct adc_message* cmd);
+
+/**
+ * @return the (escaped) value of a field, or NULL if the field is not set.
+ */
+extern const char* inf_table_get(struct inf_table* table, const char prefix[2]);
+
+/**
+ * Render the table as an INF message.
+ * @return a new message, or NULL if out of memory.
+ */
+extern struct adc_message* inf_table_render(struct inf_table* table);
+
+/**
+ * @return the number of distinct interned values in use.
+ */
+extern size_t inf_table_interned();
+
+#endif /* HAVE_UHUB_INF_TABLE_H */
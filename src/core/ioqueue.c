@@ -34,9 +34,25 @@ static void debug_msg(const char* prefix, struct adc_message* msg)
 }
 #endif
 
+/* A send queue is allocated together with its message list. */
+struct ioq_send_block
+{
+	struct ioq_send q;
+	struct linked_list list;
+};
+
+static struct mem_pool g_ioq_recv_pool = MEM_POOL_INIT("recv queue", struct ioq_recv);
+static struct mem_pool g_ioq_send_pool = MEM_POOL_INIT("send queue", struct ioq_send_block);
+
+void ioq_pool_prewarm(size_t count)
+{
+	mem_pool_prewarm(&g_ioq_recv_pool, count);
+	mem_pool_prewarm(&g_ioq_send_pool, count);
+}
+
 struct ioq_recv* ioq_recv_create()
 {
-	struct ioq_recv* q = hub_malloc_zero(sizeof(struct ioq_recv));
+	struct ioq_recv* q = mem_pool_alloc(&g_ioq_recv_pool);
 	return q;
 }
 
@@ -45,7 +61,7 @@ void ioq_recv_destroy(struct ioq_recv* q)
 	if (q)
 	{
 		hub_free(q->buf);
-		hub_free(q);
+		mem_pool_free(&g_ioq_recv_pool, q);
 	}
 }
 
@@ -90,18 +106,12 @@ size_t ioq_recv_set(struct ioq_recv* q, void* buf, size_t bufsize)
 
 struct ioq_send* ioq_send_create()
 {
-	struct ioq_send* q = hub_malloc_zero(sizeof(struct ioq_send));
-	if (!q)
+	struct ioq_send_block* block = mem_pool_alloc(&g_ioq_send_pool);
+	if (!block)
 		return 0;
 
-	q->queue = list_create();
-	if (!q->queue)
-	{
-		hub_free(q);
-		return 0;
-	}
-
-	return q;
+	block->q.queue = &block->list;
+	return &block->q;
 }
 
 static void clear_send_queue_callback(void* ptr)
@@ -109,13 +119,33 @@ static void clear_send_queue_callback(void* ptr)
 	adc_msg_free((struct adc_message*) ptr);
 }
 
+void ioq_send_set_total(struct ioq_send* q, size_t* total)
+{
+	if (q->total)
+		*q->total -= q->size;
+	if (total)
+		*total += q->size;
+	q->total = total;
+}
+
+void ioq_send_clear(struct ioq_send* q)
+{
+	size_t* total = q->total;
+
+	ioq_send_set_total(q, NULL);
+	list_clear(q->queue, &clear_send_queue_callback);
+	q->size = 0;
+	q->offset = 0;
+	q->total = total;
+}
+
 void ioq_send_destroy(struct ioq_send* q)
 {
 	if (q)
 	{
+		ioq_send_set_total(q, NULL);
 		list_clear(q->queue, &clear_send_queue_callback);
-		list_destroy(q->queue);
-		hub_free(q);
+		mem_pool_free(&g_ioq_send_pool, q);
 	}
 }
 
@@ -128,6 +158,8 @@ void ioq_send_add(struct ioq_send* q, struct adc_message* msg_)
 	uhub_assert(msg->cache && *msg->cache);
 	list_append(q->queue, msg);
 	q->size += msg->length;
+	if (q->total)
+		*q->total += msg->length;
 }
 
 static void ioq_send_remove(struct ioq_send* q, struct adc_message* msg)
@@ -137,6 +169,8 @@ static void ioq_send_remove(struct ioq_send* q, struct adc_message* msg)
 #endif
 	list_remove(q->queue, msg);
 	q->size  -= msg->length;
+	if (q->total)
+		*q->total -= msg->length;
 	adc_msg_free(msg);
 	q->offset = 0;
 }
@@ -33,6 +33,7 @@ struct ioq_send
 	size_t               last_send; /** When using SSL, one have to send the exact same buffer and length if a write cannot complete. */
 #endif
 	struct linked_list*  queue;     /** List of queued messages (struct adc_message) */
+	size_t*              total;     /** Bytes queued by all send queues of the hub, or NULL (see ioq_send_set_total) */
 };
 
 struct ioq_recv
@@ -41,11 +42,27 @@ struct ioq_recv
 	size_t size;
 };
 
+/**
+ * Preallocate send and receive queues (see mem_pool_prewarm).
+ */
+extern void ioq_pool_prewarm(size_t count);
+
 /**
  * Create a send queue
  */
 extern struct ioq_send* ioq_send_create();
 
+/**
+ * Count the bytes of the send queue in total, as well as any bytes
+ * queued later on, instead of in the counter set before.
+ */
+extern void ioq_send_set_total(struct ioq_send*, size_t* total);
+
+/**
+ * Delete all queued messages.
+ */
+extern void ioq_send_clear(struct ioq_send*);
+
 /**
  * Destroy a send queue, and delete any queued messages.
  */
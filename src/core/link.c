@@ -0,0 +1,1075 @@
+/*
+ * uhub - A tiny ADC p2p connection hub
+ * Copyright (C) 2007-2014, Jan Vidar Krey
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "uhub.h"
+
+#define ADC_CMD_ILNK FOURCC('I','L','N','K')
+
+/* A user logged in on another node */
+struct link_user
+{
+	sid_t sid;
+	size_t index;                   /** Position in the users array of the link */
+	char nick[MAX_NICK_LEN+1];
+	char cid[MAX_CID_LEN+1];
+	struct inf_table* table;        /** The INF of the user */
+	struct adc_message* info;       /** The INF rendered from the table, NULL until needed */
+};
+
+/* A hub this node connects to (see link_peers) */
+struct link_peer
+{
+	struct hub_info* hub;
+	char* address;
+	uint16_t port;
+	int tls;                            /** Connect with TLS (adcs://) */
+	char* keyprint;                     /** Certificate the peer must present, or NULL for any */
+	struct net_connect_handle* connect; /** Connection being established, or NULL */
+	struct net_connection* handshake;   /** Connection doing its TLS handshake, or NULL */
+	struct hub_link* link;              /** Link to the peer, or NULL */
+};
+
+struct hub_link
+{
+	struct hub_user* user;          /** The connection to the other node */
+	struct link_peer* peer;         /** The peer if this node connected, NULL if the other node did */
+	int node;                       /** Node id of the other node, 0 until the link is up */
+	int announced;                  /** Node id announced by the peer, until it answered the challenge */
+	char challenge[MAX_CID_LEN+1];  /** Sent to the peer, see link_send_challenge() */
+	struct ptr_table* sids;         /** Users of the other node, by session ID */
+	struct link_user** users;       /** Users of the other node */
+	size_t count;
+	size_t capacity;
+};
+
+struct link_manager
+{
+	int node;                                /** Node id of this hub */
+	struct hub_link* nodes[LINK_MAX_NODES];  /** Links that are up, by node id */
+	size_t node_count;
+	struct linked_list* links;               /** All links, including those logging in */
+	struct linked_list* peers;
+	struct rb_tree* nickmap;                 /** Users of other nodes by nick */
+	struct rb_tree* cidmap;                  /** Users of other nodes by CID */
+	size_t count;                            /** Number of users on other nodes */
+	struct timeout_evt* timeout;             /** Reconnects to the peers */
+};
+
+static int link_map_compare(const void* a, const void* b)
+{
+	return strcmp((const char*) a, (const char*) b);
+}
+
+static void link_send(struct hub_info* hub, struct hub_user* user, const char* line)
+{
+	struct adc_message* msg = adc_msg_create(line);
+	if (!msg)
+		return;
+	route_to_user(hub, user, msg);
+	adc_msg_free(msg);
+}
+
+static void link_send_node(struct hub_info* hub, struct hub_link* link)
+{
+	char buf[16];
+	snprintf(buf, sizeof(buf), "ILNK %d", hub->links->node);
+	link_send(hub, link->user, buf);
+}
+
+static struct hub_link* link_create(struct hub_info* hub, struct hub_user* user, struct link_peer* peer)
+{
+	struct hub_link* link = hub_malloc_zero(sizeof(struct hub_link));
+	if (!link)
+		return NULL;
+
+	link->sids = ptr_table_create(LINK_NODE_SIDS);
+	if (!link->sids)
+	{
+		hub_free(link);
+		return NULL;
+	}
+
+	link->user = user;
+	link->peer = peer;
+	user->link = link;
+	if (peer)
+		peer->link = link;
+
+	/* A link carries the traffic of many users, never limit it by max_send_buffer */
+	user_flag_set(user, flag_user_list);
+
+	list_append(hub->links->links, link);
+	return link;
+}
+
+static struct link_user* link_get_user(struct hub_link* link, sid_t sid)
+{
+	if (link_sid_node(sid) != link->node)
+		return NULL;
+	return (struct link_user*) ptr_table_get(link->sids, sid & (LINK_NODE_SIDS - 1));
+}
+
+static void link_map_remove(struct rb_tree* map, const char* key, struct link_user* remote)
+{
+	if (rb_tree_get(map, key) == remote)
+		rb_tree_remove(map, key);
+}
+
+static void link_set_nick(struct link_manager* manager, struct link_user* remote, const char* nick)
+{
+	if (*remote->nick)
+		link_map_remove(manager->nickmap, remote->nick, remote);
+
+	if (adc_msg_unescape_to_target(nick, remote->nick, sizeof(remote->nick)) < 0)
+		remote->nick[0] = '\0';
+
+	if (*remote->nick && !rb_tree_insert(manager->nickmap, remote->nick, remote))
+		LOG_WARN("Nick \"%s\" is used by users on two other nodes", remote->nick);
+}
+
+static int link_user_add(struct hub_info* hub, struct hub_link* link, struct adc_message* msg)
+{
+	struct link_manager* manager = hub->links;
+	struct link_user* remote;
+	struct link_user** users;
+	char* nick = adc_msg_get_named_argument(msg, ADC_INF_FLAG_NICK);
+	char* cid = adc_msg_get_named_argument(msg, ADC_INF_FLAG_CLIENT_ID);
+	size_t capacity;
+
+	if (!nick || !cid || strlen(cid) != MAX_CID_LEN)
+	{
+		LOG_DEBUG("Ignoring incomplete INF from node %d", link->node);
+		hub_free(nick);
+		hub_free(cid);
+		return 0;
+	}
+
+	if (link->count == link->capacity)
+	{
+		capacity = link->capacity ? link->capacity * 2 : 64;
+		users = hub_realloc(link->users, capacity * sizeof(struct link_user*));
+		if (!users)
+		{
+			hub_free(nick);
+			hub_free(cid);
+			return -1;
+		}
+		link->users = users;
+		link->capacity = capacity;
+	}
+
+	remote = hub_malloc_zero(sizeof(struct link_user));
+	if (remote)
+		remote->table = inf_table_create(msg);
+
+	if (!remote || !remote->table || ptr_table_set(link->sids, msg->source & (LINK_NODE_SIDS - 1), remote) == -1)
+	{
+		if (remote)
+			inf_table_destroy(remote->table);
+		hub_free(remote);
+		hub_free(nick);
+		hub_free(cid);
+		return -1;
+	}
+
+	remote->sid = msg->source;
+	remote->index = link->count;
+	remote->info = adc_msg_incref(msg);
+	link->users[link->count++] = remote;
+	manager->count++;
+
+	memcpy(remote->cid, cid, MAX_CID_LEN + 1);
+	if (!rb_tree_insert(manager->cidmap, remote->cid, remote))
+		LOG_WARN("CID %s is used by users on two other nodes", remote->cid);
+	link_set_nick(manager, remote, nick);
+
+	if (uman_get_user_by_nick(hub->users, remote->nick) || uman_get_user_by_cid(hub->users, remote->cid))
+		LOG_WARN("User \"%s\" on node %d is also logged in on this node", remote->nick, link->node);
+
+	hub_free(nick);
+	hub_free(cid);
+	return 0;
+}
+
+/*
+ * Merge an INF update into the INF of the user, see user_update_info().
+ */
+static void link_user_update(struct hub_info* hub, struct link_user* remote, struct adc_message* msg)
+{
+	const char* nick;
+
+	if (!inf_table_update(remote->table, msg))
+		return;
+
+	adc_msg_free(remote->info);
+	remote->info = NULL;
+
+	nick = inf_table_get(remote->table, ADC_INF_FLAG_NICK);
+	if (nick && adc_msg_has_named_argument(msg, ADC_INF_FLAG_NICK))
+		link_set_nick(hub->links, remote, nick);
+}
+
+static struct adc_message* link_user_get_info(struct link_user* remote)
+{
+	if (!remote->info)
+		remote->info = inf_table_render(remote->table);
+	return remote->info;
+}
+
+static void link_user_remove(struct hub_info* hub, struct hub_link* link, struct link_user* remote)
+{
+	struct link_manager* manager = hub->links;
+	struct link_user* last = link->users[--link->count];
+
+	last->index = remote->index;
+	link->users[remote->index] = last;
+	ptr_table_set(link->sids, remote->sid & (LINK_NODE_SIDS - 1), NULL);
+	manager->count--;
+
+	link_map_remove(manager->nickmap, remote->nick, remote);
+	link_map_remove(manager->cidmap, remote->cid, remote);
+	inf_table_destroy(remote->table);
+	adc_msg_free(remote->info);
+	hub_free(remote);
+}
+
+/*
+ * Remove all users of the other node, and tell the users of this node
+ * they left, in as few messages as possible.
+ */
+static void link_remove_users(struct hub_info* hub, struct hub_link* link)
+{
+	struct adc_message* quits = NULL;
+	struct adc_message* command;
+	int notify = hub->status == hub_status_running;
+
+	while (link->count)
+	{
+		struct link_user* remote = link->users[link->count - 1];
+
+		if (notify)
+		{
+			command = adc_msg_construct(ADC_CMD_IQUI, 6);
+			adc_msg_add_argument(command, sid_to_string(remote->sid));
+			if (!quits)
+			{
+				quits = command;
+			}
+			else
+			{
+				if (adc_msg_append_message(quits, command) == -1)
+					route_to_all(hub, command);
+				adc_msg_free(command);
+			}
+		}
+		link_user_remove(hub, link, remote);
+	}
+
+	if (quits)
+	{
+		route_to_all(hub, quits);
+		adc_msg_free(quits);
+	}
+}
+
+static void link_send_local_users(struct hub_info* hub, struct hub_link* link)
+{
+	struct hub_user* user;
+	LIST_FOREACH(struct hub_user*, user, hub->users->list,
+	{
+		if (user_is_logged_in(user))
+			route_to_user(hub, link->user, user_get_info(user, NULL));
+	});
+}
+
+/*
+ * Returns the node id announced by the other node (ILNK),
+ * or 0 if it is invalid or already linked to.
+ */
+static int link_get_node_id(struct hub_info* hub, struct hub_link* link, const char* arg)
+{
+	struct link_manager* manager = hub->links;
+	int node = 0;
+
+	if (!arg || !is_number(arg, &node) || node < 1 || node >= LINK_MAX_NODES || node == manager->node)
+	{
+		LOG_ERROR("Link with %s failed, invalid node id", user_get_address(link->user));
+		return 0;
+	}
+
+	if (manager->nodes[node])
+	{
+		LOG_WARN("Link with %s refused, already linked to node %d", user_get_address(link->user), node);
+		return 0;
+	}
+	return node;
+}
+
+static int link_established(struct hub_info* hub, struct hub_link* link, int node)
+{
+	struct link_manager* manager = hub->links;
+
+	/* Another link to the node may have come up in the meantime */
+	if (manager->nodes[node])
+	{
+		LOG_WARN("Link with %s refused, already linked to node %d", user_get_address(link->user), node);
+		return -1;
+	}
+
+	link->node = node;
+	manager->nodes[node] = link;
+	manager->node_count++;
+	user_set_state(link->user, state_link);
+	net_con_clear_timeout(link->user->connection);
+
+	LOG_INFO("Linked to node %d at %s", node, user_get_address(link->user));
+
+	if (link->peer)
+		link_send_node(hub, link);
+	link_send_local_users(hub, link);
+	return 0;
+}
+
+static void link_make_id(struct hub_info* hub, char* pid, char* cid)
+{
+	uint64_t seed[16];
+	uint64_t tiger_pid[3];
+	uint64_t tiger_cid[3];
+
+	memset(seed, 0, sizeof(seed));
+	snprintf((char*) seed, sizeof(seed), "link/%s/%d", hub->config->link_nick, hub->links->node);
+	tiger(seed, strlen((char*) seed), tiger_pid);
+	tiger(tiger_pid, TIGERSIZE, tiger_cid);
+	base32_encode((unsigned char*) tiger_pid, TIGERSIZE, pid);
+	base32_encode((unsigned char*) tiger_cid, TIGERSIZE, cid);
+	pid[MAX_CID_LEN] = 0;
+	cid[MAX_CID_LEN] = 0;
+}
+
+static void link_send_info(struct hub_info* hub, struct hub_link* link, const char* sid)
+{
+	char pid[64];
+	char cid[64];
+	char buf[256];
+	char* nick;
+
+	if (!sid || !string_to_sid(sid))
+		return;
+
+	nick = adc_msg_escape(hub->config->link_nick);
+	if (!nick)
+		return;
+
+	link_make_id(hub, pid, cid);
+	snprintf(buf, sizeof(buf), "BINF %s ID%s PD%s NI%s", sid, cid, pid, nick);
+	link_send(hub, link->user, buf);
+	hub_free(nick);
+}
+
+static void link_send_password(struct hub_info* hub, struct hub_link* link, const char* challenge, const char* password)
+{
+	char password_calc[MAX_CID_LEN+1];
+	char buf[5 + MAX_CID_LEN + 1];
+
+	if (!acl_password_hash(password, challenge, password_calc))
+		return;
+
+	snprintf(buf, sizeof(buf), "HPAS %s", password_calc);
+	link_send(hub, link->user, buf);
+}
+
+/*
+ * Answer the challenge of the node that logged in here, with the password
+ * it logged in with. This proves this node is the one it meant to link to.
+ */
+static void link_answer_challenge(struct hub_info* hub, struct hub_link* link, const char* challenge)
+{
+	struct auth_info* info = acl_get_access_info(hub, link->user->id.nick);
+	if (!info)
+		return;
+
+	link_send_password(hub, link, challenge, info->password);
+	hub_free(info);
+}
+
+/*
+ * Ask the peer this node logged in on to prove it knows link_password too,
+ * before the link is up (see link_check_answer()).
+ */
+static void link_send_challenge(struct hub_info* hub, struct hub_link* link)
+{
+	static unsigned int count;
+	char buf[128];
+	uint64_t tiger_res[3];
+
+	snprintf(buf, sizeof(buf), "%p%d%ld%u", (void*) link, net_con_get_sd(link->user->connection), (long) time(NULL), count++);
+	tiger((uint64_t*) buf, strlen(buf), tiger_res);
+	base32_encode((unsigned char*) tiger_res, TIGERSIZE, link->challenge);
+	link->challenge[MAX_CID_LEN] = 0;
+
+	snprintf(buf, sizeof(buf), "IGPA %s", link->challenge);
+	link_send(hub, link->user, buf);
+}
+
+static int link_check_answer(struct hub_info* hub, struct hub_link* link, const char* password)
+{
+	char password_calc[MAX_CID_LEN+1];
+
+	if (!password || !acl_password_hash(hub->config->link_password, link->challenge, password_calc) || strcasecmp(password, password_calc))
+	{
+		LOG_ERROR("Link to %s:%d refused, node %d does not know the link password", link->peer->address, (int) link->peer->port, link->announced);
+		return -1;
+	}
+	return link_established(hub, link, link->announced);
+}
+
+/*
+ * Handle the messages received while the link is logging in.
+ */
+static int link_handle_login(struct hub_info* hub, struct hub_link* link, struct adc_message* msg)
+{
+	char* arg = adc_msg_get_argument(msg, 0);
+	char* escaped;
+	char* text;
+	int node;
+	int ret = 0;
+
+	switch (msg->cmd)
+	{
+		case ADC_CMD_ILNK:
+			node = link_get_node_id(hub, link, arg);
+			if (!node || link->announced)
+			{
+				ret = -1;
+			}
+			else if (link->peer)
+			{
+				/* Logged in, now the peer has to prove itself */
+				link->announced = node;
+				link_send_challenge(hub, link);
+			}
+			else
+			{
+				ret = link_established(hub, link, node);
+			}
+			break;
+
+		case ADC_CMD_ISID:
+			if (link->peer)
+				link_send_info(hub, link, arg);
+			break;
+
+		case ADC_CMD_IGPA:
+			if (link->peer)
+				link_send_password(hub, link, arg, hub->config->link_password);
+			else
+				link_answer_challenge(hub, link, arg);
+			break;
+
+		case ADC_CMD_HPAS:
+			if (link->peer && link->announced)
+				ret = link_check_answer(hub, link, arg);
+			break;
+
+		case ADC_CMD_ISTA:
+			if (link->peer && arg && arg[0] == '2')
+			{
+				escaped = adc_msg_get_argument(msg, 1);
+				text = escaped ? adc_msg_unescape(escaped) : NULL;
+				LOG_ERROR("Link to %s:%d refused: %s", link->peer->address, (int) link->peer->port, text ? text : "");
+				hub_free(escaped);
+				hub_free(text);
+				ret = -1;
+			}
+			break;
+
+		default:
+			break;
+	}
+
+	hub_free(arg);
+	return ret;
+}
+
+static void link_handle_quit(struct hub_info* hub, struct hub_link* link, struct adc_message* msg)
+{
+	char* arg = adc_msg_get_argument(msg, 0);
+	struct link_user* remote = arg ? link_get_user(link, string_to_sid(arg)) : NULL;
+
+	if (remote)
+	{
+		link_user_remove(hub, link, remote);
+		route_to_all(hub, msg);
+	}
+	hub_free(arg);
+}
+
+int link_handle_message(struct hub_info* hub, struct hub_user* user, const char* line, size_t length)
+{
+	struct hub_link* link = user->link;
+	struct hub_user* target;
+	struct link_user* remote;
+	struct adc_message* msg;
+	int ret = 0;
+
+	msg = adc_msg_parse(line, length);
+	if (!msg)
+		return 0;
+
+	if (!link->node)
+	{
+		ret = link_handle_login(hub, link, msg);
+		adc_msg_free(msg);
+		return ret;
+	}
+
+	switch (msg->cache[0])
+	{
+		case 'B':
+		case 'F':
+			/* Only accept messages from users of the node at the other end */
+			if (link_sid_node(msg->source) != link->node)
+				break;
+
+			if (msg->cmd == ADC_CMD_BINF)
+			{
+				remote = link_get_user(link, msg->source);
+				if (remote)
+					link_user_update(hub, remote, msg);
+				else if (link_user_add(hub, link, msg) == -1 || !link_get_user(link, msg->source))
+					break;
+				route_info_update(hub, NULL, msg);
+			}
+			else if (!link_get_user(link, msg->source))
+			{
+				break;
+			}
+			else if (msg->cache[0] == 'B')
+			{
+				route_to_all(hub, msg);
+			}
+			else
+			{
+				route_to_subscribers(hub, msg);
+			}
+			break;
+
+		case 'D':
+		case 'E':
+			if (!link_get_user(link, msg->source))
+				break;
+
+			/* The sender has already been sent its copy of an E message */
+			target = uman_get_user_by_sid(hub->users, msg->target);
+			if (target)
+				route_to_user(hub, target, msg);
+			break;
+
+		case 'I':
+			if (msg->cmd == ADC_CMD_IQUI)
+				link_handle_quit(hub, link, msg);
+			break;
+
+		default:
+			break;
+	}
+
+	adc_msg_free(msg);
+	return ret;
+}
+
+void link_accept(struct hub_info* hub, struct hub_user* user)
+{
+	struct hub_link* link;
+
+	if (!hub->links || user->credentials != auth_cred_link)
+	{
+		LOG_WARN("Refused link from %s, nick \"%s\" is not registered as a link", user_get_address(user), user->id.nick);
+		on_login_failure(hub, user, status_msg_auth_user_not_found);
+		return;
+	}
+
+	link = link_create(hub, user, NULL);
+	if (!link)
+	{
+		on_login_failure(hub, user, status_msg_error_no_memory);
+		return;
+	}
+
+	/* Wait for the other node to tell its node id, see link_established() */
+	link_send_node(hub, link);
+}
+
+void link_disconnected(struct hub_info* hub, struct hub_user* user)
+{
+	struct link_manager* manager = hub->links;
+	struct hub_link* link = user->link;
+
+	if (!link)
+		return;
+
+	user->link = NULL;
+
+	if (link->node)
+	{
+		LOG_INFO("Link to node %d closed", link->node);
+		manager->nodes[link->node] = NULL;
+		manager->node_count--;
+		link_remove_users(hub, link);
+	}
+
+	if (link->peer)
+		link->peer->link = NULL;
+
+	list_remove(manager->links, link);
+	ptr_table_destroy(link->sids);
+	hub_free(link->users);
+	hub_free(link);
+}
+
+/* Log in on the peer, once connected */
+static void link_login(struct link_peer* peer, struct net_connection* con)
+{
+	struct hub_info* hub = peer->hub;
+	struct ip_addr_encap addr;
+	struct hub_user* user;
+
+	memset(&addr, 0, sizeof(addr));
+	ip_convert_to_binary(net_get_peer_address(net_con_get_sd(con)), &addr);
+
+	user = user_create(hub, con, &addr);
+	if (!user)
+	{
+		net_con_close(con);
+		return;
+	}
+
+	if (!link_create(hub, user, peer))
+	{
+		hub_disconnect_user(hub, user, quit_memory_error);
+		return;
+	}
+
+	net_con_set_timeout(con, TIMEOUT_HANDSHAKE);
+	link_send(hub, user, "HSUP ADBASE ADTIGR ADLINK");
+}
+
+#ifdef SSL_SUPPORT
+static int link_check_keyprint(struct link_peer* peer, struct net_connection* con)
+{
+	char keyprint[NET_SSL_KEYPRINT_SIZE];
+
+	if (!peer->keyprint)
+		return 1;
+
+	if (!net_ssl_get_peer_keyprint(con, keyprint) || strcasecmp(keyprint, peer->keyprint))
+	{
+		LOG_ERROR("Link to %s:%d refused, the peer did not present the certificate of kp=SHA256/%s", peer->address, (int) peer->port, peer->keyprint);
+		return 0;
+	}
+	return 1;
+}
+
+static void link_tls_event(struct net_connection* con, int events, void* ptr)
+{
+	struct link_peer* peer = (struct link_peer*) ptr;
+
+	peer->handshake = NULL;
+	if (events == NET_EVENT_READ && link_check_keyprint(peer, con))
+	{
+		link_login(peer, con);
+		return;
+	}
+
+	if (events != NET_EVENT_READ)
+		LOG_DEBUG("TLS handshake with link peer %s:%d failed", peer->address, (int) peer->port);
+	net_con_close(con);
+}
+
+static void link_start_tls(struct link_peer* peer, struct net_connection* con)
+{
+	ssize_t ret;
+
+	net_con_reinitialize(con, link_tls_event, peer, NET_EVENT_READ);
+	net_con_set_timeout(con, TIMEOUT_HANDSHAKE);
+	ret = net_con_ssl_handshake(con, net_con_ssl_mode_client, peer->hub->ctx);
+	if (ret < 0)
+	{
+		LOG_DEBUG("TLS handshake with link peer %s:%d failed", peer->address, (int) peer->port);
+		net_con_close(con);
+	}
+	else if (ret > 0)
+	{
+		link_tls_event(con, NET_EVENT_READ, peer);
+	}
+	else
+	{
+		/* Continued in link_tls_event() */
+		peer->handshake = con;
+	}
+}
+#endif /* SSL_SUPPORT */
+
+static void link_connected(struct net_connect_handle* handle, enum net_connect_status status, struct net_connection* con, void* ptr)
+{
+	struct link_peer* peer = (struct link_peer*) ptr;
+
+	peer->connect = NULL;
+
+	if (status != net_connect_status_ok)
+	{
+		LOG_DEBUG("Unable to connect to link peer %s:%d (%d)", peer->address, (int) peer->port, (int) status);
+		return;
+	}
+
+#ifdef SSL_SUPPORT
+	if (peer->tls)
+	{
+		link_start_tls(peer, con);
+		return;
+	}
+#endif
+	link_login(peer, con);
+}
+
+static void link_connect_peers(struct hub_info* hub)
+{
+	struct link_peer* peer;
+
+	if (hub->status != hub_status_running)
+		return;
+
+	LIST_FOREACH(struct link_peer*, peer, hub->links->peers,
+	{
+		if (!peer->connect && !peer->handshake && !peer->link)
+		{
+			LOG_DEBUG("Connecting to link peer %s:%d", peer->address, (int) peer->port);
+			peer->connect = net_con_connect(peer->address, peer->port, link_connected, peer);
+		}
+	});
+}
+
+static void link_timer_connect(struct timeout_evt* t)
+{
+	struct hub_info* hub = (struct hub_info*) t->ptr;
+	link_connect_peers(hub);
+	timeout_queue_reschedule(net_backend_get_timeout_queue(), hub->links->timeout, TIMEOUT_LINK_RETRY);
+}
+
+static void link_peer_free(void* ptr)
+{
+	struct link_peer* peer = (struct link_peer*) ptr;
+	net_connect_destroy(peer->connect);
+	if (peer->handshake)
+		net_con_close(peer->handshake);
+	hub_free(peer->address);
+	hub_free(peer->keyprint);
+	hub_free(peer);
+}
+
+/*
+ * Parse a link peer: host:port, adc://host:port or adcs://host:port,
+ * optionally followed by /?kp=SHA256/<keyprint> to pin the certificate.
+ */
+static int link_peer_add(char* line, int count, void* ptr)
+{
+	struct hub_info* hub = (struct hub_info*) ptr;
+	struct link_peer* peer;
+	char* address = line;
+	char* keyprint = NULL;
+	char* path;
+	char* port;
+	int tls = 0;
+	int num = 0;
+
+	if (!strncmp(line, "adcs://", 7))
+	{
+		tls = 1;
+		line += 7;
+	}
+	else if (!strncmp(line, "adc://", 6))
+	{
+		line += 6;
+	}
+
+	/* Anything after the address must be the keyprint */
+	path = strchr(line, '/');
+	if (path && tls && !strncmp(path, "/?kp=SHA256/", 12) && path[12])
+		keyprint = path + 12;
+
+	if (path && path[1] && !keyprint)
+	{
+		LOG_ERROR("Invalid link peer \"%s\", expected host:port, or adcs://host:port/?kp=SHA256/<keyprint>", address);
+		return -1;
+	}
+
+	if (path)
+		*path = '\0';
+
+	port = strrchr(line, ':');
+	if (!port || port == line || !is_number(port + 1, &num) || num < 1 || num > 65535)
+	{
+		LOG_ERROR("Invalid link peer \"%s\", expected host:port, or adcs://host:port/?kp=SHA256/<keyprint>", address);
+		return -1;
+	}
+
+#ifdef SSL_SUPPORT
+	if (tls && !hub->ctx)
+	{
+		LOG_ERROR("Link peer \"%s\" uses TLS, which needs tls_enable", address);
+		return -1;
+	}
+#else
+	if (tls)
+	{
+		LOG_ERROR("Link peer \"%s\" uses TLS, which is not supported", address);
+		return -1;
+	}
+#endif
+
+	*port = '\0';
+	if (line[0] == '[' && port[-1] == ']')
+	{
+		port[-1] = '\0';
+		line++;
+	}
+
+	peer = hub_malloc_zero(sizeof(struct link_peer));
+	if (!peer)
+		return -1;
+
+	peer->hub = hub;
+	peer->port = (uint16_t) num;
+	peer->tls = tls;
+	peer->address = hub_strdup(line);
+	peer->keyprint = keyprint ? hub_strdup(keyprint) : NULL;
+	if (!peer->address || (keyprint && !peer->keyprint))
+	{
+		link_peer_free(peer);
+		return -1;
+	}
+
+	list_append(hub->links->peers, peer);
+	return 0;
+}
+
+
+int link_start(struct hub_info* hub, struct hub_config* config)
+{
+	struct link_manager* manager;
+	struct sid_pool* sids;
+	sid_t max_users = (sid_t) net_get_max_sockets();
+
+	if (!config->link_node_id)
+		return 0;
+
+	manager = hub_malloc_zero(sizeof(struct link_manager));
+	if (!manager)
+		return -1;
+
+	hub->links = manager;
+	manager->node = config->link_node_id;
+	manager->links = list_create();
+	manager->peers = list_create();
+	manager->nickmap = rb_tree_create(link_map_compare, NULL, NULL);
+	manager->cidmap = rb_tree_create(link_map_compare, NULL, NULL);
+	if (!manager->links || !manager->peers || !manager->nickmap || !manager->cidmap)
+	{
+		link_shutdown(hub);
+		return -1;
+	}
+
+	/* Only hand out the session IDs of this node */
+	sids = sid_pool_create_range((sid_t) manager->node << LINK_NODE_BITS, MIN(max_users, LINK_NODE_SIDS - 1));
+	if (!sids)
+	{
+		link_shutdown(hub);
+		return -1;
+	}
+	sid_pool_set_reuse_delay(sids, config->sid_reuse_delay);
+	sid_pool_destroy(hub->users->sids);
+	hub->users->sids = sids;
+
+	if (config->max_users >= LINK_NODE_SIDS)
+		LOG_WARN("max_users is %d, but a linked hub can have at most %d users", config->max_users, LINK_NODE_SIDS - 1);
+
+	if (*config->link_peers && string_split(config->link_peers, ",", hub, link_peer_add) == -1)
+	{
+		link_shutdown(hub);
+		return -1;
+	}
+
+	if (net_backend_get_timeout_queue())
+	{
+		manager->timeout = hub_malloc_zero(sizeof(struct timeout_evt));
+		timeout_evt_initialize(manager->timeout, link_timer_connect, hub);
+		timeout_queue_insert(net_backend_get_timeout_queue(), manager->timeout, TIMEOUT_LINK_RETRY);
+	}
+
+	LOG_INFO("Linking as node %d, %d peers to connect to", manager->node, (int) list_size(manager->peers));
+	link_connect_peers(hub);
+	return 0;
+}
+
+int link_shutdown(struct hub_info* hub)
+{
+	struct link_manager* manager = hub->links;
+	struct hub_link* link;
+	int closed = 0;
+
+	if (!manager)
+		return 0;
+
+	if (manager->timeout)
+	{
+		timeout_queue_remove(net_backend_get_timeout_queue(), manager->timeout);
+		hub_free(manager->timeout);
+	}
+
+	if (manager->links)
+	{
+		while ((link = (struct hub_link*) list_get_first(manager->links)))
+		{
+			hub_disconnect_user(hub, link->user, quit_hub_disabled);
+			closed++;
+		}
+		list_destroy(manager->links);
+	}
+
+	if (manager->peers)
+	{
+		list_clear(manager->peers, link_peer_free);
+		list_destroy(manager->peers);
+	}
+
+	if (manager->nickmap)
+		rb_tree_destroy(manager->nickmap);
+	if (manager->cidmap)
+		rb_tree_destroy(manager->cidmap);
+
+	hub_free(manager);
+	hub->links = NULL;
+	return closed;
+}
+
+void link_broadcast(struct hub_info* hub, struct adc_message* msg)
+{
+	struct link_manager* manager = hub->links;
+	int node;
+
+	if (!manager || !manager->node_count)
+		return;
+
+	for (node = 1; node < LINK_MAX_NODES; node++)
+	{
+		if (manager->nodes[node])
+			route_to_user(hub, manager->nodes[node]->user, msg);
+	}
+}
+
+int link_route_to_node(struct hub_info* hub, struct adc_message* msg)
+{
+	struct link_manager* manager = hub->links;
+	struct hub_link* link;
+
+	if (!manager)
+		return 0;
+
+	link = manager->nodes[link_sid_node(msg->target)];
+	if (!link || !link_get_user(link, msg->target))
+		return 0;
+
+	route_to_user(hub, link->user, msg);
+	return 1;
+}
+
+int link_send_user_list(struct hub_info* hub, struct hub_user* user)
+{
+	struct link_manager* manager = hub->links;
+	struct hub_link* link;
+	struct adc_message* info;
+	size_t n;
+	int node, ret;
+	int variant = user_get_info_variant(NULL, user);
+
+	if (!manager)
+		return 1;
+
+	for (node = 1; node < LINK_MAX_NODES; node++)
+	{
+		link = manager->nodes[node];
+		if (!link)
+			continue;
+
+		for (n = 0; n < link->count; n++)
+		{
+			info = link_user_get_info(link->users[n]);
+			if (!info)
+				return 0;
+
+			if (variant == info_variant_full)
+			{
+				ret = route_to_user(hub, user, info);
+			}
+			else
+			{
+				info = user_info_create_variant(NULL, info, variant);
+				if (!info)
+					return 0;
+				ret = route_to_user(hub, user, info);
+				adc_msg_free(info);
+			}
+
+			if (!ret)
+				return 0;
+		}
+	}
+	return 1;
+}
+
+int link_has_sid(struct hub_info* hub, sid_t sid)
+{
+	struct hub_link* link;
+
+	if (!hub->links)
+		return 0;
+
+	link = hub->links->nodes[link_sid_node(sid)];
+	return link && link_get_user(link, sid);
+}
+
+int link_has_nick(struct hub_info* hub, const char* nick)
+{
+	return hub->links && rb_tree_get(hub->links->nickmap, nick);
+}
+
+int link_has_cid(struct hub_info* hub, const char* cid)
+{
+	return hub->links && rb_tree_get(hub->links->cidmap, cid);
+}
+
+size_t link_get_user_count(struct hub_info* hub)
+{
+	return hub->links ? hub->links->count : 0;
+}
+
+size_t link_get_node_count(struct hub_info* hub)
+{
+	return hub->links ? hub->links->node_count : 0;
+}
@@ -0,0 +1,133 @@
+/*
+ * uhub - A tiny ADC p2p connection hub
+ * Copyright (C) 2007-2014, Jan Vidar Krey
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef HAVE_UHUB_LINK_H
+#define HAVE_UHUB_LINK_H
+
+/*
+ * Hub links (see link_node_id).
+ *
+ * Several hubs (nodes) can be linked together into one hub, each node
+ * handling its own share of the users. Every pair of nodes is connected
+ * by one link, which is an ordinary hub connection that announced the
+ * LINK feature and logged in with "link" credentials.
+ *
+ * Each node hands out the session IDs starting with the character of its
+ * node id, so the node owning a user can be told from the session ID.
+ * Over a link, each node only sends what its own users send:
+ *  - INF and QUI messages of its users, to keep the user lists in sync.
+ *  - B and F messages, once per link rather than once per user.
+ *  - D and E messages to a user of the other node.
+ * Nothing received over a link is passed on to other links.
+ *
+ * A link logs in like this (the node dialing is "D", the other one "A"):
+ *  D: HSUP ADBASE ADTIGR ADLINK
+ *  A: ISUP ..., ISID <sid>, IINF ...
+ *  D: BINF <sid> ID<cid> PD<pid> NI<link_nick>
+ *  A: IGPA <nonce>
+ *  D: HPAS <password hash>
+ *  A: ILNK <node id of A>
+ *  D: IGPA <nonce>
+ *  A: HPAS <password hash>, with the password registered for D
+ *  D: ILNK <node id of D>, followed by the INF of all its users
+ *  A: the INF of all its users
+ *
+ * The node dialing connects with TLS if the peer is an adcs:// address.
+ */
+
+struct hub_info;
+struct hub_user;
+struct hub_config;
+struct adc_message;
+
+#define LINK_MAX_NODES 32
+#define LINK_NODE_BITS 15
+#define LINK_NODE_SIDS (1 << LINK_NODE_BITS)
+
+/** The node id a session ID belongs to */
+#define link_sid_node(sid) ((int) ((sid) >> LINK_NODE_BITS))
+
+/**
+ * Start linking if link_node_id is set: make the hub hand out session
+ * IDs of its node only, and connect to the link_peers.
+ * Must be called before any user connects.
+ * @return 0 on success, or -1 on error.
+ */
+extern int link_start(struct hub_info* hub, struct hub_config* config);
+
+/**
+ * Close all links, and forget the users of the other nodes.
+ * @return the number of links closed.
+ */
+extern int link_shutdown(struct hub_info* hub);
+
+/**
+ * Turn a user that logged in with the LINK feature into a link,
+ * or refuse the login if the user does not have link credentials.
+ */
+extern void link_accept(struct hub_info* hub, struct hub_user* user);
+
+/**
+ * Handle a message received over a link.
+ * @return 0 on success, or -1 if the link must be closed.
+ */
+extern int link_handle_message(struct hub_info* hub, struct hub_user* user, const char* line, size_t length);
+
+/**
+ * Called when the connection of a link is closed.
+ * The users of the other node are removed, and their quits sent.
+ */
+extern void link_disconnected(struct hub_info* hub, struct hub_user* user);
+
+/**
+ * Send a B or F message of a user of this node to all other nodes.
+ */
+extern void link_broadcast(struct hub_info* hub, struct adc_message* msg);
+
+/**
+ * Send a D or E message to the node owning the target user.
+ * @return 1 if sent, or 0 if the target is not a user of another node.
+ */
+extern int link_route_to_node(struct hub_info* hub, struct adc_message* msg);
+
+/**
+ * Send the INF of all users on other nodes to a user logging in.
+ * @return 1 on success, or 0 if the user could not be sent to.
+ */
+extern int link_send_user_list(struct hub_info* hub, struct hub_user* user);
+
+/**
+ * @return 1 if a user of another node has the session ID, nick or CID.
+ */
+extern int link_has_sid(struct hub_info* hub, sid_t sid);
+extern int link_has_nick(struct hub_info* hub, const char* nick);
+extern int link_has_cid(struct hub_info* hub, const char* cid);
+
+/**
+ * @return the number of users on other nodes.
+ */
+extern size_t link_get_user_count(struct hub_info* hub);
+
+/**
+ * @return the number of other nodes linked to.
+ */
+extern size_t link_get_node_count(struct hub_info* hub);
+
+#endif /* HAVE_UHUB_LINK_H */
+
@@ -34,6 +34,12 @@ static const char* arg_config  = 0;
 static const char* arg_log = 0;
 static const char* arg_pid = 0;
 static int arg_log_syslog = 0;
+static char* const* arg_argv = 0;
+static const char* arg_exec = 0;
+static int arg_upgraded = 0;
+static int pidfile_written = 0;
+
+int pidfile_create();
 
 
 #if !defined(WIN32)
@@ -61,6 +67,11 @@ void hub_handle_signal(int sig)
 			hub->status = hub_status_restart;
 			break;
 
+		case SIGUSR2:
+			if (hub->status == hub_status_running || hub->status == hub_status_disabled)
+				hub->status = hub_status_upgrade;
+			break;
+
 		default:
 			LOG_TRACE("hub_handle_signal(): caught unknown signal: %d", sig);
 			hub->status = hub_status_shutdown;
@@ -74,6 +85,7 @@ static int signals[] =
 	SIGTERM, /* Terminate the application */
 	SIGPIPE, /* prevent sigpipe from kills the application */
 	SIGHUP,  /* reload configuration */
+	SIGUSR2, /* upgrade to a new executable, without disconnecting users */
 	0
 };
 
@@ -107,70 +119,113 @@ static inline void shutdown_signal_handlers(struct hub_info* hub)
 int main_loop()
 {
 	struct hub_config configuration;
+	struct hub_config reloaded;
 	struct acl_handle acl;
 	struct hub_info* hub = 0;
+	int upgrade = 0;
 
 	if (net_initialize() == -1)
 		return -1;
 
+#if !defined(WIN32)
+	/* Started by an older process handing over its users? */
+	upgrade = hub_upgrade_receive();
+	if (upgrade == -1)
+	{
+		net_destroy();
+		hub_log_shutdown();
+		return -1;
+	}
+#endif
+
+	if (read_config(arg_config, &configuration, !arg_have_config) == -1)
+		return -1;
+
+	if (acl_initialize(&configuration, &acl) == -1)
+		return -1;
+
+	hub = hub_start_service(&configuration);
+	if (!hub)
+	{
+		acl_shutdown(&acl);
+		free_config(&configuration);
+		net_destroy();
+		hub_log_shutdown();
+		return -1;
+	}
+#if !defined(WIN32)
+	setup_signal_handlers(hub);
+#ifdef SYSTEMD_SUPPORT
+	/* Notify the service manager that this daemon has
+	 * been successfully initialized and shall enter the
+	 * main loop.
+	 */
+	sd_notifyf(0, "READY=1\nMAINPID=%lu", (unsigned long) getpid());
+#endif /* SYSTEMD_SUPPORT */
+
+#endif /* ! WIN32 */
+
+	hub_set_variables(hub, &acl);
+	vhub_start(hub);
+
 	do
 	{
-		if (hub)
+		if (hub->status == hub_status_restart)
 		{
 			LOG_INFO("Reloading configuration files...");
-			LOG_DEBUG("Hub status: %d", (int) hub->status);
 
 			/* Reinitialize logs */
 			hub_log_shutdown();
 			hub_log_initialize(arg_log, arg_log_syslog);
 			hub_set_log_verbosity(arg_verbose);
-		}
-
-		if (read_config(arg_config, &configuration, !arg_have_config) == -1)
-			return -1;
-
-		if (acl_initialize(&configuration, &acl) == -1)
-			return -1;
 
-		/*
-		 * Don't restart networking when re-reading configuration.
-		 * This might not be possible either, since we might have
-		 * dropped our privileges to do so.
-		 */
-		if (!hub)
-		{
-			hub = hub_start_service(&configuration);
-			if (!hub)
+			/*
+			 * Networking is not restarted when re-reading configuration.
+			 * This might not be possible either, since we might have
+			 * dropped our privileges to do so.
+			 */
+			if (read_config(arg_config, &reloaded, !arg_have_config) == -1)
 			{
-				acl_shutdown(&acl);
-				free_config(&configuration);
-				net_destroy();
-				hub_log_shutdown();
-				return -1;
+				LOG_ERROR("Unable to read configuration, keeping the current configuration.");
+				free_config(&reloaded);
+				hub->status = (configuration.hub_enabled ? hub_status_running : hub_status_disabled);
 			}
-#if !defined(WIN32)
-			setup_signal_handlers(hub);
-#ifdef SYSTEMD_SUPPORT
-			/* Notify the service manager that this daemon has
-			 * been successfully initialized and shall enter the
-			 * main loop.
-			 */
-			sd_notifyf(0, "READY=1\nMAINPID=%lu", (unsigned long) getpid());
-#endif /* SYSTEMD_SUPPORT */
-
-#endif /* ! WIN32 */
+			else
+			{
+				hub_reconfigure(hub, &reloaded);
+			}
+			vhub_reconfigure(hub);
 		}
 
-		hub_set_variables(hub, &acl);
+#if !defined(WIN32)
+		if (upgrade)
+		{
+			/* The old process owns the pid file until it has been told to exit */
+			if (hub_upgrade_restore(hub) != -1)
+				pidfile_create();
+			upgrade = 0;
+		}
+#endif
 
 		hub_event_loop(hub);
 
-		hub_free_variables(hub);
-		acl_shutdown(&acl);
-		free_config(&configuration);
+#if !defined(WIN32)
+		if (hub->status == hub_status_upgrade)
+		{
+			if (hub_upgrade_start(hub, arg_exec, arg_argv) == 0)
+				arg_upgraded = 1;
+			else
+				hub->status = hub_status_restart; /* Keep running, and reload the configuration */
+		}
+#endif
 
 	} while (hub->status == hub_status_restart);
 
+	vhub_shutdown();
+	hub_free_variables(hub);
+	acl_shutdown(&acl);
+	free_config(&configuration);
+
 #if !defined(WIN32)
 	shutdown_signal_handlers(hub);
 #endif
@@ -432,13 +487,14 @@ int pidfile_create()
 
 		fprintf(pidfile, "%d", (int) getpid());
 		fclose(pidfile);
+		pidfile_written = 1;
 	}
 	return 0;
 }
 
 int pidfile_destroy()
 {
-	if (arg_pid)
+	if (arg_pid && pidfile_written)
 	{
 		return unlink(arg_pid);
 	}
@@ -450,6 +506,8 @@ int main(int argc, char** argv)
 {
 	int ret = 0;
 
+	arg_argv = argv;
+	arg_exec = argv[0];
 	parse_command_line(argc, argv);
 
 	if (arg_check_config)
@@ -458,7 +516,7 @@ int main(int argc, char** argv)
 	}
 
 #ifndef WIN32
-	if (arg_fork)
+	if (arg_fork && !hub_upgrade_is_pending())
 	{
 		ret = fork();
 		if (ret == -1)
@@ -485,17 +543,25 @@ int main(int argc, char** argv)
 	}
 #endif
 
-	if (pidfile_create() == -1)
+#ifndef WIN32
+	/* When upgrading, the pid file is written once the old process has handed over */
+	if (!hub_upgrade_is_pending() && pidfile_create() == -1)
 		return -1;
 
-#ifndef WIN32
-	if (drop_privileges() == -1)
+	/* When upgrading, the old process has already dropped them */
+	if (!hub_upgrade_is_pending() && drop_privileges() == -1)
+		return -1;
+#else
+	if (pidfile_create() == -1)
 		return -1;
 #endif /* WIN32 */
 
 	ret = main_loop();
 
-	pidfile_destroy();
+	/* The pid file now belongs to the new process, and an upgraded process
+	 * that failed to take over never wrote one */
+	if (!arg_upgraded)
+		pidfile_destroy();
 
 	return ret;
 }
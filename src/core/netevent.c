@@ -21,20 +21,74 @@
 #include "ioqueue.h"
 #include "probe.h"
 
+/*
+ * Reads are handled within a budget of lines and bytes per connection,
+ * so one client sending large pipelined batches cannot hold up everyone
+ * else. Lines left over are handled in the next round, after all other
+ * users got their turn, and the socket is not read from until then.
+ * Users whose send queue is over the soft limit are not read from until
+ * the queue is drained.
+ */
+static int handle_net_read_congested(struct hub_user* user)
+{
+	return user->hub->config->read_pause_congested && user->send_queue->size > (size_t) user->hub->config->max_send_buffer_soft;
+}
+
+void handle_net_read_defer(struct hub_user* user)
+{
+	struct hub_info* hub = user->hub;
+	struct event_data post;
+
+	if (user->read_queued)
+		return;
+
+	user->read_queued = 1;
+	list_append(hub->read_queue, user);
+	user_net_io_update(user);
+
+	if (list_size(hub->read_queue) == 1)
+	{
+		memset(&post, 0, sizeof(post));
+		post.id = UHUB_EVENT_READ_CONTINUE;
+		event_queue_post(hub->queue, &post);
+	}
+}
+
 int handle_net_read(struct hub_user* user)
 {
 	static char buf[MAX_RECV_BUF];
 	struct ioq_recv* q = user->recv_queue;
+	struct hub_config* config = user->hub->config;
 	size_t buf_size = ioq_recv_get(q, buf, MAX_RECV_BUF);
-	ssize_t size;
+	size_t budget_lines = 0;
+	size_t budget_bytes = 0;
+	int deferred = 0;
+	int paused = 0;
+	int handed_over;
+	ssize_t size = 0;
+
+	if (user->read_paused || user->read_queued)
+		return 0;
 
 	if (user_flag_get(user, flag_maxbuf))
 		buf_size = 0;
-	size = net_con_recv(user->connection, buf + buf_size, MAX_RECV_BUF - buf_size);
+
+	if (buf_size < MAX_RECV_BUF)
+		size = net_con_recv(user->connection, buf + buf_size, MAX_RECV_BUF - buf_size);
 
 	if (size > 0)
 		buf_size += size;
 
+	/* The hub is known once the TLS handshake is done */
+	if (user->state == state_protocol)
+	{
+		handed_over = vhub_select(user);
+		if (handed_over == -1)
+			return quit_hub_disabled;
+		if (handed_over)
+			config = user->hub->config;
+	}
+
 	if (size < 0)
 	{
 		if (size == -1)
@@ -42,7 +96,7 @@ int handle_net_read(struct hub_user* user)
 		else
 			return quit_socket_error;
 	}
-	else if (size == 0)
+	else if (size == 0 && !buf_size)
 	{
 		return 0;
 	}
@@ -56,6 +110,19 @@ int handle_net_read(struct hub_user* user)
 
 		while ((pos = memchr(start, '\n', remaining)))
 		{
+			if ((config->read_budget_lines && budget_lines >= (size_t) config->read_budget_lines) ||
+			    (config->read_budget_bytes && budget_bytes >= (size_t) config->read_budget_bytes))
+			{
+				deferred = 1;
+				break;
+			}
+
+			if (handle_net_read_congested(user))
+			{
+				paused = 1;
+				break;
+			}
+
 			lastPos = pos + 1;
 			pos[0] = '\0';
 
@@ -69,8 +136,11 @@ int handle_net_read(struct hub_user* user)
 			{
 				user_flag_unset(user, flag_maxbuf);
 			}
-			else if (len > 0 && len < user->hub->config->max_recv_buffer)
+			else if (len > 0 && len < config->max_recv_buffer)
 			{
+				if (user->hub->capture)
+					hub_capture_message(user->hub, user, start, (size_t) len);
+
 				if (hub_handle_message(user->hub, user, start, (size_t) len) == -1)
 					return quit_protocol_error;
 			}
@@ -79,11 +149,13 @@ int handle_net_read(struct hub_user* user)
 			pos++;
 			remaining -= (size_t) len + 1;
 			start = pos;
+			budget_lines++;
+			budget_bytes += (size_t) len + 1;
 		}
 
 		if (lastPos || remaining)
 		{
-			if (remaining < (size_t) user->hub->config->max_recv_buffer)
+			if (remaining < (size_t) config->max_recv_buffer || deferred || paused)
 			{
 				ioq_recv_set(q, lastPos ? lastPos : buf, remaining);
 			}
@@ -99,9 +171,65 @@ int handle_net_read(struct hub_user* user)
 			ioq_recv_set(q, 0, 0);
 		}
 	}
+
+	if (user_is_disconnecting(user))
+		return 0;
+
+	if (paused)
+	{
+		user->read_paused = 1;
+		user->hub->stats.read_paused++;
+		user_net_io_update(user);
+	}
+	else if (deferred)
+	{
+		user->hub->stats.read_deferred++;
+		handle_net_read_defer(user);
+	}
 	return 0;
 }
 
+void handle_net_read_continue(struct hub_info* hub)
+{
+	struct hub_user* user;
+	size_t count = list_size(hub->read_queue);
+	int flag_close;
+
+	/* Users deferred again go to the back of the queue, and wait for the next round. */
+	for (; count && (user = (struct hub_user*) list_get_first(hub->read_queue)); count--)
+	{
+		list_remove_first(hub->read_queue, NULL);
+		user->read_queued = 0;
+
+		flag_close = handle_net_read(user);
+		if (flag_close)
+		{
+			hub_disconnect_user(hub, user, flag_close);
+			continue;
+		}
+
+		if (!user->read_queued)
+			user_net_io_update(user);
+	}
+
+	if (list_size(hub->read_queue))
+	{
+		struct event_data post;
+		memset(&post, 0, sizeof(post));
+		post.id = UHUB_EVENT_READ_CONTINUE;
+		event_queue_post(hub->queue, &post);
+	}
+}
+
+void handle_net_read_cancel(struct hub_info* hub, struct hub_user* user)
+{
+	if (user->read_queued)
+	{
+		list_remove(hub->read_queue, user);
+		user->read_queued = 0;
+	}
+}
+
 int handle_net_write(struct hub_user* user)
 {
 	int ret = 0;
@@ -121,6 +249,18 @@ int handle_net_write(struct hub_user* user)
 	}
 	else
 	{
+		user->send_backlog = 0;
+
+		/* The user list is sent while logging in, links keep their exemption */
+		if (user_is_logged_in(user) && !user->link)
+			user_flag_unset(user, flag_user_list);
+
+		/* Congestion is over, pick up where reading stopped. */
+		if (user->read_paused)
+		{
+			user->read_paused = 0;
+			handle_net_read_defer(user);
+		}
 		user_net_io_want_read(user);
 	}
 	return 0;
@@ -176,12 +316,11 @@ void net_on_accept(struct net_connection* con, int event, void *arg)
 	struct hub_info* hub = (struct hub_info*) arg;
 	struct hub_probe* probe = 0;
 	struct ip_addr_encap ipaddr;
-	int server_fd = net_con_get_sd(con);
 	plugin_st status;
 
 	for (;;)
 	{
-		int fd = net_accept(server_fd, &ipaddr);
+		int fd = net_con_accept(con, &ipaddr);
 		if (fd == -1)
 		{
 #ifdef WINSOCK
@@ -199,7 +338,11 @@ void net_on_accept(struct net_connection* con, int event, void *arg)
 			}
 		}
 
-		status = plugin_check_ip_early(hub, &ipaddr);
+		if (hub->acl && acl_is_addr_banned(hub->acl, &ipaddr))
+			status = st_deny;
+		else
+			status = plugin_check_ip_early(hub, &ipaddr);
+
 		if (status == st_deny)
 		{
 			plugin_log_connection_denied(hub, &ipaddr);
@@ -29,6 +29,23 @@ extern void net_event(struct net_connection* con, int event, void *arg);
 extern int handle_net_read(struct hub_user* user);
 extern int handle_net_write(struct hub_user* user);
 
+/**
+ * Continue reading from users that ran out of their read budget,
+ * see the read_budget_lines and read_budget_bytes options.
+ */
+extern void handle_net_read_continue(struct hub_info* hub);
+
+/**
+ * Queue a user to continue reading (what is left in the receive queue
+ * first) once the other users have had their turn.
+ */
+extern void handle_net_read_defer(struct hub_user* user);
+
+/**
+ * Remove a user from the queue of users waiting to continue reading.
+ */
+extern void handle_net_read_cancel(struct hub_info* hub, struct hub_user* user);
+
 
 #endif /* HAVE_UHUB_NET_EVENT_H */
 
@@ -209,6 +209,11 @@ static int cbfunc_auth_delete_user(struct plugin_handle* plugin, struct auth_inf
 	return (plugin_auth_delete_user(plugin_get_hub(plugin), info) == st_allow ? 1 : 0);
 }
 
+static void cbfunc_auth_request_complete(struct plugin_handle* plugin, struct plugin_auth_request* request, plugin_st status, struct auth_info* info)
+{
+	acl_request_complete((struct auth_request*) request, status, info);
+}
+
 static char* cbfunc_get_hub_name(struct plugin_handle* plugin)
 {
 	struct hub_info* hub = plugin_get_hub(plugin);
@@ -289,6 +294,7 @@ void plugin_register_callback_functions(struct plugin_handle* handle)
 	handle->hub.auth_register_user = cbfunc_auth_register_user;
 	handle->hub.auth_update_user = cbfunc_auth_update_user;
 	handle->hub.auth_delete_user = cbfunc_auth_delete_user;
+	handle->hub.auth_request_complete = cbfunc_auth_request_complete;
 	handle->hub.get_name = cbfunc_get_hub_name;
 	handle->hub.set_name = cbfunc_set_hub_name;
 	handle->hub.get_description = cbfunc_get_hub_description;
@@ -20,7 +20,7 @@
 #include "uhub.h"
 #include "plugin_api/handle.h"
 
-#define PLUGIN_DEBUG(hub, name) LOG_PLUGIN("Invoke %s on %d plugins", name, (hub->plugins ? (int) list_size(hub->plugins->loaded) : -1));
+#define PLUGIN_DEBUG(hub, name) LOG_PLUGIN("Invoke %s on %d plugins", #name, (hub->plugins ? (int) hub->plugins->hooks[PLUGIN_HOOK_INDEX(name)].count : -1));
 
 /* Workaround for broken visual studio variadic macros */
 #ifdef _MSC_VER
@@ -35,16 +35,19 @@
 #define PLUGIN_INVOKE        PLUGIN_INVOKE_
 #endif
 
+/* Only the plugins implementing the hook are visited, see plugin_hooks_update() */
 #define INVOKE_(HUB, FUNCNAME, CODE) \
-	PLUGIN_DEBUG(HUB, # FUNCNAME) \
-	if (HUB->plugins && HUB->plugins->loaded) \
+	PLUGIN_DEBUG(HUB, FUNCNAME) \
+	if (HUB->plugins) \
 	{ \
-		struct plugin_handle* plugin;\
-		LIST_FOREACH(struct plugin_handle*, plugin, HUB->plugins->loaded, \
+		struct plugin_hook_list* hook = &HUB->plugins->hooks[PLUGIN_HOOK_INDEX(FUNCNAME)]; \
+		struct plugin_handle* plugin; \
+		size_t n; \
+		for (n = 0; n < hook->count; n++) \
 		{ \
-			if (plugin->funcs.FUNCNAME) \
-				CODE \
-		}); \
+			plugin = hook->plugins[n]; \
+			CODE \
+		} \
 	}
 
 #define PLUGIN_INVOKE_STATUS_(HUB, FUNCNAME, ...) \
@@ -138,12 +141,33 @@ plugin_st plugin_handle_private_message(struct hub_info* hub, struct hub_user* f
 	PLUGIN_INVOKE_STATUS(hub, on_private_msg, user1, user2, message);
 }
 
-plugin_st plugin_handle_search(struct hub_info* hub, struct hub_user* from, const char* data)
+static plugin_st plugin_handle_search_raw(struct hub_info* hub, struct plugin_user* user, const char* data)
 {
-	struct plugin_user* user = convert_user_type(from);
 	PLUGIN_INVOKE_STATUS(hub, on_search, user, data);
 }
 
+static plugin_st plugin_handle_search_parsed(struct hub_info* hub, struct plugin_user* user, const struct plugin_search* search)
+{
+	PLUGIN_INVOKE_STATUS(hub, on_search_parsed, user, search);
+}
+
+plugin_st plugin_handle_search(struct hub_info* hub, struct hub_user* from, struct adc_message* cmd)
+{
+	struct plugin_user* user = convert_user_type(from);
+	const struct plugin_search* search;
+	plugin_st status = plugin_handle_search_raw(hub, user, cmd->cache);
+
+	if (status != st_default || !hub->plugins || !hub->plugins->hooks[PLUGIN_HOOK_INDEX(on_search_parsed)].count)
+		return status;
+
+	/* Only parsed if a plugin wants it, and then only once per message. */
+	search = adc_msg_get_search(cmd);
+	if (!search)
+		return st_default;
+
+	return plugin_handle_search_parsed(hub, user, search);
+}
+
 plugin_st plugin_handle_search_result(struct hub_info* hub, struct hub_user* from, struct hub_user* to, const char* data)
 {
 	struct plugin_user* user1 = convert_user_type(from);
@@ -175,6 +199,42 @@ plugin_st plugin_auth_get_user(struct hub_info* hub, const char* nickname, struc
 	PLUGIN_INVOKE_STATUS(hub, auth_get_user, nickname, info);
 }
 
+plugin_st plugin_auth_get_user_async(struct hub_info* hub, struct plugin_auth_request* request, const char* nickname, struct auth_info* info, struct plugin_handle** handler)
+{
+	struct plugin_handle* plugin;
+	plugin_st status = st_default;
+	int skip = (*handler != NULL);
+
+	PLUGIN_DEBUG(hub, auth_get_user_async);
+	if (!hub->plugins || !hub->plugins->loaded)
+		return st_default;
+
+	LIST_FOREACH(struct plugin_handle*, plugin, hub->plugins->loaded,
+	{
+		/* Resume after the plugin that handled the request last time */
+		if (skip)
+		{
+			if (plugin == *handler)
+				skip = 0;
+			continue;
+		}
+
+		if (plugin->funcs.auth_get_user_async)
+			status = plugin->funcs.auth_get_user_async(plugin, request, nickname);
+		else if (plugin->funcs.auth_get_user)
+			status = plugin->funcs.auth_get_user(plugin, nickname, info);
+		else
+			continue;
+
+		if (status != st_default)
+		{
+			*handler = plugin;
+			break;
+		}
+	});
+	return status;
+}
+
 plugin_st plugin_auth_register_user(struct hub_info* hub, struct auth_info* info)
 {
 	PLUGIN_INVOKE_STATUS(hub, auth_register_user, info);
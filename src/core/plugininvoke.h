@@ -25,6 +25,7 @@
 
 struct hub_info;
 struct ip_addr_encap;
+struct adc_message;
 
 /* All log related functions */
 void plugin_log_connection_accepted(struct hub_info* hub, struct ip_addr_encap* addr);
@@ -49,7 +50,7 @@ plugin_st plugin_handle_chat_message(struct hub_info* hub, struct hub_user* from
 plugin_st plugin_handle_private_message(struct hub_info* hub, struct hub_user* from, struct hub_user* to, const char* message, int flags);
 
 /* Handle searches */
-plugin_st plugin_handle_search(struct hub_info* hub, struct hub_user* user, const char* data);
+plugin_st plugin_handle_search(struct hub_info* hub, struct hub_user* user, struct adc_message* cmd);
 plugin_st plugin_handle_search_result(struct hub_info* hub, struct hub_user* from, struct hub_user* to, const char* data);
 
 /* Handle p2p connections */
@@ -63,5 +64,12 @@ plugin_st plugin_auth_register_user(struct hub_info* hub, struct auth_info* user
 plugin_st plugin_auth_update_user(struct hub_info* hub, struct auth_info* user);
 plugin_st plugin_auth_delete_user(struct hub_info* hub, struct auth_info* user);
 
+/*
+ * Look up a user, allowing plugins to complete the request later (st_pending).
+ * If *handler is set, only plugins loaded after it are asked.
+ * On return *handler is the plugin that answered.
+ */
+plugin_st plugin_auth_get_user_async(struct hub_info* hub, struct plugin_auth_request* request, const char* nickname, struct auth_info* info, struct plugin_handle** handler);
+
 #endif // HAVE_UHUB_PLUGIN_INVOKE_H
 
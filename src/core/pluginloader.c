@@ -89,6 +89,8 @@ void plugin_close(struct uhub_plugin* plugin)
 	FreeLibrary((HMODULE) plugin->handle);
 #endif
 	hub_free(plugin->filename);
+	hub_free(plugin->config);
+	hub_free(plugin->files);
 	hub_free(plugin);
 }
 
@@ -176,17 +178,38 @@ void plugin_unload(struct plugin_handle* plugin)
 {
 	struct plugin_hub_internals* internals = get_internals(plugin);
 	internals->unregister(plugin);
+
+	/* Lookups the plugin completed while unregistering must not refer back to it */
+	acl_request_plugin_unload(internals->hub, plugin);
+
 	plugin_unregister_callback_functions(plugin);
 	plugin_close(plugin->handle);
 	hub_free(plugin);
 }
 
+/* A "plugin" line from the plugin configuration file */
+struct plugin_config_line
+{
+	char* soname;
+	char* params;
+	struct plugin_handle* plugin; /* Running plugin to keep, if unchanged */
+};
+
+static void plugin_config_line_free(void* ptr)
+{
+	struct plugin_config_line* line = (struct plugin_config_line*) ptr;
+	if (line->plugin)
+		plugin_unload(line->plugin);
+	hub_free(line->soname);
+	hub_free(line->params);
+	hub_free(line);
+}
+
 static int plugin_parse_line(char* line, int line_count, void* ptr_data)
 {
-	struct hub_info* hub = (struct hub_info*) ptr_data;
-	struct uhub_plugins* handle = hub->plugins;
+	struct linked_list* lines = (struct linked_list*) ptr_data;
 	struct cfg_tokens* tokens = cfg_tokenize(line);
-	struct plugin_handle* plugin;
+	struct plugin_config_line* entry;
 	char *directive, *soname, *params;
 
 	if (cfg_token_count(tokens) == 0)
@@ -210,13 +233,18 @@ static int plugin_parse_line(char* line, int line_count, void* ptr_data)
 		if (!params)
 			params = "";
 
-		LOG_PLUGIN("Load plugin: \"%s\", params=\"%s\"", soname, params);
-		plugin = plugin_load(soname, params, hub);
-		if (plugin)
+		entry = hub_malloc_zero(sizeof(struct plugin_config_line));
+		if (entry)
 		{
-			list_append(handle->loaded, plugin);
-			cfg_tokens_free(tokens);
-			return 0;
+			entry->soname = hub_strdup(soname);
+			entry->params = hub_strdup(params);
+			if (entry->soname && entry->params)
+			{
+				list_append(lines, entry);
+				cfg_tokens_free(tokens);
+				return 0;
+			}
+			plugin_config_line_free(entry);
 		}
 	}
 
@@ -224,27 +252,198 @@ static int plugin_parse_line(char* line, int line_count, void* ptr_data)
 	return -1;
 }
 
-int plugin_initialize(struct hub_config* config, struct hub_info* hub)
+/* Plugins write to their databases all the time, only a replaced database counts as a change. */
+static int plugin_file_is_database(const char* filename)
 {
-	int ret;
+	static const char magic[16] = "SQLite format 3";
+	char buf[16];
+	ssize_t ret;
+	int fd = open(filename, 0);
+	if (fd == -1)
+		return 0;
 
-	hub->plugins->loaded = list_create();
-	if (!hub->plugins->loaded)
+	ret = read(fd, buf, sizeof(buf));
+	close(fd);
+	return ret == sizeof(buf) && !memcmp(buf, magic, sizeof(buf));
+}
+
+/*
+ * Get the stamps of all files named by "key=value" plugin parameters.
+ * Returns the number of stamps, or -1 on error.
+ */
+static ssize_t plugin_get_file_stamps(const char* params, struct file_stamp** files)
+{
+	struct cfg_tokens* tokens = cfg_tokenize(params);
+	struct cfg_settings* setting;
+	struct file_stamp* stamp;
+	const char* value;
+	char* token;
+	ssize_t count = 0;
+
+	*files = NULL;
+	if (!tokens)
 		return -1;
 
-	if (config)
+	if (cfg_token_count(tokens))
 	{
-		if (!*config->file_plugins)
-			return 0;
+		*files = hub_malloc_zero(sizeof(struct file_stamp) * cfg_token_count(tokens));
+		if (!*files)
+		{
+			cfg_tokens_free(tokens);
+			return -1;
+		}
+	}
+
+	for (token = cfg_token_get_first(tokens); token; token = cfg_token_get_next(tokens))
+	{
+		setting = cfg_settings_split(token);
+		if (!setting)
+			continue;
 
-		ret = file_read_lines(config->file_plugins, hub, &plugin_parse_line);
-		if (ret == -1)
+		value = cfg_settings_get_value(setting);
+		stamp = &(*files)[count];
+		if (value && file_get_stamp(value, stamp) == 0)
 		{
-			list_clear(hub->plugins->loaded, hub_free);
-			list_destroy(hub->plugins->loaded);
-			hub->plugins->loaded = 0;
+			if (plugin_file_is_database(value))
+			{
+				stamp->size = 0;
+				stamp->mtime = 0;
+				stamp->ctime = 0;
+			}
+			count++;
+		}
+		cfg_settings_free(setting);
+	}
+
+	cfg_tokens_free(tokens);
+	return count;
+}
+
+static int plugin_is_unchanged(struct plugin_handle* plugin, struct plugin_config_line* line)
+{
+	struct uhub_plugin* loaded = plugin->handle;
+	struct file_stamp* files;
+	ssize_t count;
+	int unchanged;
+
+	if (strcmp(loaded->filename, line->soname) || strcmp(loaded->config, line->params))
+		return 0;
+
+	count = plugin_get_file_stamps(line->params, &files);
+	unchanged = count >= 0 && (size_t) count == loaded->num_files && (!count || !memcmp(files, loaded->files, sizeof(struct file_stamp) * count));
+	hub_free(files);
+	return unchanged;
+}
+
+static struct plugin_handle* plugin_load_line(struct plugin_config_line* line, struct hub_info* hub)
+{
+	struct plugin_handle* plugin;
+	ssize_t count;
+
+	LOG_PLUGIN("Load plugin: \"%s\", params=\"%s\"", line->soname, line->params);
+	plugin = plugin_load(line->soname, line->params, hub);
+	if (!plugin)
+		return NULL;
+
+	plugin->handle->config = hub_strdup(line->params);
+	count = plugin_get_file_stamps(line->params, &plugin->handle->files);
+	if (!plugin->handle->config || count < 0)
+	{
+		plugin_unload(plugin);
+		return NULL;
+	}
+	plugin->handle->num_files = (size_t) count;
+	return plugin;
+}
+
+/* Where each hook (see enum plugin_hook) is found in struct plugin_funcs */
+static const size_t plugin_hook_offsets[PLUGIN_HOOK_COUNT] =
+{
+	offsetof(struct plugin_funcs, on_connection_accepted),
+	offsetof(struct plugin_funcs, on_connection_refused),
+	offsetof(struct plugin_funcs, on_user_login),
+	offsetof(struct plugin_funcs, on_user_login_error),
+	offsetof(struct plugin_funcs, on_user_logout),
+	offsetof(struct plugin_funcs, on_user_nick_change),
+	offsetof(struct plugin_funcs, on_user_update_error),
+	offsetof(struct plugin_funcs, on_user_chat_message),
+	offsetof(struct plugin_funcs, on_hub_started),
+	offsetof(struct plugin_funcs, on_hub_reloaded),
+	offsetof(struct plugin_funcs, on_hub_shutdown),
+	offsetof(struct plugin_funcs, on_hub_error),
+	offsetof(struct plugin_funcs, on_check_ip_early),
+	offsetof(struct plugin_funcs, on_check_ip_late),
+	offsetof(struct plugin_funcs, on_change_nick),
+	offsetof(struct plugin_funcs, on_chat_msg),
+	offsetof(struct plugin_funcs, on_private_msg),
+	offsetof(struct plugin_funcs, on_search),
+	offsetof(struct plugin_funcs, on_search_result),
+	offsetof(struct plugin_funcs, on_p2p_connect),
+	offsetof(struct plugin_funcs, on_p2p_revconnect),
+	offsetof(struct plugin_funcs, auth_get_user),
+	offsetof(struct plugin_funcs, auth_get_user_list),
+	offsetof(struct plugin_funcs, auth_register_user),
+	offsetof(struct plugin_funcs, auth_update_user),
+	offsetof(struct plugin_funcs, auth_delete_user),
+	offsetof(struct plugin_funcs, auth_get_user_async),
+	offsetof(struct plugin_funcs, on_search_parsed),
+};
+
+typedef void (*plugin_hook_f)(void);
+
+static plugin_hook_f plugin_get_hook(struct plugin_handle* plugin, size_t hook)
+{
+	return *(plugin_hook_f*) ((char*) &plugin->funcs + plugin_hook_offsets[hook]);
+}
+
+void plugin_hooks_clear(struct uhub_plugins* handle)
+{
+	size_t hook;
+	for (hook = 0; hook < PLUGIN_HOOK_COUNT; hook++)
+	{
+		hub_free(handle->hooks[hook].plugins);
+		handle->hooks[hook].plugins = NULL;
+		handle->hooks[hook].count = 0;
+	}
+}
+
+int plugin_hooks_update(struct uhub_plugins* handle)
+{
+	struct plugin_handle* plugin;
+	struct plugin_hook_list* list;
+	size_t hook;
+
+	plugin_hooks_clear(handle);
+
+	if (!handle->loaded)
+		return 0;
+
+	for (hook = 0; hook < PLUGIN_HOOK_COUNT; hook++)
+	{
+		list = &handle->hooks[hook];
+
+		LIST_FOREACH(struct plugin_handle*, plugin, handle->loaded,
+		{
+			if (plugin_get_hook(plugin, hook))
+				list->count++;
+		});
+
+		if (!list->count)
+			continue;
+
+		list->plugins = hub_malloc(sizeof(struct plugin_handle*) * list->count);
+		if (!list->plugins)
+		{
+			plugin_hooks_clear(handle);
 			return -1;
 		}
+
+		list->count = 0;
+		LIST_FOREACH(struct plugin_handle*, plugin, handle->loaded,
+		{
+			if (plugin_get_hook(plugin, hook))
+				list->plugins[list->count++] = plugin;
+		});
 	}
 	return 0;
 }
@@ -255,9 +454,105 @@ static void plugin_unload_ptr(void* ptr)
 	plugin_unload(plugin);
 }
 
+int plugin_reconfigure(struct hub_config* config, struct hub_info* hub, struct plugin_reload_info* info)
+{
+	struct uhub_plugins* handle = hub->plugins;
+	struct linked_list* lines;
+	struct plugin_config_line* line;
+	struct plugin_handle* plugin;
+	struct plugin_reload_info stats;
+	int ret = 0;
+
+	memset(&stats, 0, sizeof(stats));
+
+	lines = list_create();
+	if (!lines)
+		return -1;
+
+	if (file_read_lines(config->file_plugins, lines, &plugin_parse_line) < 0)
+	{
+		list_clear(lines, plugin_config_line_free);
+		list_destroy(lines);
+		return -1;
+	}
+
+	/* Claim the running plugins that can be kept as they are */
+	LIST_FOREACH(struct plugin_config_line*, line, lines,
+	{
+		LIST_FOREACH(struct plugin_handle*, plugin, handle->loaded,
+		{
+			if (plugin_is_unchanged(plugin, line))
+			{
+				list_remove(handle->loaded, plugin);
+				line->plugin = plugin;
+				break;
+			}
+		});
+	});
+
+	/* Anything left is no longer configured, or has changed */
+	stats.unloaded = list_size(handle->loaded);
+	plugin_hooks_clear(handle);
+	list_clear(handle->loaded, plugin_unload_ptr);
+
+	LIST_FOREACH(struct plugin_config_line*, line, lines,
+	{
+		if (line->plugin)
+		{
+			LOG_PLUGIN("Keeping plugin: \"%s\", params=\"%s\"", line->soname, line->params);
+			list_append(handle->loaded, line->plugin);
+			line->plugin = NULL;
+			stats.kept++;
+		}
+		else
+		{
+			plugin = plugin_load_line(line, hub);
+			if (!plugin)
+			{
+				ret = -1;
+				break;
+			}
+			list_append(handle->loaded, plugin);
+			stats.loaded++;
+		}
+	});
+
+	if (ret == 0)
+		ret = plugin_hooks_update(handle);
+
+	/* On error, this also unloads the plugins that were not added back */
+	list_clear(lines, plugin_config_line_free);
+	list_destroy(lines);
+
+	if (info)
+		*info = stats;
+	return ret;
+}
+
+int plugin_initialize(struct hub_config* config, struct hub_info* hub)
+{
+	hub->plugins->loaded = list_create();
+	if (!hub->plugins->loaded)
+		return -1;
+
+	if (config)
+	{
+		if (!*config->file_plugins)
+			return 0;
+
+		if (plugin_reconfigure(config, hub, NULL) == -1)
+		{
+			plugin_shutdown(hub->plugins);
+			hub->plugins->loaded = 0;
+			return -1;
+		}
+	}
+	return 0;
+}
 
 void plugin_shutdown(struct uhub_plugins* handle)
 {
+	plugin_hooks_clear(handle);
 	list_clear(handle->loaded, plugin_unload_ptr);
 	list_destroy(handle->loaded);
 }
@@ -25,6 +25,7 @@
 struct hub_config;
 struct hub_info;
 struct linked_list;
+struct file_stamp;
 struct plugin_handle;
 
 struct uhub_plugin
@@ -32,12 +33,63 @@ struct uhub_plugin
 	void* handle;
 	plugin_unregister_f unregister;
 	char* filename;
+	char* config;         // Plugin parameters, as given in the plugin configuration file
+	struct file_stamp* files; // Files referred to by the parameters, when the plugin was loaded
+	size_t num_files;
 	void* internals;      // Hub-internal stuff (struct plugin_hub_internals)
 };
 
+/*
+ * The hooks of struct plugin_funcs that have a dispatch table.
+ * A hook added to struct plugin_funcs must also be added to
+ * plugin_hook_offsets in pluginloader.c.
+ */
+enum plugin_hook
+{
+	plugin_hook_on_connection_accepted,
+	plugin_hook_on_connection_refused,
+	plugin_hook_on_user_login,
+	plugin_hook_on_user_login_error,
+	plugin_hook_on_user_logout,
+	plugin_hook_on_user_nick_change,
+	plugin_hook_on_user_update_error,
+	plugin_hook_on_user_chat_message,
+	plugin_hook_on_hub_started,
+	plugin_hook_on_hub_reloaded,
+	plugin_hook_on_hub_shutdown,
+	plugin_hook_on_hub_error,
+	plugin_hook_on_check_ip_early,
+	plugin_hook_on_check_ip_late,
+	plugin_hook_on_change_nick,
+	plugin_hook_on_chat_msg,
+	plugin_hook_on_private_msg,
+	plugin_hook_on_search,
+	plugin_hook_on_search_result,
+	plugin_hook_on_p2p_connect,
+	plugin_hook_on_p2p_revconnect,
+	plugin_hook_auth_get_user,
+	plugin_hook_auth_get_user_list,
+	plugin_hook_auth_register_user,
+	plugin_hook_auth_update_user,
+	plugin_hook_auth_delete_user,
+	plugin_hook_auth_get_user_async,
+	plugin_hook_on_search_parsed,
+	PLUGIN_HOOK_COUNT
+};
+
+#define PLUGIN_HOOK_INDEX(FUNCNAME) (plugin_hook_ ## FUNCNAME)
+
+/* The plugins implementing a hook, in load order */
+struct plugin_hook_list
+{
+	size_t count;
+	struct plugin_handle** plugins;
+};
+
 struct uhub_plugins
 {
 	struct linked_list* loaded;
+	struct plugin_hook_list hooks[PLUGIN_HOOK_COUNT];
 };
 
 // High level plugin loader code
@@ -48,6 +100,37 @@ extern void plugin_unload(struct plugin_handle* plugin);
 extern int plugin_initialize(struct hub_config* config, struct hub_info* hub);
 extern void plugin_shutdown(struct uhub_plugins* handle);
 
+struct plugin_reload_info
+{
+	size_t kept;
+	size_t loaded;
+	size_t unloaded;
+};
+
+/**
+ * Apply the plugin configuration file to the loaded plugins.
+ * A plugin is kept loaded if its configuration line is unchanged, and
+ * none of the files named in its parameters were modified or replaced
+ * (SQLite databases are only checked for replacement, since the plugin
+ * writes to them).
+ * All other plugins are unloaded, and new or changed ones are loaded,
+ * in the order given by the configuration file.
+ *
+ * If the configuration file cannot be read the loaded plugins are
+ * left untouched.
+ *
+ * @param info if not NULL, receives the number of plugins kept, loaded and unloaded.
+ * @return 0 on success, -1 on error.
+ */
+extern int plugin_reconfigure(struct hub_config* config, struct hub_info* hub, struct plugin_reload_info* info);
+
+/**
+ * Rebuild the per hook dispatch tables from the list of loaded plugins.
+ * Must be called whenever plugins are loaded or unloaded.
+ */
+extern int plugin_hooks_update(struct uhub_plugins* handle);
+extern void plugin_hooks_clear(struct uhub_plugins* handle);
+
 // Low level plugin loader code (used internally)
 extern struct uhub_plugin* plugin_open(const char* filename);
 extern void plugin_close(struct uhub_plugin*);
@@ -169,9 +169,16 @@ static void probe_net_event(struct net_connection* con, int events, void *arg)
 		probe_net_event_read(probe);
 }
 
+static struct mem_pool g_probe_pool = MEM_POOL_INIT("probe", struct hub_probe);
+
+void probe_pool_prewarm(size_t count)
+{
+	mem_pool_prewarm(&g_probe_pool, count);
+}
+
 struct hub_probe* probe_create(struct hub_info* hub, int sd, struct ip_addr_encap* addr)
 {
-	struct hub_probe* probe = (struct hub_probe*) hub_malloc_zero(sizeof(struct hub_probe));
+	struct hub_probe* probe = (struct hub_probe*) mem_pool_alloc(&g_probe_pool);
 	int timeout;
 
 	if (probe == NULL)
@@ -181,7 +188,12 @@ struct hub_probe* probe_create(struct hub_info* hub, int sd, struct ip_addr_enca
 
 	probe->hub = hub;
 	probe->connection = net_con_create();
-	net_con_initialize(probe->connection, sd, probe_net_event, probe, NET_EVENT_READ);
+	if (net_con_initialize(probe->connection, sd, probe_net_event, probe, NET_EVENT_READ) == -1)
+	{
+		net_con_destroy(probe->connection);
+		mem_pool_free(&g_probe_pool, probe);
+		return NULL;
+	}
 
 	if (*hub->config->nmdc_redirect_addr)
 		timeout = TIMEOUT_REDIRECT;
@@ -202,7 +214,7 @@ void probe_destroy(struct hub_probe* probe)
 		net_con_close(probe->connection);
 		probe->connection = NULL;
 	}
-	hub_free(probe);
+	mem_pool_free(&g_probe_pool, probe);
 }
 
 static void probe_handle_adc(struct hub_probe* probe, char* recvbuf, ssize_t recvlen)
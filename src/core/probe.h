@@ -31,5 +31,6 @@ struct hub_probe
 
 extern struct hub_probe* probe_create(struct hub_info* hub, int sd, struct ip_addr_encap* addr);
 extern void probe_destroy(struct hub_probe* probe);
+extern void probe_pool_prewarm(size_t count);
 
 #endif /* HAVE_UHUB_PROBE_H */
@@ -27,6 +27,7 @@ int route_message(struct hub_info* hub, struct hub_user* u, struct adc_message*
 	{
 		case 'B': /* Broadcast to all logged in clients */
 			route_to_all(hub, msg);
+			link_broadcast(hub, msg);
 			break;
 
 		case 'D':
@@ -35,6 +36,10 @@ int route_message(struct hub_info* hub, struct hub_user* u, struct adc_message*
 			{
 				route_to_user(hub, target, msg);
 			}
+			else
+			{
+				link_route_to_node(hub, msg);
+			}
 			break;
 
 		case 'E':
@@ -44,10 +49,15 @@ int route_message(struct hub_info* hub, struct hub_user* u, struct adc_message*
 				route_to_user(hub, target, msg);
 				route_to_user(hub, u, msg);
 			}
+			else if (link_route_to_node(hub, msg))
+			{
+				route_to_user(hub, u, msg);
+			}
 			break;
 
 		case 'F':
 			route_to_subscribers(hub, msg);
+			link_broadcast(hub, msg);
 			break;
 
 		default:
@@ -57,17 +67,67 @@ int route_message(struct hub_info* hub, struct hub_user* u, struct adc_message*
 	return 0;
 }
 
+/* Smallest send queue limit per user, however many users share max_send_buffer_total */
+#define SEND_QUEUE_MIN_SHARE 16384
+
+/* Slow users are disconnected until this percentage of max_send_buffer_total is used */
+#define SEND_BUDGET_LOW 90
+
+static size_t g_send_budget_auto = 0;
+
+static size_t get_send_budget_auto()
+{
+	uint64_t memory = 0;
+
+	if (!g_send_budget_auto)
+	{
+#if defined(_SC_PHYS_PAGES) && defined(_SC_PAGESIZE)
+		long pages = sysconf(_SC_PHYS_PAGES);
+		long size = sysconf(_SC_PAGESIZE);
+		if (pages > 0 && size > 0)
+			memory = (uint64_t) pages * (uint64_t) size / 4;
+#endif
+		g_send_budget_auto = (memory && memory < SIZE_MAX) ? (size_t) memory : SIZE_MAX;
+	}
+	return g_send_budget_auto;
+}
+
+size_t route_get_send_budget(struct hub_info* hub)
+{
+	uint64_t budget = (uint64_t) hub->config->max_send_buffer_total * 1024 * 1024;
+
+	if (!budget)
+		return get_send_budget_auto();
+	return budget < SIZE_MAX ? (size_t) budget : SIZE_MAX;
+}
+
 static size_t get_max_send_queue(struct hub_info* hub)
 {
-	/* TODO: More dynamic send queue limit, for instance:
-	 * return MAX(hub->config->max_send_buffer, (hub->config->max_recv_buffer * hub_get_user_count(hub)));
-	 */
-	return hub->config->max_send_buffer;
+	size_t limit = hub->config->max_send_buffer;
+	size_t share = route_get_send_budget(hub) / MAX(hub->users->count, 1);
+
+	/* Everyone gets a fair share of the budget */
+	if (share < limit)
+		limit = MIN(limit, MAX(share, SEND_QUEUE_MIN_SHARE));
+	return limit;
 }
 
 static size_t get_max_send_queue_soft(struct hub_info* hub)
 {
-	return hub->config->max_send_buffer_soft;
+	return MIN((size_t) hub->config->max_send_buffer_soft, get_max_send_queue(hub));
+}
+
+static void schedule_send_budget(struct hub_info* hub)
+{
+	struct event_data post;
+
+	if (hub->send_evict_pending)
+		return;
+
+	hub->send_evict_pending = 1;
+	memset(&post, 0, sizeof(post));
+	post.id = UHUB_EVENT_SEND_BUDGET;
+	event_queue_post(hub->queue, &post);
 }
 
 /*
@@ -77,16 +137,34 @@ static size_t get_max_send_queue_soft(struct hub_info* hub)
  */
 static int check_send_queue(struct hub_info* hub, struct hub_user* user, struct adc_message* msg)
 {
+	int over_budget = (hub->stats.send_queued + msg->length) > route_get_send_budget(hub);
+
+	if (over_budget)
+		schedule_send_budget(hub);
+
 	if (user_flag_get(user, flag_user_list))
 		return 1;
 
+	/* Dropping quits (see uman_flush_quit_messages) would leave users behind in the user list */
+	if (msg->cmd == ADC_CMD_IQUI)
+		return 1;
+
 	if ((user->send_queue->size + msg->length) > get_max_send_queue(hub))
 	{
 		user_flag_set(user, flag_choke);
+		hub->stats.send_dropped++;
 		LOG_WARN("send queue overflowed, message discarded.");
 		return -1;
 	}
 
+	/* Until the slowest users are gone, only those that keep up get more */
+	if (over_budget && (user->send_queue->size + msg->length) > SEND_QUEUE_MIN_SHARE)
+	{
+		user_flag_set(user, flag_choke);
+		hub->stats.send_dropped++;
+		return -1;
+	}
+
 	if (user->send_queue->size > get_max_send_queue_soft(hub))
 	{
 		user_flag_set(user, flag_choke);
@@ -98,6 +176,17 @@ static int check_send_queue(struct hub_info* hub, struct hub_user* user, struct
 	return 1;
 }
 
+static void route_queue_message(struct hub_info* hub, struct hub_user* user, struct adc_message* msg)
+{
+	ioq_send_add(user->send_queue, msg);
+
+	if (!user->send_backlog)
+		user->send_backlog = net_get_time();
+
+	if (hub->stats.send_queued > hub->stats.send_queued_peak)
+		hub->stats.send_queued_peak = hub->stats.send_queued;
+}
+
 int route_to_user(struct hub_info* hub, struct hub_user* user, struct adc_message* msg)
 {
 #ifdef DEBUG_SENDQ
@@ -114,14 +203,14 @@ int route_to_user(struct hub_info* hub, struct hub_user* user, struct adc_messag
 	if (ioq_send_is_empty(user->send_queue) && !user_flag_get(user, flag_pipeline))
 	{
 		/* Perform oportunistic write */
-		ioq_send_add(user->send_queue, msg);
+		route_queue_message(hub, user, msg);
 		handle_net_write(user);
 	}
 	else
 	{
 		if (check_send_queue(hub, user, msg) >= 0)
 		{
-			ioq_send_add(user->send_queue, msg);
+			route_queue_message(hub, user, msg);
 			if (!user_flag_get(user, flag_pipeline))
 				user_net_io_want_write(user);
 		}
@@ -129,6 +218,62 @@ int route_to_user(struct hub_info* hub, struct hub_user* user, struct adc_messag
 	return 1;
 }
 
+static int compare_send_backlog(const void* a, const void* b)
+{
+	const struct hub_user* u1 = *((const struct hub_user**) a);
+	const struct hub_user* u2 = *((const struct hub_user**) b);
+
+	if (u1->send_backlog != u2->send_backlog)
+		return u1->send_backlog < u2->send_backlog ? -1 : 1;
+
+	if (u1->send_queue->size != u2->send_queue->size)
+		return u1->send_queue->size > u2->send_queue->size ? -1 : 1;
+
+	return 0;
+}
+
+void route_enforce_send_budget(struct hub_info* hub)
+{
+	size_t budget = route_get_send_budget(hub);
+	size_t low = budget / 100 * SEND_BUDGET_LOW;
+	size_t count = 0;
+	size_t n;
+	struct hub_user** users;
+	struct hub_user* user;
+
+	hub->send_evict_pending = 0;
+
+	if (hub->stats.send_queued <= low || !list_size(hub->users->list))
+		return;
+
+	users = (struct hub_user**) hub_malloc(list_size(hub->users->list) * sizeof(struct hub_user*));
+	if (!users)
+		return;
+
+	LIST_FOREACH(struct hub_user*, user, hub->users->list,
+	{
+		if (user->send_backlog && user->connection)
+			users[count++] = user;
+	});
+
+	/* The users that have been behind the longest go first */
+	qsort(users, count, sizeof(struct hub_user*), compare_send_backlog);
+
+	for (n = 0; n < count && hub->stats.send_queued > low; n++)
+	{
+		user = users[n];
+		LOG_INFO("Disconnecting slow user \"%s\", %" PRIsz " bytes queued (%" PRIsz " bytes queued in total)",
+			user->id.nick, ioq_send_get_bytes(user->send_queue), hub->stats.send_queued);
+
+		ioq_send_clear(user->send_queue);
+		user->send_backlog = 0;
+		hub->stats.send_evicted++;
+		hub_disconnect_user(hub, user, quit_send_queue);
+	}
+
+	hub_free(users);
+}
+
 int route_flush_pipeline(struct hub_info* hub, struct hub_user* u)
 {
 	if (ioq_send_is_empty(u->send_queue))
@@ -194,27 +339,36 @@ int route_to_subscribers(struct hub_info* hub, struct adc_message* command) /* i
 
 int route_info_message(struct hub_info* hub, struct hub_user* u)
 {
-	if (!user_is_nat_override(u))
+	struct hub_user* user = 0;
+	LIST_FOREACH(struct hub_user*, user, hub->users->list,
 	{
-		return route_to_all(hub, u->info);
-	}
-	else
+		route_to_user(hub, user, user_get_info(u, user));
+	});
+	return 0;
+}
+
+int route_info_update(struct hub_info* hub, struct hub_user* u, struct adc_message* cmd)
+{
+	struct adc_message* variants[USER_INFO_VARIANTS];
+	struct adc_message* msg;
+	struct hub_user* user = 0;
+	int variant;
+
+	memset(variants, 0, sizeof(variants));
+	variants[info_variant_full] = cmd;
+
+	LIST_FOREACH(struct hub_user*, user, hub->users->list,
 	{
-		struct adc_message* cmd = adc_msg_copy(u->info);
-		const char* address = user_get_address(u);
-		struct hub_user* user = 0;
+		variant = user_get_info_variant(u, user);
+		if (!variants[variant])
+			variants[variant] = user_info_create_variant(u, cmd, variant);
 
-		adc_msg_remove_named_argument(cmd, ADC_INF_FLAG_IPV4_ADDR);
-		adc_msg_add_named_argument(cmd, ADC_INF_FLAG_IPV4_ADDR, address);
+		msg = variants[variant] ? variants[variant] : cmd;
+		if (!adc_msg_is_empty(msg))
+			route_to_user(hub, user, msg);
+	});
 
-		LIST_FOREACH(struct hub_user*, user, hub->users->list,
-		{
-			if (user_is_nat_override(user))
-				route_to_user(hub, user, cmd);
-			else
-				route_to_user(hub, user, u->info);
-		});
-		adc_msg_free(cmd);
-	}
+	for (variant = 1; variant < USER_INFO_VARIANTS; variant++)
+		adc_msg_free(variants[variant]);
 	return 0;
 }
@@ -45,12 +45,34 @@ extern int route_to_all(struct hub_info* hub, struct adc_message* command);
  */
 extern int route_to_subscribers(struct hub_info* hub, struct adc_message* command);
 
+/**
+ * @return the max number of bytes queued for all users together
+ * (see max_send_buffer_total).
+ */
+extern size_t route_get_send_budget(struct hub_info* hub);
+
+/**
+ * Disconnect the users that have been behind the longest, until the bytes
+ * queued for all users are within max_send_buffer_total again.
+ */
+extern void route_enforce_send_budget(struct hub_info* hub);
+
 /**
  * Broadcast initial info message to all users.
- * This will ensure the correct IP is seen by other users
- * in case nat override is in use.
+ * Each user gets the variant of the info meant for it (see user_get_info),
+ * which ensures the correct IP is seen by other users in case nat
+ * override is in use.
  */
 extern int route_info_message(struct hub_info* hub, struct hub_user* user);
 
+/**
+ * Broadcast an info update to all users, rendering the variant for each
+ * class of recipient once. Updates that are empty for a recipient, such
+ * as a new description in low bandwidth mode, are not sent.
+ *
+ * @param user the user that sent the update (NULL for a user on a linked hub)
+ */
+extern int route_info_update(struct hub_info* hub, struct hub_user* user, struct adc_message* cmd);
+
 
 #endif /* HAVE_UHUB_ROUTE_H */
@@ -0,0 +1,1018 @@
+/*
+ * uhub - A tiny ADC p2p connection hub
+ * Copyright (C) 2007-2014, Jan Vidar Krey
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "uhub.h"
+
+#ifndef WIN32
+
+#include <poll.h>
+#include <sys/wait.h>
+
+#define UPGRADE_MAGIC     "UHUBUPG2"   /* Change it whenever the layout of the state changes */
+#define UPGRADE_ENV       "UHUB_UPGRADE_FD"
+#define UPGRADE_TIMEOUT   30000        /* milliseconds to wait for the new process */
+#define UPGRADE_FD_BATCH  250          /* socket descriptors per message, SCM_MAX_FD is 253 on Linux */
+#define UPGRADE_MAX_STATE (1024 * 1024 * 1024)
+#define UPGRADE_ACK       'R'
+
+/*
+ * User flags and credentials are written as their position in these
+ * tables, not as their values, which differ between builds.
+ * Only ever append to them. Flags that describe the state of the old
+ * connection rather than the user are not handed over.
+ */
+static const enum user_flags upgrade_flags[] =
+{
+	feature_base, feature_auto, feature_bbs, feature_ucmd, feature_zlif, feature_tiger, feature_bloom,
+	feature_ping, feature_link, feature_adcs, feature_bas0, feature_hbri, feature_dht,
+	flag_flood, flag_muted, flag_ignore, flag_maxbuf, flag_pipeline, flag_nat,
+	flag_tls_peer, flag_low_bw,
+};
+
+static const enum auth_credentials upgrade_credentials[] =
+{
+	auth_cred_none, auth_cred_guest, auth_cred_user, auth_cred_bot, auth_cred_ubot, auth_cred_operator,
+	auth_cred_opbot, auth_cred_opubot, auth_cred_super, auth_cred_link, auth_cred_admin,
+};
+
+/*
+ * State received from the old process.
+ * Listening sockets are taken by hub_upgrade_take_listener() while the
+ * hub is started, everything else by hub_upgrade_restore().
+ */
+struct upgrade_state
+{
+	int sd;                 /* Connection to the old process */
+	int* fds;               /* Received socket descriptors, -1 once taken */
+	size_t num_fds;
+	uint32_t* listeners;    /* Indexes into fds */
+	size_t num_listeners;
+	char* data;
+	size_t size;
+	size_t users_offset;    /* Where the user records start in data */
+};
+
+struct upgrade_reader
+{
+	const char* data;
+	size_t size;
+	size_t offset;
+	int error;
+};
+
+static struct upgrade_state* g_upgrade = 0;
+
+static void upgrade_put_u32(struct cbuffer* buf, uint32_t val)
+{
+	char bytes[4];
+	bytes[0] = (char) (val >> 24);
+	bytes[1] = (char) (val >> 16);
+	bytes[2] = (char) (val >> 8);
+	bytes[3] = (char) val;
+	cbuf_append_bytes(buf, bytes, sizeof(bytes));
+}
+
+static void upgrade_put_u64(struct cbuffer* buf, uint64_t val)
+{
+	upgrade_put_u32(buf, (uint32_t) (val >> 32));
+	upgrade_put_u32(buf, (uint32_t) val);
+}
+
+static void upgrade_put_bytes(struct cbuffer* buf, const char* data, size_t len)
+{
+	upgrade_put_u32(buf, (uint32_t) len);
+	cbuf_append_bytes(buf, data, len);
+}
+
+static void upgrade_put_string(struct cbuffer* buf, const char* str)
+{
+	upgrade_put_bytes(buf, str, strlen(str));
+}
+
+static uint32_t upgrade_get_u32(struct upgrade_reader* r)
+{
+	const unsigned char* p = (const unsigned char*) r->data + r->offset;
+	if (r->error || r->size - r->offset < 4)
+	{
+		r->error = 1;
+		return 0;
+	}
+	r->offset += 4;
+	return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | (uint32_t) p[3];
+}
+
+static uint64_t upgrade_get_u64(struct upgrade_reader* r)
+{
+	uint64_t val = (uint64_t) upgrade_get_u32(r) << 32;
+	return val | upgrade_get_u32(r);
+}
+
+static const char* upgrade_get_bytes(struct upgrade_reader* r, size_t* len)
+{
+	const char* data;
+	*len = upgrade_get_u32(r);
+	if (r->error || r->size - r->offset < *len)
+	{
+		r->error = 1;
+		*len = 0;
+		return 0;
+	}
+	data = r->data + r->offset;
+	r->offset += *len;
+	return data;
+}
+
+static void upgrade_get_string(struct upgrade_reader* r, char* str, size_t size)
+{
+	size_t len;
+	const char* data = upgrade_get_bytes(r, &len);
+	if (!data || len >= size)
+	{
+		r->error = 1;
+		str[0] = 0;
+		return;
+	}
+	memcpy(str, data, len);
+	str[len] = 0;
+}
+
+static uint32_t upgrade_encode_flags(uint32_t flags)
+{
+	uint32_t bits = 0;
+	size_t n;
+	for (n = 0; n < sizeof(upgrade_flags) / sizeof(upgrade_flags[0]); n++)
+	{
+		if (flags & upgrade_flags[n])
+			bits |= (uint32_t) 1 << n;
+	}
+	return bits;
+}
+
+static uint32_t upgrade_decode_flags(uint32_t bits)
+{
+	uint32_t flags = 0;
+	size_t n;
+	for (n = 0; n < sizeof(upgrade_flags) / sizeof(upgrade_flags[0]); n++)
+	{
+		if (bits & ((uint32_t) 1 << n))
+			flags |= upgrade_flags[n];
+	}
+	return flags;
+}
+
+static uint32_t upgrade_encode_credentials(enum auth_credentials credentials)
+{
+	uint32_t n;
+	for (n = 0; n < sizeof(upgrade_credentials) / sizeof(upgrade_credentials[0]); n++)
+	{
+		if (upgrade_credentials[n] == credentials)
+			return n;
+	}
+	return 0;
+}
+
+static int upgrade_write_all(int sd, const void* buf, size_t len)
+{
+	const char* p = (const char*) buf;
+	ssize_t ret;
+	while (len)
+	{
+		ret = write(sd, p, len);
+		if (ret == -1 && errno == EINTR)
+			continue;
+		if (ret <= 0)
+			return -1;
+		p += ret;
+		len -= ret;
+	}
+	return 0;
+}
+
+static int upgrade_read_all(int sd, void* buf, size_t len)
+{
+	char* p = (char*) buf;
+	ssize_t ret;
+	while (len)
+	{
+		ret = read(sd, p, len);
+		if (ret == -1 && errno == EINTR)
+			continue;
+		if (ret <= 0)
+			return -1;
+		p += ret;
+		len -= ret;
+	}
+	return 0;
+}
+
+/*
+ * Socket descriptors are sent in batches, each attached to a single byte
+ * holding the number of descriptors, so a stream socket does not merge them.
+ */
+static int upgrade_send_fds(int sd, const int* fds, size_t num_fds)
+{
+	char control[CMSG_SPACE(sizeof(int) * UPGRADE_FD_BATCH)];
+	struct msghdr msg;
+	struct cmsghdr* cmsg;
+	struct iovec iov;
+	unsigned char count;
+	size_t n;
+
+	for (n = 0; n < num_fds; n += count)
+	{
+		count = (unsigned char) MIN(num_fds - n, UPGRADE_FD_BATCH);
+		memset(&msg, 0, sizeof(msg));
+		memset(control, 0, sizeof(control));
+		iov.iov_base = &count;
+		iov.iov_len = 1;
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control;
+		msg.msg_controllen = CMSG_SPACE(sizeof(int) * count);
+		cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(int) * count);
+		memcpy(CMSG_DATA(cmsg), fds + n, sizeof(int) * count);
+
+		if (sendmsg(sd, &msg, 0) != 1)
+			return -1;
+	}
+	return 0;
+}
+
+static int upgrade_recv_fds(int sd, int* fds, size_t num_fds)
+{
+	char control[CMSG_SPACE(sizeof(int) * UPGRADE_FD_BATCH)];
+	struct msghdr msg;
+	struct cmsghdr* cmsg;
+	struct iovec iov;
+	unsigned char count;
+	size_t n = 0;
+
+	while (n < num_fds)
+	{
+		memset(&msg, 0, sizeof(msg));
+		iov.iov_base = &count;
+		iov.iov_len = 1;
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+
+		if (recvmsg(sd, &msg, 0) != 1 || (msg.msg_flags & MSG_CTRUNC))
+			return -1;
+
+		cmsg = CMSG_FIRSTHDR(&msg);
+		if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS ||
+			cmsg->cmsg_len != CMSG_LEN(sizeof(int) * count) || n + count > num_fds)
+			return -1;
+
+		memcpy(fds + n, CMSG_DATA(cmsg), sizeof(int) * count);
+		n += count;
+	}
+	return 0;
+}
+
+static int upgrade_user_transferable(struct hub_user* user)
+{
+	return user_is_logged_in(user) && user->connection && !user_is_tls_connected(user) && user_get_info(user, NULL);
+}
+
+void hub_upgrade_write_user(struct cbuffer* buf, struct hub_user* user)
+{
+	struct ioq_send* q = user->send_queue;
+	struct adc_message* msg;
+	struct adc_message* info;
+	char* feature;
+	size_t offset = q->offset;
+
+	upgrade_put_u32(buf, user->id.sid);
+	upgrade_put_string(buf, user->id.nick);
+	upgrade_put_string(buf, user->id.cid);
+	upgrade_put_string(buf, user->id.user_agent);
+	upgrade_put_string(buf, ip_convert_to_string(&user->id.addr));
+	upgrade_put_u32(buf, upgrade_encode_credentials(user->credentials));
+	upgrade_put_u32(buf, upgrade_encode_flags(user->flags));
+	upgrade_put_u64(buf, user->limits.shared_size);
+	upgrade_put_u64(buf, user->limits.shared_files);
+	upgrade_put_u64(buf, user->limits.upload_slots);
+	upgrade_put_u64(buf, user->limits.hub_count_user);
+	upgrade_put_u64(buf, user->limits.hub_count_registered);
+	upgrade_put_u64(buf, user->limits.hub_count_operator);
+	upgrade_put_u64(buf, user->limits.hub_count_total);
+	/* Without its INF the new process cannot restore the user, and drops it */
+	info = user_get_info(user, NULL);
+	upgrade_put_bytes(buf, info ? info->cache : "", info ? info->length : 0);
+
+	upgrade_put_u32(buf, (uint32_t) (user->feature_cast ? list_size(user->feature_cast) : 0));
+	if (user->feature_cast)
+	{
+		LIST_FOREACH(char*, feature, user->feature_cast,
+		{
+			upgrade_put_bytes(buf, feature, 4);
+		});
+	}
+
+	/* Queued data, from where the last write stopped */
+	upgrade_put_u32(buf, (uint32_t) (q->size - q->offset));
+	LIST_FOREACH(struct adc_message*, msg, q->queue,
+	{
+		cbuf_append_bytes(buf, msg->cache + offset, msg->length - offset);
+		offset = 0;
+	});
+
+	upgrade_put_bytes(buf, user->recv_queue->buf ? user->recv_queue->buf : "", user->recv_queue->size);
+}
+
+static struct cbuffer* upgrade_write_state(struct hub_info* hub, int* fds, size_t* num_fds)
+{
+	struct cbuffer* buf = cbuf_create(4096 + hub->users->count * 512);
+	struct net_connection* con;
+	struct hub_user* user;
+	size_t num_listeners = 1 + (hub->server_alt_ports ? list_size(hub->server_alt_ports) : 0);
+	size_t num_users = 0;
+	char keys[256];
+	size_t keys_size = 0;
+	size_t n;
+
+	LIST_FOREACH(struct hub_user*, user, hub->users->list,
+	{
+		if (upgrade_user_transferable(user))
+			num_users++;
+	});
+
+#ifdef SSL_SUPPORT
+	if (hub->ctx)
+		keys_size = net_ssl_context_get_ticket_keys(hub->ctx, keys, sizeof(keys));
+#endif
+
+	cbuf_append_bytes(buf, UPGRADE_MAGIC, strlen(UPGRADE_MAGIC));
+	upgrade_put_u32(buf, (uint32_t) (num_listeners + num_users));
+	upgrade_put_u64(buf, (uint64_t) hub->tm_started);
+	upgrade_put_bytes(buf, keys, keys_size);
+	memset(keys, 0, sizeof(keys));
+
+	*num_fds = 0;
+	upgrade_put_u32(buf, (uint32_t) num_listeners);
+	fds[(*num_fds)++] = net_con_get_sd(hub->server);
+	upgrade_put_u32(buf, 0);
+	if (hub->server_alt_ports)
+	{
+		LIST_FOREACH(struct net_connection*, con, hub->server_alt_ports,
+		{
+			upgrade_put_u32(buf, (uint32_t) *num_fds);
+			fds[(*num_fds)++] = net_con_get_sd(con);
+		});
+	}
+
+	upgrade_put_u32(buf, (uint32_t) num_users);
+	LIST_FOREACH(struct hub_user*, user, hub->users->list,
+	{
+		if (upgrade_user_transferable(user))
+		{
+			n = (*num_fds)++;
+			fds[n] = net_con_get_sd(user->connection);
+			upgrade_put_u32(buf, (uint32_t) n);
+			hub_upgrade_write_user(buf, user);
+		}
+	});
+	return buf;
+}
+
+/*
+ * Find the executable like execvp() would, before forking.
+ */
+static char* upgrade_find_executable(const char* name)
+{
+	const char* path = getenv("PATH");
+	char buf[PATH_MAX];
+	size_t len;
+
+	if (strchr(name, '/'))
+		return hub_strdup(name);
+
+	if (!path)
+		path = "/bin:/usr/bin";
+
+	while (*path)
+	{
+		len = strcspn(path, ":");
+		if (len)
+			snprintf(buf, sizeof(buf), "%.*s/%s", (int) len, path, name);
+		else
+			snprintf(buf, sizeof(buf), "./%s", name);
+
+		if (access(buf, X_OK) == 0)
+			return hub_strdup(buf);
+
+		path += len;
+		if (*path == ':')
+			path++;
+	}
+	return 0;
+}
+
+/*
+ * The environment of this process, telling the new one where to read the state from.
+ * The first entry is allocated, the others belong to environ.
+ */
+static char** upgrade_make_env(int sd)
+{
+	size_t count = 0;
+	size_t n;
+	char** env;
+
+	while (environ[count])
+		count++;
+
+	env = hub_malloc_zero(sizeof(char*) * (count + 2));
+	if (!env)
+		return 0;
+
+	env[0] = hub_malloc(strlen(UPGRADE_ENV) + 16);
+	if (!env[0])
+	{
+		hub_free(env);
+		return 0;
+	}
+	sprintf(env[0], "%s=%d", UPGRADE_ENV, sd);
+
+	count = 1;
+	for (n = 0; environ[n]; n++)
+	{
+		if (strncmp(environ[n], UPGRADE_ENV "=", strlen(UPGRADE_ENV) + 1))
+			env[count++] = environ[n];
+	}
+	return env;
+}
+
+static void upgrade_free_env(char** env)
+{
+	hub_free(env[0]);
+	hub_free(env);
+}
+
+/*
+ * Runs in the child, between fork() and exec.
+ * Only async-signal-safe functions may be used here.
+ */
+NO_RETURN static void upgrade_exec(const char* path, char* const* argv, char* const* env, int sd, long max_fd)
+{
+	long fd;
+
+	/* The new process only gets the sockets sent to it */
+#ifdef CLOSE_RANGE_CLOEXEC
+	if (close_range(3, ~0U, CLOSE_RANGE_CLOEXEC) == -1)
+#endif
+	{
+		for (fd = 3; fd < max_fd; fd++)
+			fcntl((int) fd, F_SETFD, FD_CLOEXEC);
+	}
+	fcntl(sd, F_SETFD, 0);
+
+	execve(path, argv, env);
+	_exit(127);
+}
+
+int hub_upgrade_start(struct hub_info* hub, const char* path, char* const* argv)
+{
+	struct cbuffer* buf;
+	struct pollfd pfd;
+	struct hub_user* user;
+	int pair[2];
+	int* fds;
+	size_t num_fds = 0;
+	uint64_t size;
+	char size_buf[8];
+	char ack = 0;
+	char* exec_path;
+	char** env;
+	long max_fd = sysconf(_SC_OPEN_MAX);
+	pid_t pid;
+	int n;
+
+	if (vhub_count())
+	{
+		LOG_ERROR("Upgrading is not supported while virtual hubs are running.");
+		return -1;
+	}
+
+	exec_path = upgrade_find_executable(path);
+	if (!exec_path)
+	{
+		LOG_ERROR("Upgrade failed, unable to find %s", path);
+		return -1;
+	}
+
+	LOG_INFO("Upgrading: starting %s", exec_path);
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == -1)
+	{
+		LOG_ERROR("Upgrade failed, unable to create socket pair: %s", net_error_string(errno));
+		hub_free(exec_path);
+		return -1;
+	}
+
+	env = upgrade_make_env(pair[1]);
+	pid = env ? fork() : -1;
+	if (pid == -1)
+	{
+		LOG_ERROR("Upgrade failed, unable to fork: %s", net_error_string(errno));
+		if (env)
+			upgrade_free_env(env);
+		hub_free(exec_path);
+		close(pair[0]);
+		close(pair[1]);
+		return -1;
+	}
+
+	if (pid == 0)
+		upgrade_exec(exec_path, argv, env, pair[1], max_fd);
+
+	upgrade_free_env(env);
+	hub_free(exec_path);
+	close(pair[1]);
+
+	/* Users that cannot be handed over leave now */
+	LIST_FOREACH(struct hub_user*, user, hub->users->list,
+	{
+		if (user_is_logged_in(user) && !upgrade_user_transferable(user))
+			hub_disconnect_user(hub, user, quit_disconnected);
+	});
+
+	/* Deliver what is still pending, including their quit messages, so it ends up in the send queues */
+	for (n = 0; n < 10 && event_queue_process(hub->queue); n++)
+		;
+	uman_flush_quit_messages(hub, hub->users);
+
+	fds = hub_malloc(sizeof(int) * (1 + (hub->server_alt_ports ? list_size(hub->server_alt_ports) : 0) + hub->users->count));
+	if (!fds)
+	{
+		LOG_ERROR("Upgrade failed, out of memory.");
+		close(pair[0]);
+		kill(pid, SIGKILL);
+		waitpid(pid, 0, 0);
+		return -1;
+	}
+	buf = upgrade_write_state(hub, fds, &num_fds);
+
+	size = cbuf_size(buf);
+	for (n = 0; n < 8; n++)
+		size_buf[n] = (char) (size >> (56 - n * 8));
+
+	if (upgrade_write_all(pair[0], size_buf, sizeof(size_buf)) == -1 ||
+		upgrade_write_all(pair[0], cbuf_get(buf), cbuf_size(buf)) == -1 ||
+		upgrade_send_fds(pair[0], fds, num_fds) == -1)
+	{
+		LOG_ERROR("Upgrade failed, unable to send state to the new process: %s", net_error_string(errno));
+	}
+	else
+	{
+		pfd.fd = pair[0];
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		if (poll(&pfd, 1, UPGRADE_TIMEOUT) == 1 && read(pair[0], &ack, 1) == 1 && ack == UPGRADE_ACK)
+			LOG_INFO("Upgrade complete, %d users handed over to process %d", (int) (num_fds - (size_t) (1 + (hub->server_alt_ports ? list_size(hub->server_alt_ports) : 0))), (int) pid);
+		else
+			LOG_ERROR("Upgrade failed, the new process did not take over.");
+	}
+
+	cbuf_destroy(buf);
+	hub_free(fds);
+	close(pair[0]);
+
+	if (ack != UPGRADE_ACK)
+	{
+		kill(pid, SIGKILL);
+		waitpid(pid, 0, 0);
+		return -1;
+	}
+	return 0;
+}
+
+static void upgrade_state_free(struct upgrade_state* state)
+{
+	size_t n;
+	for (n = 0; state->fds && n < state->num_fds; n++)
+	{
+		if (state->fds[n] != -1)
+			close(state->fds[n]);
+	}
+	if (state->sd != -1)
+		close(state->sd);
+	hub_free(state->fds);
+	hub_free(state->listeners);
+	hub_free(state->data);
+	hub_free(state);
+}
+
+int hub_upgrade_is_pending()
+{
+	const char* env = getenv(UPGRADE_ENV);
+	return env && *env;
+}
+
+int hub_upgrade_receive()
+{
+	struct upgrade_state* state;
+	struct upgrade_reader r;
+	const char* env = getenv(UPGRADE_ENV);
+	unsigned char size_buf[8];
+	uint64_t size = 0;
+	size_t n;
+
+	if (!env || !*env)
+		return 0;
+
+	state = hub_malloc_zero(sizeof(struct upgrade_state));
+	if (!state)
+	{
+		LOG_ERROR("Upgrade: out of memory");
+		close(uhub_atoi(env));
+		unsetenv(UPGRADE_ENV);
+		return -1;
+	}
+	state->sd = uhub_atoi(env);
+	unsetenv(UPGRADE_ENV);
+
+	if (upgrade_read_all(state->sd, size_buf, sizeof(size_buf)) == -1)
+		goto error;
+
+	for (n = 0; n < 8; n++)
+		size = (size << 8) | size_buf[n];
+
+	if (size < strlen(UPGRADE_MAGIC) || size > UPGRADE_MAX_STATE)
+		goto error;
+
+	state->size = (size_t) size;
+	state->data = hub_malloc(state->size);
+	if (!state->data || upgrade_read_all(state->sd, state->data, state->size) == -1)
+		goto error;
+
+	if (memcmp(state->data, UPGRADE_MAGIC, strlen(UPGRADE_MAGIC)))
+	{
+		LOG_ERROR("Upgrade: incompatible state from the old process");
+		goto error;
+	}
+
+	memset(&r, 0, sizeof(r));
+	r.data = state->data;
+	r.size = state->size;
+	r.offset = strlen(UPGRADE_MAGIC);
+
+	state->num_fds = upgrade_get_u32(&r);
+	upgrade_get_u64(&r);           /* tm_started */
+	upgrade_get_bytes(&r, &n);     /* session ticket keys */
+	state->num_listeners = upgrade_get_u32(&r);
+	if (r.error || state->num_listeners > state->num_fds)
+		goto error;
+
+	state->fds = hub_malloc(sizeof(int) * (state->num_fds + 1));
+	state->listeners = hub_malloc(sizeof(uint32_t) * (state->num_listeners + 1));
+	if (!state->fds || !state->listeners)
+		goto error;
+
+	for (n = 0; n < state->num_fds; n++)
+		state->fds[n] = -1;
+
+	for (n = 0; n < state->num_listeners; n++)
+	{
+		state->listeners[n] = upgrade_get_u32(&r);
+		if (state->listeners[n] >= state->num_fds)
+			goto error;
+	}
+	if (r.error)
+		goto error;
+	state->users_offset = r.offset;
+
+	if (upgrade_recv_fds(state->sd, state->fds, state->num_fds) == -1)
+	{
+		LOG_ERROR("Upgrade: unable to receive sockets from the old process");
+		goto error;
+	}
+
+	LOG_INFO("Upgrade: received %d sockets from the old process", (int) state->num_fds);
+	g_upgrade = state;
+	return 1;
+
+error:
+	LOG_ERROR("Upgrade: unable to receive state from the old process");
+	upgrade_state_free(state);
+	return -1;
+}
+
+static int upgrade_same_address(const struct sockaddr* a, const struct sockaddr* b)
+{
+	if (a->sa_family != b->sa_family)
+		return 0;
+
+	if (a->sa_family == AF_INET)
+	{
+		const struct sockaddr_in* a4 = (const struct sockaddr_in*) a;
+		const struct sockaddr_in* b4 = (const struct sockaddr_in*) b;
+		return a4->sin_port == b4->sin_port && a4->sin_addr.s_addr == b4->sin_addr.s_addr;
+	}
+
+	if (a->sa_family == AF_INET6)
+	{
+		const struct sockaddr_in6* a6 = (const struct sockaddr_in6*) a;
+		const struct sockaddr_in6* b6 = (const struct sockaddr_in6*) b;
+		return a6->sin6_port == b6->sin6_port && !memcmp(&a6->sin6_addr, &b6->sin6_addr, sizeof(a6->sin6_addr));
+	}
+	return 0;
+}
+
+int hub_upgrade_take_listener(const struct sockaddr* addr, socklen_t addr_len)
+{
+	struct sockaddr_storage bound;
+	socklen_t bound_len;
+	size_t n;
+	int sd;
+
+	if (!g_upgrade)
+		return -1;
+
+	for (n = 0; n < g_upgrade->num_listeners; n++)
+	{
+		sd = g_upgrade->fds[g_upgrade->listeners[n]];
+		bound_len = sizeof(bound);
+		if (sd == -1 || getsockname(sd, (struct sockaddr*) &bound, &bound_len) == -1)
+			continue;
+
+		if (upgrade_same_address(addr, (struct sockaddr*) &bound))
+		{
+			g_upgrade->fds[g_upgrade->listeners[n]] = -1;
+			return sd;
+		}
+	}
+	return -1;
+}
+
+/*
+ * Read a user written by hub_upgrade_write_user(), with 'sd' as its connection.
+ * The socket is closed if the user cannot be restored.
+ */
+static struct hub_user* upgrade_read_record(struct hub_info* hub, struct upgrade_reader* r, int sd, sid_t* sid)
+{
+	struct hub_user* user;
+	struct net_connection* con;
+	struct adc_message* info = 0;
+	struct ip_addr_encap addr;
+	struct hub_user_info id;
+	uint32_t credentials;
+	uint32_t flags;
+	struct hub_user_limits limits;
+	const char* data;
+	char address[INET6_ADDRSTRLEN + 1];
+	size_t len;
+	uint32_t count;
+
+	memset(&id, 0, sizeof(id));
+	id.sid = upgrade_get_u32(r);
+	*sid = r->error ? 0 : id.sid;
+	upgrade_get_string(r, id.nick, sizeof(id.nick));
+	upgrade_get_string(r, id.cid, sizeof(id.cid));
+	upgrade_get_string(r, id.user_agent, sizeof(id.user_agent));
+	upgrade_get_string(r, address, sizeof(address));
+	credentials = upgrade_get_u32(r);
+	flags = upgrade_decode_flags(upgrade_get_u32(r));
+	if (credentials >= sizeof(upgrade_credentials) / sizeof(upgrade_credentials[0]))
+		r->error = 1;
+	limits.shared_size = upgrade_get_u64(r);
+	limits.shared_files = (size_t) upgrade_get_u64(r);
+	limits.upload_slots = (size_t) upgrade_get_u64(r);
+	limits.hub_count_user = (size_t) upgrade_get_u64(r);
+	limits.hub_count_registered = (size_t) upgrade_get_u64(r);
+	limits.hub_count_operator = (size_t) upgrade_get_u64(r);
+	limits.hub_count_total = (size_t) upgrade_get_u64(r);
+	data = upgrade_get_bytes(r, &len);
+
+	if (!r->error && sd != -1 && ip_convert_to_binary(address, &addr) != -1)
+		info = adc_msg_parse(data, len);
+
+	if (!info)
+	{
+		if (sd != -1)
+			net_close(sd);
+		return 0;
+	}
+
+	con = net_con_create();
+	if (net_con_initialize(con, sd, net_event, 0, NET_EVENT_READ) == -1)
+	{
+		net_con_destroy(con);
+		net_close(sd);
+		adc_msg_free(info);
+		return 0;
+	}
+	user = user_create(hub, con, &addr);
+	if (!user)
+	{
+		net_con_close(con);
+		adc_msg_free(info);
+		return 0;
+	}
+
+	memcpy(&user->id, &id, sizeof(id));
+	memcpy(&user->id.addr, &addr, sizeof(addr));
+	memcpy(&user->limits, &limits, sizeof(limits));
+	user->credentials = upgrade_credentials[credentials];
+	user->flags = flags;
+	user_set_info(user, info);
+	adc_msg_free(info);
+
+	for (count = upgrade_get_u32(r); count && !r->error; count--)
+	{
+		data = upgrade_get_bytes(r, &len);
+		if (data && len == 4)
+			user_set_feature_cast_support(user, (char*) data);
+	}
+
+	data = upgrade_get_bytes(r, &len);
+	if (data && len)
+	{
+		info = adc_msg_construct(0, len);
+		if (info)
+		{
+			memcpy(info->cache, data, len);
+			info->length = len;
+			info->cache[len] = 0;
+			ioq_send_add(user->send_queue, info);
+			adc_msg_free(info);
+		}
+	}
+
+	data = upgrade_get_bytes(r, &len);
+	if (data && len)
+		ioq_recv_set(user->recv_queue, (void*) data, len);
+
+	if (r->error)
+	{
+		user_destroy(user);
+		return 0;
+	}
+	return user;
+}
+
+/* A user record as written by upgrade_write_state(), with the socket from the old process */
+static struct hub_user* upgrade_read_user(struct hub_info* hub, struct upgrade_reader* r, sid_t* sid)
+{
+	uint32_t fd_index = upgrade_get_u32(r);
+	int sd = -1;
+
+	if (!r->error && fd_index < g_upgrade->num_fds)
+	{
+		sd = g_upgrade->fds[fd_index];
+		g_upgrade->fds[fd_index] = -1;
+	}
+	return upgrade_read_record(hub, r, sd, sid);
+}
+
+struct hub_user* hub_upgrade_read_user(struct hub_info* hub, const char* data, size_t size, int sd, sid_t* sid)
+{
+	struct upgrade_reader r;
+
+	memset(&r, 0, sizeof(r));
+	r.data = data;
+	r.size = size;
+	return upgrade_read_record(hub, &r, sd, sid);
+}
+
+/*
+ * The others still have a user that could not be restored in their user list.
+ * The quit messages are sent once all users are restored, so that they reach all of them.
+ */
+static void upgrade_add_quit(struct hub_info* hub, struct adc_message** quits, sid_t sid)
+{
+	struct adc_message* command;
+
+	/* The session ID belongs to someone else */
+	if (!sid || sid_lookup(hub->users->sids, sid))
+		return;
+
+	command = adc_msg_construct(ADC_CMD_IQUI, 6);
+	if (!command)
+		return;
+	adc_msg_add_argument(command, sid_to_string(sid));
+
+	if (!*quits)
+	{
+		*quits = command;
+		return;
+	}
+
+	if (adc_msg_append_message(*quits, command) == -1)
+		route_to_all(hub, command);
+	adc_msg_free(command);
+}
+
+int hub_upgrade_restore(struct hub_info* hub)
+{
+	struct upgrade_reader r;
+	struct hub_user* user;
+	struct adc_message* quits = 0;
+	uint32_t num_users;
+	uint32_t n;
+	sid_t sid;
+	size_t len;
+	const char* keys;
+	char ack = UPGRADE_ACK;
+	int restored = 0;
+	int claimed;
+
+	if (!g_upgrade)
+		return 0;
+
+	memset(&r, 0, sizeof(r));
+	r.data = g_upgrade->data;
+	r.size = g_upgrade->size;
+	r.offset = strlen(UPGRADE_MAGIC) + 4;
+
+	hub->tm_started = (time_t) upgrade_get_u64(&r);
+	keys = upgrade_get_bytes(&r, &len);
+#ifdef SSL_SUPPORT
+	if (hub->ctx && keys && len && !net_ssl_context_set_ticket_keys(hub->ctx, keys, len))
+		LOG_WARN("Upgrade: unable to use the session ticket keys of the old process");
+#endif
+
+	r.offset = g_upgrade->users_offset;
+	num_users = upgrade_get_u32(&r);
+
+	for (n = 0; n < num_users && !r.error; n++)
+	{
+		user = upgrade_read_user(hub, &r, &sid);
+		if (!user)
+		{
+			LOG_ERROR("Upgrade: unable to restore user %d", (int) n);
+			upgrade_add_quit(hub, &quits, sid);
+			continue;
+		}
+
+		sid = user->id.sid;
+		claimed = sid_claim(hub->users->sids, sid, user) != 0;
+		if (!claimed || uman_get_user_by_nick(hub->users, user->id.nick) || uman_get_user_by_cid(hub->users, user->id.cid))
+		{
+			LOG_WARN("Upgrade: unable to restore user %s (session ID %s)", user->id.nick, sid_to_string(sid));
+			if (claimed)
+				sid_free(hub->users->sids, sid);
+			user_destroy(user);
+			upgrade_add_quit(hub, &quits, sid);
+			continue;
+		}
+
+		user_set_state(user, state_normal);
+		uman_add(hub->users, user);
+		restored++;
+
+		if (!ioq_send_is_empty(user->send_queue))
+			user_net_io_want_write(user);
+
+		if (user->recv_queue->size)
+			handle_net_read_defer(user);
+	}
+
+	if (r.error)
+		LOG_ERROR("Upgrade: the state from the old process is truncated");
+
+	if (quits)
+	{
+		route_to_all(hub, quits);
+		link_broadcast(hub, quits);
+		adc_msg_free(quits);
+	}
+
+	if (upgrade_write_all(g_upgrade->sd, &ack, 1) == -1)
+	{
+		LOG_ERROR("Upgrade: unable to notify the old process");
+		restored = -1;
+	}
+
+	else
+	{
+		LOG_INFO("Upgrade: restored %d of %d users", restored, (int) num_users);
+	}
+
+	/* Closes the sockets not taken over, like listening sockets no longer configured */
+	upgrade_state_free(g_upgrade);
+	g_upgrade = 0;
+	return restored;
+}
+
+#endif /* !WIN32 */
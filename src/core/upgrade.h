@@ -0,0 +1,89 @@
+/*
+ * uhub - A tiny ADC p2p connection hub
+ * Copyright (C) 2007-2014, Jan Vidar Krey
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef HAVE_UHUB_UPGRADE_H
+#define HAVE_UHUB_UPGRADE_H
+
+/*
+ * Zero-downtime upgrades (SIGUSR2).
+ *
+ * The running hub starts a new process from the same executable path,
+ * and hands over its listening sockets and the sockets of all logged in
+ * users, together with the state needed to continue serving them
+ * (session ID, INF, credentials, flags, queued data). Once the new
+ * process confirms it has taken over, the old one exits.
+ *
+ * TLS connections cannot be carried over, these users are disconnected
+ * and the quit messages are handed over with the other users' send queues.
+ * Upgrading is refused while virtual hubs are running (see vhub.h).
+ * The session ticket keys are handed over, so they can reconnect with
+ * an abbreviated handshake.
+ */
+
+#ifndef WIN32
+
+/**
+ * Start a new hub process and hand over all connections to it.
+ * @return 0 if the new process took over (this one should exit), or -1
+ * if it failed, in which case this process should continue serving.
+ */
+extern int hub_upgrade_start(struct hub_info* hub, const char* path, char* const* argv);
+
+/**
+ * @return 1 if this process was started by hub_upgrade_start(), 0 otherwise.
+ */
+extern int hub_upgrade_is_pending();
+
+/**
+ * Check whether this process was started by hub_upgrade_start(), and if so
+ * receive the state from the old process.
+ * @return 1 if started as an upgrade, 0 if not, -1 on error.
+ */
+extern int hub_upgrade_receive();
+
+/**
+ * Take over a listening socket of the old process, bound to the given address.
+ * @return the socket descriptor, or -1 if there is none.
+ */
+extern int hub_upgrade_take_listener(const struct sockaddr* addr, socklen_t addr_len);
+
+/**
+ * Restore the users of the old process, and tell it to exit.
+ * Must be called after hub_set_variables().
+ * @return the number of users restored, or -1 if the old process could
+ * not be told to exit.
+ */
+extern int hub_upgrade_restore(struct hub_info* hub);
+
+/**
+ * Write the state of a logged in user, as handed over to the new process.
+ */
+extern void hub_upgrade_write_user(struct cbuffer* buf, struct hub_user* user);
+
+/**
+ * Restore a user from the state written by hub_upgrade_write_user(),
+ * with 'sd' as its connection. The user is not added to the hub.
+ * @return the user, or NULL if it cannot be restored, in which case the
+ * socket is closed, and 'sid' is the session ID of the user, or 0 if unknown.
+ */
+extern struct hub_user* hub_upgrade_read_user(struct hub_info* hub, const char* data, size_t size, int sd, sid_t* sid);
+
+#endif /* !WIN32 */
+
+#endif /* HAVE_UHUB_UPGRADE_H */
@@ -35,19 +35,27 @@ static const char* user_log_str(struct hub_user* user)
 }
 #endif
 
+static struct mem_pool g_user_pool = MEM_POOL_INIT("user", struct hub_user);
+
+void user_pool_prewarm(size_t count)
+{
+	mem_pool_prewarm(&g_user_pool, count);
+}
+
 struct hub_user* user_create(struct hub_info* hub, struct net_connection* con, struct ip_addr_encap* addr)
 {
 	struct hub_user* user = NULL;
 
 	LOG_TRACE("user_create(), hub=%p, con[sd=%d]", hub, net_con_get_sd(con));
 
-	user = (struct hub_user*) hub_malloc_zero(sizeof(struct hub_user));
+	user = (struct hub_user*) mem_pool_alloc(&g_user_pool);
 
 	if (user == NULL)
 		return NULL; /* OOM */
 
 	user->send_queue = ioq_send_create();
 	user->recv_queue = ioq_recv_create();
+	ioq_send_set_total(user->send_queue, &hub->stats.send_queued);
 
 	user->connection = con;
 	net_con_reinitialize(user->connection, net_event, user, NET_EVENT_READ);
@@ -70,6 +78,8 @@ void user_destroy(struct hub_user* user)
 {
 	LOG_TRACE("user_destroy(), user=%p", user);
 
+	vhub_release(user);
+
 	ioq_recv_destroy(user->recv_queue);
 	ioq_send_destroy(user->send_queue);
 
@@ -79,9 +89,11 @@ void user_destroy(struct hub_user* user)
 		net_con_close(user->connection);
 	}
 
-	adc_msg_free(user->info);
+	acl_request_cancel(user);
+	hub_free(user->auth_info);
+	user_set_info(user, NULL);
 	user_clear_feature_cast_support(user);
-	hub_free(user);
+	mem_pool_free(&g_user_pool, user);
 }
 
 void user_set_state(struct hub_user* user, enum user_state state)
@@ -94,53 +106,140 @@ void user_set_state(struct hub_user* user, enum user_state state)
 	user->state = state;
 }
 
+static void user_clear_info_variants(struct hub_user* user)
+{
+	size_t n;
+	for (n = 0; n < USER_INFO_VARIANTS; n++)
+	{
+		adc_msg_free(user->info_variants[n]);
+		user->info_variants[n] = 0;
+	}
+}
+
+static void user_set_tls_peer(struct hub_user* user)
+{
+	const char* support = user->info_table ? inf_table_get(user->info_table, ADC_INF_FLAG_SUPPORT) : NULL;
+	if (support && (strstr(support, "ADCS") || strstr(support, "ADC0")))
+		user_flag_set(user, flag_tls_peer);
+	else
+		user_flag_unset(user, flag_tls_peer);
+}
+
 void user_set_info(struct hub_user* user, struct adc_message* cmd)
 {
+	user_clear_info_variants(user);
 	adc_msg_free(user->info);
+	inf_table_destroy(user->info_table);
 	if (cmd)
 	{
 		user->info = adc_msg_incref(cmd);
+		user->info_table = inf_table_create(cmd);
+		user_set_tls_peer(user);
 	}
 	else
 	{
 		user->info = 0;
+		user->info_table = 0;
 	}
 }
 
-void user_update_info(struct hub_user* u, struct adc_message* cmd)
+int user_get_info_variant(struct hub_user* source, struct hub_user* target)
 {
-	char prefix[2];
-	char* argument;
-	size_t n = 0;
-	struct adc_message* cmd_new = adc_msg_copy(u->info);
-	if (!cmd_new)
+	int variant = info_variant_full;
+
+	if (!target || source == target)
+		return variant;
+
+	if (user_flag_get(target, flag_low_bw))
+		variant |= info_variant_low_bandwidth;
+
+	if (source && user_is_nat_override(source) && user_is_nat_override(target))
+		variant |= info_variant_nat;
+
+	if (!user_flag_get(target, flag_tls_peer))
+		variant |= info_variant_plain;
+
+	return variant;
+}
+
+struct adc_message* user_info_create_variant(struct hub_user* source, struct adc_message* info, int variant)
+{
+	struct adc_message* cmd = adc_msg_copy(info);
+	if (!cmd)
+		return 0;
+
+	if (variant & info_variant_low_bandwidth)
 	{
-		/* FIXME: OOM! */
-		return;
+		adc_msg_remove_named_argument(cmd, ADC_INF_FLAG_USER_AGENT_VERSION);
+		adc_msg_remove_named_argument(cmd, ADC_INF_FLAG_USER_AGENT_PRODUCT);
+		adc_msg_remove_named_argument(cmd, ADC_INF_FLAG_SHARED_FILES);
+		adc_msg_remove_named_argument(cmd, ADC_INF_FLAG_COUNT_HUB_NORMAL);
+		adc_msg_remove_named_argument(cmd, ADC_INF_FLAG_COUNT_HUB_REGISTER);
+		adc_msg_remove_named_argument(cmd, ADC_INF_FLAG_COUNT_HUB_OPERATOR);
+		adc_msg_remove_named_argument(cmd, ADC_INF_FLAG_UPLOAD_SPEED);
+		adc_msg_remove_named_argument(cmd, ADC_INF_FLAG_DOWNLOAD_SPEED);
+		adc_msg_remove_named_argument(cmd, ADC_INF_FLAG_AUTO_SLOTS);
+		adc_msg_remove_named_argument(cmd, ADC_INF_FLAG_AUTO_SLOTS_MAX);
+		adc_msg_remove_named_argument(cmd, ADC_INF_FLAG_AWAY);
+		adc_msg_remove_named_argument(cmd, ADC_INF_FLAG_DESCRIPTION);
+		adc_msg_remove_named_argument(cmd, ADC_INF_FLAG_EMAIL);
+	}
+
+	if (variant & info_variant_plain)
+	{
+		adc_msg_remove_named_argument(cmd, ADC_INF_FLAG_KEYPRINT);
 	}
 
-	/*
-	 * FIXME: Optimization potential:
-	 *
-	 * remove parts of cmd that do not really change anything in cmd_new.
-	 * this can save bandwidth if clients send multiple updates for information
-	 * that does not really change anything.
-	 */
-	argument = adc_msg_get_argument(cmd, n++);
-	while (argument)
+	/* Updates only carry the address if it changed */
+	if ((variant & info_variant_nat) && source && adc_msg_has_named_argument(cmd, ADC_INF_FLAG_IPV4_ADDR))
 	{
-		if (strlen(argument) >= 2)
+		adc_msg_remove_named_argument(cmd, ADC_INF_FLAG_IPV4_ADDR);
+		adc_msg_add_named_argument(cmd, ADC_INF_FLAG_IPV4_ADDR, user_get_address(source));
+	}
+
+	return cmd;
+}
+
+struct adc_message* user_get_info(struct hub_user* source, struct hub_user* target)
+{
+	struct adc_message* cmd;
+	int variant = user_get_info_variant(source, target);
+
+	if (!source->info && source->info_table)
+		source->info = inf_table_render(source->info_table);
+
+	if (variant == info_variant_full || !source->info)
+		return source->info;
+
+	if (!source->info_variants[variant])
+	{
+		cmd = user_info_create_variant(source, source->info, variant);
+		if (!cmd)
+			return source->info;
+
+		/* Nothing was stripped, share the original */
+		if (cmd->length == source->info->length && !(variant & info_variant_nat))
 		{
-			prefix[0] = argument[0];
-			prefix[1] = argument[1];
-			adc_msg_replace_named_argument(cmd_new, prefix, argument+2);
+			adc_msg_free(cmd);
+			cmd = adc_msg_incref(source->info);
 		}
-
-		hub_free(argument);
-		argument = adc_msg_get_argument(cmd, n++);
+		source->info_variants[variant] = cmd;
 	}
-	user_set_info(u, cmd_new);
-	adc_msg_free(cmd_new);
+	return source->info_variants[variant];
+}
+
+void user_update_info(struct hub_user* u, struct adc_message* cmd)
+{
+	if (!u->info_table || !inf_table_update(u->info_table, cmd))
+		return;
+
+	/* Rendered again when needed */
+	user_clear_info_variants(u);
+	adc_msg_free(u->info);
+	u->info = 0;
+
+	if (adc_msg_has_named_argument(cmd, ADC_INF_FLAG_SUPPORT))
+		user_set_tls_peer(u);
 }
 
 
@@ -328,14 +427,43 @@ int user_is_tls_connected(struct hub_user* user)
 	}
 }
 
+const char* user_get_tls_offload(struct hub_user* user)
+{
+#ifdef SSL_SUPPORT
+	if (net_con_is_ssl(user->connection))
+	{
+		switch (net_ssl_get_ktls(user->connection))
+		{
+			case NET_SSL_KTLS_SEND | NET_SSL_KTLS_RECV: return "send and receive";
+			case NET_SSL_KTLS_SEND: return "send";
+			case NET_SSL_KTLS_RECV: return "receive";
+		}
+	}
+#endif
+	return "off";
+}
+
+static int user_net_io_read_events(struct hub_user* user)
+{
+	return (user->read_paused || user->read_queued) ? 0 : NET_EVENT_READ;
+}
+
 void user_net_io_want_write(struct hub_user* user)
 {
-	net_con_update(user->connection, NET_EVENT_READ | NET_EVENT_WRITE);
+	net_con_update(user->connection, user_net_io_read_events(user) | NET_EVENT_WRITE);
 }
 
 void user_net_io_want_read(struct hub_user* user)
 {
-	net_con_update(user->connection, NET_EVENT_READ);
+	net_con_update(user->connection, user_net_io_read_events(user));
+}
+
+void user_net_io_update(struct hub_user* user)
+{
+	if (ioq_send_get_bytes(user->send_queue))
+		user_net_io_want_write(user);
+	else
+		user_net_io_want_read(user);
 }
 
 const char* user_get_quit_reason_string(enum user_quit_reason reason)
@@ -22,6 +22,7 @@
 
 struct hub_info;
 struct hub_iobuf;
+struct hub_link;
 struct flood_control;
 
 enum user_state
@@ -32,6 +33,7 @@ enum user_state
 	state_normal       = 3,      /**<< "User is logged in." */
 	state_cleanup      = 4,      /**<< "User is disconnected, but other users need to be notified." */
 	state_disconnected = 5,      /**<< "User is disconnected" */
+	state_link         = 6,      /**<< "Connection is a link to another hub (see link.h)" */
 };
 
 enum user_flags
@@ -44,11 +46,13 @@ enum user_flags
 	feature_tiger   = 0x00000020, /** TIGR: Client supports the tiger hash algorithm */
 	feature_bloom   = 0x00000040, /** BLO0: Bloom filter (not supported) */
 	feature_ping    = 0x00000080, /** PING: Hub pinger information extension */
-	feature_link    = 0x00000100, /** LINK: Hub link (not supported) */
+	feature_link    = 0x00000100, /** LINK: Hub link (see link.h) */
 	feature_adcs    = 0x00000200, /** ADCS: ADC over TLS/SSL */
 	feature_bas0    = 0x00000400, /** BAS0: Obsolete pre-ADC/1.0 protocol version */
 	feature_hbri    = 0x00000800, /** HBRI: IPv4/6 verification for hybrid hubs (not supported) */
 	feature_dht     = 0x00001000, /** DHT0: Distributed hash table peer-to-peer sharing (not supported) */
+	flag_tls_peer   = 0x00100000, /** Client can connect to other clients over TLS (ADCS or ADC0 in SU) */
+	flag_low_bw     = 0x00200000, /** Receives user info without the fields stripped in low bandwidth mode */
 	flag_flood      = 0x00400000, /** User has been notified about flooding. */
 	flag_muted      = 0x00800000, /** User is muted (cannot chat) */
 	flag_ignore     = 0x01000000, /** Ignore further reads */
@@ -106,6 +110,20 @@ struct hub_user_limits
 	size_t              hub_count_total;       /** The number of hubs connected to in total */
 };
 
+/**
+ * The user info is sent in a different variant to some classes of
+ * recipients. The bits are combined, see user_get_info_variant().
+ */
+enum user_info_variant
+{
+	info_variant_full          = 0x00, /** The user info as sent by the user */
+	info_variant_low_bandwidth = 0x01, /** Without descriptive fields (see flag_low_bw) */
+	info_variant_nat           = 0x02, /** With the address seen by the hub (both users are behind the same NAT) */
+	info_variant_plain         = 0x04, /** Without the TLS keyprint (the recipient does not use TLS) */
+};
+
+#define USER_INFO_VARIANTS 8
+
 struct hub_user
 {
 	struct hub_user_info    id;                 /** Contains nick name and CID */
@@ -113,13 +131,24 @@ struct hub_user
 	enum user_state         state;              /** see enum user_state */
 	uint32_t                flags;              /** see enum user_flags */
 	struct linked_list*     feature_cast;       /** Features supported by feature cast */
-	struct adc_message*     info;               /** ADC 'INF' message (broadcasted to everyone joining the hub) */
+	struct inf_table*       info_table;         /** ADC 'INF' fields (see inftable.h) */
+	struct adc_message*     info;               /** ADC 'INF' message rendered from info_table, NULL until needed (see user_get_info) */
+	struct adc_message*     info_variants[USER_INFO_VARIANTS]; /** Variants of info, rendered when first needed (see user_get_info) */
 	struct hub_info*        hub;                /** The hub instance this user belong to */
 	struct ioq_recv*        recv_queue;
 	struct ioq_send*        send_queue;
 	struct net_connection*  connection;         /** Connection data */
 	struct hub_user_limits  limits;             /** Data used for limitation */
 	enum user_quit_reason   quit_reason;        /** Quit reason (see user_quit_reason) */
+	struct auth_request*    auth_request;       /** Pending access info lookup (see acl_request_access_info) */
+	int                     login_queued;       /** Waiting for CID verification (see hub_handle_info_login_verify) */
+	int                     read_queued;        /** Ran out of read budget (see handle_net_read_continue) */
+	int                     read_paused;        /** Not read from until the send queue is drained */
+	time_t                  send_backlog;       /** When the send queue started to fill up, 0 if drained (see route_enforce_send_budget) */
+	int                     handed_over;        /** Handed over to a virtual hub, not logged in yet (see vhub_select) */
+	struct auth_info*       auth_info;          /** Access info kept until the password is verified */
+	struct hub_link*        link;               /** Set if the connection is a link to another hub (see link.h) */
+	uint32_t                capture_id;         /** Connection id in the traffic capture, 0 if not captured yet */
 
 	struct flood_control   flood_chat;
 	struct flood_control   flood_connect;
@@ -148,6 +177,11 @@ extern struct hub_user* user_create(struct hub_info* hub, struct net_connection*
  */
 extern void user_destroy(struct hub_user* user);
 
+/**
+ * Preallocate user objects (see mem_pool_prewarm).
+ */
+extern void user_pool_prewarm(size_t count);
+
 /**
  * This associates a INF message to the user.
  * If the user already has a INF message associated, then this is
@@ -161,9 +195,34 @@ extern void user_set_info(struct hub_user* user, struct adc_message* info);
  * Update a user's INF message.
  * Will parse replace all ellements in the user's inf message with
  * the parameters from the cmd (merge operation).
+ * Parameters that do not change anything are removed from cmd.
  */
 extern void user_update_info(struct hub_user* user, struct adc_message* cmd);
 
+/**
+ * Returns the variant of the user info of source (NULL for a user on a
+ * linked hub) that is sent to target (see enum user_info_variant).
+ */
+extern int user_get_info_variant(struct hub_user* source, struct hub_user* target);
+
+/**
+ * Returns the user info of source as it should be sent to target, or
+ * the full user info if target is NULL.
+ * Each variant is rendered once, when first needed, and kept until the
+ * user info changes.
+ *
+ * @return the user info, which must not be freed by the caller.
+ */
+extern struct adc_message* user_get_info(struct hub_user* source, struct hub_user* target);
+
+/**
+ * Render a variant of a full INF message or of an INF update.
+ *
+ * @param source the user the info belongs to (NULL for a user on a linked hub)
+ * @return a new message, or NULL if out of memory.
+ */
+extern struct adc_message* user_info_create_variant(struct hub_user* source, struct adc_message* info, int variant);
+
 /**
  * Specify a user's state.
  * NOTE: DON'T, unless you know what you are doing.
@@ -208,6 +267,12 @@ extern int user_is_registered(struct hub_user* user);
  */
 extern int user_is_tls_connected(struct hub_user* user);
 
+/**
+ * Returns which directions of a TLS connection are handled by the
+ * kernel (kTLS), or "off".
+ */
+extern const char* user_get_tls_offload(struct hub_user* user);
+
 /**
  * User supports the protocol extension as given in fourcc.
  * This is usually set while the user is connecting, but can
@@ -280,6 +345,12 @@ extern void user_net_io_want_write(struct hub_user* user);
  */
 extern void user_net_io_want_read(struct hub_user* user);
 
+/**
+ * Update the network events of interest to match the send queue and
+ * whether reading is paused or deferred.
+ */
+extern void user_net_io_update(struct hub_user* user);
+
 /**
  * Return the user's feature casts as a string. The returned string is
  * dynamically allocated and needs to be freed with hub_free().
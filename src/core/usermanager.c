@@ -78,6 +78,9 @@ int uman_shutdown(struct hub_user_manager* users)
 
 	sid_pool_destroy(users->sids);
 
+	if (users->quits)
+		adc_msg_free(users->quits);
+
 	hub_free(users);
 	return 0;
 }
@@ -168,19 +171,13 @@ int uman_send_user_list(struct hub_info* hub, struct hub_user_manager* users, st
 	{
 		if (user_is_logged_in(user))
 		{
-			ret = route_to_user(hub, target, user->info);
+			ret = route_to_user(hub, target, user_get_info(user, target));
 			if (!ret)
 				break;
 		}
 	});
 
-#if 0
-	FIXME: FIXME FIXME handle send queue excess
-	if (!target->send_queue_size)
-	{
-	    user_flag_unset(target, flag_user_list);
-	}
-#endif
+	/* flag_user_list is unset once logged in, and the send queue is drained (see on_login_success) */
 	return ret;
 }
 
@@ -193,10 +190,42 @@ void uman_send_quit_message(struct hub_info* hub, struct hub_user_manager* users
 	{
 		adc_msg_add_argument(command, ADC_QUI_FLAG_DISCONNECT);
 	}
-	route_to_all(hub, command);
+
+	/*
+	 * When many users leave at once, send all the quit messages together
+	 * once the current events are processed, rather than one at a time.
+	 * The batch is exempt from the send queue limit of each user.
+	 */
+	if (!users->quits)
+	{
+		struct event_data post;
+		users->quits = command;
+		memset(&post, 0, sizeof(post));
+		post.id = UHUB_EVENT_QUIT_FLUSH;
+		event_queue_post(hub->queue, &post);
+		return;
+	}
+
+	if (adc_msg_append_message(users->quits, command) == -1)
+	{
+		route_to_all(hub, command);
+		link_broadcast(hub, command);
+	}
 	adc_msg_free(command);
 }
 
+void uman_flush_quit_messages(struct hub_info* hub, struct hub_user_manager* users)
+{
+	struct adc_message* quits = users->quits;
+	if (!quits)
+		return;
+
+	users->quits = NULL;
+	route_to_all(hub, quits);
+	link_broadcast(hub, quits);
+	adc_msg_free(quits);
+}
+
 sid_t uman_get_free_sid(struct hub_user_manager* users, struct hub_user* user)
 {
 	sid_t sid = sid_alloc(users->sids, user);
@@ -30,6 +30,7 @@ struct hub_user_manager
 	struct linked_list* list;       /**<< "Contains all logged in users" */
 	struct rb_tree* nickmap;        /**<< "Maps nicknames to users (red black tree)" */
 	struct rb_tree* cidmap;         /**<< "Maps CIDs to users (red black tree)" */
+	struct adc_message* quits;      /**<< "Quit messages not yet sent, see uman_flush_quit_messages()" */
 };
 
 /**
@@ -124,5 +125,11 @@ extern int uman_send_user_list(struct hub_info* hub, struct hub_user_manager* us
  */
 extern void uman_send_quit_message(struct hub_info* hub, struct hub_user_manager* users, struct hub_user* user);
 
+/**
+ * Send the quit messages queued by uman_send_quit_message() to all
+ * connected users, as one message.
+ */
+extern void uman_flush_quit_messages(struct hub_info* hub, struct hub_user_manager* users);
+
 
 #endif /* HAVE_UHUB_USER_MANAGER_H */
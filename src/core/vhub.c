@@ -0,0 +1,424 @@
+/*
+ * uhub - A tiny ADC p2p connection hub
+ * Copyright (C) 2007-2014, Jan Vidar Krey
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "uhub.h"
+
+struct virtual_hub
+{
+	char* filename;                 /* Configuration file */
+	struct hub_config config;
+	struct acl_handle acl;
+	struct hub_info* hub;
+};
+
+static struct linked_list* g_vhubs = NULL;
+
+static int vhub_parse_line(char* line, int line_count, void* ptr_data)
+{
+	struct linked_list* files = (struct linked_list*) ptr_data;
+	struct cfg_tokens* tokens = cfg_tokenize(line);
+	char* filename;
+
+	if (cfg_token_count(tokens) == 0)
+	{
+		cfg_tokens_free(tokens);
+		return 0;
+	}
+
+	if (cfg_token_count(tokens) > 1)
+	{
+		LOG_ERROR("Virtual hubs: expected one configuration file on line %d", line_count);
+		cfg_tokens_free(tokens);
+		return -1;
+	}
+
+	filename = hub_strdup(cfg_token_get_first(tokens));
+	cfg_tokens_free(tokens);
+	if (!filename)
+		return -1;
+
+	list_append(files, filename);
+	return 0;
+}
+
+static struct linked_list* vhub_read_list(struct hub_config* config)
+{
+	struct linked_list* files = list_create();
+	if (!files)
+		return NULL;
+
+	if (*config->file_virtual_hubs && file_read_lines(config->file_virtual_hubs, files, &vhub_parse_line) < 0)
+	{
+		LOG_ERROR("Unable to read virtual hubs from %s", config->file_virtual_hubs);
+		list_clear(files, hub_free);
+		list_destroy(files);
+		return NULL;
+	}
+	return files;
+}
+
+static int vhub_is_listed(struct linked_list* files, const char* filename)
+{
+	char* file;
+	LIST_FOREACH(char*, file, files,
+	{
+		if (!strcmp(file, filename))
+			return 1;
+	});
+	return 0;
+}
+
+static struct virtual_hub* vhub_find_file(const char* filename)
+{
+	struct virtual_hub* vhub;
+	LIST_FOREACH(struct virtual_hub*, vhub, g_vhubs,
+	{
+		if (!strcmp(vhub->filename, filename))
+			return vhub;
+	});
+	return NULL;
+}
+
+static int vhub_is_listening_on(struct hub_info* hub, struct hub_config* config)
+{
+	return hub->server && hub->config->server_port == config->server_port && !strcmp(hub->config->server_bind_addr, config->server_bind_addr);
+}
+
+/* Find the running hub listening on the port of config, if any */
+static struct hub_info* vhub_find_listener(struct hub_info* main_hub, struct hub_config* config)
+{
+	struct virtual_hub* vhub;
+
+	if (vhub_is_listening_on(main_hub, config))
+		return main_hub;
+
+	LIST_FOREACH(struct virtual_hub*, vhub, g_vhubs,
+	{
+		if (vhub_is_listening_on(vhub->hub, config))
+			return vhub->hub;
+	});
+	return NULL;
+}
+
+static void vhub_free(struct virtual_hub* vhub)
+{
+	hub_free(vhub->filename);
+	hub_free(vhub);
+}
+
+static struct virtual_hub* vhub_start_one(struct hub_info* main_hub, const char* filename)
+{
+	struct virtual_hub* vhub = hub_malloc_zero(sizeof(struct virtual_hub));
+	struct hub_info* listener;
+
+	if (!vhub)
+		return NULL;
+
+	vhub->filename = hub_strdup(filename);
+	if (!vhub->filename)
+	{
+		vhub_free(vhub);
+		return NULL;
+	}
+
+	if (read_config(filename, &vhub->config, 0) == -1)
+	{
+		LOG_ERROR("Unable to read virtual hub configuration %s", filename);
+		free_config(&vhub->config);
+		vhub_free(vhub);
+		return NULL;
+	}
+
+	if (*vhub->config.file_virtual_hubs)
+		LOG_WARN("Virtual hub %s: file_virtual_hubs is ignored.", filename);
+
+	if (acl_initialize(&vhub->config, &vhub->acl) == -1)
+	{
+		LOG_ERROR("Virtual hub %s: unable to load the access control list.", filename);
+		acl_shutdown(&vhub->acl);
+		free_config(&vhub->config);
+		vhub_free(vhub);
+		return NULL;
+	}
+
+	listener = vhub_find_listener(main_hub, &vhub->config);
+	if (listener && !*vhub->config.tls_sni_name)
+	{
+		LOG_ERROR("Virtual hub %s: port %d is already in use, set tls_sni_name to share it.", filename, vhub->config.server_port);
+		vhub->hub = NULL;
+	}
+	else if (listener)
+	{
+		vhub->hub = hub_start_virtual_service(&vhub->config, listener);
+	}
+	else
+	{
+		vhub->hub = hub_start_service(&vhub->config);
+	}
+
+	if (!vhub->hub)
+	{
+		acl_shutdown(&vhub->acl);
+		free_config(&vhub->config);
+		vhub_free(vhub);
+		return NULL;
+	}
+
+	vhub->hub->handed_over = list_create();
+	if (!vhub->hub->handed_over)
+	{
+		hub_shutdown_service(vhub->hub);
+		acl_shutdown(&vhub->acl);
+		free_config(&vhub->config);
+		vhub_free(vhub);
+		return NULL;
+	}
+
+	hub_set_variables(vhub->hub, &vhub->acl);
+	list_append(g_vhubs, vhub);
+	return vhub;
+}
+
+static struct virtual_hub* vhub_find_sharing(struct hub_info* hub)
+{
+	struct virtual_hub* vhub;
+	LIST_FOREACH(struct virtual_hub*, vhub, g_vhubs,
+	{
+		if (vhub->hub->listener == hub)
+			return vhub;
+	});
+	return NULL;
+}
+
+static void vhub_stop_one(struct virtual_hub* vhub)
+{
+	struct hub_info* hub = vhub->hub;
+	struct virtual_hub* sharing;
+	struct hub_user* user;
+
+	/* Hubs sharing the port of this one cannot do without it */
+	while ((sharing = vhub_find_sharing(hub)))
+		vhub_stop_one(sharing);
+
+	LOG_INFO("Stopping virtual hub %s", vhub->filename);
+
+	event_queue_process(hub->queue);
+	LIST_FOREACH(struct hub_user*, user, hub->handed_over,
+	{
+		hub_disconnect_user(hub, user, quit_hub_disabled);
+	});
+	hub_disconnect_all(hub);
+	event_queue_process(hub->queue);
+	hub->status = hub_status_stopped;
+	list_destroy(hub->handed_over);
+	hub->handed_over = NULL;
+
+	hub_free_variables(hub);
+	hub_shutdown_service(hub);
+	acl_shutdown(&vhub->acl);
+	free_config(&vhub->config);
+
+	list_remove(g_vhubs, vhub);
+	vhub_free(vhub);
+}
+
+size_t vhub_start(struct hub_info* hub)
+{
+	struct linked_list* files;
+	char* filename;
+
+	if (!g_vhubs)
+	{
+		g_vhubs = list_create();
+		if (!g_vhubs)
+			return 0;
+	}
+
+	files = vhub_read_list(hub->config);
+	if (!files)
+		return list_size(g_vhubs);
+
+	LIST_FOREACH(char*, filename, files,
+	{
+		if (!vhub_find_file(filename))
+			vhub_start_one(hub, filename);
+	});
+
+	list_clear(files, hub_free);
+	list_destroy(files);
+
+	if (list_size(g_vhubs))
+		LOG_INFO("Running %" PRIsz " virtual hubs.", list_size(g_vhubs));
+	return list_size(g_vhubs);
+}
+
+void vhub_reconfigure(struct hub_info* hub)
+{
+	struct linked_list* files;
+	struct virtual_hub* vhub;
+	struct hub_config config;
+	char* filename;
+	int found;
+
+	if (!g_vhubs)
+	{
+		vhub_start(hub);
+		return;
+	}
+
+	files = vhub_read_list(hub->config);
+	if (!files)
+		return;
+
+	/* Stop the hubs that are no longer listed */
+	do
+	{
+		found = 0;
+		LIST_FOREACH(struct virtual_hub*, vhub, g_vhubs,
+		{
+			found = !vhub_is_listed(files, vhub->filename);
+			if (found)
+				break;
+		});
+		if (found)
+			vhub_stop_one(vhub);
+	} while (found);
+
+	LIST_FOREACH(char*, filename, files,
+	{
+		vhub = vhub_find_file(filename);
+		if (!vhub)
+			continue;
+
+		LOG_INFO("Reloading virtual hub %s", filename);
+		if (read_config(filename, &config, 0) == -1)
+		{
+			LOG_ERROR("Unable to read virtual hub configuration %s, keeping the current configuration.", filename);
+			free_config(&config);
+		}
+		else
+		{
+			hub_reconfigure(vhub->hub, &config);
+		}
+	});
+
+	list_clear(files, hub_free);
+	list_destroy(files);
+
+	/* Start new hubs, and those that were stopped */
+	vhub_start(hub);
+}
+
+void vhub_shutdown()
+{
+	if (!g_vhubs)
+		return;
+
+	while (list_size(g_vhubs))
+		vhub_stop_one((struct virtual_hub*) list_get_last(g_vhubs));
+
+	list_destroy(g_vhubs);
+	g_vhubs = NULL;
+}
+
+int vhub_process(struct hub_info* hub)
+{
+	struct virtual_hub* vhub;
+	struct virtual_hub* stopped = NULL;
+	size_t n;
+	int pending = 0;
+
+	if (!g_vhubs)
+		return 0;
+
+	/* Not LIST_FOREACH, the events may look up other virtual hubs */
+	for (n = 0; n < list_size(g_vhubs); n++)
+	{
+		vhub = (struct virtual_hub*) list_get_index(g_vhubs, n);
+		pending += event_queue_process(vhub->hub->queue);
+
+		switch (vhub->hub->status)
+		{
+			case hub_status_restart:
+				if (hub->status == hub_status_running || hub->status == hub_status_disabled)
+					hub->status = hub_status_restart;
+				vhub->hub->status = (vhub->config.hub_enabled ? hub_status_running : hub_status_disabled);
+				break;
+
+			case hub_status_shutdown:
+			case hub_status_upgrade:
+				stopped = vhub;
+				break;
+
+			default:
+				break;
+		}
+	}
+
+	if (stopped)
+		vhub_stop_one(stopped);
+	return pending;
+}
+
+int vhub_select(struct hub_user* user)
+{
+#ifdef SSL_SUPPORT
+	struct ssl_context_handle* ctx;
+	struct virtual_hub* vhub;
+
+	if (!g_vhubs || !user->hub->ctx || !net_con_is_ssl(user->connection))
+		return 0;
+
+	ctx = net_ssl_get_context(user->connection);
+	if (ctx == user->hub->ctx)
+		return 0;
+
+	/* The client asked for a hub that stopped after the handshake */
+	if (!ctx)
+		return -1;
+
+	LIST_FOREACH(struct virtual_hub*, vhub, g_vhubs,
+	{
+		if (vhub->hub->ctx == ctx && vhub->hub->listener == user->hub)
+		{
+			LOG_TRACE("Handing user %s over to virtual hub %s", user_get_address(user), vhub->filename);
+			user->hub = vhub->hub;
+			user->handed_over = 1;
+			ioq_send_set_total(user->send_queue, &vhub->hub->stats.send_queued);
+			list_append(vhub->hub->handed_over, user);
+			return 1;
+		}
+	});
+#endif
+	return 0;
+}
+
+void vhub_release(struct hub_user* user)
+{
+	if (!user->handed_over)
+		return;
+
+	user->handed_over = 0;
+	list_remove(user->hub->handed_over, user);
+}
+
+size_t vhub_count()
+{
+	return g_vhubs ? list_size(g_vhubs) : 0;
+}
@@ -0,0 +1,86 @@
+/*
+ * uhub - A tiny ADC p2p connection hub
+ * Copyright (C) 2007-2014, Jan Vidar Krey
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef HAVE_UHUB_VHUB_H
+#define HAVE_UHUB_VHUB_H
+
+/*
+ * Virtual hubs (see file_virtual_hubs).
+ *
+ * The hub started from the command line is the main hub. It can start
+ * more hubs in the same process, each with its own configuration, users,
+ * access control list and plugins. All hubs share the network backend,
+ * timers, memory pools and DNS resolver.
+ *
+ * A virtual hub either listens on its own port, or shares the port of
+ * another hub: TLS clients asking for its tls_sni_name are handed over to
+ * it when they send their first message.
+ *
+ * Signals and !reload on any hub reload all hubs, stopping a virtual hub
+ * only stops that hub until the next reload.
+ */
+
+struct hub_info;
+struct hub_user;
+
+/**
+ * Start the virtual hubs listed in the file_virtual_hubs file of the main hub.
+ * Hubs that fail to start are logged and skipped.
+ * @return the number of virtual hubs running.
+ */
+extern size_t vhub_start(struct hub_info* hub);
+
+/**
+ * Apply a reloaded main hub configuration: stop virtual hubs no longer
+ * listed, reconfigure the others (see hub_reconfigure) and start new ones.
+ */
+extern void vhub_reconfigure(struct hub_info* hub);
+
+/**
+ * Disconnect the users of all virtual hubs, and stop them.
+ */
+extern void vhub_shutdown();
+
+/**
+ * Process the events of all virtual hubs, and act on their status:
+ * a restart reloads all hubs, a shutdown stops the virtual hub.
+ * @return the number of events processed.
+ */
+extern int vhub_process(struct hub_info* hub);
+
+/**
+ * Hand a TLS user over to the virtual hub selected by the server name the
+ * client asked for, if it is not the hub that accepted the connection.
+ * Must be called before the first message of the user is handled.
+ * @return 1 if the user was handed over, 0 otherwise, or -1 if the hub
+ * the client asked for has stopped.
+ */
+extern int vhub_select(struct hub_user* user);
+
+/**
+ * Called when a handed over user logs in, or is destroyed.
+ */
+extern void vhub_release(struct hub_user* user);
+
+/**
+ * @return the number of virtual hubs running.
+ */
+extern size_t vhub_count();
+
+#endif /* HAVE_UHUB_VHUB_H */
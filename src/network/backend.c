@@ -24,6 +24,9 @@
 struct net_backend;
 struct net_connection;
 
+/* Connections closed during one event loop iteration, grown as needed. */
+#define NET_CLEANUP_QUEUE_INITIAL 64
+
 struct net_cleanup_handler
 {
 	size_t num;
@@ -39,10 +42,17 @@ struct net_backend
 	struct net_cleanup_handler* cleaner; /* handler to cleanup connections at a safe point */
 	struct net_backend_handler handler; /* backend event handler */
 	struct net_backend* data; /* backend specific data */
+	int virtual_time; /* if set, now only moves through net_backend_advance_time() */
+	struct mem_pool con_pool; /* connection objects, of handler.con_size bytes */
+	uint64_t polled; /* when the last poll returned, in microseconds */
+	uint64_t busy_max; /* longest time between two polls, in microseconds */
 };
 
 static struct net_backend* g_backend;
+static time_t g_loopback_time; /* if set, use the loopback backend with a virtual clock starting here */
+
 
+extern struct net_backend* net_backend_init_loopback(struct net_backend_handler*, struct net_backend_common*);
 
 #ifdef USE_EPOLL
 extern struct net_backend* net_backend_init_epoll(struct net_backend_handler*, struct net_backend_common*);
@@ -69,27 +79,56 @@ static net_backend_init_t net_backend_init_funcs[] = {
 	0
 };
 
+/* Monotonic clock in microseconds, for measuring the time between polls */
+static uint64_t net_backend_get_time_usec()
+{
+#ifdef WIN32
+	return (uint64_t) GetTickCount64() * 1000;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t) ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+#endif
+}
+
+void net_backend_use_loopback(time_t now)
+{
+	g_loopback_time = now;
+}
+
 int net_backend_init()
 {
 	size_t n;
 	g_backend = (struct net_backend*) hub_malloc_zero(sizeof(struct net_backend));
 	g_backend->common.num = 0;
 	g_backend->common.max = net_get_max_sockets();
-	g_backend->now = time(0);
-	timeout_queue_initialize(&g_backend->timeout_queue, g_backend->now, 120); /* FIXME: max 120 secs! */
-	g_backend->cleaner = net_cleanup_initialize(g_backend->common.max);
 
-	for (n = 0; net_backend_init_funcs[n]; n++)
+	if (g_loopback_time)
+	{
+		g_backend->data = net_backend_init_loopback(&g_backend->handler, &g_backend->common);
+		g_backend->virtual_time = 1;
+	}
+
+	for (n = 0; !g_backend->data && net_backend_init_funcs[n]; n++)
 	{
 		g_backend->data = net_backend_init_funcs[n](&g_backend->handler, &g_backend->common);
-		if (g_backend->data)
-		{
-			LOG_DEBUG("Initialized %s network backend.", g_backend->handler.backend_name());
-			return 1;
-		}
 	}
-	LOG_FATAL("Unable to find a suitable network backend");
-	return 0;
+
+	if (!g_backend->data)
+	{
+		LOG_FATAL("Unable to find a suitable network backend");
+		hub_free(g_backend);
+		g_backend = 0;
+		return 0;
+	}
+
+	g_backend->now = g_backend->virtual_time ? g_loopback_time : time(0);
+	timeout_queue_initialize(&g_backend->timeout_queue, g_backend->now, 120); /* FIXME: max 120 secs! */
+	g_backend->cleaner = net_cleanup_initialize(g_backend->common.max);
+	mem_pool_init(&g_backend->con_pool, "connection", g_backend->handler.con_size);
+
+	LOG_DEBUG("Initialized %s network backend.", g_backend->handler.backend_name());
+	return 1;
 }
 
 void net_backend_shutdown()
@@ -97,6 +136,7 @@ void net_backend_shutdown()
 	g_backend->handler.backend_shutdown(g_backend->data);
 	timeout_queue_shutdown(&g_backend->timeout_queue);
 	net_cleanup_shutdown(g_backend->cleaner);
+	mem_pool_destroy(&g_backend->con_pool);
 	hub_free(g_backend);
 	g_backend = 0;
 }
@@ -109,7 +149,20 @@ void net_backend_update(struct net_connection* con, int events)
 
 struct net_connection* net_con_create()
 {
-	return g_backend->handler.con_create(g_backend->data);
+	struct net_connection* con = (struct net_connection*) mem_pool_alloc(&g_backend->con_pool);
+	if (con)
+		con->sd = -1;
+	return con;
+}
+
+void net_backend_con_free(struct net_connection* con)
+{
+	mem_pool_free(&g_backend->con_pool, con);
+}
+
+void net_backend_con_prewarm(size_t count)
+{
+	mem_pool_prewarm(&g_backend->con_pool, count);
 }
 
 struct timeout_queue* net_backend_get_timeout_queue()
@@ -124,14 +177,30 @@ struct timeout_queue* net_backend_get_timeout_queue()
  * Process the network backend.
  */
 int net_backend_process()
+{
+	return net_backend_process_timeout(-1);
+}
+
+int net_backend_process_timeout(int ms)
 {
 	int res = 0;
 	size_t secs = timeout_queue_get_next_timeout(&g_backend->timeout_queue, g_backend->now);
+	int wait = (int) (secs * 1000);
+	uint64_t now = net_backend_get_time_usec();
+
+	if (ms >= 0 && ms < wait)
+		wait = ms;
+
+	/* Events that arrived while we were busy had to wait this long */
+	if (g_backend->polled && now - g_backend->polled > g_backend->busy_max)
+		g_backend->busy_max = now - g_backend->polled;
 
 	if (g_backend->common.num)
-		res = g_backend->handler.backend_poll(g_backend->data, secs * 1000);
+		res = g_backend->handler.backend_poll(g_backend->data, wait);
+	g_backend->polled = net_backend_get_time_usec();
 
-	g_backend->now = time(0);
+	if (!g_backend->virtual_time)
+		g_backend->now = time(0);
 	timeout_queue_process(&g_backend->timeout_queue, g_backend->now);
 
 	if (res == -1)
@@ -149,21 +218,45 @@ int net_backend_process()
 	return 1;
 }
 
+size_t net_backend_get_latency(int reset)
+{
+	size_t ms = (size_t) (g_backend->busy_max / 1000);
+	if (reset)
+		g_backend->busy_max = 0;
+	return ms;
+}
+
 time_t net_get_time()
 {
 	return g_backend->now;
 }
 
+void net_backend_advance_time(time_t seconds)
+{
+	if (!g_backend->virtual_time)
+		return;
+
+	g_backend->now += seconds;
+	timeout_queue_process(&g_backend->timeout_queue, g_backend->now);
+	net_cleanup_process(g_backend->cleaner);
+}
+
 
-void net_con_initialize(struct net_connection* con, int sd, net_connection_cb callback, const void* ptr, int events)
+int net_con_initialize(struct net_connection* con, int sd, net_connection_cb callback, const void* ptr, int events)
 {
 	g_backend->handler.con_init(g_backend->data, con, sd, callback, ptr);
 
-	net_set_nonblocking(net_con_get_sd(con), 1);
-	net_set_nosigpipe(net_con_get_sd(con), 1);
+	if (!net_loopback_is_virtual(sd))
+	{
+		net_set_nonblocking(sd, 1);
+		net_set_nosigpipe(sd, 1);
+	}
+
+	if (g_backend->handler.con_add(g_backend->data, con, events) == -1)
+		return -1;
 
-	g_backend->handler.con_add(g_backend->data, con, events);
 	g_backend->common.num++;
+	return 0;
 }
 
 void net_con_close(struct net_connection* con)
@@ -191,8 +284,8 @@ struct net_cleanup_handler* net_cleanup_initialize(size_t max)
 {
 	struct net_cleanup_handler* handler = (struct net_cleanup_handler*) hub_malloc(sizeof(struct net_cleanup_handler));
 	handler->num = 0;
-	handler->max = max;
-	handler->queue = hub_calloc(max, sizeof(struct net_connection*));
+	handler->max = (max && max < NET_CLEANUP_QUEUE_INITIAL) ? max : NET_CLEANUP_QUEUE_INITIAL;
+	handler->queue = hub_calloc(handler->max, sizeof(struct net_connection*));
 	return handler;
 }
 
@@ -205,6 +298,21 @@ void net_cleanup_shutdown(struct net_cleanup_handler* handler)
 
 void net_cleanup_delayed_free(struct net_cleanup_handler* handler, struct net_connection* con)
 {
+	if (handler->num == handler->max)
+	{
+		size_t max = handler->max * 2;
+		struct net_connection** queue = hub_realloc(handler->queue, max * sizeof(struct net_connection*));
+		if (!queue)
+		{
+			/* Better to leak the connection than to free it while in use. */
+			LOG_FATAL("Unable to queue connection for cleanup: out of memory");
+			con->flags |= NET_CLEANUP;
+			return;
+		}
+		handler->queue = queue;
+		handler->max = max;
+	}
+
 	handler->queue[handler->num++] = con;
 	con->flags |= NET_CLEANUP;
 }
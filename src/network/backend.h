@@ -33,9 +33,8 @@ typedef int (*net_backend_poll)(struct net_backend*, int ms);
 typedef void (*net_backend_proc)(struct net_backend*, int res);
 typedef void (*net_backend_destroy)(struct net_backend*);
 
-typedef struct net_connection* (*net_con_backend_create)(struct net_backend*);
 typedef void (*net_con_backend_init)(struct net_backend*, struct net_connection*, int sd, net_connection_cb callback, const void* ptr);
-typedef void (*net_con_backend_add)(struct net_backend*, struct net_connection*, int mask);
+typedef int (*net_con_backend_add)(struct net_backend*, struct net_connection*, int mask);
 typedef void (*net_con_backend_mod)(struct net_backend*, struct net_connection*, int mask);
 typedef void (*net_con_backend_del)(struct net_backend*,struct net_connection*);
 typedef const char* (*net_con_backend_name)();
@@ -46,7 +45,7 @@ struct net_backend_handler
 	net_backend_poll backend_poll;
 	net_backend_proc backend_process;
 	net_backend_destroy backend_shutdown;
-	net_con_backend_create con_create;
+	size_t con_size; /* size of the backend's connection struct */
 	net_con_backend_init con_init;
 	net_con_backend_add con_add;
 	net_con_backend_mod con_mod;
@@ -65,6 +64,13 @@ struct net_backend_common
  */
 extern int net_backend_init();
 
+/**
+ * Use the in-memory loopback backend (see network/loopback.h) the next time
+ * the backend is initialized, with a virtual clock starting at the given time.
+ * Pass 0 to go back to the regular socket backends.
+ */
+extern void net_backend_use_loopback(time_t now);
+
 /**
  * Shutdown the network connection backend.
  */
@@ -75,6 +81,12 @@ extern void net_backend_shutdown();
  */
 extern int net_backend_process();
 
+/**
+ * Process the network backend, waiting at most ms milliseconds for events
+ * (or until the next timeout event if ms is negative).
+ */
+extern int net_backend_process_timeout(int ms);
+
 /**
  * Update the event mask.
  *
@@ -83,11 +95,25 @@ extern int net_backend_process();
  */
 extern void net_backend_update(struct net_connection* con, int events);
 
+/**
+ * Get the longest time in milliseconds the event loop spent between two
+ * polls, i.e. how long an event could wait before being handled.
+ *
+ * @param reset if set, start measuring again.
+ */
+extern size_t net_backend_get_latency(int reset);
+
 /**
  * Get the current time.
  */
 time_t net_get_time();
 
+/**
+ * Move the virtual clock of the loopback backend forward,
+ * and run any timeouts that expire. Does nothing for other backends.
+ */
+extern void net_backend_advance_time(time_t seconds);
+
 extern struct timeout_queue* net_backend_get_timeout_queue();
 
 struct net_cleanup_handler* net_cleanup_initialize(size_t max);
@@ -98,5 +124,15 @@ void net_cleanup_delayed_free(struct net_cleanup_handler* handler, struct net_co
 
 void net_cleanup_process(struct net_cleanup_handler* handler);
 
+/**
+ * Return a connection allocated by net_con_create() to the pool.
+ */
+extern void net_backend_con_free(struct net_connection* con);
+
+/**
+ * Preallocate connection objects (see mem_pool_prewarm).
+ */
+extern void net_backend_con_prewarm(size_t count);
+
 
 #endif /* HAVE_UHUB_NETWORK_BACKEND_H */
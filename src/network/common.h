@@ -28,6 +28,7 @@
 
 struct ssl_handle; /* abstract type */
 
+#define NET_LOOPBACK              0x4000
 #define NET_CLEANUP               0x8000
 
 #define NET_CON_STRUCT_BASIC \
@@ -36,6 +36,8 @@ static int is_blocked_or_interrupted()
 ssize_t net_con_send(struct net_connection* con, const void* buf, size_t len)
 {
 	int ret;
+	if (con->flags & NET_LOOPBACK)
+		return net_loopback_send(con, buf, len);
 #ifdef SSL_SUPPORT
 	if (!con->ssl)
 	{
@@ -60,6 +62,8 @@ ssize_t net_con_send(struct net_connection* con, const void* buf, size_t len)
 ssize_t net_con_recv(struct net_connection* con, void* buf, size_t len)
 {
 	int ret;
+	if (con->flags & NET_LOOPBACK)
+		return net_loopback_recv(con, buf, len, 0);
 #ifdef SSL_SUPPORT
 	if (!con->ssl)
 	{
@@ -87,7 +91,11 @@ ssize_t net_con_recv(struct net_connection* con, void* buf, size_t len)
 
 ssize_t net_con_peek(struct net_connection* con, void* buf, size_t len)
 {
-	int ret = net_recv(con->sd, buf, len, MSG_PEEK);
+	int ret;
+	if (con->flags & NET_LOOPBACK)
+		return net_loopback_recv(con, buf, len, 1);
+
+	ret = net_recv(con->sd, buf, len, MSG_PEEK);
 	if (ret == -1)
 	{
 		if (is_blocked_or_interrupted())
@@ -99,6 +107,13 @@ ssize_t net_con_peek(struct net_connection* con, void* buf, size_t len)
 	return ret;
 }
 
+int net_con_accept(struct net_connection* con, struct ip_addr_encap* ipaddr)
+{
+	if (con->flags & NET_LOOPBACK)
+		return net_loopback_accept(con, ipaddr);
+	return net_accept(con->sd, ipaddr);
+}
+
 #ifdef SSL_SUPPORT
 
 int net_con_is_ssl(struct net_connection* con)
@@ -140,7 +155,7 @@ void net_con_destroy(struct net_connection* con)
 	if (con && con->ssl)
 		net_ssl_destroy(con);
 #endif
-	hub_free(con);
+	net_backend_con_free(con);
 }
 
 void net_con_callback(struct net_connection* con, int events)
@@ -283,7 +298,14 @@ static int net_connect_job_process(struct net_connect_job* job)
 		}
 
 		job->con = 	net_con_create();
-		net_con_initialize(job->con, sd, net_connect_job_internal_cb, job, NET_EVENT_WRITE);
+		if (net_con_initialize(job->con, sd, net_connect_job_internal_cb, job, NET_EVENT_WRITE) == -1)
+		{
+			net_con_destroy(job->con);
+			job->con = 0;
+			net_close(sd);
+			net_connect_callback(job->handle, net_connect_status_socket_error, NULL);
+			return -1;
+		}
 		net_con_set_timeout(job->con, TIMEOUT_CONNECTED); // FIXME: Use a proper timeout value!
 	}
 
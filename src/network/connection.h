@@ -36,6 +36,7 @@ struct net_connection
 };
 
 struct net_connect_handle;
+struct ip_addr_encap;
 
 enum net_connect_status
 {
@@ -71,7 +72,11 @@ extern struct net_connect_handle* net_con_connect(const char* address, uint16_t
 extern void net_connect_destroy(struct net_connect_handle* handle);
 
 extern void net_con_destroy(struct net_connection*);
-extern void net_con_initialize(struct net_connection* con, int sd, net_connection_cb callback, const void* ptr, int events);
+/**
+ * Start monitoring a socket.
+ * @return 0 on success, or -1 if the backend could not monitor it (the socket is not closed).
+ */
+extern int net_con_initialize(struct net_connection* con, int sd, net_connection_cb callback, const void* ptr, int events);
 extern void net_con_reinitialize(struct net_connection* con, net_connection_cb callback, const void* ptr, int events);
 extern void net_con_update(struct net_connection* con, int events);
 extern void net_con_callback(struct net_connection* con, int events);
@@ -108,6 +113,14 @@ extern ssize_t net_con_recv(struct net_connection* con, void* buf, size_t len);
  */
 extern ssize_t net_con_peek(struct net_connection* con, void* buf, size_t len);
 
+/**
+ * Accept an incoming connection on a listening connection.
+ *
+ * @return the socket descriptor of the new connection, or -1 on error
+ *         (net_error() is EWOULDBLOCK if there is nothing more to accept).
+ */
+extern int net_con_accept(struct net_connection* con, struct ip_addr_encap* ipaddr);
+
 /**
  * Set timeout for connection.
  *
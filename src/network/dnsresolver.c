@@ -44,6 +44,19 @@ struct net_dns_result
 	struct net_dns_job* job;
 };
 
+// NOTE: Any job manipulating the members of this
+// struct must lock the mutex!
+struct net_dns_subsystem
+{
+	struct linked_list* jobs;    // currently running jobs
+	struct linked_list* results; // queue of results that are awaiting being delivered to callback.
+	uhub_mutex_t mutex;
+
+	struct uhub_notify_handle* notify_handle; // used to signal back to the event loop that there is something to process.
+};
+
+static struct net_dns_subsystem* g_dns = NULL;
+
 static void free_job(struct net_dns_job* job)
 {
 	if (job)
@@ -56,9 +69,20 @@ static void free_job(struct net_dns_job* job)
 static void shutdown_free_jobs(void* ptr)
 {
 	struct net_dns_job* job = (struct net_dns_job*) ptr;
+	struct net_dns_result* result;
+
 	uhub_thread_cancel(job->thread_handle);
 	uhub_thread_join(job->thread_handle);
-	free_job(job);
+
+	/* The job may have posted its result before it was cancelled */
+	uhub_mutex_lock(&g_dns->mutex);
+	result = find_and_remove_result(job);
+	uhub_mutex_unlock(&g_dns->mutex);
+
+	if (result)
+		net_dns_result_free(result);
+	else
+		free_job(job);
 }
 
 static void shutdown_free_results(void* ptr)
@@ -73,20 +97,6 @@ static void notify_callback(struct uhub_notify_handle* handle, void* ptr)
 	net_dns_process();
 }
 
-
-// NOTE: Any job manipulating the members of this
-// struct must lock the mutex!
-struct net_dns_subsystem
-{
-	struct linked_list* jobs;    // currently running jobs
-	struct linked_list* results; // queue of results that are awaiting being delivered to callback.
-	uhub_mutex_t mutex;
-
-	struct uhub_notify_handle* notify_handle; // used to signal back to the event loop that there is something to process.
-};
-
-static struct net_dns_subsystem* g_dns = NULL;
-
 void net_dns_initialize()
 {
 	LOG_TRACE("net_dns_initialize()");
@@ -99,9 +109,19 @@ void net_dns_initialize()
 
 void net_dns_destroy()
 {
+	struct linked_list* jobs;
+
+	/* The job threads need the mutex to finish, so it cannot be held while joining them. */
+	uhub_mutex_lock(&g_dns->mutex);
+	jobs = g_dns->jobs;
+	g_dns->jobs = list_create();
+	uhub_mutex_unlock(&g_dns->mutex);
+
+	LOG_TRACE("net_dns_destroy(): jobs=%d", (int) list_size(jobs));
+	list_clear(jobs, &shutdown_free_jobs);
+	list_destroy(jobs);
+
 	uhub_mutex_lock(&g_dns->mutex);
-	LOG_TRACE("net_dns_destroy(): jobs=%d", (int) list_size(g_dns->jobs));
-	list_clear(g_dns->jobs, &shutdown_free_jobs);
 
 	LOG_TRACE("net_dns_destroy(): results=%d", (int) list_size(g_dns->results));
 	list_clear(g_dns->results, &shutdown_free_results);
@@ -36,7 +36,7 @@ struct net_connection_epoll
 struct net_backend_epoll
 {
 	int epfd;
-	struct net_connection_epoll** conns;
+	struct ptr_table* conns; /* struct net_connection_epoll, by socket descriptor */
 	struct epoll_event events[EPOLL_EVBUFFER];
 	struct net_backend_common* common;
 };
@@ -63,7 +63,7 @@ void net_backend_process_epoll(struct net_backend* data, int res)
 	struct net_backend_epoll* backend = (struct net_backend_epoll*) data;
 	for (n = 0; n < res; n++)
 	{
-		struct net_connection_epoll* con = backend->conns[backend->events[n].data.fd];
+		struct net_connection_epoll* con = ptr_table_get(backend->conns, backend->events[n].data.fd);
 		if (con)
 		{
 			ev = 0;
@@ -74,13 +74,6 @@ void net_backend_process_epoll(struct net_backend* data, int res)
 	}
 }
 
-struct net_connection* net_con_create_epoll(struct net_backend* data)
-{
-	struct net_connection* con = (struct net_connection*) hub_malloc_zero(sizeof(struct net_connection_epoll));
-	con->sd = -1;
-	return con;
-}
-
 void net_con_initialize_epoll(struct net_backend* data, struct net_connection* con_, int sd, net_connection_cb callback, const void* ptr)
 {
 	struct net_connection_epoll* con = (struct net_connection_epoll*) con_;
@@ -92,12 +85,16 @@ void net_con_initialize_epoll(struct net_backend* data, struct net_connection* c
 	con->ev.data.fd = sd;
 }
 
-void net_con_backend_add_epoll(struct net_backend* data, struct net_connection* con_, int events)
+int net_con_backend_add_epoll(struct net_backend* data, struct net_connection* con_, int events)
 {
 	struct net_backend_epoll* backend = (struct net_backend_epoll*) data;
 	struct net_connection_epoll* con = (struct net_connection_epoll*) con_;
 
-	backend->conns[con->sd] = con;
+	if (ptr_table_set(backend->conns, con->sd, con) == -1)
+	{
+		LOG_ERROR("Unable to monitor socket %d.", con->sd);
+		return -1;
+	}
 
 	if (events & NET_EVENT_READ)  con->ev.events |= EPOLLIN;
 	if (events & NET_EVENT_WRITE) con->ev.events |= EPOLLOUT;
@@ -105,7 +102,10 @@ void net_con_backend_add_epoll(struct net_backend* data, struct net_connection*
 	if (epoll_ctl(backend->epfd, EPOLL_CTL_ADD, con->sd, &con->ev) == -1)
 	{
 		LOG_TRACE("epoll_ctl() add failed.");
+		ptr_table_set(backend->conns, con->sd, 0);
+		return -1;
 	}
+	return 0;
 }
 
 void net_con_backend_mod_epoll(struct net_backend* data, struct net_connection* con_, int events)
@@ -132,7 +132,7 @@ void net_con_backend_del_epoll(struct net_backend* data, struct net_connection*
 	struct net_backend_epoll* backend = (struct net_backend_epoll*) data;
 	struct net_connection_epoll* con = (struct net_connection_epoll*) con_;
 
-	backend->conns[con->sd] = 0;
+	ptr_table_set(backend->conns, con->sd, 0);
 
 	if (epoll_ctl(backend->epfd, EPOLL_CTL_DEL, con->sd, &con->ev) == -1)
 	{
@@ -144,7 +144,7 @@ void net_backend_shutdown_epoll(struct net_backend* data)
 {
 	struct net_backend_epoll* backend = (struct net_backend_epoll*) data;
 	close(backend->epfd);
-	hub_free(backend->conns);
+	ptr_table_destroy(backend->conns);
 	hub_free(backend);
 }
 
@@ -164,7 +164,7 @@ struct net_backend* net_backend_init_epoll(struct net_backend_handler* handler,
 		return 0;
 	}
 
-	backend->conns = hub_calloc(common->max, sizeof(struct net_connection_epoll*));
+	backend->conns = ptr_table_create(common->max);
 	backend->common = common;
 
 	net_backend_set_handlers(handler);
@@ -177,7 +177,7 @@ static void net_backend_set_handlers(struct net_backend_handler* handler)
 	handler->backend_poll = net_backend_poll_epoll;
 	handler->backend_process = net_backend_process_epoll;
 	handler->backend_shutdown = net_backend_shutdown_epoll;
-	handler->con_create = net_con_create_epoll;
+	handler->con_size = sizeof(struct net_connection_epoll);
 	handler->con_init = net_con_initialize_epoll;
 	handler->con_add = net_con_backend_add_epoll;
 	handler->con_mod = net_con_backend_mod_epoll;
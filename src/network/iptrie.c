@@ -0,0 +1,315 @@
+/*
+ * uhub - A tiny ADC p2p connection hub
+ * Copyright (C) 2007-2014, Jan Vidar Krey
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "uhub.h"
+
+#define IP_TRIE_KEY_LEN 16
+
+struct ip_trie_node
+{
+	struct ip_trie_node* child[2];
+	void* data;
+	uint8_t key[IP_TRIE_KEY_LEN];   /* Prefix, bits past 'bits' are always zero */
+	uint8_t bits;                   /* Prefix length */
+	uint8_t terminal;               /* Set if a prefix was inserted here, otherwise only a branch point */
+};
+
+struct ip_trie
+{
+	struct ip_trie_node* root[2];   /* IPv4 and IPv6 */
+	size_t size;
+};
+
+/*
+ * Convert an address to a big endian key, returns the key width in bits,
+ * or 0 if the address family is not supported.
+ */
+static int ip_trie_key(struct ip_addr_encap* addr, uint8_t* key)
+{
+	memset(key, 0, IP_TRIE_KEY_LEN);
+	if (addr->af == AF_INET)
+	{
+		memcpy(key, &addr->internal_ip_data.in.s_addr, 4);
+		return 32;
+	}
+	else if (addr->af == AF_INET6)
+	{
+		memcpy(key, &addr->internal_ip_data.in6, 16);
+		return 128;
+	}
+	return 0;
+}
+
+static struct ip_trie_node** ip_trie_root(struct ip_trie* trie, int width)
+{
+	return &trie->root[width == 32 ? 0 : 1];
+}
+
+static inline int key_bit(const uint8_t* key, int n)
+{
+	return (key[n >> 3] >> (7 - (n & 7))) & 1;
+}
+
+static inline void key_set_bit(uint8_t* key, int n)
+{
+	key[n >> 3] |= (uint8_t) (0x80 >> (n & 7));
+}
+
+static inline void key_clear_bit(uint8_t* key, int n)
+{
+	key[n >> 3] &= (uint8_t) ~(0x80 >> (n & 7));
+}
+
+/* Zero all bits after the first 'bits' bits */
+static void key_mask(uint8_t* key, int bits)
+{
+	int n = bits >> 3;
+	if (bits & 7)
+	{
+		key[n] &= (uint8_t) (0xff << (8 - (bits & 7)));
+		n++;
+	}
+	if (n < IP_TRIE_KEY_LEN)
+		memset(&key[n], 0, IP_TRIE_KEY_LEN - n);
+}
+
+/* Returns 1 if the first 'bits' bits of a and b are equal */
+static inline int key_match(const uint8_t* a, const uint8_t* b, int bits)
+{
+	int n = bits >> 3;
+	if (n && memcmp(a, b, n) != 0)
+		return 0;
+	if (bits & 7)
+		return ((a[n] ^ b[n]) & (uint8_t) (0xff << (8 - (bits & 7)))) == 0;
+	return 1;
+}
+
+/* Returns the number of equal leading bits of a and b, at most max */
+static int key_common(const uint8_t* a, const uint8_t* b, int max)
+{
+	int i, n;
+	uint8_t x;
+
+	for (i = 0; i < IP_TRIE_KEY_LEN && i * 8 < max; i++)
+	{
+		x = a[i] ^ b[i];
+		if (x)
+		{
+			n = i * 8;
+			while (!(x & 0x80))
+			{
+				x <<= 1;
+				n++;
+			}
+			return MIN(n, max);
+		}
+	}
+	return max;
+}
+
+static struct ip_trie_node* ip_trie_node_create(const uint8_t* key, int bits)
+{
+	struct ip_trie_node* node = (struct ip_trie_node*) hub_malloc_zero(sizeof(struct ip_trie_node));
+	if (!node)
+		return NULL;
+	memcpy(node->key, key, IP_TRIE_KEY_LEN);
+	key_mask(node->key, bits);
+	node->bits = (uint8_t) bits;
+	return node;
+}
+
+static void ip_trie_node_destroy(struct ip_trie_node* node)
+{
+	if (!node)
+		return;
+	ip_trie_node_destroy(node->child[0]);
+	ip_trie_node_destroy(node->child[1]);
+	hub_free(node);
+}
+
+struct ip_trie* ip_trie_create()
+{
+	return (struct ip_trie*) hub_malloc_zero(sizeof(struct ip_trie));
+}
+
+void ip_trie_destroy(struct ip_trie* trie)
+{
+	if (!trie)
+		return;
+	ip_trie_node_destroy(trie->root[0]);
+	ip_trie_node_destroy(trie->root[1]);
+	hub_free(trie);
+}
+
+static int ip_trie_insert_key(struct ip_trie* trie, int width, const uint8_t* key, int bits, void* data)
+{
+	struct ip_trie_node** link = ip_trie_root(trie, width);
+	struct ip_trie_node* node;
+	struct ip_trie_node* leaf;
+	struct ip_trie_node* branch;
+	int common;
+
+	for (;;)
+	{
+		node = *link;
+		if (!node)
+		{
+			leaf = ip_trie_node_create(key, bits);
+			if (!leaf)
+				return -1;
+			leaf->terminal = 1;
+			leaf->data = data;
+			*link = leaf;
+			trie->size++;
+			return 0;
+		}
+
+		common = key_common(node->key, key, MIN(node->bits, bits));
+		if (common == node->bits)
+		{
+			if (bits == node->bits)
+			{
+				/* Exact match, possibly a former branch point */
+				if (!node->terminal)
+					trie->size++;
+				node->terminal = 1;
+				node->data = data;
+				return 0;
+			}
+			link = &node->child[key_bit(key, node->bits)];
+			continue;
+		}
+
+		leaf = ip_trie_node_create(key, bits);
+		if (!leaf)
+			return -1;
+		leaf->terminal = 1;
+		leaf->data = data;
+		trie->size++;
+
+		if (common == bits)
+		{
+			/* The new prefix contains the existing node */
+			leaf->child[key_bit(node->key, bits)] = node;
+			*link = leaf;
+			return 0;
+		}
+
+		/* Split at the first differing bit */
+		branch = ip_trie_node_create(key, common);
+		if (!branch)
+		{
+			hub_free(leaf);
+			trie->size--;
+			return -1;
+		}
+		branch->child[key_bit(key, common)] = leaf;
+		branch->child[key_bit(node->key, common)] = node;
+		*link = branch;
+		return 0;
+	}
+}
+
+int ip_trie_insert(struct ip_trie* trie, struct ip_addr_encap* prefix, int bits, void* data)
+{
+	uint8_t key[IP_TRIE_KEY_LEN];
+	int width = ip_trie_key(prefix, key);
+
+	if (!width || bits < 0 || bits > width)
+		return -1;
+
+	return ip_trie_insert_key(trie, width, key, bits, data);
+}
+
+int ip_trie_insert_range(struct ip_trie* trie, struct ip_range* range, void* data)
+{
+	uint8_t lo[IP_TRIE_KEY_LEN];
+	uint8_t hi[IP_TRIE_KEY_LEN];
+	uint8_t end[IP_TRIE_KEY_LEN];
+	int width = ip_trie_key(&range->lo, lo);
+	int len = width / 8;
+	int k, n;
+
+	if (!width || range->lo.af != range->hi.af)
+		return -1;
+
+	ip_trie_key(&range->hi, hi);
+	if (memcmp(lo, hi, len) > 0)
+		return -1;
+
+	for (;;)
+	{
+		/* Find the largest aligned block starting at lo which ends within the range */
+		memcpy(end, lo, IP_TRIE_KEY_LEN);
+		for (k = 0; k < width; k++)
+		{
+			n = width - 1 - k;
+			if (key_bit(lo, n))
+				break;
+			key_set_bit(end, n);
+			if (memcmp(end, hi, len) > 0)
+			{
+				key_clear_bit(end, n);
+				break;
+			}
+		}
+
+		if (ip_trie_insert_key(trie, width, lo, width - k, data) == -1)
+			return -1;
+
+		if (memcmp(end, hi, len) == 0)
+			return 0;
+
+		/* lo = end + 1, this cannot overflow as end < hi */
+		memcpy(lo, end, IP_TRIE_KEY_LEN);
+		for (n = len - 1; n >= 0 && ++lo[n] == 0; n--);
+	}
+}
+
+int ip_trie_lookup(struct ip_trie* trie, struct ip_addr_encap* addr, void** data)
+{
+	uint8_t key[IP_TRIE_KEY_LEN];
+	int width = ip_trie_key(addr, key);
+	struct ip_trie_node* node;
+	int found = 0;
+
+	if (!width)
+		return 0;
+
+	node = *ip_trie_root(trie, width);
+	while (node && key_match(node->key, key, node->bits))
+	{
+		if (node->terminal)
+		{
+			found = 1;
+			if (data)
+				*data = node->data;
+		}
+
+		if (node->bits == width)
+			break;
+		node = node->child[key_bit(key, node->bits)];
+	}
+	return found;
+}
+
+size_t ip_trie_size(struct ip_trie* trie)
+{
+	return trie->size;
+}
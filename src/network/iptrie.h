@@ -0,0 +1,70 @@
+/*
+ * uhub - A tiny ADC p2p connection hub
+ * Copyright (C) 2007-2014, Jan Vidar Krey
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef HAVE_UHUB_IP_TRIE_H
+#define HAVE_UHUB_IP_TRIE_H
+
+/*
+ * A path compressed binary radix trie for IP prefixes (IPv4 and IPv6).
+ * Used for matching addresses against large sets of IP ranges,
+ * such as ban lists, without scanning every range.
+ */
+
+struct ip_addr_encap;
+struct ip_range;
+struct ip_trie;
+
+extern struct ip_trie* ip_trie_create();
+
+/**
+ * Destroy the trie. The data pointers are owned by the caller,
+ * as a range may be stored as several prefixes sharing the same data.
+ */
+extern void ip_trie_destroy(struct ip_trie* trie);
+
+/**
+ * Insert a prefix of the given number of bits.
+ * If the prefix already exists its data is replaced.
+ *
+ * @return 0 on success, -1 on error.
+ */
+extern int ip_trie_insert(struct ip_trie* trie, struct ip_addr_encap* prefix, int bits, void* data);
+
+/**
+ * Insert an arbitrary address range. The range is split into
+ * the smallest set of prefixes covering it.
+ *
+ * @return 0 on success, -1 on error.
+ */
+extern int ip_trie_insert_range(struct ip_trie* trie, struct ip_range* range, void* data);
+
+/**
+ * Find the longest prefix matching the address.
+ *
+ * @param data if not NULL, set to the data of the matching prefix.
+ * @return 1 if the address matches a prefix, 0 otherwise.
+ */
+extern int ip_trie_lookup(struct ip_trie* trie, struct ip_addr_encap* addr, void** data);
+
+/**
+ * @return the number of prefixes in the trie.
+ */
+extern size_t ip_trie_size(struct ip_trie* trie);
+
+#endif /* HAVE_UHUB_IP_TRIE_H */
@@ -38,10 +38,11 @@ struct net_connection_kqueue
 struct net_backend_kqueue
 {
 	int kqfd;
-	struct net_connection_kqueue** conns;
+	struct ptr_table* conns; /* struct net_connection_kqueue, by socket descriptor */
 	struct kevent* changes;
 	int* change_list;
 	size_t change_list_len;
+	size_t change_list_max;
 	struct kevent events[KQUEUE_EVBUFFER];
 	struct net_backend_common* common;
 };
@@ -87,7 +88,7 @@ void net_backend_process_kqueue(struct net_backend* data, int res)
 	for (n = 0; n < res; n++)
 	{
 		struct net_connection_kqueue* con = (struct net_connection_kqueue*) backend->events[n].udata;
-		if (con && con->sd >= 0 && backend->conns[con->sd])
+		if (con && con->sd >= 0 && ptr_table_get(backend->conns, con->sd))
 		{
 			int ev = 0;
 			if (backend->events[n].filter == EVFILT_READ) ev = NET_EVENT_READ;
@@ -97,13 +98,6 @@ void net_backend_process_kqueue(struct net_backend* data, int res)
 	}
 }
 
-struct net_connection* net_con_create_kqueue(struct net_backend* data)
-{
-	struct net_connection* con = (struct net_connection*) hub_malloc_zero(sizeof(struct net_connection_kqueue));
-	con->sd = -1;
-	return con;
-}
-
 void net_con_initialize_kqueue(struct net_backend* data, struct net_connection* con_, int sd, net_connection_cb callback, const void* ptr)
 {
 	struct net_connection_kqueue* con = (struct net_connection_kqueue*) con_;
@@ -113,13 +107,17 @@ void net_con_initialize_kqueue(struct net_backend* data, struct net_connection*
 	con->ptr = (void*) ptr;
 }
 
-void net_con_backend_add_kqueue(struct net_backend* data, struct net_connection* con_, int events)
+int net_con_backend_add_kqueue(struct net_backend* data, struct net_connection* con_, int events)
 {
 	struct net_backend_kqueue* backend = (struct net_backend_kqueue*) data;
 	struct net_connection_kqueue* con = (struct net_connection_kqueue*) con_;
 	int operation;
 
-	backend->conns[con->sd] = con;
+	if (ptr_table_set(backend->conns, con->sd, con) == -1)
+	{
+		LOG_ERROR("Unable to monitor socket %d.", con->sd);
+		return -1;
+	}
 
 	operation = CHANGE_ACTION_ADD;
 
@@ -130,6 +128,7 @@ void net_con_backend_add_kqueue(struct net_backend* data, struct net_connection*
 	  operation |= CHANGE_OP_WANT_WRITE;
 
 	add_change(backend, con, operation);
+	return 0;
 }
 
 void net_con_backend_mod_kqueue(struct net_backend* data, struct net_connection* con_, int events)
@@ -158,14 +157,14 @@ void net_con_backend_del_kqueue(struct net_backend* data, struct net_connection*
 	add_change(backend, con, CHANGE_ACTION_DEL);
 
 	// Unmap the socket descriptor.
-	backend->conns[con->sd] = 0;
+	ptr_table_set(backend->conns, con->sd, 0);
 }
 
 void net_backend_shutdown_kqueue(struct net_backend* data)
 {
 	struct net_backend_kqueue* backend = (struct net_backend_kqueue*) data;
 	close(backend->kqfd);
-	hub_free(backend->conns);
+	ptr_table_destroy(backend->conns);
 	hub_free(backend->changes);
 	hub_free(backend->change_list);
 	hub_free(backend);
@@ -186,9 +185,7 @@ struct net_backend* net_backend_init_kqueue(struct net_backend_handler* handler,
 		return 0;
 	}
 
-	backend->conns = hub_calloc(common->max, sizeof(struct net_connection_kqueue*));
-	backend->changes = hub_calloc(common->max * 2, sizeof(struct kevent));
-	backend->change_list = hub_calloc(common->max, sizeof(int));
+	backend->conns = ptr_table_create(common->max);
 	backend->common = common;
 
 	net_backend_set_handlers(handler);
@@ -201,7 +198,7 @@ static void net_backend_set_handlers(struct net_backend_handler* handler)
 	handler->backend_poll = net_backend_poll_kqueue;
 	handler->backend_process = net_backend_process_kqueue;
 	handler->backend_shutdown = net_backend_shutdown_kqueue;
-	handler->con_create = net_con_create_kqueue;
+	handler->con_size = sizeof(struct net_connection_kqueue);
 	handler->con_init = net_con_initialize_kqueue;
 	handler->con_add = net_con_backend_add_kqueue;
 	handler->con_mod = net_con_backend_mod_kqueue;
@@ -212,6 +209,22 @@ static void add_change(struct net_backend_kqueue* backend, struct net_connection
 {
 	if (actions && !con->change)
 	{
+		if (backend->change_list_len == backend->change_list_max)
+		{
+			/* Grow on demand, there can be two changes per socket. */
+			size_t max = MAX(backend->change_list_max * 2, KQUEUE_EVBUFFER);
+			int* change_list = hub_realloc(backend->change_list, max * sizeof(int));
+			struct kevent* changes = change_list ? hub_realloc(backend->changes, max * 2 * sizeof(struct kevent)) : 0;
+			if (change_list)
+				backend->change_list = change_list;
+			if (!changes)
+			{
+				LOG_ERROR("Unable to queue kqueue change for socket %d.", con->sd);
+				return;
+			}
+			backend->changes = changes;
+			backend->change_list_max = max;
+		}
 		backend->change_list[backend->change_list_len++] = con->sd;
 		con->change = actions;
 	}
@@ -229,7 +242,7 @@ static size_t create_change_list(struct net_backend_kqueue* backend)
 	for (; n < backend->change_list_len; n++)
 	{
 		sd = backend->change_list[n];
-		con = backend->conns[sd];
+		con = ptr_table_get(backend->conns, sd);
 		if (con)
 		{
 			flags_r = 0;
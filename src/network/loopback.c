@@ -0,0 +1,523 @@
+/*
+ * uhub - A tiny ADC p2p connection hub
+ * Copyright (C) 2007-2014, Jan Vidar Krey
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "uhub.h"
+
+#include "network/connection.h"
+#include "network/common.h"
+#include "network/backend.h"
+#include "network/loopback.h"
+
+#define NET_LOOPBACK_MAX_CONNECTIONS 262144
+
+struct net_connection_loopback;
+
+struct net_loopback_endpoint
+{
+	int sd;
+	struct net_loopback_endpoint* peer;  /* other end, or NULL once it is closed */
+	struct net_connection_loopback* con; /* attached connection, or NULL until accepted */
+	struct linked_list* backlog;         /* endpoints waiting to be accepted (listeners only) */
+	struct ip_addr_encap addr;           /* peer address reported by accept */
+	char* buf;                           /* data sent by the peer and not yet received */
+	size_t offset;
+	size_t length;
+	size_t capacity;
+};
+
+struct net_connection_loopback
+{
+	NET_CON_STRUCT_COMMON
+	struct net_loopback_endpoint* endpoint;
+	int events;                          /* monitored events (NET_EVENT_READ, NET_EVENT_WRITE) */
+	size_t index;                        /* position in backend->conns */
+};
+
+struct net_loopback_ready
+{
+	struct net_connection_loopback* con;
+	int events;
+};
+
+struct net_backend_loopback
+{
+	struct net_loopback_endpoint** endpoints; /* indexed by sd - NET_LOOPBACK_SD_BASE */
+	size_t endpoints_num;
+	size_t endpoints_max;
+	struct net_connection_loopback** conns;   /* monitored connections */
+	struct net_loopback_ready* ready;
+	size_t conns_num;
+	size_t conns_max;
+	struct net_backend_common* common;
+};
+
+static struct net_backend_loopback* g_loopback;
+static size_t g_loopback_buffer_size = NET_LOOPBACK_BUFFER_SIZE;
+
+static void net_backend_set_handlers(struct net_backend_handler* handler);
+
+void net_loopback_set_buffer_size(size_t size)
+{
+	g_loopback_buffer_size = MAX(size, 1);
+}
+
+static struct net_loopback_endpoint* net_loopback_endpoint_create(struct net_backend_loopback* backend)
+{
+	struct net_loopback_endpoint* ep;
+
+	if (backend->endpoints_num == backend->endpoints_max)
+	{
+		size_t max = MAX(backend->endpoints_max * 2, 64);
+		struct net_loopback_endpoint** endpoints = hub_realloc(backend->endpoints, max * sizeof(struct net_loopback_endpoint*));
+		if (!endpoints)
+			return 0;
+		backend->endpoints = endpoints;
+		backend->endpoints_max = max;
+	}
+
+	ep = hub_malloc_zero(sizeof(struct net_loopback_endpoint));
+	if (!ep)
+		return 0;
+
+	/* Descriptors are never reused, which keeps a simulation reproducible. */
+	ep->sd = NET_LOOPBACK_SD_BASE + (int) backend->endpoints_num;
+	backend->endpoints[backend->endpoints_num++] = ep;
+	return ep;
+}
+
+static void net_loopback_endpoint_destroy(struct net_backend_loopback* backend, struct net_loopback_endpoint* ep)
+{
+	if (ep->peer)
+		ep->peer->peer = 0;
+
+	if (net_loopback_is_virtual(ep->sd))
+		backend->endpoints[ep->sd - NET_LOOPBACK_SD_BASE] = 0;
+
+	hub_free(ep->buf);
+	hub_free(ep);
+}
+
+static int net_loopback_reserve(struct net_loopback_endpoint* ep, size_t len)
+{
+	size_t capacity;
+	char* buf;
+
+	if (ep->offset + ep->length + len <= ep->capacity)
+		return 1;
+
+	if (ep->offset)
+	{
+		memmove(ep->buf, ep->buf + ep->offset, ep->length);
+		ep->offset = 0;
+		if (ep->length + len <= ep->capacity)
+			return 1;
+	}
+
+	capacity = MAX(ep->capacity * 2, 1024);
+	while (capacity < ep->length + len)
+		capacity *= 2;
+
+	buf = hub_realloc(ep->buf, capacity);
+	if (!buf)
+		return 0;
+
+	ep->buf = buf;
+	ep->capacity = capacity;
+	return 1;
+}
+
+static int net_loopback_get_events(struct net_loopback_endpoint* ep)
+{
+	int events = 0;
+
+	if (ep->backlog)
+		return list_size(ep->backlog) ? NET_EVENT_READ : 0;
+
+	/* A closed peer is reported as both readable and writable,
+	 * so the owner finds out on its next recv or send. */
+	if (ep->length || !ep->peer)
+		events |= NET_EVENT_READ;
+
+	if (!ep->peer || ep->peer->length < g_loopback_buffer_size)
+		events |= NET_EVENT_WRITE;
+
+	return events;
+}
+
+ssize_t net_loopback_send(struct net_connection* con_, const void* buf, size_t len)
+{
+	struct net_connection_loopback* con = (struct net_connection_loopback*) con_;
+	struct net_loopback_endpoint* peer;
+
+	if (!con->endpoint || !con->endpoint->peer)
+	{
+		errno = EPIPE;
+		net_stats_add_error();
+		return -1;
+	}
+
+	peer = con->endpoint->peer;
+	if (peer->length >= g_loopback_buffer_size)
+		return 0;
+
+	len = MIN(len, g_loopback_buffer_size - peer->length);
+	if (!net_loopback_reserve(peer, len))
+	{
+		errno = ENOMEM;
+		net_stats_add_error();
+		return -1;
+	}
+
+	memcpy(peer->buf + peer->offset + peer->length, buf, len);
+	peer->length += len;
+	net_stats_add_tx(len);
+	return len;
+}
+
+ssize_t net_loopback_recv(struct net_connection* con_, void* buf, size_t len, int peek)
+{
+	struct net_connection_loopback* con = (struct net_connection_loopback*) con_;
+	struct net_loopback_endpoint* ep = con->endpoint;
+
+	if (!ep)
+	{
+		errno = EBADF;
+		net_stats_add_error();
+		return -1;
+	}
+
+	if (!ep->length)
+		return ep->peer ? 0 : -1;
+
+	len = MIN(len, ep->length);
+	memcpy(buf, ep->buf + ep->offset, len);
+
+	if (!peek)
+	{
+		ep->offset += len;
+		ep->length -= len;
+		if (!ep->length)
+			ep->offset = 0;
+		net_stats_add_rx(len);
+	}
+	return len;
+}
+
+int net_loopback_accept(struct net_connection* con_, struct ip_addr_encap* ipaddr)
+{
+	struct net_connection_loopback* con = (struct net_connection_loopback*) con_;
+	struct net_loopback_endpoint* ep;
+
+	if (!con->endpoint || !con->endpoint->backlog)
+	{
+		errno = EINVAL;
+		net_stats_add_error();
+		return -1;
+	}
+
+	ep = (struct net_loopback_endpoint*) list_get_first(con->endpoint->backlog);
+	if (!ep)
+	{
+		errno = EWOULDBLOCK;
+		return -1;
+	}
+
+	list_remove_first(con->endpoint->backlog, NULL);
+	if (ipaddr)
+		memcpy(ipaddr, &ep->addr, sizeof(struct ip_addr_encap));
+
+	net_stats_add_accept();
+	return ep->sd;
+}
+
+int net_loopback_close(int sd)
+{
+	size_t index = (size_t) (sd - NET_LOOPBACK_SD_BASE);
+	struct net_loopback_endpoint* ep;
+
+	if (!g_loopback || index >= g_loopback->endpoints_num)
+	{
+		errno = EBADF;
+		return -1;
+	}
+
+	/* Endpoints attached to a connection are released by net_con_close(). */
+	ep = g_loopback->endpoints[index];
+	if (ep && !ep->con)
+	{
+		net_loopback_endpoint_destroy(g_loopback, ep);
+		net_stats_add_close();
+	}
+	return 0;
+}
+
+struct net_connection* net_loopback_connect(struct net_connection* listener_, const struct ip_addr_encap* addr, net_connection_cb callback, const void* ptr, int events)
+{
+	struct net_connection_loopback* listener = (struct net_connection_loopback*) listener_;
+	struct net_loopback_endpoint* client;
+	struct net_loopback_endpoint* server;
+	struct net_connection* con;
+
+	if (!g_loopback || !listener || !(listener->flags & NET_LOOPBACK) || !listener->endpoint || !listener->endpoint->backlog)
+		return 0;
+
+	client = net_loopback_endpoint_create(g_loopback);
+	if (!client)
+		return 0;
+
+	server = net_loopback_endpoint_create(g_loopback);
+	if (!server)
+	{
+		net_loopback_endpoint_destroy(g_loopback, client);
+		return 0;
+	}
+
+	client->peer = server;
+	server->peer = client;
+	memcpy(&client->addr, addr, sizeof(struct ip_addr_encap));
+	memcpy(&server->addr, addr, sizeof(struct ip_addr_encap));
+	list_append(listener->endpoint->backlog, server);
+
+	con = net_con_create();
+	if (net_con_initialize(con, client->sd, callback, ptr, events) == -1)
+	{
+		net_con_destroy(con);
+		net_loopback_endpoint_destroy(g_loopback, client);
+		return 0;
+	}
+	return con;
+}
+
+const char* net_backend_name_loopback()
+{
+	return "loopback";
+}
+
+/*
+ * Real descriptors are listeners, or notify pipes signalled by other threads.
+ * They are checked without blocking.
+ */
+static int net_loopback_get_events_real(int sd)
+{
+	fd_set rfds;
+	struct timeval tv;
+
+	if (sd < 0 || sd >= FD_SETSIZE)
+		return 0;
+
+	FD_ZERO(&rfds);
+	FD_SET(sd, &rfds);
+	tv.tv_sec = 0;
+	tv.tv_usec = 0;
+	return select(sd + 1, &rfds, NULL, NULL, &tv) > 0 ? NET_EVENT_READ : 0;
+}
+
+int net_backend_poll_loopback(struct net_backend* data, int ms)
+{
+	struct net_backend_loopback* backend = (struct net_backend_loopback*) data;
+	size_t n;
+	int res = 0;
+
+	/* Never blocks: time only moves through net_backend_advance_time(). */
+	for (n = 0; n < backend->conns_num; n++)
+	{
+		struct net_connection_loopback* con = backend->conns[n];
+		int events = con->events ? (net_loopback_get_events(con->endpoint) & con->events) : 0;
+		if ((con->events & NET_EVENT_READ) && !net_loopback_is_virtual(con->sd))
+			events |= net_loopback_get_events_real(con->sd);
+		if (events)
+		{
+			backend->ready[res].con = con;
+			backend->ready[res].events = events;
+			res++;
+		}
+	}
+	return res;
+}
+
+void net_backend_process_loopback(struct net_backend* data, int res)
+{
+	struct net_backend_loopback* backend = (struct net_backend_loopback*) data;
+	int n;
+
+	for (n = 0; n < res; n++)
+	{
+		/* Connections closed by an earlier callback are skipped by net_con_callback(),
+		 * and are not freed until net_cleanup_process(). */
+		net_con_callback((struct net_connection*) backend->ready[n].con, backend->ready[n].events);
+	}
+}
+
+void net_con_initialize_loopback(struct net_backend* data, struct net_connection* con_, int sd, net_connection_cb callback, const void* ptr)
+{
+	struct net_backend_loopback* backend = (struct net_backend_loopback*) data;
+	struct net_connection_loopback* con = (struct net_connection_loopback*) con_;
+
+	con->sd = sd;
+	con->flags = NET_LOOPBACK;
+	con->callback = callback;
+	con->ptr = (void*) ptr;
+	con->events = 0;
+
+	if (net_loopback_is_virtual(sd))
+	{
+		size_t index = (size_t) (sd - NET_LOOPBACK_SD_BASE);
+		con->endpoint = index < backend->endpoints_num ? backend->endpoints[index] : 0;
+		if (con->endpoint)
+			con->endpoint->con = con;
+	}
+	else
+	{
+		/* A real descriptor is a listener (see start_listening_socket) that
+		 * accepts loopback connections, or a notify pipe. */
+		con->endpoint = hub_malloc_zero(sizeof(struct net_loopback_endpoint));
+		con->endpoint->sd = sd;
+		con->endpoint->con = con;
+		con->endpoint->backlog = list_create();
+	}
+}
+
+int net_con_backend_add_loopback(struct net_backend* data, struct net_connection* con_, int events)
+{
+	struct net_backend_loopback* backend = (struct net_backend_loopback*) data;
+	struct net_connection_loopback* con = (struct net_connection_loopback*) con_;
+	struct net_connection_loopback** conns;
+	struct net_loopback_ready* ready;
+
+	if (backend->conns_num == backend->conns_max)
+	{
+		size_t max = MAX(backend->conns_max * 2, 64);
+
+		conns = hub_realloc(backend->conns, max * sizeof(struct net_connection_loopback*));
+		if (!conns)
+			return -1;
+		backend->conns = conns;
+
+		ready = hub_realloc(backend->ready, max * sizeof(struct net_loopback_ready));
+		if (!ready)
+			return -1;
+		backend->ready = ready;
+		backend->conns_max = max;
+	}
+
+	con->index = backend->conns_num;
+	backend->conns[backend->conns_num++] = con;
+	con->events = events & (NET_EVENT_READ | NET_EVENT_WRITE);
+	return 0;
+}
+
+void net_con_backend_mod_loopback(struct net_backend* data, struct net_connection* con_, int events)
+{
+	struct net_connection_loopback* con = (struct net_connection_loopback*) con_;
+	con->events = events & (NET_EVENT_READ | NET_EVENT_WRITE);
+}
+
+void net_con_backend_del_loopback(struct net_backend* data, struct net_connection* con_)
+{
+	struct net_backend_loopback* backend = (struct net_backend_loopback*) data;
+	struct net_connection_loopback* con = (struct net_connection_loopback*) con_;
+	struct net_loopback_endpoint* ep = con->endpoint;
+
+	backend->conns[con->index] = backend->conns[--backend->conns_num];
+	backend->conns[con->index]->index = con->index;
+	con->events = 0;
+
+	if (!ep)
+		return;
+
+	if (ep->backlog)
+	{
+		struct net_loopback_endpoint* pending;
+		while ((pending = (struct net_loopback_endpoint*) list_get_first(ep->backlog)))
+		{
+			list_remove_first(ep->backlog, NULL);
+			net_loopback_endpoint_destroy(backend, pending);
+		}
+		list_destroy(ep->backlog);
+	}
+	else
+	{
+		net_stats_add_close();
+	}
+
+	net_loopback_endpoint_destroy(backend, ep);
+	con->endpoint = 0;
+}
+
+void net_backend_shutdown_loopback(struct net_backend* data)
+{
+	struct net_backend_loopback* backend = (struct net_backend_loopback*) data;
+	size_t n;
+
+	for (n = 0; n < backend->conns_num; n++)
+	{
+		struct net_loopback_endpoint* ep = backend->conns[n]->endpoint;
+		if (ep && ep->backlog)
+		{
+			list_destroy(ep->backlog);
+			hub_free(ep);
+		}
+		backend->conns[n]->endpoint = 0;
+	}
+
+	for (n = 0; n < backend->endpoints_num; n++)
+	{
+		if (backend->endpoints[n])
+		{
+			if (backend->endpoints[n]->con)
+				backend->endpoints[n]->con->endpoint = 0;
+			hub_free(backend->endpoints[n]->buf);
+			hub_free(backend->endpoints[n]);
+		}
+	}
+
+	hub_free(backend->endpoints);
+	hub_free(backend->conns);
+	hub_free(backend->ready);
+	hub_free(backend);
+	g_loopback = 0;
+}
+
+struct net_backend* net_backend_init_loopback(struct net_backend_handler* handler, struct net_backend_common* common)
+{
+	struct net_backend_loopback* backend = hub_malloc_zero(sizeof(struct net_backend_loopback));
+	if (!backend)
+		return 0;
+
+	/* Not bound by the descriptor limit of the process. */
+	common->max = NET_LOOPBACK_MAX_CONNECTIONS;
+	backend->common = common;
+	g_loopback = backend;
+
+	net_backend_set_handlers(handler);
+	return (struct net_backend*) backend;
+}
+
+static void net_backend_set_handlers(struct net_backend_handler* handler)
+{
+	handler->backend_name = net_backend_name_loopback;
+	handler->backend_poll = net_backend_poll_loopback;
+	handler->backend_process = net_backend_process_loopback;
+	handler->backend_shutdown = net_backend_shutdown_loopback;
+	handler->con_size = sizeof(struct net_connection_loopback);
+	handler->con_init = net_con_initialize_loopback;
+	handler->con_add = net_con_backend_add_loopback;
+	handler->con_mod = net_con_backend_mod_loopback;
+	handler->con_del = net_con_backend_del_loopback;
+}
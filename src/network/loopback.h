@@ -0,0 +1,85 @@
+/*
+ * uhub - A tiny ADC p2p connection hub
+ * Copyright (C) 2007-2014, Jan Vidar Krey
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef HAVE_UHUB_NETWORK_LOOPBACK_H
+#define HAVE_UHUB_NETWORK_LOOPBACK_H
+
+/*
+ * The loopback backend is an in-memory network backend meant for tests and
+ * simulations. Connections are pairs of in-memory pipes created with
+ * net_loopback_connect(), and the backend clock only moves when
+ * net_backend_advance_time() is called, so a hub with thousands of simulated
+ * clients runs deterministically in a single process without touching the kernel.
+ *
+ * Enable it with net_backend_use_loopback() before net_initialize().
+ * TLS is not supported on loopback connections.
+ */
+
+struct ip_addr_encap;
+
+/**
+ * Descriptors handed out for loopback connections start here, which is above
+ * anything the kernel will hand out (see fs.nr_open).
+ */
+#define NET_LOOPBACK_SD_BASE      0x40000000
+
+/**
+ * Default number of bytes that can be queued in each direction of a loopback
+ * connection before the sender sees a would-block.
+ */
+#define NET_LOOPBACK_BUFFER_SIZE  65536
+
+#define net_loopback_is_virtual(sd) ((sd) >= NET_LOOPBACK_SD_BASE)
+
+/**
+ * Set the number of bytes that can be queued in each direction of a
+ * loopback connection. Takes effect for subsequent writes.
+ */
+extern void net_loopback_set_buffer_size(size_t size);
+
+/**
+ * Connect to a listening connection (normally hub->server) of the loopback backend.
+ * The hub sees the new connection when it accepts it from the listener, with
+ * the given address as the peer address.
+ *
+ * @param listener listening connection to connect to.
+ * @param addr peer address the hub should see.
+ * @param callback connection callback for the client side.
+ * @param ptr data pointer for the client side.
+ * @param events events to monitor for the client side (NET_EVENT_*).
+ * @return the client side of the connection, or NULL if the loopback backend is not in use.
+ */
+extern struct net_connection* net_loopback_connect(struct net_connection* listener, const struct ip_addr_encap* addr, net_connection_cb callback, const void* ptr, int events);
+
+/**
+ * Send, receive and accept for loopback connections.
+ * These follow the conventions of net_con_send(), net_con_recv()
+ * and net_accept() and are called through them.
+ */
+extern ssize_t net_loopback_send(struct net_connection* con, const void* buf, size_t len);
+extern ssize_t net_loopback_recv(struct net_connection* con, void* buf, size_t len, int peek);
+extern int net_loopback_accept(struct net_connection* con, struct ip_addr_encap* ipaddr);
+
+/**
+ * Close a loopback descriptor that was accepted but never attached to a
+ * connection. Called through net_close().
+ */
+extern int net_loopback_close(int sd);
+
+#endif /* HAVE_UHUB_NETWORK_LOOPBACK_H */
@@ -287,10 +287,15 @@ int net_get_recvbuf_size(int fd, size_t* size)
 
 int net_close(int fd)
 {
+	int ret;
+
+	if (net_loopback_is_virtual(fd))
+		return net_loopback_close(fd);
+
 #ifdef WINSOCK
-	int ret = closesocket(fd);
+	ret = closesocket(fd);
 #else
-	int ret = close(fd);
+	ret = close(fd);
 #endif
 
 	if (ret == 0)
@@ -309,6 +314,9 @@ int net_close(int fd)
 
 int net_shutdown_r(int fd)
 {
+	if (net_loopback_is_virtual(fd))
+		return 0;
+
 #ifdef WINSOCK
 	return shutdown(fd, SD_RECEIVE);
 #else
@@ -318,6 +326,9 @@ int net_shutdown_r(int fd)
 
 int net_shutdown_w(int fd)
 {
+	if (net_loopback_is_virtual(fd))
+		return 0;
+
 #ifdef WINSOCK
 	return shutdown(fd, SD_SEND);
 #else
@@ -327,6 +338,9 @@ int net_shutdown_w(int fd)
 
 int net_shutdown_rw(int fd)
 {
+	if (net_loopback_is_virtual(fd))
+		return 0;
+
 #ifdef WINSOCK
 	return shutdown(fd, SD_BOTH);
 #else
@@ -774,6 +788,50 @@ ssize_t net_send(int fd, const void* buf, size_t len, int flags)
 }
 
 
+ssize_t net_recvfrom(int fd, void* buf, size_t len, int flags, struct sockaddr* from, socklen_t* fromlen)
+{
+	ssize_t ret = recvfrom(fd, buf, len, flags, from, fromlen);
+	if (ret >= 0)
+	{
+		net_stats_add_rx(ret);
+	}
+	else
+	{
+#ifdef WINSOCK
+		if (net_error() != WSAEWOULDBLOCK)
+#else
+		if (net_error() != EWOULDBLOCK)
+#endif
+		{
+			net_stats_add_error();
+		}
+	}
+	return ret;
+}
+
+
+ssize_t net_sendto(int fd, const void* buf, size_t len, int flags, const struct sockaddr* to, socklen_t tolen)
+{
+	ssize_t ret = sendto(fd, buf, len, flags, to, tolen);
+	if (ret >= 0)
+	{
+		net_stats_add_tx(ret);
+	}
+	else
+	{
+#ifdef WINSOCK
+		if (net_error() != WSAEWOULDBLOCK)
+#else
+		if (net_error() != EWOULDBLOCK)
+#endif
+		{
+			net_stats_add_error();
+		}
+	}
+	return ret;
+}
+
+
 int net_bind(int fd, const struct sockaddr *my_addr, socklen_t addrlen)
 {
 	int ret = bind(fd, my_addr, addrlen);
@@ -820,6 +878,10 @@ void net_stats_reset()
 	stats_total.accept += stats.accept;
 	stats_total.errors += stats.errors;
 	stats_total.closed += stats.closed;
+	stats_total.tls_accept += stats.tls_accept;
+	stats_total.tls_resumed += stats.tls_resumed;
+	stats_total.tls_ktls += stats.tls_ktls;
+	stats_total.tls_ktls_fallback += stats.tls_ktls_fallback;
 
 	memset(&stats, 0, sizeof(struct net_statistics));
 	stats.timestamp = time(NULL);
@@ -874,3 +936,18 @@ void net_stats_tls_add_close()
 {
 	stats.tls_close++;
 }
+
+void net_stats_tls_add_resumed()
+{
+	stats.tls_resumed++;
+}
+
+void net_stats_tls_add_ktls()
+{
+	stats.tls_ktls++;
+}
+
+void net_stats_tls_add_ktls_fallback()
+{
+	stats.tls_ktls_fallback++;
+}
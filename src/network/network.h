@@ -32,6 +32,9 @@ struct net_statistics
 	size_t tls_connect;
 	size_t tls_error;
 	size_t tls_close;
+	size_t tls_resumed;       /* TLS handshakes that resumed a previous session */
+	size_t tls_ktls;          /* TLS connections offloaded to the kernel */
+	size_t tls_ktls_fallback; /* TLS connections where kernel offload was not possible */
 };
 
 struct net_socket_t;
@@ -209,6 +212,16 @@ extern ssize_t net_recv(int fd, void* buf, size_t len, int flags);
  */
 extern ssize_t net_send(int fd, const void* buf, size_t len, int flags);
 
+/**
+ * A wrapper for the recvfrom() function call.
+ */
+extern ssize_t net_recvfrom(int fd, void* buf, size_t len, int flags, struct sockaddr* from, socklen_t* fromlen);
+
+/**
+ * A wrapper for the sendto() function call.
+ */
+extern ssize_t net_sendto(int fd, const void* buf, size_t len, int flags, const struct sockaddr* to, socklen_t tolen);
+
 /**
  * This tries to create a AF_INET6 socket.
  * If it succeeds it concludes IPv6 is supported on the host operating
@@ -255,6 +268,9 @@ extern void net_stats_tls_add_accept();
 extern void net_stats_tls_add_connect();
 extern void net_stats_tls_add_error();
 extern void net_stats_tls_add_close();
+extern void net_stats_tls_add_ktls();
+extern void net_stats_tls_add_resumed();
+extern void net_stats_tls_add_ktls_fallback();
 extern void net_stats_add_accept();
 extern void net_stats_add_error();
 extern void net_stats_add_close();
@@ -71,7 +71,15 @@ struct uhub_notify_handle* net_notify_create(net_notify_callback cb, void* ptr)
 	}
 
 	handle->con = net_con_create();
-	net_con_initialize(handle->con, handle->pipe_fd[0], notify_callback, handle, NET_EVENT_READ);
+	if (net_con_initialize(handle->con, handle->pipe_fd[0], notify_callback, handle, NET_EVENT_READ) == -1)
+	{
+		LOG_ERROR("Unable to monitor notification pipes.");
+		net_con_destroy(handle->con);
+		close(handle->pipe_fd[0]);
+		close(handle->pipe_fd[1]);
+		hub_free(handle);
+		return 0;
+	}
 #endif
 	return handle;
 }
@@ -25,11 +25,18 @@
 #ifdef SSL_SUPPORT
 #ifdef SSL_USE_OPENSSL
 
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+#include <openssl/core_names.h>
+#endif
+
 void net_stats_add_tx(size_t bytes);
 void net_stats_add_rx(size_t bytes);
 void net_stats_tls_add_accept();
 void net_stats_tls_add_errors();
 void net_stats_tls_add_accept();
+void net_stats_tls_add_ktls();
+void net_stats_tls_add_ktls_fallback();
+void net_stats_tls_add_resumed();
 
 
 struct net_ssl_openssl
@@ -41,13 +48,32 @@ struct net_ssl_openssl
 	int ssl_read_events;
 	int ssl_write_events;
 	uint32_t flags;
+	int ktls;          /* NET_SSL_KTLS_SEND and NET_SSL_KTLS_RECV, if offloaded to the kernel */
 	size_t bytes_rx;
 	size_t bytes_tx;
 };
 
+#define NET_SSL_TICKET_KEYS 2
+
+struct net_ssl_ticket_key
+{
+	unsigned char name[16];
+	unsigned char aes_key[32];
+	unsigned char hmac_key[32];
+};
+
 struct net_context_openssl
 {
 	SSL_CTX* ssl;
+	struct net_ssl_ticket_key ticket_keys[NET_SSL_TICKET_KEYS]; /* The current key first, then the previous one */
+	size_t num_ticket_keys;
+	struct linked_list* sni;    /* Contexts selected by TLS server name (struct net_ssl_sni) */
+};
+
+struct net_ssl_sni
+{
+	char* name;
+	struct net_context_openssl* ctx;
 };
 
 static struct net_ssl_openssl* get_handle(struct net_connection* con)
@@ -268,16 +294,292 @@ struct ssl_context_handle* net_ssl_context_create(const char* tls_version, const
 
 	SSL_CTX_set_alpn_select_cb(ctx->ssl, alpn_server_select_protocol, NULL);
 
+	/* Sessions can only be resumed within the same context */
+	SSL_CTX_set_session_id_context(ctx->ssl, (const unsigned char*) "uhub", 4);
+	SSL_CTX_set_app_data(ctx->ssl, ctx);
+
 	return (struct ssl_context_handle*) ctx;
 }
 
+static void net_ssl_sni_free(void* ptr)
+{
+	struct net_ssl_sni* sni = (struct net_ssl_sni*) ptr;
+	hub_free(sni->name);
+	hub_free(sni);
+}
+
 void net_ssl_context_destroy(struct ssl_context_handle* ctx_)
 {
 	struct net_context_openssl* ctx = (struct net_context_openssl*) ctx_;
+	if (ctx->sni)
+	{
+		list_clear(ctx->sni, net_ssl_sni_free);
+		list_destroy(ctx->sni);
+	}
+	/* Connections handed this context by server name keep the SSL_CTX alive, but not ctx */
+	SSL_CTX_set_app_data(ctx->ssl, NULL);
 	SSL_CTX_free(ctx->ssl);
+	OPENSSL_cleanse(ctx->ticket_keys, sizeof(ctx->ticket_keys));
 	hub_free(ctx);
 }
 
+void net_ssl_context_set_session_cache(struct ssl_context_handle* ctx_, size_t size, int timeout)
+{
+	struct net_context_openssl* ctx = (struct net_context_openssl*) ctx_;
+	if (size)
+	{
+		SSL_CTX_set_session_cache_mode(ctx->ssl, SSL_SESS_CACHE_SERVER);
+		SSL_CTX_sess_set_cache_size(ctx->ssl, size);
+	}
+	else
+	{
+		SSL_CTX_set_session_cache_mode(ctx->ssl, SSL_SESS_CACHE_OFF);
+	}
+	SSL_CTX_set_timeout(ctx->ssl, timeout);
+}
+
+static int net_ssl_servername_cb(SSL* ssl, int* alert, void* arg)
+{
+	struct net_context_openssl* ctx = (struct net_context_openssl*) arg;
+	const char* name = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+	struct net_ssl_sni* sni;
+
+	if (!name)
+		return SSL_TLSEXT_ERR_NOACK;
+
+	LIST_FOREACH(struct net_ssl_sni*, sni, ctx->sni,
+	{
+		if (!strcasecmp(name, sni->name))
+		{
+			SSL_set_SSL_CTX(ssl, sni->ctx->ssl);
+			return SSL_TLSEXT_ERR_OK;
+		}
+	});
+
+	/* Unknown names are served by this context */
+	return SSL_TLSEXT_ERR_NOACK;
+}
+
+int net_ssl_context_add_sni(struct ssl_context_handle* ctx_, const char* name, struct ssl_context_handle* sni_ctx)
+{
+	struct net_context_openssl* ctx = (struct net_context_openssl*) ctx_;
+	struct net_ssl_sni* sni;
+
+	if (!ctx->sni)
+	{
+		ctx->sni = list_create();
+		if (!ctx->sni)
+			return 0;
+		SSL_CTX_set_tlsext_servername_callback(ctx->ssl, net_ssl_servername_cb);
+		SSL_CTX_set_tlsext_servername_arg(ctx->ssl, ctx);
+	}
+
+	sni = hub_malloc_zero(sizeof(struct net_ssl_sni));
+	if (!sni)
+		return 0;
+
+	sni->name = hub_strdup(name);
+	sni->ctx = (struct net_context_openssl*) sni_ctx;
+	if (!sni->name)
+	{
+		hub_free(sni);
+		return 0;
+	}
+	list_append(ctx->sni, sni);
+	return 1;
+}
+
+void net_ssl_context_remove_sni(struct ssl_context_handle* ctx_, struct ssl_context_handle* sni_ctx)
+{
+	struct net_context_openssl* ctx = (struct net_context_openssl*) ctx_;
+	struct net_ssl_sni* sni;
+
+	if (!ctx->sni)
+		return;
+
+	LIST_FOREACH(struct net_ssl_sni*, sni, ctx->sni,
+	{
+		if (sni->ctx == (struct net_context_openssl*) sni_ctx)
+		{
+			list_remove(ctx->sni, sni);
+			net_ssl_sni_free(sni);
+			return;
+		}
+	});
+}
+
+static struct net_ssl_ticket_key* net_ssl_find_ticket_key(struct net_context_openssl* ctx, const unsigned char* name, int* current)
+{
+	size_t n;
+	for (n = 0; n < ctx->num_ticket_keys; n++)
+	{
+		if (!memcmp(ctx->ticket_keys[n].name, name, sizeof(ctx->ticket_keys[n].name)))
+		{
+			*current = (n == 0);
+			return &ctx->ticket_keys[n];
+		}
+	}
+	return 0;
+}
+
+/*
+ * Encrypts session tickets with the current key, and decrypts tickets
+ * made with the current or the previous key. Tickets made with the
+ * previous key are renewed (return value 2).
+ * Tickets with an unknown key cause a full handshake (return value 0).
+ */
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+static int net_ssl_ticket_key_cb(SSL* ssl, unsigned char* name, unsigned char* iv, EVP_CIPHER_CTX* cipher, EVP_MAC_CTX* mac, int enc)
+#else
+static int net_ssl_ticket_key_cb(SSL* ssl, unsigned char* name, unsigned char* iv, EVP_CIPHER_CTX* cipher, HMAC_CTX* mac, int enc)
+#endif
+{
+	struct net_context_openssl* ctx = (struct net_context_openssl*) SSL_CTX_get_app_data(SSL_get_SSL_CTX(ssl));
+	struct net_ssl_ticket_key* key;
+	int current = 1;
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+	OSSL_PARAM params[3];
+#endif
+
+	/* The hub of this context has stopped */
+	if (!ctx)
+		return -1;
+
+	if (enc)
+	{
+		if (!ctx->num_ticket_keys || RAND_bytes(iv, EVP_CIPHER_iv_length(EVP_aes_256_cbc())) <= 0)
+			return -1;
+		key = &ctx->ticket_keys[0];
+		memcpy(name, key->name, sizeof(key->name));
+		if (!EVP_EncryptInit_ex(cipher, EVP_aes_256_cbc(), NULL, key->aes_key, iv))
+			return -1;
+	}
+	else
+	{
+		key = net_ssl_find_ticket_key(ctx, name, &current);
+		if (!key)
+			return 0;
+		if (!EVP_DecryptInit_ex(cipher, EVP_aes_256_cbc(), NULL, key->aes_key, iv))
+			return -1;
+	}
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+	params[0] = OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY, key->hmac_key, sizeof(key->hmac_key));
+	params[1] = OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, "SHA256", 0);
+	params[2] = OSSL_PARAM_construct_end();
+	if (!EVP_MAC_CTX_set_params(mac, params))
+		return -1;
+#else
+	if (!HMAC_Init_ex(mac, key->hmac_key, sizeof(key->hmac_key), EVP_sha256(), NULL))
+		return -1;
+#endif
+
+	return current ? 1 : 2;
+}
+
+int net_ssl_context_rotate_ticket_key(struct ssl_context_handle* ctx_)
+{
+	struct net_context_openssl* ctx = (struct net_context_openssl*) ctx_;
+	struct net_ssl_ticket_key key;
+
+	if (RAND_bytes((unsigned char*) &key, sizeof(key)) <= 0)
+	{
+		LOG_ERROR("Unable to generate a TLS session ticket key: %s", ERR_error_string(ERR_get_error(), NULL));
+		return 0;
+	}
+
+	memmove(&ctx->ticket_keys[1], &ctx->ticket_keys[0], sizeof(struct net_ssl_ticket_key) * (NET_SSL_TICKET_KEYS - 1));
+	memcpy(&ctx->ticket_keys[0], &key, sizeof(key));
+	OPENSSL_cleanse(&key, sizeof(key));
+	if (ctx->num_ticket_keys < NET_SSL_TICKET_KEYS)
+		ctx->num_ticket_keys++;
+	return 1;
+}
+
+size_t net_ssl_context_get_ticket_keys(struct ssl_context_handle* ctx_, void* buf, size_t size)
+{
+	struct net_context_openssl* ctx = (struct net_context_openssl*) ctx_;
+	size_t bytes = ctx->num_ticket_keys * sizeof(struct net_ssl_ticket_key);
+
+	if (bytes > size)
+		return 0;
+	memcpy(buf, ctx->ticket_keys, bytes);
+	return bytes;
+}
+
+int net_ssl_context_set_ticket_keys(struct ssl_context_handle* ctx_, const void* buf, size_t size)
+{
+	struct net_context_openssl* ctx = (struct net_context_openssl*) ctx_;
+
+	if (!size || size % sizeof(struct net_ssl_ticket_key) || size > sizeof(ctx->ticket_keys))
+		return 0;
+
+	OPENSSL_cleanse(ctx->ticket_keys, sizeof(ctx->ticket_keys));
+	memcpy(ctx->ticket_keys, buf, size);
+	ctx->num_ticket_keys = size / sizeof(struct net_ssl_ticket_key);
+	return 1;
+}
+
+int net_ssl_context_set_tickets(struct ssl_context_handle* ctx_, int enable)
+{
+	struct net_context_openssl* ctx = (struct net_context_openssl*) ctx_;
+
+	if (!enable)
+	{
+		SSL_CTX_set_options(ctx->ssl, SSL_OP_NO_TICKET);
+		return 1;
+	}
+
+	if (!ctx->num_ticket_keys && !net_ssl_context_rotate_ticket_key(ctx_))
+		return 0;
+
+	SSL_CTX_clear_options(ctx->ssl, SSL_OP_NO_TICKET);
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+	SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx->ssl, net_ssl_ticket_key_cb);
+#else
+	SSL_CTX_set_tlsext_ticket_key_cb(ctx->ssl, net_ssl_ticket_key_cb);
+#endif
+	return 1;
+}
+
+int net_ssl_context_set_ktls(struct ssl_context_handle* ctx_, int enable)
+{
+#if defined(SSL_OP_ENABLE_KTLS) && !defined(OPENSSL_NO_KTLS)
+	struct net_context_openssl* ctx = (struct net_context_openssl*) ctx_;
+	if (enable)
+		SSL_CTX_set_options(ctx->ssl, SSL_OP_ENABLE_KTLS);
+	else
+		SSL_CTX_clear_options(ctx->ssl, SSL_OP_ENABLE_KTLS);
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+/*
+ * Once the handshake is done, OpenSSL has handed the keys to the kernel
+ * if it could. Otherwise (no kernel support, or a cipher the kernel does
+ * not handle) records are processed in user space as usual.
+ */
+static void net_ssl_check_ktls(struct net_ssl_openssl* handle)
+{
+#if defined(SSL_OP_ENABLE_KTLS) && !defined(OPENSSL_NO_KTLS)
+	handle->ktls = 0;
+	if (BIO_get_ktls_send(SSL_get_wbio(handle->ssl)))
+		handle->ktls |= NET_SSL_KTLS_SEND;
+	if (BIO_get_ktls_recv(SSL_get_rbio(handle->ssl)))
+		handle->ktls |= NET_SSL_KTLS_RECV;
+
+	if (SSL_get_options(handle->ssl) & SSL_OP_ENABLE_KTLS)
+	{
+		if (handle->ktls)
+			net_stats_tls_add_ktls();
+		else
+			net_stats_tls_add_ktls_fallback();
+	}
+#endif
+}
+
 int ssl_load_certificate(struct ssl_context_handle* ctx_, const char* pem_file)
 {
 	struct net_context_openssl* ctx = (struct net_context_openssl*) ctx_;
@@ -312,29 +614,33 @@ int ssl_check_private_key(struct ssl_context_handle* ctx_)
 	return 1;
 }
 
+/* The SHA256 digest of the certificate, base32 encoded, as in a KEYP link */
+static int ssl_get_keyprint(X509* cert, char* keyp)
+{
+	unsigned int n;
+	unsigned char md[EVP_MAX_MD_SIZE];
+
+	if (!X509_digest(cert, EVP_sha256(), md, &n))
+		return 0;
+
+	base32_encode(md, (size_t)n, keyp);
+	return 1;
+}
+
 void ssl_keyprint_info(struct ssl_context_handle* ctx_, int port)
 {
 	struct net_context_openssl* ctx = (struct net_context_openssl*) ctx_;
 
-	unsigned int n;
-	unsigned char md[EVP_MAX_MD_SIZE];
-	char keyp[EVP_MAX_MD_SIZE * 8 / 5 + 2];
-	const EVP_MD *fdig;
+	char keyp[NET_SSL_KEYPRINT_SIZE];
 	X509 *cert;
 
 	if (hub_get_log_verbosity() < log_info)
 		return;
 
 	cert = SSL_CTX_get0_certificate(ctx->ssl);
-	if (cert == NULL)
-		return;
-
-	fdig = EVP_sha256();
-	if (!X509_digest(cert, fdig, md, &n))
+	if (cert == NULL || !ssl_get_keyprint(cert, keyp))
 		return;
 
-	base32_encode(md, (size_t)n, keyp);
-
 	// E.g. adcs://localhost:1511/?kp=SHA256/CHCX3O6OIOFV4SPYZ36JLASNEOFRXLFA4CRS2GCRSIGY4OJB5NCA
 	LOG_INFO("Secure ADCS URL: adcs://localhost:%d/?kp=SHA256/%s", port, keyp);
 }
@@ -387,6 +693,9 @@ ssize_t net_con_ssl_accept(struct net_connection* con)
 		net_con_update(con, NET_EVENT_READ);
 		net_ssl_set_state(handle, tls_st_connected);
 		net_stats_tls_add_accept();
+		if (SSL_session_reused(handle->ssl))
+			net_stats_tls_add_resumed();
+		net_ssl_check_ktls(handle);
 		return ret;
 	}
 
@@ -411,6 +720,7 @@ ssize_t net_con_ssl_connect(struct net_connection* con)
 		net_con_update(con, NET_EVENT_READ);
 		net_ssl_set_state(handle, tls_st_connected);
 		net_stats_tls_add_connect();
+		net_ssl_check_ktls(handle);
 		return ret;
 	}
 
@@ -469,7 +779,8 @@ ssize_t net_ssl_send(struct net_connection* con, const void* buf, size_t len)
 
 	uhub_assert(handle->state == tls_st_connected);
 
-
+	/* With kTLS, SSL_write() hands the data straight to the kernel, after any
+	 * records OpenSSL still has queued (such as a KeyUpdate). */
 	ERR_clear_error();
 	ssize_t ret = SSL_write(handle->ssl, buf, len);
 	add_io_stats(handle);
@@ -591,6 +902,37 @@ const char* net_ssl_get_tls_version(struct net_connection* con)
 	return SSL_get_version(handle->ssl);
 }
 
+struct ssl_context_handle* net_ssl_get_context(struct net_connection* con)
+{
+	struct net_ssl_openssl* handle = get_handle(con);
+	return (struct ssl_context_handle*) SSL_CTX_get_app_data(SSL_get_SSL_CTX(handle->ssl));
+}
+
+int net_ssl_get_peer_keyprint(struct net_connection* con, char* keyprint)
+{
+	struct net_ssl_openssl* handle = get_handle(con);
+	X509* cert;
+	int ret;
+
+#if OPENSSL_VERSION_NUMBER >= 0x30000000L
+	cert = SSL_get1_peer_certificate(handle->ssl);
+#else
+	cert = SSL_get_peer_certificate(handle->ssl);
+#endif
+	if (!cert)
+		return 0;
+
+	ret = ssl_get_keyprint(cert, keyprint);
+	X509_free(cert);
+	return ret;
+}
+
+int net_ssl_get_ktls(struct net_connection* con)
+{
+	struct net_ssl_openssl* handle = get_handle(con);
+	return handle->ktls;
+}
+
 const char* net_ssl_get_tls_cipher(struct net_connection* con)
 {
 	struct net_ssl_openssl* handle = get_handle(con);
@@ -32,7 +32,7 @@ struct net_connection_select
 
 struct net_backend_select
 {
-	struct net_connection_select** conns;
+	struct ptr_table* conns; /* struct net_connection_select, by socket descriptor */
 	fd_set rfds;
 	fd_set wfds;
 	fd_set xfds;
@@ -64,7 +64,7 @@ int net_backend_poll_select(struct net_backend* data, int ms)
 	backend->maxfd = -1;
 	for (n = 0, found = 0; found < backend->common->num && n < backend->common->max; n++)
 	{
-		struct net_connection_select* con = backend->conns[n];
+		struct net_connection_select* con = ptr_table_get(backend->conns, n);
 		if (con)
 		{
 			if (con->flags & NET_EVENT_READ)  FD_SET(con->sd, &backend->rfds);
@@ -93,7 +93,7 @@ void net_backend_process_select(struct net_backend* data, int res)
 	struct net_backend_select* backend = (struct net_backend_select*) data;
 	for (n = 0, found = 0; found < res && n < backend->maxfd; n++)
 	{
-		struct net_connection_select* con = backend->conns[n];
+		struct net_connection_select* con = ptr_table_get(backend->conns, n);
 		if (con)
 		{
 			int ev = 0;
@@ -109,13 +109,6 @@ void net_backend_process_select(struct net_backend* data, int res)
 	}
 }
 
-struct net_connection* net_con_create_select(struct net_backend* data)
-{
-	struct net_connection* con = (struct net_connection*) hub_malloc_zero(sizeof(struct net_connection_select));
-	con->sd = -1;
-	return con;
-}
-
 void net_con_initialize_select(struct net_backend* data, struct net_connection* con_, int sd, net_connection_cb callback, const void* ptr)
 {
 	struct net_connection_select* con = (struct net_connection_select*) con_;
@@ -125,11 +118,18 @@ void net_con_initialize_select(struct net_backend* data, struct net_connection*
 	con->ptr = (void*) ptr;
 }
 
-void net_con_backend_add_select(struct net_backend* data, struct net_connection* con, int events)
+int net_con_backend_add_select(struct net_backend* data, struct net_connection* con, int events)
 {
 	struct net_backend_select* backend = (struct net_backend_select*) data;
-	backend->conns[con->sd] = (struct net_connection_select*) con;
+
+	if (ptr_table_set(backend->conns, con->sd, con) == -1)
+	{
+		LOG_ERROR("Unable to monitor socket %d.", con->sd);
+		return -1;
+	}
+
 	con->flags |= (events & (NET_EVENT_READ | NET_EVENT_WRITE));
+	return 0;
 }
 
 
@@ -141,13 +141,13 @@ void net_con_backend_mod_select(struct net_backend* data, struct net_connection*
 void net_con_backend_del_select(struct net_backend* data, struct net_connection* con)
 {
 	struct net_backend_select* backend = (struct net_backend_select*) data;
-	backend->conns[con->sd] = 0;
+	ptr_table_set(backend->conns, con->sd, 0);
 }
 
 void net_backend_shutdown_select(struct net_backend* data)
 {
 	struct net_backend_select* backend = (struct net_backend_select*) data;
-	hub_free(backend->conns);
+	ptr_table_destroy(backend->conns);
 	hub_free(backend);
 }
 
@@ -161,7 +161,7 @@ struct net_backend* net_backend_init_select(struct net_backend_handler* handler,
 	backend = hub_malloc_zero(sizeof(struct net_backend_select));
 	FD_ZERO(&backend->rfds);
 	FD_ZERO(&backend->wfds);
-	backend->conns = hub_calloc(common->max, sizeof(struct net_connection_select*));
+	backend->conns = ptr_table_create(common->max);
 	backend->common = common;
 	net_backend_set_handlers(handler);
 	return (struct net_backend*) backend;
@@ -173,7 +173,7 @@ static void net_backend_set_handlers(struct net_backend_handler* handler)
 	handler->backend_poll = net_backend_poll_select;
 	handler->backend_process = net_backend_process_select;
 	handler->backend_shutdown = net_backend_shutdown_select;
-	handler->con_create = net_con_create_select;
+	handler->con_size = sizeof(struct net_connection_select);
 	handler->con_init = net_con_initialize_select;
 	handler->con_add = net_con_backend_add_select;
 	handler->con_mod = net_con_backend_mod_select;
@@ -61,6 +61,51 @@ extern int net_ssl_library_shutdown();
 extern struct ssl_context_handle* net_ssl_context_create(const char* tls_version, const char* tls_cipher_list, const char* tls_ciphersuites);
 extern void net_ssl_context_destroy(struct ssl_context_handle* ctx);
 
+/**
+ * Let the kernel encrypt and decrypt TLS records (kTLS) after the handshake,
+ * if the kernel supports it for the negotiated cipher.
+ * Return 0 if not supported by the TLS library, 1 otherwise.
+ */
+extern int net_ssl_context_set_ktls(struct ssl_context_handle* ctx, int enable);
+
+/**
+ * Keep up to 'size' sessions for 'timeout' seconds, so that clients
+ * reconnecting can resume them with an abbreviated handshake.
+ * A size of 0 disables the server side session cache.
+ */
+extern void net_ssl_context_set_session_cache(struct ssl_context_handle* ctx, size_t size, int timeout);
+
+/**
+ * Enable or disable stateless session tickets.
+ * Tickets are encrypted with keys owned by the hub, see net_ssl_context_rotate_ticket_key().
+ * Return 0 if no ticket key could be generated, 1 otherwise.
+ */
+extern int net_ssl_context_set_tickets(struct ssl_context_handle* ctx, int enable);
+
+/**
+ * Generate a new session ticket key. Tickets made with the previous key
+ * are still accepted (and renewed), older tickets are not.
+ * Return 0 on error, 1 otherwise.
+ */
+extern int net_ssl_context_rotate_ticket_key(struct ssl_context_handle* ctx);
+
+/**
+ * Copy the session ticket keys to or from a buffer, so that a new hub
+ * process (see hub_upgrade_start) accepts the tickets of the old one.
+ * net_ssl_context_get_ticket_keys() returns the number of bytes written.
+ * net_ssl_context_set_ticket_keys() returns 0 if the data is not valid, 1 otherwise.
+ */
+extern size_t net_ssl_context_get_ticket_keys(struct ssl_context_handle* ctx, void* buf, size_t size);
+extern int net_ssl_context_set_ticket_keys(struct ssl_context_handle* ctx, const void* buf, size_t size);
+
+/**
+ * Hand TLS clients asking for the server name 'name' (SNI) over to sni_ctx,
+ * instead of ctx. Clients asking for other names stay with ctx.
+ * Return 0 on error, 1 otherwise.
+ */
+extern int net_ssl_context_add_sni(struct ssl_context_handle* ctx, const char* name, struct ssl_context_handle* sni_ctx);
+extern void net_ssl_context_remove_sni(struct ssl_context_handle* ctx, struct ssl_context_handle* sni_ctx);
+
 /**
  * Return 0 on error, 1 otherwise.
  */
@@ -76,6 +121,9 @@ extern int ssl_load_private_key(struct ssl_context_handle* ctx, const char* pem_
  */
 extern int ssl_check_private_key(struct ssl_context_handle* ctx);
 
+/* Room for a keyprint: a SHA256 digest, base32 encoded */
+#define NET_SSL_KEYPRINT_SIZE 64
+
 /**
  * Prints the KEYP connect link for the server. Returns 1.
  */
@@ -114,6 +162,29 @@ extern int   net_con_is_ssl(struct net_connection* con);
 extern const char* net_ssl_get_tls_version(struct net_connection* con);
 extern const char* net_ssl_get_tls_cipher(struct net_connection* con);
 
+/**
+ * Return the context of a connection, which differs from the one given to
+ * net_con_ssl_handshake() if the client was handed over by server name.
+ * Returns NULL if that context has been destroyed since.
+ */
+extern struct ssl_context_handle* net_ssl_get_context(struct net_connection* con);
+
+/**
+ * Store the keyprint of the certificate the other end presented, as in
+ * the kp=SHA256/<keyprint> part of an adcs:// address.
+ * keyprint must hold NET_SSL_KEYPRINT_SIZE characters.
+ * Return 0 if there is no certificate, 1 otherwise.
+ */
+extern int net_ssl_get_peer_keyprint(struct net_connection* con, char* keyprint);
+
+#define NET_SSL_KTLS_SEND 0x01
+#define NET_SSL_KTLS_RECV 0x02
+
+/**
+ * Return which directions are offloaded to the kernel (NET_SSL_KTLS_*).
+ */
+extern int net_ssl_get_ktls(struct net_connection* con);
+
 #endif /* SSL_SUPPORT */
 #endif /* HAVE_UHUB_NETWORK_TLS_H */
 
@@ -54,6 +54,7 @@ typedef plugin_st (*on_change_nick_t)(struct plugin_handle*, struct plugin_user*
 typedef plugin_st (*on_chat_msg_t)(struct plugin_handle*, struct plugin_user* from, const char* message);
 typedef plugin_st (*on_private_msg_t)(struct plugin_handle*, struct plugin_user* from, struct plugin_user* to, const char* message);
 typedef plugin_st (*on_search_t)(struct plugin_handle*, struct plugin_user* from, const char* data);
+typedef plugin_st (*on_search_parsed_t)(struct plugin_handle*, struct plugin_user* from, const struct plugin_search* search);
 typedef plugin_st (*on_search_result_t)(struct plugin_handle*, struct plugin_user* from, struct plugin_user* to, const char* data);
 typedef plugin_st (*on_p2p_connect_t)(struct plugin_handle*, struct plugin_user* from, struct plugin_user* to);
 typedef plugin_st (*on_p2p_revconnect_t)(struct plugin_handle*, struct plugin_user* from, struct plugin_user* to);
@@ -63,6 +64,7 @@ typedef plugin_st (*auth_get_user_list_t)(struct plugin_handle*, const char* sea
 typedef plugin_st (*auth_register_user_t)(struct plugin_handle*, struct auth_info* user);
 typedef plugin_st (*auth_update_user_t)(struct plugin_handle*, struct auth_info* user);
 typedef plugin_st (*auth_delete_user_t)(struct plugin_handle*, struct auth_info* user);
+typedef plugin_st (*auth_get_user_async_t)(struct plugin_handle*, struct plugin_auth_request* request, const char* nickname);
 
 /**
  * These are callbacks used for the hub to invoke functions in plugins.
@@ -106,6 +108,15 @@ struct plugin_funcs
 	auth_update_user_t      auth_update_user;    /* Update a registered user */
 	auth_delete_user_t      auth_delete_user;    /* Delete a registered user */
 
+	/*
+	 * Get authentication info from plugin without blocking the hub (used at login).
+	 * Return st_pending and call hub.auth_request_complete() once the lookup is done,
+	 * possibly from another thread. Pending requests must be completed before
+	 * the plugin is unregistered.
+	 */
+	auth_get_user_async_t   auth_get_user_async;
+
+	on_search_parsed_t      on_search_parsed;    /* A search is about to be sent, pre-parsed by the hub (can be intercepted) */
 };
 
 struct plugin_command_handle;
@@ -132,6 +143,7 @@ typedef int (*hfunc_auth_get_user_list_t)(struct plugin_handle*, const char* sea
 typedef int (*hfunc_auth_register_user_t)(struct plugin_handle*, struct auth_info* user);
 typedef int (*hfunc_auth_update_user_t)(struct plugin_handle*, struct auth_info* user);
 typedef int (*hfunc_auth_delete_user_t)(struct plugin_handle*, struct auth_info* user);
+typedef void (*hfunc_auth_request_complete_t)(struct plugin_handle*, struct plugin_auth_request* request, plugin_st status, struct auth_info* info);
 
 typedef char* (*hfunc_get_hub_name)(struct plugin_handle*);
 typedef void  (*hfunc_set_hub_name)(struct plugin_handle*, const char*);
@@ -169,6 +181,7 @@ struct plugin_hub_funcs
 	hfunc_set_hub_description set_description;
 	hfunc_sid_to_string sid_to_string;
 	hfunc_ip_to_string ip_to_string;
+	hfunc_auth_request_complete_t auth_request_complete; /* Thread safe */
 };
 
 struct plugin_handle
@@ -20,7 +20,7 @@
 #ifndef HAVE_UHUB_PLUGIN_TYPES_H
 #define HAVE_UHUB_PLUGIN_TYPES_H
 
-#define PLUGIN_API_VERSION 1
+#define PLUGIN_API_VERSION 3
 
 #ifndef MAX_NICK_LEN
 #define MAX_NICK_LEN 64
@@ -48,6 +48,7 @@ typedef uint32_t sid_t;
 #endif
 
 struct plugin_handle;
+struct plugin_auth_request;
 
 struct plugin_user
 {
@@ -69,6 +70,7 @@ enum plugin_status
 	st_default = 0,    /* Use default */
 	st_allow = 1,      /* Allow action */
 	st_deny = -1,      /* Deny action */
+	st_pending = 2,    /* Action will be completed asynchronously */
 };
 
 typedef enum plugin_status plugin_st;
@@ -98,6 +100,42 @@ struct ban_info
 	time_t expiry;                      /* Time when the ban record expires */
 };
 
+enum search_flags
+{
+	search_size_min   = 0x01, /* size_min is defined (GE) */
+	search_size_max   = 0x02, /* size_max is defined (LE) */
+	search_size_exact = 0x04, /* size_exact is defined (EQ) */
+};
+
+enum search_type
+{
+	search_type_any       = 0, /* No TY given */
+	search_type_file      = 1, /* TY1 */
+	search_type_directory = 2, /* TY2 */
+};
+
+/*
+ * A search request (SCH) as parsed by the hub.
+ * All strings are unescaped and owned by the hub, and are only valid
+ * during the callback they are passed to.
+ */
+struct plugin_search
+{
+	const char* token;                  /* Search token (TO), or NULL. */
+	const char* tth;                    /* TTH root (TR), or NULL. */
+	const char** include;               /* Terms that must be matched (AN) */
+	size_t include_count;
+	const char** exclude;               /* Terms that must not be matched (NO) */
+	size_t exclude_count;
+	const char** extensions;            /* File extensions (EX) */
+	size_t extension_count;
+	unsigned int flags;                 /* See enum search_flags. */
+	uint64_t size_min;                  /* Minimum size (GE) */
+	uint64_t size_max;                  /* Maximum size (LE) */
+	uint64_t size_exact;                /* Exact size (EQ) */
+	enum search_type type;              /* File or directory (TY) */
+};
+
 
 
 #endif /* HAVE_UHUB_PLUGIN_TYPES_H */
@@ -20,6 +20,7 @@
 #include "plugin_api/handle.h"
 #include "util/memory.h"
 #include "util/list.h"
+#include "util/rbtree.h"
 #include "util/misc.h"
 #include "util/log.h"
 #include "util/config_token.h"
@@ -31,18 +32,31 @@ static void set_error_message(struct plugin_handle* plugin, const char* msg)
 
 struct acl_data
 {
-	struct linked_list* users;
+	struct rb_tree* users; /* nickname -> struct auth_info */
 	char* file;
 	int exclusive;
 };
 
-static void insert_user(struct linked_list* users, const char* nick, const char* pass, enum auth_credentials cred)
+static int compare_nick(const void* a, const void* b)
+{
+	return strcasecmp((const char*) a, (const char*) b);
+}
+
+static void free_user(struct rb_node* node)
+{
+	hub_free((void*) node->value);
+}
+
+static void insert_user(struct rb_tree* users, const char* nick, const char* pass, enum auth_credentials cred)
 {
 	struct auth_info* data = (struct auth_info*) hub_malloc_zero(sizeof(struct auth_info));
 	strlcpy(data->nickname, nick, MAX_NICK_LEN + 1);
 	strlcpy(data->password, pass, MAX_PASS_LEN + 1);
 	data->credentials = cred;
-	list_append(users, data);
+
+	// The first entry for a nickname wins
+	if (!rb_tree_insert(users, data->nickname, data))
+		hub_free(data);
 }
 
 static void free_acl(struct acl_data* data)
@@ -52,8 +66,9 @@ static void free_acl(struct acl_data* data)
 
 	if (data->users)
 	{
-		list_clear(data->users, hub_free);
-		list_destroy(data->users);
+		while (data->users->root)
+			rb_tree_remove_node(data->users, data->users->root->key, free_user);
+		rb_tree_destroy(data->users);
 	}
 
 	hub_free(data->file);
@@ -75,7 +90,7 @@ static struct acl_data* parse_config(const char* line, struct plugin_handle* plu
 
 	// set defaults
 	data->exclusive = 0;
-	data->users = list_create();
+	data->users = rb_tree_create(compare_nick, NULL, NULL);
 
 	while (token)
 	{
@@ -125,7 +140,7 @@ static struct acl_data* parse_config(const char* line, struct plugin_handle* plu
 
 static int parse_line(char* line, int line_count, void* ptr_data)
 {
-	struct linked_list* users = (struct linked_list*) ptr_data;
+	struct rb_tree* users = (struct rb_tree*) ptr_data;
 	struct cfg_tokens* tokens = cfg_tokenize(line);
 	enum auth_credentials cred;
 	char* credential;
@@ -195,15 +210,12 @@ static void unload_acl(struct acl_data* data)
 static plugin_st get_user(struct plugin_handle* plugin, const char* nickname, struct auth_info* data)
 {
 	struct acl_data* acl = (struct acl_data*) plugin->ptr;
-	struct auth_info* info;
-	LIST_FOREACH(struct auth_info*, info, acl->users,
+	struct auth_info* info = (struct auth_info*) rb_tree_get(acl->users, nickname);
+	if (info)
 	{
-		if (strcasecmp((char*)info->nickname, nickname) == 0)
-		{
-			memcpy(data, info, sizeof(struct auth_info));
-			return st_allow;
-		}
-	});
+		memcpy(data, info, sizeof(struct auth_info));
+		return st_allow;
+	}
 	if (acl->exclusive)
 		return st_deny;
 	return st_default;
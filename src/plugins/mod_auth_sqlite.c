@@ -25,6 +25,7 @@
 #include "util/misc.h"
 #include "util/log.h"
 #include "util/config_token.h"
+#include "util/threads.h"
 
 // #define DEBUG_SQL
 
@@ -40,6 +41,20 @@ struct auth_sqlite
 	int readonly; ///<<< "Do not modify the user database"
 	int update_activity; ///<<< "Update the user's activity timestamp when they log in"
 	char journal[16]; ///<<< "The SQLite journal mode to use"
+
+	// Login lookups are done by a worker thread, so the hub does not wait for the database.
+	// NOTE: jobs and shutdown must only be accessed with the mutex locked!
+	uhub_thread_t* worker;
+	uhub_mutex_t mutex;
+	uhub_cond_t cond;
+	struct linked_list* jobs;
+	int shutdown;
+};
+
+struct auth_sqlite_job
+{
+	struct plugin_auth_request* request;
+	char nickname[MAX_NICK_LEN+1];
 };
 
 /* Can't use PRINTF_ARG() since we use the sqlite3_printf() which allows %q */
@@ -424,6 +439,58 @@ static plugin_st get_user(struct plugin_handle* plugin, const char* nickname, st
 	return fail;
 }
 
+static void* lookup_worker(void* ptr)
+{
+	struct plugin_handle* plugin = (struct plugin_handle*) ptr;
+	struct auth_sqlite* pdata = (struct auth_sqlite*) plugin->ptr;
+	struct auth_sqlite_job* job;
+	struct auth_info info;
+	plugin_st status;
+
+	for (;;)
+	{
+		uhub_mutex_lock(&pdata->mutex);
+		while (!pdata->shutdown && !list_size(pdata->jobs))
+			uhub_cond_wait(&pdata->cond, &pdata->mutex);
+
+		// Finish all queued lookups before shutting down, the hub waits for them.
+		job = (struct auth_sqlite_job*) list_get_first(pdata->jobs);
+		if (job)
+			list_remove_first(pdata->jobs, NULL);
+		uhub_mutex_unlock(&pdata->mutex);
+
+		if (!job)
+			break;
+
+		status = get_user(plugin, job->nickname, &info);
+		plugin->hub.auth_request_complete(plugin, job->request, status, &info);
+		hub_free(job);
+	}
+	return NULL;
+}
+
+static plugin_st get_user_async(struct plugin_handle* plugin, struct plugin_auth_request* request, const char* nickname)
+{
+	struct auth_sqlite* pdata = (struct auth_sqlite*) plugin->ptr;
+	struct auth_sqlite_job* job = (struct auth_sqlite_job*) hub_malloc(sizeof(struct auth_sqlite_job));
+
+	if (!job)
+	{
+		LOG_ERROR("mod_auth_sqlite: OOM");
+		return (pdata->exclusive) ? st_deny : st_default;
+	}
+
+	job->request = request;
+	strlcpy(job->nickname, nickname, sizeof(job->nickname));
+
+	uhub_mutex_lock(&pdata->mutex);
+	list_append(pdata->jobs, job);
+	uhub_cond_signal(&pdata->cond);
+	uhub_mutex_unlock(&pdata->mutex);
+
+	return st_pending;
+}
+
 static plugin_st get_user_list(struct plugin_handle* plugin, const char* search, struct linked_list* users)
 {
 	struct auth_sqlite* pdata = (struct auth_sqlite*) plugin->ptr;
@@ -610,6 +677,18 @@ PLUGIN_API int plugin_register(struct plugin_handle* plugin, const char* config)
 
 	sqlite_setup(plugin);
 
+	pdata->jobs = list_create();
+	uhub_mutex_init(&pdata->mutex);
+	uhub_cond_init(&pdata->cond);
+	if (pdata->jobs)
+		pdata->worker = uhub_thread_create(lookup_worker, plugin);
+
+	// Fall back to doing the lookups in the hub's thread
+	if (pdata->worker)
+		plugin->funcs.auth_get_user_async = get_user_async;
+	else
+		LOG_WARN("mod_auth_sqlite: Unable to start worker thread, lookups will block the hub.");
+
 	return 0;
 }
 
@@ -620,6 +699,18 @@ PLUGIN_API int plugin_unregister(struct plugin_handle* plugin)
 
 	if (pdata)
 	{
+		if (pdata->worker)
+		{
+			uhub_mutex_lock(&pdata->mutex);
+			pdata->shutdown = 1;
+			uhub_cond_signal(&pdata->cond);
+			uhub_mutex_unlock(&pdata->mutex);
+			uhub_thread_join(pdata->worker);
+		}
+		list_destroy(pdata->jobs);
+		uhub_cond_destroy(&pdata->cond);
+		uhub_mutex_destroy(&pdata->mutex);
+
 		sqlite3_close(pdata->db);
 		hub_free(pdata);
 		plugin->ptr = NULL;
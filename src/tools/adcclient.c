@@ -61,6 +61,7 @@ enum ADC_client_flags
 	cflag_ssl = 1,
 	cflag_choke = 2,
 	cflag_pipe = 4,
+	cflag_paused = 8,
 };
 
 struct ADC_client_address
@@ -334,8 +335,16 @@ static int ADC_client_on_recv_line(struct ADC_client* client, const char* line,
 
 		case ADC_CMD_BSCH:
 		case ADC_CMD_FSCH:
-			client->callback(client, ADC_CLIENT_SEARCH_REQ, 0);
+		{
+			struct ADC_search_request search;
+			search.from_sid = msg->source;
+			EXTRACT_NAMED_ARG(msg, "TO", search.token);
+
+			data.search = &search;
+			client->callback(client, ADC_CLIENT_SEARCH_REQ, &data);
+			hub_free(search.token);
 			break;
+		}
 
 		case ADC_CMD_BINF:
 			if (msg->source == client->sid)
@@ -360,6 +369,17 @@ static int ADC_client_on_recv_line(struct ADC_client* client, const char* line,
 					data.user = &user;
 					client->callback(client, ADC_CLIENT_USER_JOIN, &data);
 				}
+				else
+				{
+					struct ADC_user user;
+					memset(&user, 0, sizeof(user));
+					user.sid = msg->source;
+					EXTRACT_NAMED_ARG_X(msg, "NI", user.name, sizeof(user.name));
+					EXTRACT_NAMED_ARG_X(msg, "DE", user.description, sizeof(user.description));
+
+					data.user = &user;
+					client->callback(client, ADC_CLIENT_USER_UPDATE, &data);
+				}
 			}
 		break;
 
@@ -468,6 +488,19 @@ static ssize_t ADC_client_recv(struct ADC_client* client)
 	return 0;
 }
 
+static void ADC_client_update_events(struct ADC_client* client)
+{
+	int events = 0;
+
+	if (!(client->flags & cflag_paused))
+		events |= NET_EVENT_READ;
+
+	if (ioq_send_get_bytes(client->send_queue))
+		events |= NET_EVENT_WRITE;
+
+	net_con_update(client->con, events);
+}
+
 static int ADC_client_send_queue(struct ADC_client* client)
 {
 	int ret = 0;
@@ -481,14 +514,7 @@ static int ADC_client_send_queue(struct ADC_client* client)
 	if (ret < 0)
 		return quit_socket_error;
 
-	if (ioq_send_get_bytes(client->send_queue))
-	{
-		net_con_update(client->con, NET_EVENT_READ | NET_EVENT_WRITE);
-	}
-	else
-	{
-		net_con_update(client->con, NET_EVENT_READ);
-	}
+	ADC_client_update_events(client);
 	return 0;
 }
 
@@ -510,10 +536,23 @@ void ADC_client_send(struct ADC_client* client, struct adc_message* msg)
 	{
 		ioq_send_add(client->send_queue, msg);
 		if (!(client->flags & cflag_pipe))
-			net_con_update(client->con, NET_EVENT_READ | NET_EVENT_WRITE);
+			ADC_client_update_events(client);
 	}
 }
 
+void ADC_client_pause(struct ADC_client* client, int paused)
+{
+	ADC_TRACE;
+
+	if (paused)
+		client->flags |= cflag_paused;
+	else
+		client->flags &= ~cflag_paused;
+
+	if (client->con && client->state == ps_normal)
+		ADC_client_update_events(client);
+}
+
 static void ADC_client_send_info(struct ADC_client* client)
 {
 	ADC_TRACE;
@@ -95,6 +95,12 @@ struct ADC_client_quit_reason
 	int flags;
 };
 
+struct ADC_search_request
+{
+	sid_t from_sid;
+	char* token;
+};
+
 struct ADC_client_tls_info
 {
 	const char* cipher;
@@ -109,6 +115,7 @@ struct ADC_client_callback_data
 		struct ADC_user* user;
 		struct ADC_client_quit_reason* quit;
 		struct ADC_client_tls_info* tls_info;
+		struct ADC_search_request* search;
 	};
 };
 
@@ -126,6 +133,9 @@ int ADC_client_connect(struct ADC_client* client, const char* address);
 void ADC_client_disconnect(struct ADC_client* client);
 void ADC_client_send(struct ADC_client* client, struct adc_message* msg);
 
+/* Stop (paused=1) or resume (paused=0) reading from the hub, used to simulate slow clients. */
+void ADC_client_pause(struct ADC_client* client, int paused);
+
 #endif /* HAVE_UHUB_ADC_CLIENT_H */
 
 
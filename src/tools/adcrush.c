@@ -19,35 +19,108 @@
 
 #include "adcclient.h"
 
+#include <sys/wait.h>
+
 #define ADC_CLIENTS_DEFAULT 100
-#define ADC_MAX_CLIENTS 25000
-#define ADC_CID_SIZE 39
-#define BIG_BUFSIZE 32768
-#define TIGERSIZE 24
+#define ADC_INTERVAL_DEFAULT 30000 /* ms */
+#define ADC_SLOW_PAUSE_DEFAULT 1000 /* ms */
+#define ADC_SLOW_READ 100 /* ms */
+#define ADC_MAX_WORKERS 64
+#define ADC_MAX_HUBS 32
 #define STATS_INTERVAL 3
-#define ADCRUSH "adcrush/0.3"
+#define ADCRUSH "adcrush/0.4"
 #define ADC_NICK "[BOT]adcrush"
 #define ADC_DESC "crash\\stest\\sdummy"
 
+/* Measured messages carry "adcrush:<type>:<microseconds>" */
+#define LATENCY_TAG "adcrush:"
+#define LATENCY_TAG_LEN 8
+
+/* Latency histogram: 2^LATENCY_SUB_BITS buckets per power of two (~3% resolution) */
+#define LATENCY_SUB_BITS 5
+#define LATENCY_BUCKETS (48 << LATENCY_SUB_BITS)
 
 #define LVL_INFO 1
 #define LVL_DEBUG 2
 #define LVL_VERBOSE 3
 
+enum adcrush_action
+{
+	action_chat = 0,   /* BMSG */
+	action_private,    /* DMSG */
+	action_search,     /* BSCH/FSCH */
+	action_update,     /* BINF */
+	action_connect,    /* DCTM */
+	action_reconnect,  /* Disconnect and log in again */
+	action_max
+};
+
+/* Actions up to (and including) action_update are timestamped and measured. */
+#define ACTION_MEASURED (action_update + 1)
+
+static const char* action_names[action_max] = { "chat", "private", "search", "update", "connect", "reconnect" };
+static const char action_tags[ACTION_MEASURED] = { 'c', 'p', 's', 'i' };
+
+struct adcrush_scenario
+{
+	int clients;          /* Number of simulated clients */
+	int workers;          /* Number of worker processes, each with its own event loop */
+	int join_rate;        /* Clients connecting per second, 0 = all at once */
+	int duration;         /* Seconds to run, 0 = until interrupted */
+	int interval;         /* Average milliseconds between the actions of a client */
+	int mix[action_max];  /* Relative weight of each action */
+	int tls;              /* Percentage of clients using TLS, -1 = use the address scheme */
+	int slow_readers;     /* Percentage of clients that rarely read from the hub */
+	int slow_pause;       /* Milliseconds a slow reader stops reading */
+	int drop;             /* Percentage of clients that disconnect at the same time */
+	int drop_at;          /* Seconds after the start when they disconnect */
+};
+
+struct latency_stats
+{
+	uint64_t received;
+	uint64_t sum;
+	uint64_t min;
+	uint64_t max;
+	uint64_t buckets[LATENCY_BUCKETS];
+};
+
+struct adcrush_stats
+{
+	uint64_t logged_in;
+	uint64_t dropped;
+	uint64_t quits;        /* Quit notifications received after the drop */
+	uint64_t quit_last_us; /* Time from the drop until the last quit notification */
+	uint64_t sent[action_max];
+	struct latency_stats latency[ACTION_MEASURED];
+};
+
+static struct adcrush_scenario cfg_scenario = {
+	ADC_CLIENTS_DEFAULT, 1, 0, 0, ADC_INTERVAL_DEFAULT,
+	{ 0, 1, 1, 1, 0, 1 },
+	-1, 0, ADC_SLOW_PAUSE_DEFAULT,
+	0, 0
+};
+
 static const char* cfg_uri = 0; /* address */
+static const char* cfg_report = 0; /* JSON report file, NULL = stdout */
 static int cfg_debug       = 0; /* debug level */
-static int cfg_level       = 1; /* activity level (0..3) */
-static int cfg_chat        = 0; /* chat mode, allow sending chat messages */
 static int cfg_quiet       = 0; /* quiet mode (no output) */
-static int cfg_clients     = ADC_CLIENTS_DEFAULT; /* number of clients */
 static int cfg_netstats_interval = STATS_INTERVAL;
-static int running         = 1;
+static volatile int running = 1;
 static int blank           = 0;
+static char uri_plain[ADC_MAX_HUBS][256];
+static char uri_tls[ADC_MAX_HUBS][256];
+static int uri_count = 0;
 static struct net_statistics* stats_intermediate;
 static struct net_statistics* stats_total;
+static struct adcrush_stats g_stats;
+static struct timeout_queue g_actions; /* Client actions, in milliseconds */
+static uint64_t g_drop_time;           /* When clients were dropped, in microseconds */
 
 static int handle(struct ADC_client* client, enum ADC_client_callback_type type, struct ADC_client_callback_data* data);
 static void timer_callback(struct timeout_evt* t);
+static void reader_callback(struct timeout_evt* t);
 
 static void do_blank(int n)
 {
@@ -62,10 +135,19 @@ static void do_blank(int n)
 struct AdcFuzzUser
 {
 	struct ADC_client* client;
-	struct timeout_evt* timer;
+	struct timeout_evt timer;
+	struct timeout_evt reader;
 	int logged_in;
+	int tls;
+	int slow;
+	int paused;
+	int drop;
+	int hub;              /* Index of the address to connect to */
 };
 
+static struct AdcFuzzUser* g_clients;
+static size_t g_num_clients;
+
 #define MAX_CHAT_MSGS 35
 const char* chat_messages[MAX_CHAT_MSGS] = {
 	"hello",
@@ -107,16 +189,16 @@ const char* chat_messages[MAX_CHAT_MSGS] = {
 
 #define MAX_SEARCH_MSGS 10
 const char* search_messages[MAX_SEARCH_MSGS] = {
-	"ANmp3 TOauto",
-	"ANxxx TOauto",
-	"ANdivx TOauto",
-	"ANtest ANfoo TOauto",
-	"ANwmv TO1289718",
-	"ANbabe TO8981884",
-	"ANpr0n TOauto",
-	"ANmusic TOauto",
-	"ANvideo TOauto",
-	"ANburnout ANps3 TOauto",
+	"ANmp3",
+	"ANxxx",
+	"ANdivx",
+	"ANtest ANfoo",
+	"ANwmv",
+	"ANbabe",
+	"ANpr0n",
+	"ANmusic",
+	"ANvideo",
+	"ANburnout ANps3",
 };
 
 
@@ -138,79 +220,203 @@ static void bot_output(struct ADC_client* client, int level, const char* format,
 }
 
 
+static size_t rand_next = 0;
+
 static size_t get_wait_rand(size_t max)
 {
-	static size_t next = 0;
-	if (next == 0) next = (size_t) time(0);
-	next = (next * 1103515245) + 12345;
-	return ((size_t )(next / 65536) % max);
+	if (rand_next == 0) rand_next = (size_t) time(0);
+	rand_next = (rand_next * 1103515245) + 12345;
+	return ((size_t )(rand_next / 65536) % max);
+}
+
+/* Monotonic clock, comparable between the worker processes. */
+static uint64_t get_time_us()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t) ts.tv_sec * 1000000) + ((uint64_t) ts.tv_nsec / 1000);
+}
+
+static time_t get_time_ms()
+{
+	return (time_t) (get_time_us() / 1000);
+}
+
+/* Schedule an action, the queue wraps around so the delay must stay below its size. */
+static void schedule(struct timeout_evt* evt, size_t ms)
+{
+	timeout_queue_reschedule(&g_actions, evt, MIN(ms, g_actions.max - 1));
+}
+
+static void unschedule(struct timeout_evt* evt)
+{
+	if (timeout_evt_is_scheduled(evt))
+		timeout_queue_remove(&g_actions, evt);
 }
 
 static size_t get_next_timeout_evt()
 {
-	switch (cfg_level)
+	return get_wait_rand((size_t) cfg_scenario.interval * 2 + 1);
+}
+
+
+static size_t latency_bucket(uint64_t us)
+{
+	size_t shift = 0;
+
+	if (us < (2 << LATENCY_SUB_BITS))
+		return (size_t) us;
+
+	while ((us >> shift) >= (2 << LATENCY_SUB_BITS))
+		shift++;
+
+	return MIN(((shift + 1) << LATENCY_SUB_BITS) + (size_t) ((us >> shift) - (1 << LATENCY_SUB_BITS)), LATENCY_BUCKETS - 1);
+}
+
+/* Lowest value in a histogram bucket */
+static uint64_t latency_bucket_value(size_t bucket)
+{
+	size_t shift;
+
+	if (bucket < (2 << LATENCY_SUB_BITS))
+		return bucket;
+
+	shift = (bucket >> LATENCY_SUB_BITS) - 1;
+	return ((uint64_t) ((bucket & ((1 << LATENCY_SUB_BITS) - 1)) + (1 << LATENCY_SUB_BITS))) << shift;
+}
+
+static void latency_add(struct latency_stats* stats, uint64_t us)
+{
+	if (!stats->received || us < stats->min)
+		stats->min = us;
+	if (us > stats->max)
+		stats->max = us;
+	stats->received++;
+	stats->sum += us;
+	stats->buckets[latency_bucket(us)]++;
+}
+
+static void latency_merge(struct latency_stats* target, const struct latency_stats* source)
+{
+	size_t n;
+
+	if (!source->received)
+		return;
+
+	if (!target->received || source->min < target->min)
+		target->min = source->min;
+	if (source->max > target->max)
+		target->max = source->max;
+	target->received += source->received;
+	target->sum += source->sum;
+	for (n = 0; n < LATENCY_BUCKETS; n++)
+		target->buckets[n] += source->buckets[n];
+}
+
+/* Latency at the given per mille, as the middle of the histogram bucket it falls in. */
+static uint64_t latency_percentile(const struct latency_stats* stats, uint64_t per_mille)
+{
+	uint64_t rank = MAX((stats->received * per_mille + 999) / 1000, 1);
+	uint64_t seen = 0;
+	uint64_t low, high;
+	size_t n;
+
+	for (n = 0; n < LATENCY_BUCKETS; n++)
+	{
+		seen += stats->buckets[n];
+		if (seen >= rank)
+		{
+			low = latency_bucket_value(n);
+			high = (n + 1 < LATENCY_BUCKETS) ? latency_bucket_value(n + 1) : low + 1;
+			return MIN(MAX(low + ((high - low) / 2), stats->min), stats->max);
+		}
+	}
+	return stats->max;
+}
+
+/* Record the delivery latency if the text carries an adcrush timestamp */
+static void latency_record(const char* text)
+{
+	uint64_t now = get_time_us();
+	uint64_t sent;
+	size_t type;
+
+	if (!text || strncmp(text, LATENCY_TAG, LATENCY_TAG_LEN) || !text[LATENCY_TAG_LEN] || text[LATENCY_TAG_LEN + 1] != ':')
+		return;
+
+	for (type = 0; type < ACTION_MEASURED; type++)
 	{
-		case 0: return get_wait_rand(120);
-		case 1: return get_wait_rand(60);
-		case 2: return get_wait_rand(15);
-		case 3: return get_wait_rand(5);
+		if (action_tags[type] == text[LATENCY_TAG_LEN])
+		{
+			sent = strtoull(text + LATENCY_TAG_LEN + 2, NULL, 10);
+			latency_add(&g_stats.latency[type], now > sent ? now - sent : 0);
+			return;
+		}
 	}
-	return 0;
+}
+
+static void format_tag(char* buf, size_t size, enum adcrush_action type)
+{
+	snprintf(buf, size, LATENCY_TAG "%c:%" PRIu64, action_tags[type], get_time_us());
 }
 
 
+/* A random logged in client of this worker, to send private messages to. */
+static sid_t get_random_peer(struct ADC_client* client)
+{
+	struct AdcFuzzUser* peer = &g_clients[get_wait_rand(g_num_clients)];
+	if (peer->logged_in)
+		return ADC_client_get_sid(peer->client);
+	return ADC_client_get_sid(client);
+}
+
 static void perf_chat(struct ADC_client* client, int priv)
 {
-	size_t r = get_wait_rand(MAX_CHAT_MSGS-1);
-	char* msg = adc_msg_escape(chat_messages[r]);
+	char tag[64];
+	char buf[256];
+	size_t r = get_wait_rand(MAX_CHAT_MSGS);
+	char* msg;
 	struct adc_message* cmd = NULL;
 
+	format_tag(tag, sizeof(tag), priv ? action_private : action_chat);
+	snprintf(buf, sizeof(buf), "%s %s", tag, chat_messages[r]);
+	msg = adc_msg_escape(buf);
+
 	if (priv)
-		cmd = adc_msg_construct_source_dest(ADC_CMD_DMSG, ADC_client_get_sid(client), ADC_client_get_sid(client), strlen(msg));
+		cmd = adc_msg_construct_source_dest(ADC_CMD_DMSG, ADC_client_get_sid(client), get_random_peer(client), strlen(msg));
 	else
 		cmd = adc_msg_construct_source(ADC_CMD_BMSG, ADC_client_get_sid(client), strlen(msg));
+	adc_msg_add_argument(cmd, msg);
 	hub_free(msg);
 
 	ADC_client_send(client, cmd);
+	adc_msg_free(cmd);
 }
 
 static void perf_search(struct ADC_client* client)
 {
-	size_t r = get_wait_rand(MAX_SEARCH_MSGS-1);
+	char tag[64];
+	size_t r = get_wait_rand(MAX_SEARCH_MSGS);
 	size_t pst = get_wait_rand(100);
 	struct adc_message* cmd = NULL;
 
+	format_tag(tag, sizeof(tag), action_search);
+
 	if (pst > 80)
 	{
-		cmd = adc_msg_construct_source(ADC_CMD_FSCH, ADC_client_get_sid(client), strlen(search_messages[r]) + 6);
+		cmd = adc_msg_construct_source(ADC_CMD_FSCH, ADC_client_get_sid(client), strlen(search_messages[r]) + strlen(tag) + 10);
 		adc_msg_add_argument(cmd, "+TCP4");
 	}
 	else
 	{
-		cmd = adc_msg_construct_source(ADC_CMD_BSCH, ADC_client_get_sid(client), strlen(search_messages[r]) + 6);
-		adc_msg_add_argument(cmd, "+TCP4");
+		cmd = adc_msg_construct_source(ADC_CMD_BSCH, ADC_client_get_sid(client), strlen(search_messages[r]) + strlen(tag) + 4);
 	}
-	ADC_client_send(client, cmd);
-}
-
-#if 0
-static void perf_result(struct ADC_client* client, sid_t target, const char* what, const char* token)
-{
-	char tmp[256];
-	struct adc_message* cmd = adc_msg_construct_source_dest(ADC_CMD_DRES, ADC_client_get_sid(client), target, strlen(what) + strlen(token) + 64);
-
-	snprintf(tmp, sizeof(tmp), "FNtest/%s.dat", what);
-	adc_msg_add_argument(cmd, tmp);
-
-	adc_msg_add_argument(cmd, "SL0");
-	adc_msg_add_argument(cmd, "SI1209818412");
-	adc_msg_add_argument(cmd, "TR5T6YJYKO3WECS52BKWVSOP5VUG4IKNSZBZ5YHBA");
-	snprintf(tmp, sizeof(tmp), "TO%s", token);
-	adc_msg_add_argument(cmd, tmp);
+	adc_msg_add_argument(cmd, search_messages[r]);
+	adc_msg_add_named_argument(cmd, "TO", tag);
 
 	ADC_client_send(client, cmd);
+	adc_msg_free(cmd);
 }
-#endif
 
 static void perf_ctm(struct ADC_client* client)
 {
@@ -219,17 +425,22 @@ static void perf_ctm(struct ADC_client* client)
 	adc_msg_add_argument(cmd, "TOKEN123456");
 	adc_msg_add_argument(cmd, sid_to_string(ADC_client_get_sid(client)));
 	ADC_client_send(client, cmd);
+	adc_msg_free(cmd);
 }
 
 
 static void perf_update(struct ADC_client* client)
 {
+	char tag[64];
 	char buf[16] = { 0, };
 	int n = (int) get_wait_rand(10)+1;
-	struct adc_message* cmd = adc_msg_construct_source(ADC_CMD_BINF, ADC_client_get_sid(client), 32);
+	struct adc_message* cmd = adc_msg_construct_source(ADC_CMD_BINF, ADC_client_get_sid(client), 96);
 	snprintf(buf, sizeof(buf), "HN%d", n);
 	adc_msg_add_argument(cmd, buf);
+	format_tag(tag, sizeof(tag), action_update);
+	adc_msg_add_named_argument(cmd, ADC_INF_FLAG_DESCRIPTION, tag);
 	ADC_client_send(client, cmd);
+	adc_msg_free(cmd);
 }
 
 static void client_disconnect(struct AdcFuzzUser* c)
@@ -237,11 +448,11 @@ static void client_disconnect(struct AdcFuzzUser* c)
 		ADC_client_destroy(c->client);
 		c->client = 0;
 
-		timeout_queue_remove(net_backend_get_timeout_queue(), c->timer);
-		hub_free(c->timer);
-		c->timer = 0;
+		unschedule(&c->timer);
+		unschedule(&c->reader);
 
 		c->logged_in = 0;
+		c->paused = 0;
 }
 
 static void client_connect(struct AdcFuzzUser* c, const char* nick, const char* description)
@@ -250,73 +461,88 @@ static void client_connect(struct AdcFuzzUser* c, const char* nick, const char*
 	struct ADC_client* client = ADC_client_create(nick, description, c);
 
 	c->client = client;
-	c->timer = (struct timeout_evt*) hub_malloc(sizeof(struct timeout_evt));
-	timeout_evt_initialize(c->timer, timer_callback, c);
-	timeout_queue_insert(net_backend_get_timeout_queue(), c->timer, timeout);
+	timeout_evt_initialize(&c->timer, timer_callback, c);
+	timeout_evt_initialize(&c->reader, reader_callback, c);
+	schedule(&c->timer, timeout);
 
-	bot_output(client, LVL_VERBOSE, "Initial timeout: %" PRIsz " seconds", timeout);
+	bot_output(client, LVL_VERBOSE, "Initial timeout: %" PRIsz " ms", timeout);
 	c->logged_in = 0;
+	c->paused = 0;
 
 	ADC_client_set_callback(client, handle);
-	ADC_client_connect(client, cfg_uri);
+	ADC_client_connect(client, c->tls ? uri_tls[c->hub] : uri_plain[c->hub]);
+}
+
+static enum adcrush_action get_random_action()
+{
+	int total = 0;
+	int r;
+	size_t n;
+
+	for (n = 0; n < action_max; n++)
+		total += cfg_scenario.mix[n];
+
+	if (!total)
+		return action_max;
+
+	r = (int) get_wait_rand((size_t) total);
+	for (n = 0; n < action_max; n++)
+	{
+		r -= cfg_scenario.mix[n];
+		if (r < 0)
+			break;
+	}
+	return (enum adcrush_action) n;
 }
 
 static void perf_normal_action(struct ADC_client* client)
 {
 	struct AdcFuzzUser* user = (struct AdcFuzzUser*) ADC_client_get_ptr(client);
-	size_t r = get_wait_rand(5);
-	// size_t p = get_wait_rand(100);
+	enum adcrush_action action = get_random_action();
+
+	if (action == action_max)
+		return;
+
+	bot_output(client, LVL_VERBOSE, "timeout -> %s", action_names[action]);
+	g_stats.sent[action]++;
 
-	switch (r)
+	switch (action)
 	{
-		case 0:
-			// if (p > (90 - (10 * cfg_level)))
-			{
-				char* nick = hub_strdup(ADC_client_get_nick(client));
-				char* desc = hub_strdup(ADC_client_get_description(client));
+		case action_reconnect:
+		{
+			char* nick = hub_strdup(ADC_client_get_nick(client));
+			char* desc = hub_strdup(ADC_client_get_description(client));
 
-				bot_output(client, LVL_VERBOSE, "timeout -> disconnect");
-				client_disconnect(user);
-				client_connect(user, nick, desc);
+			client_disconnect(user);
+			client_connect(user, nick, desc);
 
-				hub_free(nick);
-				hub_free(desc);
-			}
+			hub_free(nick);
+			hub_free(desc);
 			break;
+		}
 
-		case 1:
-			if (cfg_chat)
-			{
-				bot_output(client, LVL_VERBOSE, "timeout -> chat");
-				if (user->logged_in)
-					perf_chat(client, 0);
-			}
+		case action_chat:
+			perf_chat(client, 0);
 			break;
 
-		case 2:
-			bot_output(client, LVL_VERBOSE, "timeout -> search");
-			if (user->logged_in)
-				perf_search(client);
+		case action_private:
+			perf_chat(client, 1);
 			break;
 
-		case 3:
-			bot_output(client, LVL_VERBOSE, "timeout -> update");
-			if (user->logged_in)
-				perf_update(client);
+		case action_search:
+			perf_search(client);
 			break;
 
-		case 4:
-			bot_output(client, LVL_VERBOSE, "timeout -> privmsg");
-			if (user->logged_in)
-				perf_chat(client, 1);
+		case action_update:
+			perf_update(client);
 			break;
 
-		case 5:
-			bot_output(client, LVL_VERBOSE, "timeout -> ctm/rcm");
-			if (user->logged_in)
-				perf_ctm(client);
+		case action_connect:
+			perf_ctm(client);
 			break;
 
+		case action_max:
+			break;
 	}
 }
 
@@ -336,6 +562,7 @@ static int handle(struct ADC_client* client, enum ADC_client_callback_type type,
 
 		case ADC_CLIENT_DISCONNECTED:
 			bot_output(client, LVL_DEBUG, "*** Disconnected.");
+			user->logged_in = 0;
 			break;
 
 		case ADC_CLIENT_LOGGING_IN:
@@ -349,6 +576,8 @@ static int handle(struct ADC_client* client, enum ADC_client_callback_type type,
 		case ADC_CLIENT_LOGGED_IN:
 			bot_output(client, LVL_DEBUG, "*** Logged in.");
 			user->logged_in = 1;
+			if (user->slow)
+				schedule(&user->reader, ADC_SLOW_READ);
 			break;
 
 		case ADC_CLIENT_LOGIN_ERROR:
@@ -361,15 +590,26 @@ static int handle(struct ADC_client* client, enum ADC_client_callback_type type,
 
 		case ADC_CLIENT_MESSAGE:
 // 			bot_output(client, LVL_DEBUG, "    <%s> %s", sid_to_string(data->chat->from_sid), data->chat->message);
+			latency_record(data->chat->message);
 			break;
 
 		case ADC_CLIENT_USER_JOIN:
 			break;
 
+		case ADC_CLIENT_USER_UPDATE:
+			latency_record(data->user->description);
+			break;
+
 		case ADC_CLIENT_USER_QUIT:
+			if (g_drop_time)
+			{
+				g_stats.quits++;
+				g_stats.quit_last_us = MAX(g_stats.quit_last_us, get_time_us() - g_drop_time);
+			}
 			break;
 
 		case ADC_CLIENT_SEARCH_REQ:
+			latency_record(data->search->token);
 			break;
 
 		case ADC_CLIENT_HUB_INFO:
@@ -389,23 +629,37 @@ static void timer_callback(struct timeout_evt* t)
 	if (client->logged_in)
 	{
 		perf_normal_action(client->client);
-		bot_output(client->client, LVL_VERBOSE, "Next timeout: %d seconds", (int) timeout);
+		bot_output(client->client, LVL_VERBOSE, "Next timeout: %d ms", (int) timeout);
 	}
-	timeout_queue_reschedule(net_backend_get_timeout_queue(), client->timer, timeout);
+	/* The client may have been reconnected, which schedules a new timer. */
+	if (!timeout_evt_is_scheduled(&client->timer))
+		schedule(&client->timer, timeout);
 }
 
-static struct AdcFuzzUser client[ADC_MAX_CLIENTS];
-void p_status()
+/* Slow readers alternate between reading for a short while and not reading at all. */
+static void reader_callback(struct timeout_evt* t)
+{
+	struct AdcFuzzUser* client = (struct AdcFuzzUser*) t->ptr;
+
+	if (!client->logged_in)
+		return;
+
+	client->paused = !client->paused;
+	ADC_client_pause(client->client, client->paused);
+	schedule(&client->reader, client->paused ? (size_t) cfg_scenario.slow_pause : ADC_SLOW_READ);
+}
+
+static void p_status()
 {
 	static char rxbuf[64] = { "0 B" };
 	static char txbuf[64] = { "0 B" };
 	int logged_in = 0;
-	int n;
+	size_t n;
 	static size_t rx = 0, tx = 0;
 
-	for (n = 0; n < cfg_clients; n++)
+	for (n = 0; n < g_num_clients; n++)
 	{
-		if (client[n].logged_in)
+		if (g_clients[n].logged_in)
 			logged_in++;
 	}
 
@@ -420,34 +674,311 @@ void p_status()
 	}
 
 	n = blank;
-	blank = printf("Connected bots: %d/%d, network: rx=%s/s, tx=%s/s", logged_in, (int) cfg_clients, rxbuf, txbuf);
-	if (n > blank)
-		do_blank(n - blank);
+	blank = printf("Connected bots: %d/%d, network: rx=%s/s, tx=%s/s", logged_in, (int) g_num_clients, rxbuf, txbuf);
+	if ((int) n > blank)
+		do_blank((int) n - blank);
 	printf("\r");
 }
 
-void runloop(size_t clients)
+/* Disconnect the selected clients all at once, and keep them away. */
+static void client_drop()
 {
-	size_t n = 0;
+	size_t n;
+
+	g_drop_time = get_time_us();
+	for (n = 0; n < g_num_clients; n++)
+	{
+		struct AdcFuzzUser* c = &g_clients[n];
+		if (c->drop && c->client)
+		{
+			client_disconnect(c);
+			g_stats.dropped++;
+		}
+	}
+}
+
+/*
+ * Run clients [first, first + count) in this process until the scenario
+ * is over or we are interrupted.
+ */
+static void runloop(size_t first, size_t count, int status)
+{
+	struct adcrush_scenario* sc = &cfg_scenario;
+	time_t start = get_time_ms();
+	time_t now = start;
+	size_t joined = 0;
+	int dropped = 0;
+	size_t target;
+	size_t n;
+	int wait;
+
 	blank = 0;
+	g_num_clients = count;
+	g_clients = hub_malloc_zero(sizeof(struct AdcFuzzUser) * count);
+	timeout_queue_initialize(&g_actions, now, (size_t) MAX(MAX(sc->interval * 2, sc->slow_pause), ADC_SLOW_READ) + 1000);
+
+	for (n = 0; n < count; n++)
+	{
+		/* Spread TLS and slow clients evenly over the whole range */
+		g_clients[n].tls = (((first + n) * 37) % 100) < (size_t) sc->tls;
+		g_clients[n].slow = (((first + n) * 61) % 100) < (size_t) sc->slow_readers;
+		g_clients[n].drop = (((first + n) * 53) % 100) < (size_t) sc->drop;
+		g_clients[n].hub = (int) ((first + n) % uri_count);
+	}
+
+	while (running)
+	{
+		now = get_time_ms();
+
+		if (sc->join_rate)
+			target = MIN(count, (size_t) (((uint64_t) (now - start) * sc->join_rate * count) / ((uint64_t) sc->clients * 1000)) + 1);
+		else
+			target = count;
+
+		for (; joined < target; joined++)
+		{
+			char nick[20];
+			snprintf(nick, 20, "adcrush_%d", (int) (first + joined));
+			client_connect(&g_clients[joined], nick, "stresstester");
+		}
+
+		timeout_queue_process(&g_actions, now);
+
+		if (sc->drop && !dropped && now - start >= (time_t) sc->drop_at * 1000)
+		{
+			client_drop();
+			dropped = 1;
+		}
+
+		if (sc->duration && now - start >= (time_t) sc->duration * 1000)
+			break;
+
+		wait = (int) MIN(timeout_queue_get_next_timeout(&g_actions, now), 1000);
+		if (joined < count)
+			wait = 1;
+
+		if (!net_backend_process_timeout(wait))
+			break;
+
+		if (status)
+			p_status();
+	}
+
+	for (n = 0; n < count; n++)
+	{
+		if (g_clients[n].logged_in)
+			g_stats.logged_in++;
+	}
+
+	for (n = 0; n < joined; n++)
+	{
+		struct AdcFuzzUser* c = &g_clients[n];
+		if (c->client)
+			client_disconnect(c);
+	}
+
+	timeout_queue_shutdown(&g_actions);
+	hub_free(g_clients);
+	g_clients = 0;
+	g_num_clients = 0;
+	g_drop_time = 0;
+}
+
+static void run_worker(size_t first, size_t count, int status)
+{
+	net_initialize();
+	net_stats_get(&stats_intermediate, &stats_total);
+	runloop(first, count, status);
+	net_destroy();
+}
 
-	for (n = 0; n < clients; n++)
+static void stats_merge(struct adcrush_stats* target, const struct adcrush_stats* source)
+{
+	size_t n;
+
+	target->logged_in += source->logged_in;
+	target->dropped += source->dropped;
+	target->quits += source->quits;
+	target->quit_last_us = MAX(target->quit_last_us, source->quit_last_us);
+	for (n = 0; n < action_max; n++)
+		target->sent[n] += source->sent[n];
+	for (n = 0; n < ACTION_MEASURED; n++)
+		latency_merge(&target->latency[n], &source->latency[n]);
+}
+
+/* Fork one process per worker and collect their statistics through a pipe. */
+static int run_workers(struct adcrush_stats* total)
+{
+	struct adcrush_stats stats;
+	int fds[ADC_MAX_WORKERS];
+	int workers = cfg_scenario.workers;
+	size_t first = 0;
+	size_t count;
+	int w;
+
+	for (w = 0; w < workers; w++)
 	{
-		char nick[20];
-		snprintf(nick, 20, "adcrush_%d", (int) n);
-		client_connect(&client[n], nick, "stresstester");
+		int pipefd[2];
+		pid_t pid;
+
+		count = ((size_t) cfg_scenario.clients * (w + 1) / workers) - first;
+
+		if (pipe(pipefd) == -1)
+		{
+			LOG_ERROR("Unable to create pipe: %s", strerror(errno));
+			return 0;
+		}
+
+		pid = fork();
+		if (pid == -1)
+		{
+			LOG_ERROR("Unable to start worker: %s", strerror(errno));
+			return 0;
+		}
+
+		if (pid == 0)
+		{
+			char* ptr = (char*) &g_stats;
+			size_t left = sizeof(g_stats);
+			ssize_t ret;
+
+			close(pipefd[0]);
+			rand_next = (size_t) time(0) + (size_t) w;
+			run_worker(first, count, 0);
+
+			while (left)
+			{
+				ret = write(pipefd[1], ptr, left);
+				if (ret == -1 && errno == EINTR)
+					continue;
+				if (ret <= 0)
+					break;
+				ptr += ret;
+				left -= (size_t) ret;
+			}
+			_exit(left ? 1 : 0);
+		}
+
+		close(pipefd[1]);
+		fds[w] = pipefd[0];
+		first += count;
 	}
 
-	while (running && net_backend_process())
+	for (w = 0; w < workers; w++)
 	{
-		p_status();
+		char* ptr = (char*) &stats;
+		size_t left = sizeof(stats);
+		ssize_t ret;
+
+		while (left)
+		{
+			ret = read(fds[w], ptr, left);
+			if (ret == -1 && errno == EINTR)
+				continue;
+			if (ret <= 0)
+				break;
+			ptr += ret;
+			left -= (size_t) ret;
+		}
+		close(fds[w]);
+
+		if (left)
+			LOG_ERROR("Worker %d did not report statistics", w);
+		else
+			stats_merge(total, &stats);
 	}
 
-	for (n = 0; n < clients; n++)
+	while (wait(NULL) > 0 || errno == EINTR)
+		;
+	return 1;
+}
+
+static void report_json(FILE* out, const struct adcrush_stats* stats, time_t elapsed)
+{
+	size_t n;
+
+	fprintf(out, "{\n");
+	fprintf(out, "\t\"version\": \"%s\",\n", ADCRUSH);
+	fprintf(out, "\t\"clients\": %d,\n", cfg_scenario.clients);
+	fprintf(out, "\t\"workers\": %d,\n", cfg_scenario.workers);
+	fprintf(out, "\t\"logged_in\": %" PRIu64 ",\n", stats->logged_in);
+	fprintf(out, "\t\"elapsed_ms\": %" PRIu64 ",\n", (uint64_t) elapsed);
+
+	if (cfg_scenario.drop)
+	{
+		fprintf(out, "\t\"drop\": { \"dropped\": %" PRIu64 ", \"quits\": %" PRIu64 ", \"last_quit_ms\": %" PRIu64 " },\n",
+			stats->dropped, stats->quits, stats->quit_last_us / 1000);
+	}
+
+	fprintf(out, "\t\"sent\": {");
+	for (n = 0; n < action_max; n++)
+		fprintf(out, "%s \"%s\": %" PRIu64, n ? "," : "", action_names[n], stats->sent[n]);
+	fprintf(out, " },\n");
+
+	fprintf(out, "\t\"latency_us\": {\n");
+	for (n = 0; n < ACTION_MEASURED; n++)
+	{
+		const struct latency_stats* lat = &stats->latency[n];
+		fprintf(out, "\t\t\"%s\": { \"received\": %" PRIu64, action_names[n], lat->received);
+		if (lat->received)
+		{
+			fprintf(out, ", \"min\": %" PRIu64 ", \"mean\": %" PRIu64 ", \"p50\": %" PRIu64 ", \"p99\": %" PRIu64 ", \"p999\": %" PRIu64 ", \"max\": %" PRIu64,
+				lat->min, lat->sum / lat->received,
+				latency_percentile(lat, 500), latency_percentile(lat, 990), latency_percentile(lat, 999),
+				lat->max);
+		}
+		fprintf(out, " }%s\n", (n + 1 < ACTION_MEASURED) ? "," : "");
+	}
+	fprintf(out, "\t}\n");
+	fprintf(out, "}\n");
+}
+
+static int report(const struct adcrush_stats* stats, time_t elapsed)
+{
+	FILE* out = stdout;
+
+	if (cfg_report)
+	{
+		out = fopen(cfg_report, "w");
+		if (!out)
+		{
+			fprintf(stderr, "Unable to write report to %s: %s\n", cfg_report, strerror(errno));
+			return 0;
+		}
+	}
+	else if (cfg_quiet)
 	{
-		struct AdcFuzzUser* c = &client[n];
-		client_disconnect(c);
+		return 1;
 	}
+	else
+	{
+		printf("\n");
+	}
+
+	report_json(out, stats, elapsed);
+
+	if (out != stdout)
+		fclose(out);
+	return 1;
+}
+
+static void adcrush_handle_signal(int sig)
+{
+	running = 0;
+}
+
+static void setup_signal_handlers()
+{
+	struct sigaction act;
+
+	memset(&act, 0, sizeof(act));
+	sigemptyset(&act.sa_mask);
+	act.sa_handler = adcrush_handle_signal;
+	sigaction(SIGINT, &act, 0);
+	sigaction(SIGTERM, &act, 0);
+
+	act.sa_handler = SIG_IGN;
+	sigaction(SIGPIPE, &act, 0);
 }
 
 NO_RETURN static void print_usage(const char* program)
@@ -456,7 +987,9 @@ NO_RETURN static void print_usage(const char* program)
 	printf("Copyright (C) 2008-2012, Jan Vidar Krey\n");
 	printf("\n");
 
-	printf("Usage: %s [adc[s]://<host>:<port>] [options]\n", program);
+	printf("Usage: %s [adc[s]://<host>:<port>[,adc[s]://<host>:<port>...]] [options]\n", program);
+	printf("\n");
+	printf("  Clients are spread evenly across several addresses, such as linked hubs.\n");
 
 	printf("\n");
 	printf("  OPTIONS\n");
@@ -466,17 +999,102 @@ NO_RETURN static void print_usage(const char* program)
 	printf("    -d          Enable debug output.\n");
 	printf("    -q          Quiet mode (no output).\n");
 	printf("    -i <num>    Average network statistics for given interval (default: 3)\n");
+	printf("    -s <file>   Read a scenario file (see doc/adcrush.conf).\n");
+	printf("    -w <num>    Number of worker processes (default: 1)\n");
+	printf("    -t <secs>   Stop after the given number of seconds.\n");
+	printf("    -j <file>   Write the JSON latency report to a file instead of stdout.\n");
 	printf("\n");
 
 	exit(0);
 }
 
-int parse_address(const char* arg)
+static int* scenario_get_setting(struct adcrush_scenario* sc, const char* key)
+{
+	size_t n;
+
+	if (!strcmp(key, "clients"))      return &sc->clients;
+	if (!strcmp(key, "workers"))      return &sc->workers;
+	if (!strcmp(key, "join_rate"))    return &sc->join_rate;
+	if (!strcmp(key, "duration"))     return &sc->duration;
+	if (!strcmp(key, "interval"))     return &sc->interval;
+	if (!strcmp(key, "tls"))          return &sc->tls;
+	if (!strcmp(key, "slow_readers")) return &sc->slow_readers;
+	if (!strcmp(key, "slow_pause"))   return &sc->slow_pause;
+	if (!strcmp(key, "drop"))         return &sc->drop;
+	if (!strcmp(key, "drop_at"))      return &sc->drop_at;
+
+	for (n = 0; n < action_max; n++)
+	{
+		if (!strcmp(key, action_names[n]))
+			return &sc->mix[n];
+	}
+	return NULL;
+}
+
+static int scenario_parse_line(char* line, int line_count, void* ptr)
 {
-	if (!arg || strlen(arg) < 9)
+	struct adcrush_scenario* sc = (struct adcrush_scenario*) ptr;
+	char* pos;
+	char* key;
+	char* data;
+	int* setting;
+	int val;
+
+	strip_off_ini_line_comments(line, line_count);
+
+	if (!*line)
 		return 0;
 
-	if (strncmp(arg, "adc://", 6) && strncmp(arg, "adcs://", 7))
+	if ((pos = strchr(line, '=')) == NULL)
+	{
+		fprintf(stderr, "Invalid format on line %d, no '=' found\n", line_count);
+		return -1;
+	}
+	pos[0] = 0;
+
+	key = strip_white_space(line);
+	data = strip_white_space(&pos[1]);
+
+	setting = scenario_get_setting(sc, key);
+	if (!setting)
+	{
+		fprintf(stderr, "Unknown setting \"%s\" on line %d\n", key, line_count);
+		return -1;
+	}
+
+	if (!is_number(data, &val) || val < 0)
+	{
+		fprintf(stderr, "Invalid value for \"%s\" on line %d\n", key, line_count);
+		return -1;
+	}
+
+	*setting = val;
+	return 0;
+}
+
+static int parse_address_entry(char* uri, int count, void* ptr)
+{
+	const char* host;
+
+	if (uri_count == ADC_MAX_HUBS || strlen(uri) < 9)
+		return -1;
+
+	if (!strncmp(uri, "adc://", 6))
+		host = uri + 6;
+	else if (!strncmp(uri, "adcs://", 7))
+		host = uri + 7;
+	else
+		return -1;
+
+	snprintf(uri_plain[uri_count], sizeof(uri_plain[0]), "adc://%s", host);
+	snprintf(uri_tls[uri_count], sizeof(uri_tls[0]), "adcs://%s", host);
+	uri_count++;
+	return 0;
+}
+
+int parse_address(const char* arg)
+{
+	if (!arg || string_split(arg, ",", NULL, parse_address_entry) < 0 || !uri_count)
 		return 0;
 
 	cfg_uri = arg;
@@ -490,19 +1108,22 @@ int parse_arguments(int argc, char** argv)
 	for (opt = 2; opt < argc; opt++)
 	{
 		if (!strcmp(argv[opt], "-c"))
-			cfg_chat = 1;
+			cfg_scenario.mix[action_chat] = 1;
 		else if (!strncmp(argv[opt], "-d", 2))
 			cfg_debug += strlen(argv[opt]) - 1;
 		else if (!strcmp(argv[opt], "-q"))
 			cfg_quiet = 1;
 		else if (!strcmp(argv[opt], "-l"))
 		{
+			/* Average time between actions: 60s, 30s, 7.5s or 2.5s. */
+			static const int intervals[] = { 60000, 30000, 7500, 2500 };
+
 			opt++;
 			if (opt >= argc)
 				return 0;
 
 			// ensure level is between 0 and 3 (or equal to either)
-			cfg_level = MIN(MAX(uhub_atoi(argv[opt]), 0), 3);
+			cfg_scenario.interval = intervals[MIN(MAX(uhub_atoi(argv[opt]), 0), 3)];
 		}
 		else if (!strcmp(argv[opt], "-i"))
 		{
@@ -519,14 +1140,57 @@ int parse_arguments(int argc, char** argv)
 			if (opt >= argc)
 				return 0;
 
-			// ensure clients is between 1 and ADC_MAX_CLIENTS (or equal to either)
-			cfg_clients = MIN(MAX(uhub_atoi(argv[opt]), 1), ADC_MAX_CLIENTS);
+			cfg_scenario.clients = MAX(uhub_atoi(argv[opt]), 1);
+		}
+		else if (!strcmp(argv[opt], "-s"))
+		{
+			opt++;
+			if (opt >= argc)
+				return 0;
+
+			if (file_read_lines(argv[opt], &cfg_scenario, &scenario_parse_line) < 0)
+			{
+				fprintf(stderr, "Unable to read scenario %s\n", argv[opt]);
+				exit(1);
+			}
+		}
+		else if (!strcmp(argv[opt], "-w"))
+		{
+			opt++;
+			if (opt >= argc)
+				return 0;
+
+			cfg_scenario.workers = uhub_atoi(argv[opt]);
+		}
+		else if (!strcmp(argv[opt], "-t"))
+		{
+			opt++;
+			if (opt >= argc)
+				return 0;
+
+			cfg_scenario.duration = MAX(uhub_atoi(argv[opt]), 0);
+		}
+		else if (!strcmp(argv[opt], "-j"))
+		{
+			opt++;
+			if (opt >= argc)
+				return 0;
+
+			cfg_report = argv[opt];
 		}
 		else
 		{
 			return 0;
 		}
 	}
+
+	if (cfg_scenario.tls < 0)
+		cfg_scenario.tls = strncmp(cfg_uri, "adcs://", 7) ? 0 : 100;
+
+	cfg_scenario.clients = MAX(cfg_scenario.clients, 1);
+	cfg_scenario.workers = MIN(MAX(cfg_scenario.workers, 1), MIN(ADC_MAX_WORKERS, cfg_scenario.clients));
+	cfg_scenario.interval = MAX(cfg_scenario.interval, 1);
+	cfg_scenario.slow_pause = MAX(cfg_scenario.slow_pause, 1);
 	return ok;
 }
 
@@ -543,17 +1207,32 @@ void parse_command_line(int argc, char** argv)
 
 int main(int argc, char** argv)
 {
+	time_t start;
+	int ok = 1;
 
 	parse_command_line(argc, argv);
 
-	net_initialize();
-	net_stats_get(&stats_intermediate, &stats_total);
-
 	hub_log_initialize(NULL, 0);
 	hub_set_log_verbosity(1000);
 	setvbuf(stdout, NULL, _IONBF, 0);
-	runloop(cfg_clients);
+	setup_signal_handlers();
 
-	net_destroy();
-	return 0;
+	start = get_time_ms();
+	if (cfg_scenario.workers == 1)
+	{
+		run_worker(0, (size_t) cfg_scenario.clients, !cfg_quiet);
+	}
+	else
+	{
+		struct adcrush_stats* total = hub_malloc_zero(sizeof(struct adcrush_stats));
+		ok = run_workers(total);
+		g_stats = *total;
+		hub_free(total);
+	}
+
+	if (!report(&g_stats, get_time_ms() - start))
+		ok = 0;
+
+	hub_log_shutdown();
+	return ok ? 0 : 1;
 }
@@ -19,27 +19,45 @@
 
 #include "adcclient.h"
 
-static struct ADC_user g_usermap[SID_MAX];
+static struct ptr_table* g_usermap;
 
-static void user_add(const struct ADC_user* user)
+static int user_add(const struct ADC_user* user)
 {
+	struct ADC_user* copy = ptr_table_get(g_usermap, user->sid);
 	printf(" >> JOIN: %s (%s)\n", user->name, user->address);
-	memcpy(&g_usermap[user->sid], user, sizeof(struct ADC_user));
+	if (!copy)
+	{
+		copy = hub_malloc(sizeof(struct ADC_user));
+		if (!copy || ptr_table_set(g_usermap, user->sid, copy) == -1)
+		{
+			hub_free(copy);
+			return -1;
+		}
+	}
+	memcpy(copy, user, sizeof(struct ADC_user));
+	return 0;
 }
 
+/* Returns NULL if the user is not known, for instance if it could not be added */
 static struct ADC_user* user_get(sid_t sid)
 {
-
-	struct ADC_user* user = &g_usermap[sid];
-	uhub_assert(user->sid != 0);
-	return user;
+	return ptr_table_get(g_usermap, sid);
 }
 
 static void user_remove(const struct ADC_client_quit_reason* quit)
 {
 	struct ADC_user* user = user_get(quit->sid);
-	printf(" << QUIT: %s (%s)\n", user->name, quit->message);
-	memset(&g_usermap[quit->sid], 0, sizeof(struct ADC_user));
+	printf(" << QUIT: %s (%s)\n", user ? user->name : sid_to_string(quit->sid), quit->message);
+	ptr_table_set(g_usermap, quit->sid, 0);
+	hub_free(user);
+}
+
+static void user_clear()
+{
+	size_t n;
+	for (n = 0; n < g_usermap->size; n++)
+		hub_free(ptr_table_get(g_usermap, n));
+	ptr_table_destroy(g_usermap);
 }
 
 static void on_message(struct ADC_chat_message* chat)
@@ -59,7 +77,7 @@ static void on_message(struct ADC_chat_message* chat)
 	else
 	{
 		user = user_get(chat->from_sid);
-		printf(" %s %s%s%s ", pm, brack1, user->name, brack2);
+		printf(" %s %s%s%s ", pm, brack1, user ? user->name : sid_to_string(chat->from_sid), brack2);
 	}
 
 	lines = list_create();
@@ -132,13 +150,18 @@ static int handle(struct ADC_client* client, enum ADC_client_callback_type type,
 			break;
 
 		case ADC_CLIENT_USER_JOIN:
-			user_add(data->user);
+			if (user_add(data->user) == -1)
+			{
+				status("Out of memory, unable to keep track of the user.");
+				return 0;
+			}
 			break;
 
 		case ADC_CLIENT_USER_QUIT:
 			user_remove(data->quit);
 			break;
 
+		case ADC_CLIENT_USER_UPDATE:
 		case ADC_CLIENT_SEARCH_REQ:
 			break;
 
@@ -247,7 +270,7 @@ int main(int argc, char** argv)
 	net_initialize();
 	adm_setup_control_pipe();
 
-	memset(g_usermap, 0, sizeof(g_usermap));
+	g_usermap = ptr_table_create(SID_MAX);
 
 	client = ADC_client_create("uhub-admin", "stresstester", NULL);
 	ADC_client_set_callback(client, handle);
@@ -260,6 +283,7 @@ int main(int argc, char** argv)
 	adm_shutdown_control_pipe();
 
 	ADC_client_destroy(client);
+	user_clear();
 	net_destroy();
 	adm_shutdown_signal_handlers();
 	return 0;
@@ -0,0 +1,581 @@
+/*
+ * uhub - A tiny ADC p2p connection hub
+ * Copyright (C) 2007-2014, Jan Vidar Krey
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * uhub-replay: replay a traffic capture (see file_capture) against a hub.
+ *
+ * Every captured connection is replayed as a new connection, sending the
+ * same messages at the same relative times (optionally sped up or slowed down).
+ * SIDs in the captured messages are rewritten to the SIDs the hub gives out
+ * during the replay.
+ *
+ * Logins that need a password cannot be replayed, as the hub uses a new
+ * random salt for each login.
+ */
+
+#include "uhub.h"
+
+#include <signal.h>
+
+#define REPLAY "uhub-replay/0.1"
+#define REPLAY_SID_MAX (1 << 20)   /* SIDs are 4 base32 characters */
+#define REPLAY_MAX_WAIT 100        /* ms */
+#define REPLAY_DRAIN_TIME 5000     /* ms */
+
+struct replay_con
+{
+	uint32_t id;
+	struct net_connect_handle* connect;
+	struct net_connection* con;
+	sid_t capture_sid;              /* SID of the connection in the capture */
+	sid_t sid;                      /* SID given by the hub in this replay */
+	struct linked_list* held;       /* Lines waiting for the SID from the hub */
+	char* sendbuf;
+	size_t sendlen;
+	size_t sendmax;
+	char recvbuf[64];               /* Partial line, until the SID is known */
+	size_t recvlen;
+	uint64_t started;
+	int closing;
+	int dead;
+};
+
+struct replay_stats
+{
+	size_t records;
+	size_t connections;
+	size_t failed;
+	size_t disconnected;
+	size_t lines;
+	size_t dropped;
+	uint64_t tx;
+	uint64_t rx;
+	uint64_t lag_max;               /* us behind schedule, worst case */
+	uint64_t lag_total;
+	uint64_t sid_wait_total;        /* us from connect to ISID */
+	uint64_t sid_wait_max;
+	size_t sid_count;
+};
+
+static const char* cfg_capture = 0;
+static char cfg_host[256];
+static uint16_t cfg_port = 0;
+static double cfg_speed = 1.0; /* 0 = as fast as possible */
+static int cfg_quiet = 0;
+
+static volatile int running = 1;
+static struct replay_stats g_stats;
+static struct replay_con** g_cons;    /* indexed by capture connection id */
+static size_t g_cons_max;
+static sid_t* g_sids;                 /* capture SID -> replay SID */
+
+static void con_flush(struct replay_con* c);
+
+static uint64_t get_time_us()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t) ts.tv_sec * 1000000) + ((uint64_t) ts.tv_nsec / 1000);
+}
+
+static void map_sid(struct replay_con* c)
+{
+	if (c->capture_sid && c->sid && c->capture_sid < REPLAY_SID_MAX)
+		g_sids[c->capture_sid] = c->sid;
+}
+
+static void con_queue(struct replay_con* c, const char* data, size_t len)
+{
+	if (c->sendlen + len > c->sendmax)
+	{
+		size_t max = MAX(c->sendmax * 2, 4096);
+		while (max < c->sendlen + len)
+			max *= 2;
+		c->sendbuf = hub_realloc(c->sendbuf, max);
+		c->sendmax = max;
+	}
+	memcpy(c->sendbuf + c->sendlen, data, len);
+	c->sendlen += len;
+}
+
+/* Messages from a client carrying the SID of the sender (and for D/E also of the target) */
+static int line_has_sid(const char* line, size_t len)
+{
+	return len >= 9 && strchr("BDEF", line[0]) && line[4] == ' ';
+}
+
+static void con_send_line(struct replay_con* c, const char* line, size_t len)
+{
+	char buf[MAX_RECV_BUF + 1];
+
+	len = MIN(len, sizeof(buf) - 1);
+	memcpy(buf, line, len);
+
+	if (line_has_sid(buf, len))
+	{
+		memcpy(buf + 5, sid_to_string(c->sid), 4);
+
+		if ((buf[0] == 'D' || buf[0] == 'E') && len >= 14 && buf[9] == ' ')
+		{
+			sid_t target = string_to_sid(buf + 10);
+			if (target && target < REPLAY_SID_MAX && g_sids[target])
+				memcpy(buf + 10, sid_to_string(g_sids[target]), 4);
+		}
+	}
+
+	buf[len++] = '\n';
+	con_queue(c, buf, len);
+	g_stats.lines++;
+}
+
+static void con_release_held(struct replay_con* c)
+{
+	char* line;
+	while ((line = (char*) list_get_first(c->held)))
+	{
+		con_send_line(c, line, strlen(line));
+		list_remove_first(c->held, hub_free);
+	}
+}
+
+static void con_destroy(struct replay_con* c)
+{
+	if (c->connect)
+		net_connect_destroy(c->connect);
+	if (c->con)
+		net_con_close(c->con);
+	list_clear(c->held, hub_free);
+	list_destroy(c->held);
+	hub_free(c->sendbuf);
+	g_cons[c->id] = 0;
+	hub_free(c);
+}
+
+static void con_dead(struct replay_con* c)
+{
+	if (c->con)
+	{
+		net_con_close(c->con);
+		c->con = 0;
+	}
+	c->dead = 1;
+	c->sendlen = 0;
+	list_clear(c->held, hub_free);
+}
+
+static void con_update_events(struct replay_con* c)
+{
+	net_con_update(c->con, NET_EVENT_READ | (c->sendlen ? NET_EVENT_WRITE : 0));
+}
+
+static void con_flush(struct replay_con* c)
+{
+	ssize_t ret;
+
+	if (!c->con)
+		return;
+
+	while (c->sendlen)
+	{
+		ret = net_con_send(c->con, c->sendbuf, c->sendlen);
+		if (ret < 0)
+		{
+			g_stats.disconnected++;
+			con_dead(c);
+			return;
+		}
+
+		if (ret == 0)
+			break;
+
+		memmove(c->sendbuf, c->sendbuf + ret, c->sendlen - (size_t) ret);
+		c->sendlen -= (size_t) ret;
+		g_stats.tx += (uint64_t) ret;
+	}
+
+	if (!c->sendlen && c->closing)
+	{
+		con_destroy(c);
+		return;
+	}
+
+	con_update_events(c);
+}
+
+static void con_handle_line(struct replay_con* c, const char* line)
+{
+	uint64_t wait;
+
+	if (strncmp(line, "ISID ", 5) || strlen(line) < 9)
+		return;
+
+	c->sid = string_to_sid(line + 5);
+	map_sid(c);
+
+	wait = get_time_us() - c->started;
+	g_stats.sid_wait_total += wait;
+	g_stats.sid_wait_max = MAX(g_stats.sid_wait_max, wait);
+	g_stats.sid_count++;
+
+	/* Sent on the next write event, the connection is in use by con_read(). */
+	con_release_held(c);
+	con_update_events(c);
+}
+
+static void con_read(struct replay_con* c)
+{
+	static char buf[65536];
+	ssize_t n, i;
+
+	while (c->con && (n = net_con_recv(c->con, buf, sizeof(buf))) != 0)
+	{
+		if (n < 0)
+		{
+			g_stats.disconnected++;
+			con_dead(c);
+			return;
+		}
+
+		g_stats.rx += (uint64_t) n;
+
+		/* Everything after the SID is ignored */
+		for (i = 0; i < n && !c->sid; i++)
+		{
+			if (buf[i] == '\n')
+			{
+				c->recvbuf[c->recvlen] = 0;
+				con_handle_line(c, c->recvbuf);
+				c->recvlen = 0;
+			}
+			else if (c->recvlen < sizeof(c->recvbuf) - 1)
+			{
+				c->recvbuf[c->recvlen++] = buf[i];
+			}
+		}
+	}
+}
+
+static void con_event(struct net_connection* con, int events, void* arg)
+{
+	struct replay_con* c = (struct replay_con*) net_con_get_ptr(con);
+
+	if (events & NET_EVENT_READ)
+		con_read(c);
+
+	if (!c->dead && (events & NET_EVENT_WRITE))
+		con_flush(c);
+}
+
+static void con_connected(struct net_connect_handle* handle, enum net_connect_status status, struct net_connection* con, void* ptr)
+{
+	struct replay_con* c = (struct replay_con*) ptr;
+	c->connect = 0;
+
+	if (status != net_connect_status_ok)
+	{
+		g_stats.failed++;
+		con_dead(c);
+		if (c->closing)
+			con_destroy(c);
+		return;
+	}
+
+	c->con = con;
+	net_con_reinitialize(con, con_event, c, NET_EVENT_READ);
+	con_flush(c);
+}
+
+static struct replay_con* con_get(uint32_t id, int create)
+{
+	struct replay_con* c;
+
+	if (id < g_cons_max && g_cons[id])
+		return g_cons[id];
+
+	if (!create)
+		return 0;
+
+	if (id >= g_cons_max)
+	{
+		size_t max = MAX(g_cons_max * 2, 1024);
+		while (max <= id)
+			max *= 2;
+		g_cons = hub_realloc(g_cons, max * sizeof(struct replay_con*));
+		memset(g_cons + g_cons_max, 0, (max - g_cons_max) * sizeof(struct replay_con*));
+		g_cons_max = max;
+	}
+
+	c = hub_malloc_zero(sizeof(struct replay_con));
+	c->id = id;
+	c->held = list_create();
+	c->started = get_time_us();
+	g_cons[id] = c;
+	g_stats.connections++;
+
+	c->connect = net_con_connect(cfg_host, cfg_port, con_connected, c);
+	if (!c->connect)
+	{
+		g_stats.failed++;
+		c->dead = 1;
+	}
+	return c;
+}
+
+static void cons_close_all()
+{
+	size_t n;
+	for (n = 0; n < g_cons_max; n++)
+	{
+		if (g_cons[n])
+			con_destroy(g_cons[n]);
+	}
+	memset(g_sids, 0, REPLAY_SID_MAX * sizeof(sid_t));
+}
+
+static size_t cons_pending()
+{
+	size_t n, pending = 0;
+	for (n = 0; n < g_cons_max; n++)
+	{
+		if (g_cons[n] && !g_cons[n]->dead && (g_cons[n]->sendlen || g_cons[n]->connect || list_size(g_cons[n]->held)))
+			pending++;
+	}
+	return pending;
+}
+
+static void replay_record(struct capture_record* record)
+{
+	struct replay_con* c;
+
+	g_stats.records++;
+
+	switch (record->type)
+	{
+		case capture_session:
+			cons_close_all();
+			break;
+
+		case capture_connect:
+			con_get(record->id, 1);
+			break;
+
+		case capture_line:
+			c = con_get(record->id, 1);
+			if (c->dead || c->closing)
+			{
+				g_stats.dropped++;
+				break;
+			}
+
+			if (record->sid && !c->capture_sid)
+			{
+				c->capture_sid = record->sid;
+				map_sid(c);
+			}
+
+			if (!c->sid && (line_has_sid(record->data, record->length) || list_size(c->held)))
+				list_append(c->held, hub_strndup(record->data, record->length));
+			else
+				con_send_line(c, record->data, record->length);
+
+			con_flush(c);
+			break;
+
+		case capture_disconnect:
+			c = con_get(record->id, 0);
+			if (!c)
+				break;
+			if (c->dead || (!c->sendlen && !c->connect && !list_size(c->held)))
+				con_destroy(c);
+			else
+				c->closing = 1;
+			break;
+	}
+}
+
+static int replay(struct capture_file* capture)
+{
+	struct capture_record record;
+	uint64_t session = get_time_us();
+	uint64_t now, due, drain;
+	int ret = capture_read(capture, &record);
+
+	while (running && ret == 1)
+	{
+		now = get_time_us();
+		if (record.type == capture_session)
+			session = now;
+
+		due = session + (cfg_speed > 0 ? (uint64_t) (record.time / cfg_speed) : 0);
+		if (due <= now)
+		{
+			g_stats.lag_total += now - due;
+			g_stats.lag_max = MAX(g_stats.lag_max, now - due);
+			replay_record(&record);
+			ret = capture_read(capture, &record);
+			continue;
+		}
+
+		net_backend_process_timeout((int) MIN((due - now + 999) / 1000, REPLAY_MAX_WAIT));
+	}
+
+	/* Let the last messages go out before disconnecting. */
+	drain = get_time_us() + REPLAY_DRAIN_TIME * 1000;
+	while (running && cons_pending() && get_time_us() < drain)
+		net_backend_process_timeout(REPLAY_MAX_WAIT);
+
+	cons_close_all();
+	net_backend_process_timeout(0);
+
+	if (ret == -1)
+	{
+		fprintf(stderr, "Capture file is truncated or corrupt after %" PRIsz " records.\n", g_stats.records);
+		return 0;
+	}
+	return 1;
+}
+
+static void report(uint64_t elapsed)
+{
+	if (cfg_quiet)
+		return;
+
+	printf("Replayed %" PRIsz " records in %.3f seconds.\n", g_stats.records, (double) elapsed / 1000000.0);
+	printf("  Connections:      %" PRIsz " (%" PRIsz " failed, %" PRIsz " closed by the hub)\n", g_stats.connections, g_stats.failed, g_stats.disconnected);
+	printf("  Messages sent:    %" PRIsz " (%" PRIsz " dropped)\n", g_stats.lines, g_stats.dropped);
+	printf("  Bytes sent:       %" PRIu64 "\n", g_stats.tx);
+	printf("  Bytes received:   %" PRIu64 "\n", g_stats.rx);
+	printf("  Schedule lag:     avg %.3f ms, max %.3f ms\n",
+		g_stats.records ? (double) g_stats.lag_total / g_stats.records / 1000.0 : 0.0,
+		(double) g_stats.lag_max / 1000.0);
+	printf("  Time to SID:      avg %.3f ms, max %.3f ms\n",
+		g_stats.sid_count ? (double) g_stats.sid_wait_total / g_stats.sid_count / 1000.0 : 0.0,
+		(double) g_stats.sid_wait_max / 1000.0);
+}
+
+static void replay_handle_signal(int sig)
+{
+	running = 0;
+}
+
+NO_RETURN static void print_usage(const char* program)
+{
+	printf(REPLAY "\n");
+	printf("\n");
+	printf("Usage: %s <capture file> adc://<host>:<port> [options]\n", program);
+	printf("\n");
+	printf("  OPTIONS\n");
+	printf("    -x <speed>  Replay speed, 2 is twice as fast (default: 1, 0 = as fast as possible)\n");
+	printf("    -q          Quiet mode (no output).\n");
+	printf("\n");
+	exit(0);
+}
+
+static int parse_address(const char* arg)
+{
+	const char* port;
+	size_t len;
+
+	if (strncmp(arg, "adc://", 6))
+		return 0;
+
+	arg += 6;
+	port = strrchr(arg, ':');
+	if (!port || port == arg)
+		return 0;
+
+	len = (size_t) (port - arg);
+	if (*arg == '[' && port[-1] == ']')
+	{
+		arg++;
+		len -= 2;
+	}
+
+	if (len >= sizeof(cfg_host))
+		return 0;
+
+	memcpy(cfg_host, arg, len);
+	cfg_host[len] = 0;
+	cfg_port = (uint16_t) uhub_atoi(port + 1);
+	return cfg_port != 0;
+}
+
+static void parse_command_line(int argc, char** argv)
+{
+	int opt;
+
+	if (argc < 3 || !parse_address(argv[2]))
+		print_usage(argv[0]);
+
+	cfg_capture = argv[1];
+
+	for (opt = 3; opt < argc; opt++)
+	{
+		if (!strcmp(argv[opt], "-q"))
+		{
+			cfg_quiet = 1;
+		}
+		else if (!strcmp(argv[opt], "-x") && opt + 1 < argc)
+		{
+			cfg_speed = atof(argv[++opt]);
+			if (cfg_speed < 0)
+				cfg_speed = 0;
+		}
+		else
+		{
+			print_usage(argv[0]);
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	struct capture_file* capture;
+	uint64_t start;
+	int ok;
+
+	parse_command_line(argc, argv);
+
+	capture = capture_open_read(cfg_capture);
+	if (!capture)
+	{
+		fprintf(stderr, "Unable to open capture file %s\n", cfg_capture);
+		return 1;
+	}
+
+	hub_log_initialize(NULL, 0);
+	hub_set_log_verbosity(0);
+	signal(SIGINT, replay_handle_signal);
+	signal(SIGTERM, replay_handle_signal);
+	signal(SIGPIPE, SIG_IGN);
+
+	g_sids = hub_calloc(REPLAY_SID_MAX, sizeof(sid_t));
+	net_initialize();
+
+	start = get_time_us();
+	ok = replay(capture);
+	report(get_time_us() - start);
+
+	net_destroy();
+	capture_close(capture);
+	hub_free(g_cons);
+	hub_free(g_sids);
+	hub_log_shutdown();
+	return ok ? 0 : 1;
+}
@@ -41,6 +41,9 @@
 #define TIMEOUT_HANDSHAKE 30
 #define TIMEOUT_SENDQ     120
 #define TIMEOUT_STATS     10
+#define TIMEOUT_TLS_TICKET 60
+#define TIMEOUT_LINK_RETRY 10
+#define TIMEOUT_BALANCE   1
 
 #define MAX_CID_LEN  39
 #define MAX_NICK_LEN 64
@@ -57,6 +60,7 @@ extern "C" {
 
 #include "adc/adcconst.h"
 
+#include "util/capture.h"
 #include "util/cbuffer.h"
 #include "util/config_token.h"
 #include "util/credentials.h"
@@ -65,19 +69,24 @@ extern "C" {
 #include "util/list.h"
 #include "util/log.h"
 #include "util/memory.h"
+#include "util/mempool.h"
 #include "util/misc.h"
+#include "util/ptrtable.h"
 #include "util/tiger.h"
 #include "util/threads.h"
 #include "util/rbtree.h"
 
 #include "adc/sid.h"
 #include "adc/message.h"
+#include "adc/search.h"
 
 #include "network/network.h"
 #include "network/notify.h"
 #include "network/connection.h"
+#include "network/loopback.h"
 #include "network/dnsresolver.h"
 #include "network/ipcalc.h"
+#include "network/iptrie.h"
 #include "network/timeout.h"
 
 #include "core/auth.h"
@@ -86,6 +95,7 @@ extern "C" {
 #include "core/eventqueue.h"
 #include "core/netevent.h"
 #include "core/ioqueue.h"
+#include "core/inftable.h"
 #include "core/user.h"
 #include "core/usermanager.h"
 #include "core/route.h"
@@ -95,6 +105,10 @@ extern "C" {
 #include "core/commands.h"
 #include "core/inf.h"
 #include "core/hubevent.h"
+#include "core/upgrade.h"
+#include "core/vhub.h"
+#include "core/link.h"
+#include "core/balance.h"
 #include "core/plugincallback.h"
 #include "core/plugininvoke.h"
 #include "core/pluginloader.h"
@@ -0,0 +1,210 @@
+/*
+ * uhub - A tiny ADC p2p connection hub
+ * Copyright (C) 2007-2014, Jan Vidar Krey
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "uhub.h"
+
+#define CAPTURE_HEADER_SIZE 8
+#define CAPTURE_MAX_RECORD  1048576
+
+struct capture_file
+{
+	FILE* fd;
+	uint64_t last;      /* time of the last record written or read (microseconds) */
+	char* buf;          /* data of the last record read */
+	size_t size;
+};
+
+static uint64_t capture_now()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return ((uint64_t) tv.tv_sec * 1000000) + (uint64_t) tv.tv_usec;
+}
+
+static size_t capture_encode_varint(uint64_t value, unsigned char* buf)
+{
+	size_t n = 0;
+	while (value >= 0x80)
+	{
+		buf[n++] = (unsigned char) (value | 0x80);
+		value >>= 7;
+	}
+	buf[n++] = (unsigned char) value;
+	return n;
+}
+
+static int capture_decode_varint(FILE* fd, uint64_t* value)
+{
+	int c;
+	int shift = 0;
+	*value = 0;
+
+	do
+	{
+		if (shift > 63 || (c = fgetc(fd)) == EOF)
+			return -1;
+		*value |= ((uint64_t) (c & 0x7f)) << shift;
+		shift += 7;
+	}
+	while (c & 0x80);
+	return 0;
+}
+
+struct capture_file* capture_open_write(const char* filename)
+{
+	struct capture_file* capture;
+	char header[CAPTURE_HEADER_SIZE];
+	char start[24];
+	FILE* fd = fopen(filename, "ab");
+
+	if (!fd)
+	{
+		LOG_ERROR("Unable to open capture file %s: %s", filename, strerror(errno));
+		return 0;
+	}
+
+	capture = hub_malloc_zero(sizeof(struct capture_file));
+	if (!capture)
+	{
+		fclose(fd);
+		return 0;
+	}
+	capture->fd = fd;
+
+	fseek(fd, 0, SEEK_END);
+	if (ftell(fd) == 0)
+	{
+		memcpy(header, CAPTURE_SIGNATURE, CAPTURE_HEADER_SIZE - 1);
+		header[CAPTURE_HEADER_SIZE - 1] = CAPTURE_VERSION;
+		fwrite(header, 1, CAPTURE_HEADER_SIZE, fd);
+	}
+
+	capture->last = capture_now();
+	snprintf(start, sizeof(start), "%" PRIu64, capture->last / 1000000);
+	if (capture_write(capture, capture_session, 0, 0, start, strlen(start)) == -1)
+	{
+		capture_close(capture);
+		return 0;
+	}
+	return capture;
+}
+
+struct capture_file* capture_open_read(const char* filename)
+{
+	struct capture_file* capture;
+	char header[CAPTURE_HEADER_SIZE];
+	FILE* fd = fopen(filename, "rb");
+
+	if (!fd)
+		return 0;
+
+	if (fread(header, 1, CAPTURE_HEADER_SIZE, fd) != CAPTURE_HEADER_SIZE ||
+		memcmp(header, CAPTURE_SIGNATURE, CAPTURE_HEADER_SIZE - 1) ||
+		header[CAPTURE_HEADER_SIZE - 1] != CAPTURE_VERSION)
+	{
+		fclose(fd);
+		return 0;
+	}
+
+	capture = hub_malloc_zero(sizeof(struct capture_file));
+	if (!capture)
+	{
+		fclose(fd);
+		return 0;
+	}
+	capture->fd = fd;
+	return capture;
+}
+
+void capture_close(struct capture_file* capture)
+{
+	if (!capture)
+		return;
+
+	fclose(capture->fd);
+	hub_free(capture->buf);
+	hub_free(capture);
+}
+
+int capture_write(struct capture_file* capture, enum capture_record_type type, uint32_t id, uint32_t sid, const char* data, size_t length)
+{
+	unsigned char head[1 + 4 * 10];
+	size_t n = 0;
+	uint64_t now = capture_now();
+
+	/* The wall clock may step backwards, keep the deltas positive. */
+	if (type == capture_session || now < capture->last)
+		now = capture->last;
+
+	head[n++] = (unsigned char) type;
+	n += capture_encode_varint(now - capture->last, head + n);
+	n += capture_encode_varint(id, head + n);
+	n += capture_encode_varint(sid, head + n);
+	n += capture_encode_varint(length, head + n);
+	capture->last = now;
+
+	if (fwrite(head, 1, n, capture->fd) != n || (length && fwrite(data, 1, length, capture->fd) != length))
+	{
+		LOG_ERROR("Unable to write to capture file: %s", strerror(errno));
+		return -1;
+	}
+	return 0;
+}
+
+int capture_read(struct capture_file* capture, struct capture_record* record)
+{
+	uint64_t time, id, sid, length;
+	int type = fgetc(capture->fd);
+
+	if (type == EOF)
+		return 0;
+
+	if (type > capture_disconnect ||
+		capture_decode_varint(capture->fd, &time) == -1 ||
+		capture_decode_varint(capture->fd, &id) == -1 ||
+		capture_decode_varint(capture->fd, &sid) == -1 ||
+		capture_decode_varint(capture->fd, &length) == -1 ||
+		length > CAPTURE_MAX_RECORD)
+	{
+		return -1;
+	}
+
+	if (capture->size < length + 1)
+	{
+		char* buf = hub_realloc(capture->buf, length + 1);
+		if (!buf)
+			return -1;
+		capture->buf = buf;
+		capture->size = length + 1;
+	}
+
+	if (length && fread(capture->buf, 1, length, capture->fd) != length)
+		return -1;
+	capture->buf[length] = 0;
+
+	capture->last = (type == capture_session) ? 0 : capture->last + time;
+
+	record->type = (enum capture_record_type) type;
+	record->time = capture->last;
+	record->id = (uint32_t) id;
+	record->sid = (uint32_t) sid;
+	record->length = (size_t) length;
+	record->data = capture->buf;
+	return 1;
+}
@@ -0,0 +1,96 @@
+/*
+ * uhub - A tiny ADC p2p connection hub
+ * Copyright (C) 2007-2014, Jan Vidar Krey
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef HAVE_UHUB_CAPTURE_H
+#define HAVE_UHUB_CAPTURE_H
+
+/*
+ * Capture files record the ADC traffic received by the hub, so that it can
+ * be replayed later (see uhub-replay).
+ *
+ * A capture file starts with the 8 byte signature "uhubcap" followed by
+ * the format version (1), and then a stream of records:
+ *
+ *   uint8  type    (enum capture_record_type)
+ *   varint time    (microseconds since the previous record)
+ *   varint id      (connection id, unique within a session)
+ *   varint sid     (SID of the connection, 0 if not yet assigned)
+ *   varint length
+ *   bytes  data
+ *
+ * A varint is stored 7 bits at a time, least significant group first,
+ * with the high bit set on all but the last byte.
+ * The hub appends to an existing capture file, starting each run with a
+ * session record.
+ */
+
+#define CAPTURE_SIGNATURE "uhubcap"
+#define CAPTURE_VERSION   1
+
+enum capture_record_type
+{
+	capture_session    = 0, /* Hub started. data: start time as a decimal string (seconds since the epoch) */
+	capture_connect    = 1, /* New connection. data: peer address */
+	capture_line       = 2, /* Received ADC message. data: the line without the newline */
+	capture_disconnect = 3, /* Connection closed. */
+};
+
+struct capture_record
+{
+	enum capture_record_type type;
+	uint64_t time;   /* microseconds since the start of the session */
+	uint32_t id;
+	uint32_t sid;
+	size_t length;
+	char* data;      /* nul-terminated, valid until the next capture_read() */
+};
+
+struct capture_file;
+
+/**
+ * Open a capture file for writing, appending to it if it exists.
+ * A session record is written first.
+ * @return a capture handle or NULL on error.
+ */
+extern struct capture_file* capture_open_write(const char* filename);
+
+/**
+ * Open a capture file for reading.
+ * @return a capture handle or NULL on error (including a bad signature).
+ */
+extern struct capture_file* capture_open_read(const char* filename);
+
+/**
+ * Close a capture file, flushing any pending writes.
+ */
+extern void capture_close(struct capture_file* capture);
+
+/**
+ * Write a record, timestamped with the current time.
+ * @return 0 on success, -1 on error.
+ */
+extern int capture_write(struct capture_file* capture, enum capture_record_type type, uint32_t id, uint32_t sid, const char* data, size_t length);
+
+/**
+ * Read the next record.
+ * @return 1 if a record was read, 0 at the end of the file, or -1 if the file is truncated or corrupt.
+ */
+extern int capture_read(struct capture_file* capture, struct capture_record* record);
+
+#endif /* HAVE_UHUB_CAPTURE_H */
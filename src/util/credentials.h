@@ -31,7 +31,7 @@ enum auth_credentials
 	auth_cred_opbot,                /**<<< "User is a operator robot" */
 	auth_cred_opubot,               /**<<< "User is an unrestricted operator robot" */
 	auth_cred_super,                /**<<< "User is a super user" (not used) */
-	auth_cred_link,                 /**<<< "User is a link (not used currently)" */
+	auth_cred_link,                 /**<<< "User is a link to another hub (see link.h)" */
 	auth_cred_admin,                /**<<< "User is identified as a hub administrator/owner" */
 };
 
@@ -0,0 +1,212 @@
+/*
+ * uhub - A tiny ADC p2p connection hub
+ * Copyright (C) 2007-2014, Jan Vidar Krey
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "uhub.h"
+
+struct mem_pool_slab
+{
+	struct mem_pool_slab* next;
+	char* begin;
+	char* end;
+};
+
+static struct mem_pool* g_pools = 0;
+
+static void mem_pool_register(struct mem_pool* pool)
+{
+	if (pool->registered)
+		return;
+	pool->next = g_pools;
+	g_pools = pool;
+	pool->registered = 1;
+}
+
+static void mem_pool_unregister(struct mem_pool* pool)
+{
+	struct mem_pool** it;
+	for (it = &g_pools; *it; it = &(*it)->next)
+	{
+		if (*it == pool)
+		{
+			*it = pool->next;
+			break;
+		}
+	}
+	pool->registered = 0;
+}
+
+static int mem_pool_in_slab(struct mem_pool* pool, void* ptr)
+{
+	struct mem_pool_slab* slab;
+	for (slab = pool->slabs; slab; slab = slab->next)
+	{
+		if ((char*) ptr >= slab->begin && (char*) ptr < slab->end)
+			return 1;
+	}
+	return 0;
+}
+
+#define mem_pool_push(LIST, COUNT, PTR) \
+	do { \
+		*((void**) (PTR)) = (LIST); \
+		(LIST) = (PTR); \
+		(COUNT)++; \
+	} while (0)
+
+#define mem_pool_pop(LIST, COUNT, PTR) \
+	do { \
+		(PTR) = (LIST); \
+		(LIST) = *((void**) (PTR)); \
+		(COUNT)--; \
+	} while (0)
+
+void mem_pool_init(struct mem_pool* pool, const char* name, size_t size)
+{
+	memset(pool, 0, sizeof(struct mem_pool));
+	pool->name = name;
+	pool->size = size;
+	pool->max_free = MEM_POOL_DEFAULT_MAX_FREE;
+	mem_pool_register(pool);
+}
+
+void mem_pool_destroy(struct mem_pool* pool)
+{
+	struct mem_pool_slab* slab;
+	void* ptr;
+
+	if (pool->in_use)
+		LOG_WARN("Memory pool '%s' destroyed with %" PRIsz " objects in use", pool->name, pool->in_use);
+
+	while (pool->free_heap)
+	{
+		mem_pool_pop(pool->free_heap, pool->free_heap_count, ptr);
+		hub_free(ptr);
+	}
+
+	/* Objects in use can still point into the slabs */
+	while (!pool->in_use && (slab = pool->slabs))
+	{
+		pool->slabs = slab->next;
+		hub_free(slab);
+	}
+
+	if (!pool->slabs)
+	{
+		pool->free_slab = 0;
+		pool->free_slab_count = 0;
+	}
+
+	mem_pool_unregister(pool);
+}
+
+void mem_pool_prewarm(struct mem_pool* pool, size_t count)
+{
+	struct mem_pool_slab* slab;
+	size_t size = pool->size;
+	size_t n;
+
+	mem_pool_register(pool);
+
+	if (count > pool->max_free)
+		pool->max_free = count;
+
+	if (count <= pool->free_slab_count)
+		return;
+	count -= pool->free_slab_count;
+
+	/* Keep the objects aligned for any type, like malloc() does. */
+	size = (size + sizeof(uint64_t) - 1) & ~(sizeof(uint64_t) - 1);
+
+	slab = (struct mem_pool_slab*) hub_malloc(sizeof(struct mem_pool_slab) + sizeof(uint64_t) + size * count);
+	if (!slab)
+	{
+		LOG_ERROR("Unable to preallocate %" PRIsz " objects for memory pool '%s'", count, pool->name);
+		return;
+	}
+
+	slab->begin = (char*) (slab + 1);
+	slab->begin += (sizeof(uint64_t) - ((uintptr_t) slab->begin % sizeof(uint64_t))) % sizeof(uint64_t);
+	slab->end = slab->begin + size * count;
+	slab->next = pool->slabs;
+	pool->slabs = slab;
+
+	/* Push in reverse, so objects are handed out in address order */
+	for (n = count; n > 0; n--)
+		mem_pool_push(pool->free_slab, pool->free_slab_count, slab->begin + (n - 1) * size);
+}
+
+void* mem_pool_alloc(struct mem_pool* pool)
+{
+	void* ptr;
+
+	mem_pool_register(pool);
+
+	/* Prefer the slabs, so loose heap objects are the ones left over. */
+	if (pool->free_slab)
+		mem_pool_pop(pool->free_slab, pool->free_slab_count, ptr);
+	else if (pool->free_heap)
+		mem_pool_pop(pool->free_heap, pool->free_heap_count, ptr);
+	else
+		ptr = 0;
+
+	if (ptr)
+	{
+		pool->reused++;
+		memset(ptr, 0, pool->size);
+	}
+	else
+	{
+		ptr = hub_malloc_zero(pool->size);
+		if (!ptr)
+			return 0;
+	}
+
+	pool->allocs++;
+	pool->in_use++;
+	if (pool->in_use > pool->peak)
+		pool->peak = pool->in_use;
+	return ptr;
+}
+
+void mem_pool_free(struct mem_pool* pool, void* ptr)
+{
+	if (!ptr)
+		return;
+
+	uhub_assert(pool->in_use > 0);
+	pool->in_use--;
+
+	if (mem_pool_in_slab(pool, ptr))
+		mem_pool_push(pool->free_slab, pool->free_slab_count, ptr);
+	else if (pool->free_heap_count < pool->max_free)
+		mem_pool_push(pool->free_heap, pool->free_heap_count, ptr);
+	else
+		hub_free(ptr);
+}
+
+void mem_pool_format_stats(struct cbuffer* buf)
+{
+	struct mem_pool* pool;
+	for (pool = g_pools; pool; pool = pool->next)
+	{
+		cbuf_append_format(buf, "%s: %" PRIsz " in use (peak %" PRIsz "), %" PRIsz " free, %" PRIsz "%% reused\n",
+			pool->name, pool->in_use, pool->peak, pool->free_slab_count + pool->free_heap_count,
+			pool->allocs ? (pool->reused * 100 / pool->allocs) : 0);
+	}
+}
@@ -0,0 +1,92 @@
+/*
+ * uhub - A tiny ADC p2p connection hub
+ * Copyright (C) 2007-2014, Jan Vidar Krey
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef HAVE_UHUB_MEMORY_POOL_H
+#define HAVE_UHUB_MEMORY_POOL_H
+
+/*
+ * Free list pools for objects of a single type that are created and
+ * destroyed all the time, such as users and connections.
+ *
+ * Objects are handed out zeroed. Freed objects are kept on the free list,
+ * up to max_free of them, and reused by the next allocation.
+ * Objects allocated by mem_pool_prewarm() come from one contiguous block
+ * and always return to the free list.
+ *
+ * Pools are not thread safe, and must only be used from the main thread.
+ */
+
+#define MEM_POOL_DEFAULT_MAX_FREE 256
+
+struct mem_pool_slab;
+
+struct mem_pool
+{
+	const char* name;             /** Name shown in the statistics */
+	size_t size;                  /** Object size in bytes */
+	size_t max_free;              /** Max number of heap objects kept on the free list */
+	void* free_slab;              /** Free objects in the slabs, linked through their first word */
+	void* free_heap;              /** Other free objects, linked the same way */
+	size_t free_slab_count;       /** Number of objects in free_slab */
+	size_t free_heap_count;       /** Number of objects in free_heap */
+	size_t in_use;                /** Number of objects handed out */
+	size_t peak;                  /** Peak value of in_use */
+	size_t allocs;                /** Total number of allocations */
+	size_t reused;                /** Allocations served from the free list */
+	struct mem_pool_slab* slabs;  /** Blocks allocated by mem_pool_prewarm() */
+	struct mem_pool* next;        /** Next pool in the list of all pools */
+	int registered;
+};
+
+#define MEM_POOL_INIT(NAME, TYPE) { NAME, sizeof(TYPE), MEM_POOL_DEFAULT_MAX_FREE, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }
+
+/**
+ * Initialize a pool for objects of the given size.
+ * Static pools can use MEM_POOL_INIT instead, and are never destroyed.
+ */
+extern void mem_pool_init(struct mem_pool* pool, const char* name, size_t size);
+
+/**
+ * Free all objects on the free list, and the prewarmed slabs.
+ * All objects must have been returned to the pool.
+ */
+extern void mem_pool_destroy(struct mem_pool* pool);
+
+/**
+ * Make sure at least 'count' objects are available without allocating,
+ * and keep up to 'count' freed objects around.
+ */
+extern void mem_pool_prewarm(struct mem_pool* pool, size_t count);
+
+/**
+ * @return a zeroed object, or NULL if out of memory.
+ */
+extern void* mem_pool_alloc(struct mem_pool* pool);
+
+/**
+ * Return an object to the pool. NULL is ignored.
+ */
+extern void mem_pool_free(struct mem_pool* pool, void* ptr);
+
+/**
+ * Append the occupancy of every pool that has been used to the buffer.
+ */
+extern void mem_pool_format_stats(struct cbuffer* buf);
+
+#endif /* HAVE_UHUB_MEMORY_POOL_H */
@@ -348,6 +348,22 @@ int file_read_lines(const char* file, void* data, file_line_handler_t handler)
 	return string_split(buf, "\n", &split_data, file_read_line_handler);
 }
 
+int file_get_stamp(const char* file, struct file_stamp* stamp)
+{
+	struct stat st;
+
+	memset(stamp, 0, sizeof(struct file_stamp));
+	if (stat(file, &st) == -1 || !S_ISREG(st.st_mode))
+		return -1;
+
+	stamp->device = (uint64_t) st.st_dev;
+	stamp->inode  = (uint64_t) st.st_ino;
+	stamp->size   = (uint64_t) st.st_size;
+	stamp->mtime  = (int64_t) st.st_mtime;
+	stamp->ctime  = (int64_t) st.st_ctime;
+	return 0;
+}
+
 
 int uhub_atoi(const char* value)
 {
@@ -58,6 +58,26 @@ extern const char* format_size(size_t bytes, char* buf, size_t bufsize);
 
 extern int file_read_lines(const char* file, void* data, file_line_handler_t handler);
 
+/**
+ * Identifies a version of a file, two stamps of the same file
+ * compare equal (memcmp) unless the file was modified or replaced.
+ */
+struct file_stamp
+{
+	uint64_t device;
+	uint64_t inode;
+	uint64_t size;
+	int64_t mtime;
+	int64_t ctime;
+};
+
+/**
+ * Get the stamp of a regular file.
+ * @return 0 on success, -1 if the file cannot be found or is not a regular file
+ * (the stamp is then zeroed).
+ */
+extern int file_get_stamp(const char* file, struct file_stamp* stamp);
+
 /**
  * Convert a string to a boolean (0 or 1).
  * Example:
@@ -0,0 +1,103 @@
+/*
+ * uhub - A tiny ADC p2p connection hub
+ * Copyright (C) 2007-2014, Jan Vidar Krey
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "uhub.h"
+
+#define PTR_TABLE_SEGMENT_MASK (PTR_TABLE_SEGMENT_SIZE - 1)
+
+static size_t ptr_table_dir_size(size_t size)
+{
+	return (size + PTR_TABLE_SEGMENT_SIZE - 1) >> PTR_TABLE_SEGMENT_BITS;
+}
+
+struct ptr_table* ptr_table_create(size_t size)
+{
+	struct ptr_table* table = (struct ptr_table*) hub_malloc_zero(sizeof(struct ptr_table));
+	if (!table)
+		return 0;
+
+	table->size = size;
+	table->dir = (void***) hub_calloc(ptr_table_dir_size(size) + 1, sizeof(void**));
+	if (!table->dir)
+	{
+		hub_free(table);
+		return 0;
+	}
+	return table;
+}
+
+void ptr_table_destroy(struct ptr_table* table)
+{
+	size_t n;
+
+	if (!table)
+		return;
+
+	for (n = 0; n < ptr_table_dir_size(table->size); n++)
+		hub_free(table->dir[n]);
+	hub_free(table->dir);
+	hub_free(table);
+}
+
+void* ptr_table_get(struct ptr_table* table, size_t index)
+{
+	void** segment;
+
+	if (index >= table->size)
+		return 0;
+
+	segment = table->dir[index >> PTR_TABLE_SEGMENT_BITS];
+	if (!segment)
+		return 0;
+
+	return segment[index & PTR_TABLE_SEGMENT_MASK];
+}
+
+int ptr_table_set(struct ptr_table* table, size_t index, void* ptr)
+{
+	void** segment;
+
+	if (index >= table->size)
+		return -1;
+
+	segment = table->dir[index >> PTR_TABLE_SEGMENT_BITS];
+	if (!segment)
+	{
+		/* Nothing to clear in a segment that was never used */
+		if (!ptr)
+			return 0;
+
+		segment = (void**) hub_calloc(PTR_TABLE_SEGMENT_SIZE, sizeof(void*));
+		if (!segment)
+			return -1;
+
+		table->dir[index >> PTR_TABLE_SEGMENT_BITS] = segment;
+		table->segments++;
+	}
+
+	segment[index & PTR_TABLE_SEGMENT_MASK] = ptr;
+	return 0;
+}
+
+size_t ptr_table_memory(struct ptr_table* table)
+{
+	return sizeof(struct ptr_table)
+		+ (ptr_table_dir_size(table->size) + 1) * sizeof(void**)
+		+ table->segments * PTR_TABLE_SEGMENT_SIZE * sizeof(void*);
+}
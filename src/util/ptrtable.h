@@ -0,0 +1,68 @@
+/*
+ * uhub - A tiny ADC p2p connection hub
+ * Copyright (C) 2007-2014, Jan Vidar Krey
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef HAVE_UHUB_PTR_TABLE_H
+#define HAVE_UHUB_PTR_TABLE_H
+
+/*
+ * A fixed size table of pointers that only allocates memory for the
+ * parts of it that are used.
+ *
+ * The slots are split into page sized segments, which are allocated
+ * the first time a pointer is stored in them. Reading a slot in a
+ * segment that was never touched returns NULL.
+ * Segments are kept once allocated, so the memory use follows the
+ * highest number of slots used at the same time.
+ */
+
+#define PTR_TABLE_SEGMENT_BITS 9
+#define PTR_TABLE_SEGMENT_SIZE (1 << PTR_TABLE_SEGMENT_BITS)
+
+struct ptr_table
+{
+	size_t size;      /** Number of slots */
+	size_t segments;  /** Number of segments allocated */
+	void*** dir;      /** Segment directory, NULL for segments not allocated */
+};
+
+/**
+ * Create a table with 'size' slots, all set to NULL.
+ * @return the table, or NULL if out of memory.
+ */
+extern struct ptr_table* ptr_table_create(size_t size);
+
+extern void ptr_table_destroy(struct ptr_table* table);
+
+/**
+ * @return the pointer stored at index, or NULL if none or out of range.
+ */
+extern void* ptr_table_get(struct ptr_table* table, size_t index);
+
+/**
+ * Store a pointer at index.
+ * @return 0 on success, or -1 if out of range or out of memory.
+ */
+extern int ptr_table_set(struct ptr_table* table, size_t index, void* ptr);
+
+/**
+ * @return the number of bytes allocated for the table.
+ */
+extern size_t ptr_table_memory(struct ptr_table* table);
+
+#endif /* HAVE_UHUB_PTR_TABLE_H */
@@ -224,6 +224,248 @@ void tiger(uint64_t* str, uint64_t length, uint64_t res[3]) {
 }
 
 
+/*
+ * Multi-buffer hashing.
+ *
+ * Messages that need the same number of compression calls are hashed
+ * TIGER_LANES at a time, one message per 64-bit lane of an AVX2 register.
+ * The S-box lookups become gathers, so the win comes from keeping four
+ * independent dependency chains in flight rather than from wider math.
+ * Anything else (no AVX2, big endian, mixed lengths) uses tiger_compress().
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && !defined(ARCH_BIGENDIAN)
+#define TIGER_AVX2
+#endif
+
+struct tiger_lane
+{
+	uint64_t* str;
+	uint64_t full;      /* number of 64 byte blocks taken directly from str */
+	uint64_t blocks;    /* total number of compression calls */
+	uint64_t tail[16];  /* padded final block(s) */
+};
+
+static void tiger_lane_init(struct tiger_lane* lane, uint64_t* str, uint64_t length)
+{
+	uint8_t* temp = (uint8_t*) lane->tail;
+	uint64_t i, j;
+
+	lane->str = str;
+	lane->full = length / 64;
+	i = length - lane->full * 64;
+
+	memset(lane->tail, 0, sizeof(lane->tail));
+	memcpy(temp, ((uint8_t*) str) + lane->full * 64, i);
+	temp[i] = 0x01;
+	j = (i + 8) & ~7;
+	if (j > 56)
+		j = 64 + 56;
+	else
+		j = 56;
+
+	length <<= 3;
+	memcpy(&temp[j], &length, sizeof(uint64_t));
+	lane->blocks = lane->full + (j + 8) / 64;
+}
+
+static uint64_t* tiger_lane_block(struct tiger_lane* lane, uint64_t n)
+{
+	if (n < lane->full)
+		return lane->str + n * 8;
+	return lane->tail + (n - lane->full) * 8;
+}
+
+static void tiger_init_state(uint64_t res[3])
+{
+	res[0]= 0x0123456789ABCDEFULL;
+	res[1]= 0xFEDCBA9876543210ULL;
+	res[2]= 0xF096A5B4C3B2E187ULL;
+}
+
+#ifdef TIGER_AVX2
+#include <immintrin.h>
+
+#define V_ADD(x, y) _mm256_add_epi64(x, y)
+#define V_SUB(x, y) _mm256_sub_epi64(x, y)
+#define V_XOR(x, y) _mm256_xor_si256(x, y)
+#define V_NOT(x) _mm256_xor_si256(x, ones)
+#define V_SHL(x, n) _mm256_slli_epi64(x, n)
+#define V_SHR(x, n) _mm256_srli_epi64(x, n)
+#define V_MUL5(x) V_ADD(V_SHL(x, 2), x)
+#define V_MUL7(x) V_SUB(V_SHL(x, 3), x)
+#define V_MUL9(x) V_ADD(V_SHL(x, 3), x)
+#define V_SBOX(t, x, shift) \
+	_mm256_i64gather_epi64((const long long*) (t), _mm256_and_si256(V_SHR(x, shift), bytemask), 8)
+
+#define V_ROUND(a, b, c, x, mul) \
+	c = V_XOR(c, x); \
+	a = V_SUB(a, V_XOR(V_XOR(V_SBOX(t1, c, 0x00), V_SBOX(t2, c, 0x10)), \
+	                   V_XOR(V_SBOX(t3, c, 0x20), V_SBOX(t4, c, 0x30)))); \
+	b = V_ADD(b, V_XOR(V_XOR(V_SBOX(t4, c, 0x08), V_SBOX(t3, c, 0x18)), \
+	                   V_XOR(V_SBOX(t2, c, 0x28), V_SBOX(t1, c, 0x38)))); \
+	b = V_MUL##mul(b);
+
+#define V_PASS(a, b, c, mul) \
+	V_ROUND(a, b, c, x0, mul) \
+	V_ROUND(b, c, a, x1, mul) \
+	V_ROUND(c, a, b, x2, mul) \
+	V_ROUND(a, b, c, x3, mul) \
+	V_ROUND(b, c, a, x4, mul) \
+	V_ROUND(c, a, b, x5, mul) \
+	V_ROUND(a, b, c, x6, mul) \
+	V_ROUND(b, c, a, x7, mul)
+
+#define V_SCHEDULE \
+	x0 = V_SUB(x0, V_XOR(x7, k1)); \
+	x1 = V_XOR(x1, x0); \
+	x2 = V_ADD(x2, x1); \
+	x3 = V_SUB(x3, V_XOR(x2, V_SHL(V_NOT(x1), 19))); \
+	x4 = V_XOR(x4, x3); \
+	x5 = V_ADD(x5, x4); \
+	x6 = V_SUB(x6, V_XOR(x5, V_SHR(V_NOT(x4), 23))); \
+	x7 = V_XOR(x7, x6); \
+	x0 = V_ADD(x0, x7); \
+	x1 = V_SUB(x1, V_XOR(x0, V_SHL(V_NOT(x7), 19))); \
+	x2 = V_XOR(x2, x1); \
+	x3 = V_ADD(x3, x2); \
+	x4 = V_SUB(x4, V_XOR(x3, V_SHR(V_NOT(x2), 23))); \
+	x5 = V_XOR(x5, x4); \
+	x6 = V_ADD(x6, x5); \
+	x7 = V_SUB(x7, V_XOR(x6, k2));
+
+#define V_LOAD(i) _mm256_set_epi64x(str[3][i], str[2][i], str[1][i], str[0][i])
+
+__attribute__((target("avx2")))
+static void tiger_compress_avx2(uint64_t* str[TIGER_LANES], __m256i state[3])
+{
+	const __m256i ones = _mm256_set1_epi64x(-1);
+	const __m256i bytemask = _mm256_set1_epi64x(0xFF);
+	const __m256i k1 = _mm256_set1_epi64x(0xA5A5A5A5A5A5A5A5ULL);
+	const __m256i k2 = _mm256_set1_epi64x(0x0123456789ABCDEFULL);
+	__m256i a = state[0];
+	__m256i b = state[1];
+	__m256i c = state[2];
+	__m256i x0 = V_LOAD(0);
+	__m256i x1 = V_LOAD(1);
+	__m256i x2 = V_LOAD(2);
+	__m256i x3 = V_LOAD(3);
+	__m256i x4 = V_LOAD(4);
+	__m256i x5 = V_LOAD(5);
+	__m256i x6 = V_LOAD(6);
+	__m256i x7 = V_LOAD(7);
+
+	V_PASS(a, b, c, 5);
+	V_SCHEDULE;
+	V_PASS(c, a, b, 7);
+	V_SCHEDULE;
+	V_PASS(b, c, a, 9);
+
+	state[0] = V_XOR(a, state[0]);
+	state[1] = V_SUB(b, state[1]);
+	state[2] = V_ADD(c, state[2]);
+}
+
+__attribute__((target("avx2")))
+static void tiger_lanes_avx2(struct tiger_lane* lanes, uint64_t (*res)[3])
+{
+	uint64_t* str[TIGER_LANES];
+	uint64_t out[3][TIGER_LANES];
+	__m256i state[3];
+	uint64_t n;
+	size_t l, i;
+
+	state[0] = _mm256_set1_epi64x(0x0123456789ABCDEFULL);
+	state[1] = _mm256_set1_epi64x(0xFEDCBA9876543210ULL);
+	state[2] = _mm256_set1_epi64x(0xF096A5B4C3B2E187ULL);
+
+	for (n = 0; n < lanes[0].blocks; n++)
+	{
+		for (l = 0; l < TIGER_LANES; l++)
+			str[l] = tiger_lane_block(&lanes[l], n);
+		tiger_compress_avx2(str, state);
+	}
+
+	for (i = 0; i < 3; i++)
+		_mm256_storeu_si256((__m256i*) out[i], state[i]);
+
+	for (l = 0; l < TIGER_LANES; l++)
+		for (i = 0; i < 3; i++)
+			res[l][i] = out[i][l];
+}
+
+static int tiger_have_avx2()
+{
+	static int avx2 = -1;
+	if (avx2 == -1)
+	{
+		__builtin_cpu_init();
+		avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+	}
+	return avx2;
+}
+#endif /* TIGER_AVX2 */
+
+static void tiger_lane_scalar(struct tiger_lane* lane, uint64_t res[3])
+{
+	uint64_t n;
+	tiger_init_state(res);
+	for (n = 0; n < lane->blocks; n++)
+		tiger_compress(tiger_lane_block(lane, n), res);
+}
+
+const char* tiger_batch_impl()
+{
+#ifdef TIGER_AVX2
+	if (tiger_have_avx2())
+		return "avx2";
+#endif
+	return "scalar";
+}
+
+void tiger_batch(uint64_t** str, const uint64_t* length, uint64_t (*res)[3], size_t count)
+{
+	struct tiger_lane lanes[TIGER_LANES];
+	size_t n = 0;
+	size_t l;
+
+#ifdef TIGER_AVX2
+	if (tiger_have_avx2())
+	{
+		for (; n + TIGER_LANES <= count; n += TIGER_LANES)
+		{
+			int same = 1;
+			for (l = 0; l < TIGER_LANES; l++)
+			{
+				tiger_lane_init(&lanes[l], str[n + l], length[n + l]);
+				if (lanes[l].blocks != lanes[0].blocks)
+					same = 0;
+			}
+
+			if (same)
+			{
+				tiger_lanes_avx2(lanes, &res[n]);
+			}
+			else
+			{
+				for (l = 0; l < TIGER_LANES; l++)
+					tiger_lane_scalar(&lanes[l], res[n + l]);
+			}
+		}
+	}
+#endif
+
+	for (; n < count; n++)
+	{
+#ifdef ARCH_BIGENDIAN
+		tiger(str[n], length[n], res[n]);
+#else
+		tiger_lane_init(&lanes[0], str[n], length[n]);
+		tiger_lane_scalar(&lanes[0], res[n]);
+#endif
+	}
+}
+
+
 uint64_t tiger_sboxes[1024] = {
 	0x02AAB17CF7E90C5EULL,
 	0xAC424B03E243A8ECULL,
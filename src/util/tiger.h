@@ -23,4 +23,19 @@
 
 extern void tiger(uint64_t* str, uint64_t length, uint64_t* res);
 
+#define TIGER_LANES 4
+
+/**
+ * Hash 'count' independent messages, str[n] being length[n] bytes long.
+ * The result is the same as calling tiger() for each message, but
+ * messages are hashed TIGER_LANES at a time when the CPU supports it.
+ */
+extern void tiger_batch(uint64_t** str, const uint64_t* length, uint64_t (*res)[3], size_t count);
+
+/**
+ * @return the name of the implementation used by tiger_batch(),
+ * "avx2" or "scalar".
+ */
+extern const char* tiger_batch_impl();
+
 #endif /* HAVE_UHUB_HASH_TIGER_H */
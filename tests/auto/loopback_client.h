@@ -0,0 +1,221 @@
+/*
+ * Simulated ADC clients for the tests that run a hub on the loopback
+ * network backend (see net_backend_use_loopback()).
+ *
+ * Include this from a test*.tcc file. All test files are built as one
+ * translation unit, so it is only defined once.
+ */
+
+#ifndef HAVE_UHUB_TEST_LOOPBACK_CLIENT_H
+#define HAVE_UHUB_TEST_LOOPBACK_CLIENT_H
+
+#include <uhub.h>
+
+#define LOOPBACK_EPOCH 1000000000
+
+struct loopback_client;
+
+/* Called for every line a client receives, after the fixture has handled it */
+typedef void (*loopback_line_handler)(struct loopback_client* client);
+
+struct loopback_client
+{
+	struct net_connection* con;
+	char nick[MAX_NICK_LEN+1];
+	const char* password;       /* Answers password requests (IGPA), if set */
+	loopback_line_handler on_line;
+	char sid[5];
+	char line[1024];
+	size_t length;
+	char received[8192];        /* Lines received, see lbc_received() */
+	size_t received_length;
+	int link;                   /* Logs in as a linked hub (ADLINK) */
+	int bad_cid;                /* Sends a CID that does not match the PID */
+	int paused;                 /* Stops reading, so the hub has to queue */
+	int logged_in;
+	int closed;
+	int messages;               /* BMSG received */
+	int quits;                  /* IQUI received */
+};
+
+static void lbc_send(struct loopback_client* client, const char* msg)
+{
+	net_con_send(client->con, msg, strlen(msg));
+}
+
+static void lbc_make_id(const char* name, int bad_cid, char* pid, char* cid)
+{
+	uint64_t seed[8];
+	uint64_t tiger_pid[3];
+	uint64_t tiger_cid[3];
+
+	memset(seed, 0, sizeof(seed));
+	snprintf((char*) seed, sizeof(seed), "loopback-client-%s", name);
+	tiger(seed, strlen((char*) seed), tiger_pid);
+	tiger(tiger_pid, TIGERSIZE, tiger_cid);
+	if (bad_cid)
+		tiger_cid[0]++;
+	base32_encode((unsigned char*) tiger_pid, TIGERSIZE, pid);
+	base32_encode((unsigned char*) tiger_cid, TIGERSIZE, cid);
+	pid[MAX_CID_LEN] = 0;
+	cid[MAX_CID_LEN] = 0;
+}
+
+static void lbc_send_info(struct loopback_client* client)
+{
+	char pid[64];
+	char cid[64];
+	char buf[256];
+
+	lbc_make_id(client->nick, client->bad_cid, pid, cid);
+	if (client->link)
+		snprintf(buf, sizeof(buf), "BINF %s ID%s PD%s NI%s\n", client->sid, cid, pid, client->nick);
+	else
+		snprintf(buf, sizeof(buf), "BINF %s ID%s PD%s NI%s SL1 SS0 SF0 HN1 HR0 HO0\n", client->sid, cid, pid, client->nick);
+	lbc_send(client, buf);
+}
+
+/* The answer to a password challenge (IGPA) */
+static void lbc_hash_password(const char* password, const char* challenge, char* hash)
+{
+	char buf[128];
+	char raw_challenge[64];
+	uint64_t tiger_res[3];
+	size_t length = strlen(password);
+
+	base32_decode(challenge, (unsigned char*) raw_challenge, MAX_CID_LEN);
+	memcpy(buf, password, length);
+	memcpy(buf + length, raw_challenge, TIGERSIZE);
+	tiger((uint64_t*) buf, TIGERSIZE + length, tiger_res);
+	base32_encode((unsigned char*) tiger_res, TIGERSIZE, hash);
+	hash[MAX_CID_LEN] = 0;
+}
+
+static void lbc_send_password(struct loopback_client* client, const char* challenge)
+{
+	char buf[128];
+	char password[64];
+
+	lbc_hash_password(client->password, challenge, password);
+	snprintf(buf, sizeof(buf), "HPAS %s\n", password);
+	lbc_send(client, buf);
+}
+
+static void lbc_handle_line(struct loopback_client* client)
+{
+	if (!strncmp(client->line, "ISID ", 5))
+	{
+		memcpy(client->sid, client->line + 5, 4);
+		client->sid[4] = 0;
+		lbc_send_info(client);
+	}
+	else if (!strncmp(client->line, "IGPA ", 5) && client->password)
+	{
+		lbc_send_password(client, client->line + 5);
+	}
+	else if (!strncmp(client->line, "BINF ", 5) && !strncmp(client->line + 5, client->sid, 4) && !client->link)
+	{
+		client->logged_in = 1;
+	}
+	else if (!strncmp(client->line, "BMSG ", 5))
+	{
+		client->messages++;
+	}
+	else if (!strncmp(client->line, "IQUI ", 5))
+	{
+		client->quits++;
+	}
+
+	if (client->received_length + client->length + 1 < sizeof(client->received))
+	{
+		memcpy(client->received + client->received_length, client->line, client->length);
+		client->received_length += client->length;
+		client->received[client->received_length++] = '\n';
+		client->received[client->received_length] = 0;
+	}
+
+	if (client->on_line)
+		client->on_line(client);
+}
+
+static void lbc_client_event(struct net_connection* con, int event, void* ptr)
+{
+	struct loopback_client* client = (struct loopback_client*) net_con_get_ptr(con);
+	char buf[1024];
+	ssize_t n, i;
+
+	if (!(event & NET_EVENT_READ) || client->paused)
+		return;
+
+	while ((n = net_con_recv(con, buf, sizeof(buf))) > 0)
+	{
+		for (i = 0; i < n; i++)
+		{
+			if (buf[i] == '\n')
+			{
+				client->line[client->length] = 0;
+				lbc_handle_line(client);
+				client->length = 0;
+			}
+			else if (client->length < sizeof(client->line) - 1)
+			{
+				client->line[client->length++] = buf[i];
+			}
+		}
+	}
+
+	if (n < 0)
+	{
+		client->closed = 1;
+		net_con_close(con);
+		client->con = 0;
+	}
+}
+
+/* Let the hub and the clients handle everything that is pending */
+static void lbc_process(struct hub_info* hub)
+{
+	int n;
+	for (n = 0; n < 20; n++)
+	{
+		net_backend_process();
+		event_queue_process(hub->queue);
+	}
+}
+
+/* Connect a client from the given address, without sending anything yet */
+static int lbc_connect(struct hub_info* hub, struct loopback_client* client, const char* ip, const char* nick)
+{
+	struct ip_addr_encap addr;
+
+	ip_convert_to_binary(ip, &addr);
+
+	memset(client, 0, sizeof(struct loopback_client));
+	strlcpy(client->nick, nick, sizeof(client->nick));
+	client->con = net_loopback_connect(hub->server, &addr, lbc_client_event, client, NET_EVENT_READ);
+	return client->con != 0;
+}
+
+/* Start the login, the client answers the hub as it goes */
+static void lbc_send_support(struct loopback_client* client)
+{
+	lbc_send(client, client->link ? "HSUP ADBASE ADTIGR ADLINK\n" : "HSUP ADBASE ADTIGR\n");
+}
+
+static void lbc_disconnect(struct loopback_client* client)
+{
+	if (client->con)
+		net_con_close(client->con);
+	client->con = 0;
+}
+
+/* Returns 1 if the client received the text, and forgets what it received */
+static int lbc_received(struct loopback_client* client, const char* text)
+{
+	int found = strstr(client->received, text) != NULL;
+	client->received_length = 0;
+	client->received[0] = 0;
+	return found;
+}
+
+#endif /* HAVE_UHUB_TEST_LOOPBACK_CLIENT_H */
@@ -45,6 +45,8 @@ extern int  exotic_run(struct exotic_handle* handle);
 #endif /* HAVE_EXOTIC_AUTOTEST_H */
 
 #include "init.tcc"
+#include "test_authrequest.tcc"
+#include "test_balance.tcc"
 #include "test_cbuffer.tcc"
 #include "test_commands.tcc"
 #include "test_config.tcc"
@@ -53,18 +55,31 @@ extern int  exotic_run(struct exotic_handle* handle);
 #include "test_flood.tcc"
 #include "test_hub.tcc"
 #include "test_inf.tcc"
+#include "test_inftable.tcc"
+#include "test_infvariant.tcc"
 #include "test_ipfilter.tcc"
+#include "test_iptrie.tcc"
+#include "test_link.tcc"
+#include "test_linkpeer.tcc"
 #include "test_list.tcc"
 #include "test_log.tcc"
+#include "test_loopback.tcc"
 #include "test_memory.tcc"
+#include "test_mempool.tcc"
 #include "test_message.tcc"
 #include "test_misc.tcc"
+#include "test_pluginhooks.tcc"
+#include "test_ptrtable.tcc"
 #include "test_rbtree.tcc"
+#include "test_sendbudget.tcc"
 #include "test_sid.tcc"
 #include "test_tiger.tcc"
 #include "test_timer.tcc"
+#include "test_tlsticket.tcc"
 #include "test_tokenizer.tcc"
+#include "test_upgrade.tcc"
 #include "test_usermanager.tcc"
+#include "test_vhubsni.tcc"
 #include "exit.tcc"
 
 int main(int argc, char** argv)
@@ -79,6 +94,30 @@ int main(int argc, char** argv)
 	exotic_add_test(&handle, &exotic_test_set_log_verbosity, "set_log_verbosity");
 	exotic_add_test(&handle, &exotic_test_get_log_verbosity, "get_log_verbosity");
 	exotic_add_test(&handle, &exotic_test_check_str_match, "check_str_match");
+	exotic_add_test(&handle, &exotic_test_authrequest_startup, "authrequest_startup");
+	exotic_add_test(&handle, &exotic_test_authrequest_hub_startup, "authrequest_hub_startup");
+	exotic_add_test(&handle, &exotic_test_authrequest_complete_registered, "authrequest_complete_registered");
+	exotic_add_test(&handle, &exotic_test_authrequest_complete_unknown, "authrequest_complete_unknown");
+	exotic_add_test(&handle, &exotic_test_authrequest_cancel, "authrequest_cancel");
+	exotic_add_test(&handle, &exotic_test_authrequest_reload_pending, "authrequest_reload_pending");
+	exotic_add_test(&handle, &exotic_test_authrequest_hub_shutdown, "authrequest_hub_shutdown");
+	exotic_add_test(&handle, &exotic_test_authrequest_shutdown, "authrequest_shutdown");
+	exotic_add_test(&handle, &exotic_test_balance_startup, "balance_startup");
+	exotic_add_test(&handle, &exotic_test_balance_hub_startup, "balance_hub_startup");
+	exotic_add_test(&handle, &exotic_test_balance_no_reports, "balance_no_reports");
+	exotic_add_test(&handle, &exotic_test_balance_report_unknown_peer, "balance_report_unknown_peer");
+	exotic_add_test(&handle, &exotic_test_balance_report_invalid, "balance_report_invalid");
+	exotic_add_test(&handle, &exotic_test_balance_report_accepted, "balance_report_accepted");
+	exotic_add_test(&handle, &exotic_test_balance_not_loaded, "balance_not_loaded");
+	exotic_add_test(&handle, &exotic_test_balance_least_loaded, "balance_least_loaded");
+	exotic_add_test(&handle, &exotic_test_balance_skip_overloaded, "balance_skip_overloaded");
+	exotic_add_test(&handle, &exotic_test_balance_skip_congested, "balance_skip_congested");
+	exotic_add_test(&handle, &exotic_test_balance_skip_huge_load, "balance_skip_huge_load");
+	exotic_add_test(&handle, &exotic_test_balance_skip_no_address, "balance_skip_no_address");
+	exotic_add_test(&handle, &exotic_test_balance_redirect_login, "balance_redirect_login");
+	exotic_add_test(&handle, &exotic_test_balance_reports_expire, "balance_reports_expire");
+	exotic_add_test(&handle, &exotic_test_balance_hub_shutdown, "balance_hub_shutdown");
+	exotic_add_test(&handle, &exotic_test_balance_shutdown, "balance_shutdown");
 	exotic_add_test(&handle, &exotic_test_cbuf_create_const_1, "cbuf_create_const_1");
 	exotic_add_test(&handle, &exotic_test_cbuf_create_1, "cbuf_create_1");
 	exotic_add_test(&handle, &exotic_test_cbuf_create_2, "cbuf_create_2");
@@ -428,6 +467,9 @@ int main(int argc, char** argv)
 	exotic_add_test(&handle, &exotic_test_check_config_3_1, "check_config_3_1");
 	exotic_add_test(&handle, &exotic_test_check_config_3_2, "check_config_3_2");
 	exotic_add_test(&handle, &exotic_test_remove_config_file, "remove_config_file");
+	exotic_add_test(&handle, &exotic_test_compare_config_1, "compare_config_1");
+	exotic_add_test(&handle, &exotic_test_compare_config_2, "compare_config_2");
+	exotic_add_test(&handle, &exotic_test_compare_config_3, "compare_config_3");
 	exotic_add_test(&handle, &exotic_test_free_configs, "free_configs");
 	exotic_add_test(&handle, &exotic_test_cred_to_string_1, "cred_to_string_1");
 	exotic_add_test(&handle, &exotic_test_cred_to_string_2, "cred_to_string_2");
@@ -495,6 +537,29 @@ int main(int argc, char** argv)
 	exotic_add_test(&handle, &exotic_test_hub_acl_initialize, "hub_acl_initialize");
 	exotic_add_test(&handle, &exotic_test_hub_service_initialize, "hub_service_initialize");
 	exotic_add_test(&handle, &exotic_test_hub_variables_startup, "hub_variables_startup");
+	exotic_add_test(&handle, &exotic_test_hub_acl_ban_nick_1, "hub_acl_ban_nick_1");
+	exotic_add_test(&handle, &exotic_test_hub_acl_ban_nick_2, "hub_acl_ban_nick_2");
+	exotic_add_test(&handle, &exotic_test_hub_acl_ban_nick_3, "hub_acl_ban_nick_3");
+	exotic_add_test(&handle, &exotic_test_hub_acl_ban_nick_4, "hub_acl_ban_nick_4");
+	exotic_add_test(&handle, &exotic_test_hub_acl_ban_nick_5, "hub_acl_ban_nick_5");
+	exotic_add_test(&handle, &exotic_test_hub_acl_ban_nick_6, "hub_acl_ban_nick_6");
+	exotic_add_test(&handle, &exotic_test_hub_acl_unban_nick_1, "hub_acl_unban_nick_1");
+	exotic_add_test(&handle, &exotic_test_hub_acl_unban_nick_2, "hub_acl_unban_nick_2");
+	exotic_add_test(&handle, &exotic_test_hub_acl_unban_nick_3, "hub_acl_unban_nick_3");
+	exotic_add_test(&handle, &exotic_test_hub_acl_ban_cid_1, "hub_acl_ban_cid_1");
+	exotic_add_test(&handle, &exotic_test_hub_acl_ban_cid_2, "hub_acl_ban_cid_2");
+	exotic_add_test(&handle, &exotic_test_hub_acl_ban_cid_3, "hub_acl_ban_cid_3");
+	exotic_add_test(&handle, &exotic_test_hub_acl_unban_cid_1, "hub_acl_unban_cid_1");
+	exotic_add_test(&handle, &exotic_test_hub_acl_unban_cid_2, "hub_acl_unban_cid_2");
+	exotic_add_test(&handle, &exotic_test_hub_reconfigure_1, "hub_reconfigure_1");
+	exotic_add_test(&handle, &exotic_test_hub_reconfigure_2, "hub_reconfigure_2");
+	exotic_add_test(&handle, &exotic_test_hub_reconfigure_3, "hub_reconfigure_3");
+	exotic_add_test(&handle, &exotic_test_hub_reconfigure_4, "hub_reconfigure_4");
+	exotic_add_test(&handle, &exotic_test_hub_vhub_start, "hub_vhub_start");
+	exotic_add_test(&handle, &exotic_test_hub_vhub_process, "hub_vhub_process");
+	exotic_add_test(&handle, &exotic_test_hub_vhub_reconfigure_1, "hub_vhub_reconfigure_1");
+	exotic_add_test(&handle, &exotic_test_hub_vhub_reconfigure_2, "hub_vhub_reconfigure_2");
+	exotic_add_test(&handle, &exotic_test_hub_vhub_shutdown, "hub_vhub_shutdown");
 	exotic_add_test(&handle, &exotic_test_hub_variables_shutdown, "hub_variables_shutdown");
 	exotic_add_test(&handle, &exotic_test_hub_acl_shutdown, "hub_acl_shutdown");
 	exotic_add_test(&handle, &exotic_test_hub_config_shutdown, "hub_config_shutdown");
@@ -543,6 +608,41 @@ int main(int argc, char** argv)
 	exotic_add_test(&handle, &exotic_test_inf_limit_hubs_6, "inf_limit_hubs_6");
 	exotic_add_test(&handle, &exotic_test_inf_limit_hubs_7, "inf_limit_hubs_7");
 	exotic_add_test(&handle, &exotic_test_inf_destroy_setup, "inf_destroy_setup");
+	exotic_add_test(&handle, &exotic_test_inftable_create, "inftable_create");
+	exotic_add_test(&handle, &exotic_test_inftable_get_1, "inftable_get_1");
+	exotic_add_test(&handle, &exotic_test_inftable_get_2, "inftable_get_2");
+	exotic_add_test(&handle, &exotic_test_inftable_get_3, "inftable_get_3");
+	exotic_add_test(&handle, &exotic_test_inftable_get_4, "inftable_get_4");
+	exotic_add_test(&handle, &exotic_test_inftable_interned_1, "inftable_interned_1");
+	exotic_add_test(&handle, &exotic_test_inftable_interned_2, "inftable_interned_2");
+	exotic_add_test(&handle, &exotic_test_inftable_render, "inftable_render");
+	exotic_add_test(&handle, &exotic_test_inftable_update_1, "inftable_update_1");
+	exotic_add_test(&handle, &exotic_test_inftable_update_2, "inftable_update_2");
+	exotic_add_test(&handle, &exotic_test_inftable_update_unchanged, "inftable_update_unchanged");
+	exotic_add_test(&handle, &exotic_test_inftable_update_none, "inftable_update_none");
+	exotic_add_test(&handle, &exotic_test_inftable_update_repeated_1, "inftable_update_repeated_1");
+	exotic_add_test(&handle, &exotic_test_inftable_update_repeated_2, "inftable_update_repeated_2");
+	exotic_add_test(&handle, &exotic_test_inftable_update_add, "inftable_update_add");
+	exotic_add_test(&handle, &exotic_test_inftable_update_remove, "inftable_update_remove");
+	exotic_add_test(&handle, &exotic_test_inftable_update_remove_missing, "inftable_update_remove_missing");
+	exotic_add_test(&handle, &exotic_test_inftable_update_interned, "inftable_update_interned");
+	exotic_add_test(&handle, &exotic_test_inftable_render_update, "inftable_render_update");
+	exotic_add_test(&handle, &exotic_test_inftable_destroy_1, "inftable_destroy_1");
+	exotic_add_test(&handle, &exotic_test_inftable_destroy_2, "inftable_destroy_2");
+	exotic_add_test(&handle, &exotic_test_infvariant_setup, "infvariant_setup");
+	exotic_add_test(&handle, &exotic_test_infvariant_tls_peer, "infvariant_tls_peer");
+	exotic_add_test(&handle, &exotic_test_infvariant_classes, "infvariant_classes");
+	exotic_add_test(&handle, &exotic_test_infvariant_self, "infvariant_self");
+	exotic_add_test(&handle, &exotic_test_infvariant_full, "infvariant_full");
+	exotic_add_test(&handle, &exotic_test_infvariant_plain, "infvariant_plain");
+	exotic_add_test(&handle, &exotic_test_infvariant_cached, "infvariant_cached");
+	exotic_add_test(&handle, &exotic_test_infvariant_low_bandwidth, "infvariant_low_bandwidth");
+	exotic_add_test(&handle, &exotic_test_infvariant_nat, "infvariant_nat");
+	exotic_add_test(&handle, &exotic_test_infvariant_nat_other, "infvariant_nat_other");
+	exotic_add_test(&handle, &exotic_test_infvariant_invalidate, "infvariant_invalidate");
+	exotic_add_test(&handle, &exotic_test_infvariant_shared, "infvariant_shared");
+	exotic_add_test(&handle, &exotic_test_infvariant_update_empty, "infvariant_update_empty");
+	exotic_add_test(&handle, &exotic_test_infvariant_shutdown, "infvariant_shutdown");
 	exotic_add_test(&handle, &exotic_test_prepare_network, "prepare_network");
 	exotic_add_test(&handle, &exotic_test_check_ipv6, "check_ipv6");
 	exotic_add_test(&handle, &exotic_test_ip_is_valid_ipv4_1, "ip_is_valid_ipv4_1");
@@ -1090,6 +1190,70 @@ int main(int argc, char** argv)
 	exotic_add_test(&handle, &exotic_test_ipv6_range_23, "ipv6_range_23");
 	exotic_add_test(&handle, &exotic_test_ipv6_range_24, "ipv6_range_24");
 	exotic_add_test(&handle, &exotic_test_shutdown_network, "shutdown_network");
+	exotic_add_test(&handle, &exotic_test_iptrie_prepare_network, "iptrie_prepare_network");
+	exotic_add_test(&handle, &exotic_test_iptrie_create, "iptrie_create");
+	exotic_add_test(&handle, &exotic_test_iptrie_empty_1, "iptrie_empty_1");
+	exotic_add_test(&handle, &exotic_test_iptrie_empty_2, "iptrie_empty_2");
+	exotic_add_test(&handle, &exotic_test_iptrie_add_1, "iptrie_add_1");
+	exotic_add_test(&handle, &exotic_test_iptrie_add_2, "iptrie_add_2");
+	exotic_add_test(&handle, &exotic_test_iptrie_add_3, "iptrie_add_3");
+	exotic_add_test(&handle, &exotic_test_iptrie_add_4, "iptrie_add_4");
+	exotic_add_test(&handle, &exotic_test_iptrie_add_5, "iptrie_add_5");
+	exotic_add_test(&handle, &exotic_test_iptrie_size_1, "iptrie_size_1");
+	exotic_add_test(&handle, &exotic_test_iptrie_ipv4_1, "iptrie_ipv4_1");
+	exotic_add_test(&handle, &exotic_test_iptrie_ipv4_2, "iptrie_ipv4_2");
+	exotic_add_test(&handle, &exotic_test_iptrie_ipv4_3, "iptrie_ipv4_3");
+	exotic_add_test(&handle, &exotic_test_iptrie_ipv4_4, "iptrie_ipv4_4");
+	exotic_add_test(&handle, &exotic_test_iptrie_ipv4_5, "iptrie_ipv4_5");
+	exotic_add_test(&handle, &exotic_test_iptrie_ipv4_6, "iptrie_ipv4_6");
+	exotic_add_test(&handle, &exotic_test_iptrie_ipv4_7, "iptrie_ipv4_7");
+	exotic_add_test(&handle, &exotic_test_iptrie_ipv4_8, "iptrie_ipv4_8");
+	exotic_add_test(&handle, &exotic_test_iptrie_ipv4_9, "iptrie_ipv4_9");
+	exotic_add_test(&handle, &exotic_test_iptrie_ipv4_10, "iptrie_ipv4_10");
+	exotic_add_test(&handle, &exotic_test_iptrie_ipv4_11, "iptrie_ipv4_11");
+	exotic_add_test(&handle, &exotic_test_iptrie_ipv6_1, "iptrie_ipv6_1");
+	exotic_add_test(&handle, &exotic_test_iptrie_ipv6_2, "iptrie_ipv6_2");
+	exotic_add_test(&handle, &exotic_test_iptrie_ipv6_3, "iptrie_ipv6_3");
+	exotic_add_test(&handle, &exotic_test_iptrie_ipv6_4, "iptrie_ipv6_4");
+	exotic_add_test(&handle, &exotic_test_iptrie_ipv6_5, "iptrie_ipv6_5");
+	exotic_add_test(&handle, &exotic_test_iptrie_ipv6_6, "iptrie_ipv6_6");
+	exotic_add_test(&handle, &exotic_test_iptrie_ipv6_7, "iptrie_ipv6_7");
+	exotic_add_test(&handle, &exotic_test_iptrie_replace_1, "iptrie_replace_1");
+	exotic_add_test(&handle, &exotic_test_iptrie_replace_2, "iptrie_replace_2");
+	exotic_add_test(&handle, &exotic_test_iptrie_replace_3, "iptrie_replace_3");
+	exotic_add_test(&handle, &exotic_test_iptrie_all_1, "iptrie_all_1");
+	exotic_add_test(&handle, &exotic_test_iptrie_all_2, "iptrie_all_2");
+	exotic_add_test(&handle, &exotic_test_iptrie_all_3, "iptrie_all_3");
+	exotic_add_test(&handle, &exotic_test_iptrie_all_4, "iptrie_all_4");
+	exotic_add_test(&handle, &exotic_test_iptrie_all_5, "iptrie_all_5");
+	exotic_add_test(&handle, &exotic_test_iptrie_invalid_1, "iptrie_invalid_1");
+	exotic_add_test(&handle, &exotic_test_iptrie_destroy, "iptrie_destroy");
+	exotic_add_test(&handle, &exotic_test_iptrie_shutdown_network, "iptrie_shutdown_network");
+	exotic_add_test(&handle, &exotic_test_link_startup, "link_startup");
+	exotic_add_test(&handle, &exotic_test_link_hub_startup, "link_hub_startup");
+	exotic_add_test(&handle, &exotic_test_link_local_sid, "link_local_sid");
+	exotic_add_test(&handle, &exotic_test_link_peer_login, "link_peer_login");
+	exotic_add_test(&handle, &exotic_test_link_peer_gets_users, "link_peer_gets_users");
+	exotic_add_test(&handle, &exotic_test_link_remote_join, "link_remote_join");
+	exotic_add_test(&handle, &exotic_test_link_broadcast_local, "link_broadcast_local");
+	exotic_add_test(&handle, &exotic_test_link_broadcast_remote, "link_broadcast_remote");
+	exotic_add_test(&handle, &exotic_test_link_direct_to_remote, "link_direct_to_remote");
+	exotic_add_test(&handle, &exotic_test_link_direct_to_local, "link_direct_to_local");
+	exotic_add_test(&handle, &exotic_test_link_not_limited, "link_not_limited");
+	exotic_add_test(&handle, &exotic_test_link_spoofed_source, "link_spoofed_source");
+	exotic_add_test(&handle, &exotic_test_link_info_update, "link_info_update");
+	exotic_add_test(&handle, &exotic_test_link_nick_taken, "link_nick_taken");
+	exotic_add_test(&handle, &exotic_test_link_remote_quit, "link_remote_quit");
+	exotic_add_test(&handle, &exotic_test_link_local_quit, "link_local_quit");
+	exotic_add_test(&handle, &exotic_test_link_refused, "link_refused");
+	exotic_add_test(&handle, &exotic_test_link_drop, "link_drop");
+	exotic_add_test(&handle, &exotic_test_link_hub_shutdown, "link_hub_shutdown");
+	exotic_add_test(&handle, &exotic_test_link_shutdown, "link_shutdown");
+	exotic_add_test(&handle, &exotic_test_linkpeer_start, "linkpeer_start");
+	exotic_add_test(&handle, &exotic_test_linkpeer_tls, "linkpeer_tls");
+	exotic_add_test(&handle, &exotic_test_linkpeer_wrong_answer, "linkpeer_wrong_answer");
+	exotic_add_test(&handle, &exotic_test_linkpeer_wrong_keyprint, "linkpeer_wrong_keyprint");
+	exotic_add_test(&handle, &exotic_test_linkpeer_shutdown, "linkpeer_shutdown");
 	exotic_add_test(&handle, &exotic_test_list_create_destroy, "list_create_destroy");
 	exotic_add_test(&handle, &exotic_test_list_create, "list_create");
 	exotic_add_test(&handle, &exotic_test_list_append_1, "list_append_1");
@@ -1187,6 +1351,19 @@ int main(int argc, char** argv)
 	exotic_add_test(&handle, &exotic_test_log_verb_from_int_10, "log_verb_from_int_10");
 	exotic_add_test(&handle, &exotic_test_log_verb_from_int_11, "log_verb_from_int_11");
 	exotic_add_test(&handle, &exotic_test_log_verb_from_bad_str, "log_verb_from_bad_str");
+	exotic_add_test(&handle, &exotic_test_loopback_startup, "loopback_startup");
+	exotic_add_test(&handle, &exotic_test_loopback_hub_startup, "loopback_hub_startup");
+	exotic_add_test(&handle, &exotic_test_loopback_connect, "loopback_connect");
+	exotic_add_test(&handle, &exotic_test_loopback_login, "loopback_login");
+	exotic_add_test(&handle, &exotic_test_loopback_chat, "loopback_chat");
+	exotic_add_test(&handle, &exotic_test_loopback_handshake_timeout, "loopback_handshake_timeout");
+	exotic_add_test(&handle, &exotic_test_loopback_bad_cid, "loopback_bad_cid");
+	exotic_add_test(&handle, &exotic_test_loopback_users_survive_timeout, "loopback_users_survive_timeout");
+	exotic_add_test(&handle, &exotic_test_loopback_read_budget, "loopback_read_budget");
+	exotic_add_test(&handle, &exotic_test_loopback_mass_quit, "loopback_mass_quit");
+	exotic_add_test(&handle, &exotic_test_loopback_disconnect, "loopback_disconnect");
+	exotic_add_test(&handle, &exotic_test_loopback_hub_shutdown, "loopback_hub_shutdown");
+	exotic_add_test(&handle, &exotic_test_loopback_shutdown, "loopback_shutdown");
 	exotic_add_test(&handle, &exotic_test_test_message_refc_1, "test_message_refc_1");
 	exotic_add_test(&handle, &exotic_test_test_message_refc_2, "test_message_refc_2");
 	exotic_add_test(&handle, &exotic_test_test_message_refc_3, "test_message_refc_3");
@@ -1194,6 +1371,14 @@ int main(int argc, char** argv)
 	exotic_add_test(&handle, &exotic_test_test_message_refc_5, "test_message_refc_5");
 	exotic_add_test(&handle, &exotic_test_test_message_refc_6, "test_message_refc_6");
 	exotic_add_test(&handle, &exotic_test_test_message_refc_7, "test_message_refc_7");
+	exotic_add_test(&handle, &exotic_test_mempool_init, "mempool_init");
+	exotic_add_test(&handle, &exotic_test_mempool_alloc_zeroed, "mempool_alloc_zeroed");
+	exotic_add_test(&handle, &exotic_test_mempool_reuse, "mempool_reuse");
+	exotic_add_test(&handle, &exotic_test_mempool_max_free, "mempool_max_free");
+	exotic_add_test(&handle, &exotic_test_mempool_prewarm, "mempool_prewarm");
+	exotic_add_test(&handle, &exotic_test_mempool_prewarm_contiguous, "mempool_prewarm_contiguous");
+	exotic_add_test(&handle, &exotic_test_mempool_prewarm_returns_to_slab, "mempool_prewarm_returns_to_slab");
+	exotic_add_test(&handle, &exotic_test_mempool_destroy, "mempool_destroy");
 	exotic_add_test(&handle, &exotic_test_adc_message_first, "adc_message_first");
 	exotic_add_test(&handle, &exotic_test_adc_message_parse_1, "adc_message_parse_1");
 	exotic_add_test(&handle, &exotic_test_adc_message_parse_2, "adc_message_parse_2");
@@ -1277,6 +1462,11 @@ int main(int argc, char** argv)
 	exotic_add_test(&handle, &exotic_test_adc_message_empty_3, "adc_message_empty_3");
 	exotic_add_test(&handle, &exotic_test_adc_message_construct_source_1, "adc_message_construct_source_1");
 	exotic_add_test(&handle, &exotic_test_adc_message_construct_source_dest_1, "adc_message_construct_source_dest_1");
+	exotic_add_test(&handle, &exotic_test_adc_message_search_1, "adc_message_search_1");
+	exotic_add_test(&handle, &exotic_test_adc_message_search_2, "adc_message_search_2");
+	exotic_add_test(&handle, &exotic_test_adc_message_search_3, "adc_message_search_3");
+	exotic_add_test(&handle, &exotic_test_adc_message_search_4, "adc_message_search_4");
+	exotic_add_test(&handle, &exotic_test_adc_message_append_message, "adc_message_append_message");
 	exotic_add_test(&handle, &exotic_test_adc_message_last, "adc_message_last");
 	exotic_add_test(&handle, &exotic_test_is_num_0, "is_num_0");
 	exotic_add_test(&handle, &exotic_test_is_num_1, "is_num_1");
@@ -1586,6 +1776,23 @@ int main(int argc, char** argv)
 	exotic_add_test(&handle, &exotic_test_format_size_39, "format_size_39");
 	exotic_add_test(&handle, &exotic_test_format_size_40, "format_size_40");
 	exotic_add_test(&handle, &exotic_test_format_size_41, "format_size_41");
+	exotic_add_test(&handle, &exotic_test_pluginhooks_setup, "pluginhooks_setup");
+	exotic_add_test(&handle, &exotic_test_pluginhooks_first_member, "pluginhooks_first_member");
+	exotic_add_test(&handle, &exotic_test_pluginhooks_shared, "pluginhooks_shared");
+	exotic_add_test(&handle, &exotic_test_pluginhooks_auth, "pluginhooks_auth");
+	exotic_add_test(&handle, &exotic_test_pluginhooks_last_member, "pluginhooks_last_member");
+	exotic_add_test(&handle, &exotic_test_pluginhooks_match_loaded, "pluginhooks_match_loaded");
+	exotic_add_test(&handle, &exotic_test_pluginhooks_unload, "pluginhooks_unload");
+	exotic_add_test(&handle, &exotic_test_pluginhooks_shutdown, "pluginhooks_shutdown");
+	exotic_add_test(&handle, &exotic_test_ptrtable_create, "ptrtable_create");
+	exotic_add_test(&handle, &exotic_test_ptrtable_get_untouched, "ptrtable_get_untouched");
+	exotic_add_test(&handle, &exotic_test_ptrtable_set_null_untouched, "ptrtable_set_null_untouched");
+	exotic_add_test(&handle, &exotic_test_ptrtable_set_get, "ptrtable_set_get");
+	exotic_add_test(&handle, &exotic_test_ptrtable_set_same_segment, "ptrtable_set_same_segment");
+	exotic_add_test(&handle, &exotic_test_ptrtable_set_new_segment, "ptrtable_set_new_segment");
+	exotic_add_test(&handle, &exotic_test_ptrtable_out_of_range, "ptrtable_out_of_range");
+	exotic_add_test(&handle, &exotic_test_ptrtable_clear, "ptrtable_clear");
+	exotic_add_test(&handle, &exotic_test_ptrtable_destroy, "ptrtable_destroy");
 	exotic_add_test(&handle, &exotic_test_rbtree_create_destroy, "rbtree_create_destroy");
 	exotic_add_test(&handle, &exotic_test_rbtree_create_1, "rbtree_create_1");
 	exotic_add_test(&handle, &exotic_test_rbtree_size_0, "rbtree_size_0");
@@ -1614,6 +1821,19 @@ int main(int argc, char** argv)
 	exotic_add_test(&handle, &exotic_test_rbtree_iterate_10000, "rbtree_iterate_10000");
 	exotic_add_test(&handle, &exotic_test_rbtree_remove_10000, "rbtree_remove_10000");
 	exotic_add_test(&handle, &exotic_test_rbtree_destroy_1, "rbtree_destroy_1");
+	exotic_add_test(&handle, &exotic_test_sendbudget_startup, "sendbudget_startup");
+	exotic_add_test(&handle, &exotic_test_sendbudget_hub_startup, "sendbudget_hub_startup");
+	exotic_add_test(&handle, &exotic_test_sendbudget_login, "sendbudget_login");
+	exotic_add_test(&handle, &exotic_test_sendbudget_drained, "sendbudget_drained");
+	exotic_add_test(&handle, &exotic_test_sendbudget_fair_share, "sendbudget_fair_share");
+	exotic_add_test(&handle, &exotic_test_sendbudget_evict, "sendbudget_evict");
+	exotic_add_test(&handle, &exotic_test_sendbudget_evict_slowest, "sendbudget_evict_slowest");
+	exotic_add_test(&handle, &exotic_test_sendbudget_fast_users, "sendbudget_fast_users");
+	exotic_add_test(&handle, &exotic_test_sendbudget_resume, "sendbudget_resume");
+	exotic_add_test(&handle, &exotic_test_sendbudget_user_list, "sendbudget_user_list");
+	exotic_add_test(&handle, &exotic_test_sendbudget_quit_batch, "sendbudget_quit_batch");
+	exotic_add_test(&handle, &exotic_test_sendbudget_hub_shutdown, "sendbudget_hub_shutdown");
+	exotic_add_test(&handle, &exotic_test_sendbudget_shutdown, "sendbudget_shutdown");
 	exotic_add_test(&handle, &exotic_test_sid_create_pool, "sid_create_pool");
 	exotic_add_test(&handle, &exotic_test_sid_check_0a, "sid_check_0a");
 	exotic_add_test(&handle, &exotic_test_sid_check_0b, "sid_check_0b");
@@ -1634,6 +1854,22 @@ int main(int argc, char** argv)
 	exotic_add_test(&handle, &exotic_test_sid_remove_3, "sid_remove_3");
 	exotic_add_test(&handle, &exotic_test_sid_remove_4, "sid_remove_4");
 	exotic_add_test(&handle, &exotic_test_sid_destroy_pool, "sid_destroy_pool");
+	exotic_add_test(&handle, &exotic_test_sid_large_alloc_all, "sid_large_alloc_all");
+	exotic_add_test(&handle, &exotic_test_sid_large_reuse_lowest, "sid_large_reuse_lowest");
+	exotic_add_test(&handle, &exotic_test_sid_large_destroy, "sid_large_destroy");
+	exotic_add_test(&handle, &exotic_test_sid_delay_setup, "sid_delay_setup");
+	exotic_add_test(&handle, &exotic_test_sid_delay_not_reused, "sid_delay_not_reused");
+	exotic_add_test(&handle, &exotic_test_sid_delay_reused_later, "sid_delay_reused_later");
+	exotic_add_test(&handle, &exotic_test_sid_delay_reused_when_full, "sid_delay_reused_when_full");
+	exotic_add_test(&handle, &exotic_test_sid_delay_disable, "sid_delay_disable");
+	exotic_add_test(&handle, &exotic_test_sid_claim_free, "sid_claim_free");
+	exotic_add_test(&handle, &exotic_test_sid_claim_used, "sid_claim_used");
+	exotic_add_test(&handle, &exotic_test_sid_claim_out_of_range, "sid_claim_out_of_range");
+	exotic_add_test(&handle, &exotic_test_sid_claim_alloc_skips, "sid_claim_alloc_skips");
+	exotic_add_test(&handle, &exotic_test_sid_range_alloc, "sid_range_alloc");
+	exotic_add_test(&handle, &exotic_test_sid_range_free, "sid_range_free");
+	exotic_add_test(&handle, &exotic_test_sid_range_claim, "sid_range_claim");
+	exotic_add_test(&handle, &exotic_test_sid_delay_shutdown, "sid_delay_shutdown");
 	exotic_add_test(&handle, &exotic_test_sid_to_str_1, "sid_to_str_1");
 	exotic_add_test(&handle, &exotic_test_sid_to_str_2, "sid_to_str_2");
 	exotic_add_test(&handle, &exotic_test_sid_to_str_3, "sid_to_str_3");
@@ -1718,6 +1954,10 @@ int main(int argc, char** argv)
 	exotic_add_test(&handle, &exotic_test_hash_tiger_5, "hash_tiger_5");
 	exotic_add_test(&handle, &exotic_test_hash_tiger_6, "hash_tiger_6");
 	exotic_add_test(&handle, &exotic_test_hash_tiger_7, "hash_tiger_7");
+	exotic_add_test(&handle, &exotic_test_hash_tiger_batch_cid, "hash_tiger_batch_cid");
+	exotic_add_test(&handle, &exotic_test_hash_tiger_batch_odd_count, "hash_tiger_batch_odd_count");
+	exotic_add_test(&handle, &exotic_test_hash_tiger_batch_mixed_lengths, "hash_tiger_batch_mixed_lengths");
+	exotic_add_test(&handle, &exotic_test_hash_tiger_batch_same_blocks, "hash_tiger_batch_same_blocks");
 	exotic_add_test(&handle, &exotic_test_timer_setup, "timer_setup");
 	exotic_add_test(&handle, &exotic_test_timer_check_timeout_0, "timer_check_timeout_0");
 	exotic_add_test(&handle, &exotic_test_timer_add_event_1, "timer_add_event_1");
@@ -1729,6 +1969,12 @@ int main(int argc, char** argv)
 	exotic_add_test(&handle, &exotic_test_timer_check_5_events_1, "timer_check_5_events_1");
 	exotic_add_test(&handle, &exotic_test_timer_process_5_events_1, "timer_process_5_events_1");
 	exotic_add_test(&handle, &exotic_test_timer_shutdown, "timer_shutdown");
+	exotic_add_test(&handle, &exotic_test_tlsticket_full_handshake, "tlsticket_full_handshake");
+	exotic_add_test(&handle, &exotic_test_tlsticket_resume_current_key, "tlsticket_resume_current_key");
+	exotic_add_test(&handle, &exotic_test_tlsticket_resume_previous_key, "tlsticket_resume_previous_key");
+	exotic_add_test(&handle, &exotic_test_tlsticket_resume_renewed, "tlsticket_resume_renewed");
+	exotic_add_test(&handle, &exotic_test_tlsticket_older_key_full_handshake, "tlsticket_older_key_full_handshake");
+	exotic_add_test(&handle, &exotic_test_tlsticket_shutdown, "tlsticket_shutdown");
 	exotic_add_test(&handle, &exotic_test_tokenizer_basic_0, "tokenizer_basic_0");
 	exotic_add_test(&handle, &exotic_test_tokenizer_basic_1, "tokenizer_basic_1");
 	exotic_add_test(&handle, &exotic_test_tokenizer_basic_1a, "tokenizer_basic_1a");
@@ -1773,6 +2019,17 @@ int main(int argc, char** argv)
 	exotic_add_test(&handle, &exotic_test_tokenizer_settings_11, "tokenizer_settings_11");
 	exotic_add_test(&handle, &exotic_test_tokenizer_free_1, "tokenizer_free_1");
 	exotic_add_test(&handle, &exotic_test_tokenizer_free_2, "tokenizer_free_2");
+	exotic_add_test(&handle, &exotic_test_upgrade_startup, "upgrade_startup");
+	exotic_add_test(&handle, &exotic_test_upgrade_hub_startup, "upgrade_hub_startup");
+	exotic_add_test(&handle, &exotic_test_upgrade_login, "upgrade_login");
+	exotic_add_test(&handle, &exotic_test_upgrade_write_user, "upgrade_write_user");
+	exotic_add_test(&handle, &exotic_test_upgrade_read_user, "upgrade_read_user");
+	exotic_add_test(&handle, &exotic_test_upgrade_read_user_truncated, "upgrade_read_user_truncated");
+	exotic_add_test(&handle, &exotic_test_upgrade_read_user_bad_credentials, "upgrade_read_user_bad_credentials");
+	exotic_add_test(&handle, &exotic_test_upgrade_read_user_garbage, "upgrade_read_user_garbage");
+	exotic_add_test(&handle, &exotic_test_upgrade_write_user_no_info, "upgrade_write_user_no_info");
+	exotic_add_test(&handle, &exotic_test_upgrade_hub_shutdown, "upgrade_hub_shutdown");
+	exotic_add_test(&handle, &exotic_test_upgrade_shutdown, "upgrade_shutdown");
 	exotic_add_test(&handle, &exotic_test_um_init_1, "um_init_1");
 	exotic_add_test(&handle, &exotic_test_um_shutdown_1, "um_shutdown_1");
 	exotic_add_test(&handle, &exotic_test_um_shutdown_2, "um_shutdown_2");
@@ -1785,6 +2042,14 @@ int main(int argc, char** argv)
 	exotic_add_test(&handle, &exotic_test_um_size_3, "um_size_3");
 	exotic_add_test(&handle, &exotic_test_um_remove_2, "um_remove_2");
 	exotic_add_test(&handle, &exotic_test_um_shutdown_4, "um_shutdown_4");
+	exotic_add_test(&handle, &exotic_test_vhubsni_start, "vhubsni_start");
+	exotic_add_test(&handle, &exotic_test_vhubsni_handover, "vhubsni_handover");
+	exotic_add_test(&handle, &exotic_test_vhubsni_other_name_stays, "vhubsni_other_name_stays");
+	exotic_add_test(&handle, &exotic_test_vhubsni_stop, "vhubsni_stop");
+	exotic_add_test(&handle, &exotic_test_vhubsni_stopped_after_handshake, "vhubsni_stopped_after_handshake");
+	exotic_add_test(&handle, &exotic_test_vhubsni_stopped_during_handshake, "vhubsni_stopped_during_handshake");
+	exotic_add_test(&handle, &exotic_test_vhubsni_listener_alive, "vhubsni_listener_alive");
+	exotic_add_test(&handle, &exotic_test_vhubsni_shutdown, "vhubsni_shutdown");
 	exotic_add_test(&handle, &exotic_test_exit_log, "exit_log");
 
 	return exotic_run(&handle);
@@ -0,0 +1,165 @@
+#include <uhub.h>
+
+#include "loopback_client.h"
+
+#define AUTHREQ_CLIENTS 4
+
+static struct hub_config ar_config;
+static struct acl_handle ar_acl;
+static struct hub_info* ar_hub;
+static struct loopback_client ar_clients[AUTHREQ_CLIENTS];
+static struct plugin_handle ar_async_plugin;
+static struct plugin_handle ar_sync_plugin;
+static struct plugin_auth_request* ar_request;
+
+/* Stands in for mod_auth_sqlite, the lookup is completed by the test */
+static plugin_st ar_get_user_async(struct plugin_handle* plugin, struct plugin_auth_request* request, const char* nickname)
+{
+	ar_request = request;
+	return st_pending;
+}
+
+/* Stands in for the plugin that replaced it on reload */
+static plugin_st ar_get_user(struct plugin_handle* plugin, const char* nickname, struct auth_info* info)
+{
+	if (strcmp(nickname, "dave"))
+		return st_default;
+
+	memset(info, 0, sizeof(struct auth_info));
+	strcpy(info->nickname, nickname);
+	strcpy(info->password, "secret");
+	info->credentials = auth_cred_user;
+	return st_allow;
+}
+
+static void ar_complete(plugin_st status, const char* nickname)
+{
+	struct auth_info info;
+
+	memset(&info, 0, sizeof(info));
+	strcpy(info.nickname, nickname);
+	strcpy(info.password, "secret");
+	info.credentials = auth_cred_user;
+	acl_request_complete((struct auth_request*) ar_request, status, &info);
+	ar_request = NULL;
+}
+
+static void ar_process()
+{
+	lbc_process(ar_hub);
+}
+
+/* Start the login, which waits for the asynchronous lookup */
+static int ar_login(int index, const char* nick)
+{
+	struct loopback_client* client = &ar_clients[index];
+	char ip[32];
+
+	snprintf(ip, sizeof(ip), "10.3.0.%d", index + 1);
+	if (!lbc_connect(ar_hub, client, ip, nick))
+		return 0;
+
+	client->password = "secret";
+	lbc_send_support(client);
+	ar_process();
+	return !client->logged_in && ar_request && acl_request_pending_count(ar_hub) == 1;
+}
+
+static enum auth_credentials ar_get_credentials(struct loopback_client* client)
+{
+	struct hub_user* user = uman_get_user_by_sid(ar_hub->users, string_to_sid(client->sid));
+	return user ? user->credentials : auth_cred_none;
+}
+
+EXO_TEST(authrequest_startup, {
+	net_backend_use_loopback(LOOPBACK_EPOCH);
+	return net_initialize() == 0;
+});
+
+EXO_TEST(authrequest_hub_startup, {
+	config_defaults(&ar_config);
+	ar_config.server_port = 0;
+	if (acl_initialize(&ar_config, &ar_acl) == -1)
+		return 0;
+	ar_hub = hub_start_service(&ar_config);
+	if (!ar_hub)
+		return 0;
+	hub_set_variables(ar_hub, &ar_acl);
+
+	ar_hub->plugins = hub_malloc_zero(sizeof(struct uhub_plugins));
+	if (!ar_hub->plugins || plugin_initialize(NULL, ar_hub) < 0)
+		return 0;
+	ar_async_plugin.funcs.auth_get_user_async = ar_get_user_async;
+	ar_sync_plugin.funcs.auth_get_user = ar_get_user;
+	list_append(ar_hub->plugins->loaded, &ar_async_plugin);
+	return plugin_hooks_update(ar_hub->plugins) == 0 && ar_hub->auth_requests != NULL;
+});
+
+EXO_TEST(authrequest_complete_registered, {
+	struct loopback_client* client = &ar_clients[0];
+	if (!ar_login(0, "alice"))
+		return 0;
+	ar_complete(st_allow, "alice");
+	ar_process();
+	return client->logged_in && ar_get_credentials(client) == auth_cred_user && !acl_request_pending_count(ar_hub);
+});
+
+EXO_TEST(authrequest_complete_unknown, {
+	struct loopback_client* client = &ar_clients[1];
+	if (!ar_login(1, "bob"))
+		return 0;
+	ar_complete(st_default, "bob");
+	ar_process();
+	return client->logged_in && ar_get_credentials(client) == auth_cred_guest && !acl_request_pending_count(ar_hub);
+});
+
+EXO_TEST(authrequest_cancel, {
+	struct loopback_client* client = &ar_clients[2];
+	size_t users = ar_hub->users->count;
+	if (!ar_login(2, "carol"))
+		return 0;
+	lbc_disconnect(client);
+	ar_process();
+	if (acl_request_pending_count(ar_hub) != 1)
+		return 0;
+	/* The plugin completes the lookup after the user left */
+	ar_complete(st_allow, "carol");
+	ar_process();
+	return !acl_request_pending_count(ar_hub) && ar_hub->users->count == users;
+});
+
+EXO_TEST(authrequest_reload_pending, {
+	struct loopback_client* client = &ar_clients[3];
+	if (!ar_login(3, "dave"))
+		return 0;
+
+	/* Reload: the plugin completes its lookups as it is unloaded, and is replaced */
+	list_remove(ar_hub->plugins->loaded, &ar_async_plugin);
+	ar_complete(st_default, "dave");
+	acl_request_plugin_unload(ar_hub, &ar_async_plugin);
+	list_append(ar_hub->plugins->loaded, &ar_sync_plugin);
+	if (plugin_hooks_update(ar_hub->plugins) < 0)
+		return 0;
+
+	ar_process();
+	return lbc_received(client, "IGPA ") && client->logged_in && ar_get_credentials(client) == auth_cred_user && !acl_request_pending_count(ar_hub);
+});
+
+EXO_TEST(authrequest_hub_shutdown, {
+	int n;
+	for (n = 0; n < AUTHREQ_CLIENTS; n++)
+		lbc_disconnect(&ar_clients[n]);
+	ar_process();
+	list_remove(ar_hub->plugins->loaded, &ar_sync_plugin);
+	hub_free_variables(ar_hub);
+	acl_shutdown(&ar_acl);
+	free_config(&ar_config);
+	hub_shutdown_service(ar_hub);
+	return 1;
+});
+
+EXO_TEST(authrequest_shutdown, {
+	int ret = net_destroy();
+	net_backend_use_loopback(0);
+	return ret == 0;
+});
@@ -0,0 +1,148 @@
+#include <uhub.h>
+
+#include "loopback_client.h"
+
+#define BALANCE_CLIENTS 3
+
+static struct hub_config bl_config;
+static struct acl_handle bl_acl;
+static struct hub_info* bl_hub;
+static struct loopback_client bl_clients[BALANCE_CLIENTS];
+
+static void bl_process()
+{
+	lbc_process(bl_hub);
+}
+
+/* Log in a client, returns 1 if it got in */
+static int bl_login(int index)
+{
+	struct loopback_client* client = &bl_clients[index];
+	char ip[32];
+	char nick[32];
+
+	snprintf(ip, sizeof(ip), "10.2.0.%d", index + 1);
+	snprintf(nick, sizeof(nick), "balance-%d", index);
+	if (!lbc_connect(bl_hub, client, ip, nick))
+		return 0;
+
+	lbc_send_support(client);
+	bl_process();
+	return client->logged_in;
+}
+
+/* Pretend a load report arrived from the given peer */
+static int bl_report(const char* ip, int port, const char* report)
+{
+	struct sockaddr_storage addr;
+	socklen_t addr_len;
+
+	if (ip_convert_address(ip, port, (struct sockaddr*) &addr, &addr_len) == -1)
+		return -2;
+	return balance_handle_report(bl_hub, (struct sockaddr*) &addr, addr_len, report);
+}
+
+EXO_TEST(balance_startup, {
+	net_backend_use_loopback(LOOPBACK_EPOCH);
+	return net_initialize() == 0;
+});
+
+EXO_TEST(balance_hub_startup, {
+	config_defaults(&bl_config);
+	bl_config.server_port = 0;
+	bl_config.max_users = 2;
+	apply_config(&bl_config, "server_bind_addr", "127.0.0.1", 1);
+	apply_config(&bl_config, "balance_port", "24512", 1);
+	apply_config(&bl_config, "balance_peers", "127.0.0.1:24513=adc://a:1511, 127.0.0.1:24514=adc://b:1511, 127.0.0.1:24516", 1);
+	if (acl_initialize(&bl_config, &bl_acl) == -1)
+		return 0;
+	bl_hub = hub_start_service(&bl_config);
+	if (!bl_hub)
+		return 0;
+	hub_set_variables(bl_hub, &bl_acl);
+	return bl_hub->balance != NULL;
+});
+
+EXO_TEST(balance_no_reports, {
+	return !balance_should_redirect(bl_hub) && !balance_redirect(bl_hub);
+});
+
+EXO_TEST(balance_report_unknown_peer, {
+	return bl_report("127.0.0.1", 24515, "LOAD 1 10 0 0 adc://x:1511") == -1;
+});
+
+EXO_TEST(balance_report_invalid, {
+	return bl_report("127.0.0.1", 24513, "LOAD 1 10") == -1 && bl_report("127.0.0.1", 24513, "HELLO") == -1;
+});
+
+EXO_TEST(balance_report_accepted, {
+	/* The address in the report is not used */
+	return bl_report("127.0.0.1", 24513, "LOAD 5 10 3 0") == 0 && bl_report("127.0.0.1", 24514, "LOAD 1 10 3 0 adc://evil:1511") == 0;
+});
+
+EXO_TEST(balance_not_loaded, {
+	/* An idle hub keeps its users, even if another hub is less loaded */
+	return !balance_should_redirect(bl_hub) && bl_login(0) && bl_login(1);
+});
+
+EXO_TEST(balance_least_loaded, {
+	const char* address = balance_redirect(bl_hub);
+	return balance_should_redirect(bl_hub) && address && !strcmp(address, "adc://b:1511");
+});
+
+EXO_TEST(balance_skip_overloaded, {
+	const char* address;
+	if (bl_report("127.0.0.1", 24514, "LOAD 1 10 900 0") != 0)
+		return 0;
+	address = balance_redirect(bl_hub);
+	return address && !strcmp(address, "adc://a:1511");
+});
+
+EXO_TEST(balance_skip_congested, {
+	if (bl_report("127.0.0.1", 24514, "LOAD 4 10 0 4") != 0)
+		return 0;
+	return !strcmp(balance_redirect(bl_hub), "adc://a:1511");
+});
+
+EXO_TEST(balance_skip_huge_load, {
+	/* 4294968 * 1000 users would wrap around to a load of 672 */
+	if (bl_report("127.0.0.1", 24514, "LOAD 4294968 1000 0 0") != 0)
+		return 0;
+	return !strcmp(balance_redirect(bl_hub), "adc://a:1511");
+});
+
+EXO_TEST(balance_skip_no_address, {
+	if (bl_report("127.0.0.1", 24516, "LOAD 0 10 0 0 adc://c:1511") != 0)
+		return 0;
+	return !strcmp(balance_redirect(bl_hub), "adc://a:1511");
+});
+
+EXO_TEST(balance_redirect_login, {
+	return !bl_login(2) && bl_clients[2].closed && strstr(bl_clients[2].received, " RDadc://a:1511") != NULL;
+});
+
+EXO_TEST(balance_reports_expire, {
+	net_backend_advance_time(6);
+	bl_process();
+	return !balance_should_redirect(bl_hub) && !bl_login(2) && bl_clients[2].closed && !strstr(bl_clients[2].received, " RD");
+});
+
+EXO_TEST(balance_hub_shutdown, {
+	int n;
+	for (n = 0; n < BALANCE_CLIENTS; n++)
+	{
+		lbc_disconnect(&bl_clients[n]);
+	}
+	bl_process();
+	hub_free_variables(bl_hub);
+	acl_shutdown(&bl_acl);
+	free_config(&bl_config);
+	hub_shutdown_service(bl_hub);
+	return 1;
+});
+
+EXO_TEST(balance_shutdown, {
+	int ret = net_destroy();
+	net_backend_use_loopback(0);
+	return ret == 0;
+});
@@ -3,6 +3,14 @@
 static struct hub_config config1;
 static struct hub_config config2;
 static struct hub_config config3;
+static struct hub_config config4;
+static int config_restart;
+
+static void config_changed(const char* key, int restart, void* ptr)
+{
+	if (restart)
+		config_restart++;
+}
 
 EXO_TEST(zero_configs, {
 	memset(&config1, 0, sizeof(struct hub_config));
@@ -189,9 +197,23 @@ EXO_TEST(remove_config_file, {
 	return 1;
 });
 
+EXO_TEST(compare_config_1, {
+	return compare_config(&config2, &config3, config_changed, NULL) == 0 && config_restart == 0;
+});
+
+EXO_TEST(compare_config_2, {
+	config_defaults(&config4);
+	return compare_config(&config1, &config4, config_changed, NULL) == 3 && config_restart == 2;
+});
+
+EXO_TEST(compare_config_3, {
+	return !apply_config(&config4, "hub_name", "renamed", 501) && compare_config(&config3, &config4, NULL, NULL) == 4;
+});
+
 EXO_TEST(free_configs, {
 	free_config(&config1);
 	free_config(&config2);
 	free_config(&config3);
+	free_config(&config4);
 	return 1;
 });
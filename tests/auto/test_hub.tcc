@@ -3,6 +3,17 @@
 static struct hub_config g_config;
 static struct acl_handle g_acl;
 static struct hub_info* g_hub;
+static struct hub_config g_reload;
+
+static int hub_write_file(const char* filename, const char* data)
+{
+	FILE* fp = fopen(filename, "w");
+	if (!fp)
+		return 0;
+	fputs(data, fp);
+	fclose(fp);
+	return 1;
+}
 
 /*
 static void create_test_user()
@@ -43,6 +54,76 @@ EXO_TEST(hub_variables_startup, {
 
 /*** HUB IS OPERATIONAL HERE! ***/
 
+EXO_TEST(hub_acl_ban_nick_1, { return !acl_is_user_banned(&g_acl, "exotic-tester"); });
+EXO_TEST(hub_acl_ban_nick_2, { return acl_user_ban_nick(&g_acl, "exotic-tester") == 0; });
+EXO_TEST(hub_acl_ban_nick_3, { return acl_user_ban_nick(&g_acl, "exotic-tester") == 0; });
+EXO_TEST(hub_acl_ban_nick_4, { return acl_is_user_banned(&g_acl, "exotic-tester"); });
+EXO_TEST(hub_acl_ban_nick_5, { return acl_is_user_banned(&g_acl, "Exotic-Tester"); });
+EXO_TEST(hub_acl_ban_nick_6, { return !acl_is_user_denied(&g_acl, "exotic-tester"); });
+EXO_TEST(hub_acl_unban_nick_1, { return acl_user_unban_nick(&g_acl, "EXOTIC-TESTER") == 0; });
+EXO_TEST(hub_acl_unban_nick_2, { return !acl_is_user_banned(&g_acl, "exotic-tester"); });
+EXO_TEST(hub_acl_unban_nick_3, { return acl_user_unban_nick(&g_acl, "exotic-tester") == -1; });
+
+EXO_TEST(hub_acl_ban_cid_1, { return acl_user_ban_cid(&g_acl, "3AGHMAASJA2RFNM22AA6753V7B7DYEPNTIWHBAY") == 0; });
+EXO_TEST(hub_acl_ban_cid_2, { return acl_is_cid_banned(&g_acl, "3AGHMAASJA2RFNM22AA6753V7B7DYEPNTIWHBAY"); });
+EXO_TEST(hub_acl_ban_cid_3, { return !acl_is_cid_banned(&g_acl, "3AGHMAASJA2RFNM22AA6753V7B7DYEPNTIWHBAA"); });
+EXO_TEST(hub_acl_unban_cid_1, { return acl_user_unban_cid(&g_acl, "3AGHMAASJA2RFNM22AA6753V7B7DYEPNTIWHBAY") == 0; });
+EXO_TEST(hub_acl_unban_cid_2, { return !acl_is_cid_banned(&g_acl, "3AGHMAASJA2RFNM22AA6753V7B7DYEPNTIWHBAY"); });
+
+EXO_TEST(hub_reconfigure_1, {
+	if (!hub_write_file("reload.acl", "deny_nick reloaded-nick\n"))
+		return 0;
+	config_defaults(&g_reload);
+	g_reload.server_port = 65111;
+	apply_config(&g_reload, "hub_name", "reloaded", 1);
+	apply_config(&g_reload, "file_acl", "reload.acl", 2);
+	return hub_reconfigure(g_hub, &g_reload) == 0 && g_hub->status == hub_status_running;
+});
+
+EXO_TEST(hub_reconfigure_2, { return str_match(g_config.hub_name, "reloaded") && acl_is_user_denied(&g_acl, "reloaded-nick"); });
+
+EXO_TEST(hub_reconfigure_3, {
+	/* Changes made at runtime survive a reload, as long as the file is unchanged */
+	acl_user_ban_nick(&g_acl, "runtime-nick");
+	config_defaults(&g_reload);
+	g_reload.server_port = 65111;
+	apply_config(&g_reload, "file_acl", "reload.acl", 1);
+	return hub_reconfigure(g_hub, &g_reload) == 0 && acl_is_user_banned(&g_acl, "runtime-nick") && str_match(g_config.hub_name, "uhub");
+});
+
+EXO_TEST(hub_reconfigure_4, {
+	config_defaults(&g_reload);
+	g_reload.server_port = 65111;
+	hub_reconfigure(g_hub, &g_reload);
+	return !acl_is_user_denied(&g_acl, "reloaded-nick") && !acl_is_user_banned(&g_acl, "runtime-nick") && remove("reload.acl") == 0;
+});
+
+EXO_TEST(hub_vhub_start, {
+	if (!hub_write_file("vhub.conf", "server_port = 65112\nhub_name = virtual\n") || !hub_write_file("vhubs.conf", "vhub.conf\n"))
+		return 0;
+	apply_config(&g_config, "file_virtual_hubs", "vhubs.conf", 1);
+	return vhub_start(g_hub) == 1 && vhub_start(g_hub) == 1;
+});
+
+EXO_TEST(hub_vhub_process, { return vhub_process(g_hub) == 0 && g_hub->status == hub_status_running; });
+
+EXO_TEST(hub_vhub_reconfigure_1, {
+	vhub_reconfigure(g_hub);
+	return vhub_count() == 1;
+});
+
+EXO_TEST(hub_vhub_reconfigure_2, {
+	if (!hub_write_file("vhubs.conf", "# none\n"))
+		return 0;
+	vhub_reconfigure(g_hub);
+	return vhub_count() == 0;
+});
+
+EXO_TEST(hub_vhub_shutdown, {
+	vhub_shutdown();
+	return vhub_count() == 0 && remove("vhub.conf") == 0 && remove("vhubs.conf") == 0;
+});
+
 EXO_TEST(hub_variables_shutdown, {
 	hub_free_variables(g_hub);
 	return 1;
@@ -0,0 +1,81 @@
+#include <uhub.h>
+
+#define INF_TABLE_LINE "BINF AAAB IDGNSSMURMD7K466NGZIHU65TP3S3UZSQ6MN5B2RI NItester DEhello\\sworld SL3 SS1024 VE++\\s0.868 SUTCP4,UDP4\n"
+
+static struct adc_message* it_info = 0;
+static struct inf_table* it_table1 = 0;
+static struct inf_table* it_table2 = 0;
+static size_t it_interned = 0;
+
+static int it_update(const char* line, const char* expect, int changed)
+{
+	struct adc_message* cmd = adc_msg_parse(line, strlen(line));
+	int ret = cmd && inf_table_update(it_table1, cmd) == changed && !strcmp(cmd->cache, expect);
+	adc_msg_free(cmd);
+	return ret;
+}
+
+static int it_render(const char* expect)
+{
+	struct adc_message* msg = inf_table_render(it_table1);
+	int ret = msg && !strcmp(msg->cache, expect) && msg->source == it_info->source;
+	adc_msg_free(msg);
+	return ret;
+}
+
+EXO_TEST(inftable_create, {
+	it_interned = inf_table_interned();
+	it_info = adc_msg_parse(INF_TABLE_LINE, strlen(INF_TABLE_LINE));
+	it_table1 = inf_table_create(it_info);
+	it_table2 = inf_table_create(it_info);
+	return it_table1 && it_table2;
+});
+
+EXO_TEST(inftable_get_1, { return !strcmp(inf_table_get(it_table1, "NI"), "tester"); });
+EXO_TEST(inftable_get_2, { return !strcmp(inf_table_get(it_table1, "DE"), "hello\\sworld"); });
+EXO_TEST(inftable_get_3, { return !strcmp(inf_table_get(it_table1, "SU"), "TCP4,UDP4"); });
+EXO_TEST(inftable_get_4, { return inf_table_get(it_table1, "EM") == NULL; });
+
+EXO_TEST(inftable_interned_1, {
+	/* SL, VE and SU */
+	return inf_table_interned() == it_interned + 3;
+});
+
+EXO_TEST(inftable_interned_2, {
+	return inf_table_get(it_table1, "VE") == inf_table_get(it_table2, "VE") && inf_table_get(it_table1, "NI") != inf_table_get(it_table2, "NI");
+});
+
+EXO_TEST(inftable_render, { return it_render(INF_TABLE_LINE); });
+
+EXO_TEST(inftable_update_1, { return it_update("BINF AAAB SS2048\n", "BINF AAAB SS2048\n", 1); });
+EXO_TEST(inftable_update_2, { return !strcmp(inf_table_get(it_table1, "SS"), "2048"); });
+
+EXO_TEST(inftable_update_unchanged, { return it_update("BINF AAAB SL3 SS4096 NItester\n", "BINF AAAB SS4096\n", 1); });
+EXO_TEST(inftable_update_none, { return it_update("BINF AAAB SL3\n", "BINF AAAB\n", 0); });
+EXO_TEST(inftable_update_repeated_1, { return it_update("BINF AAAB SL3 SL5\n", "BINF AAAB SL3 SL5\n", 1) && !strcmp(inf_table_get(it_table1, "SL"), "5"); });
+EXO_TEST(inftable_update_repeated_2, { return it_update("BINF AAAB SL5 SL3\n", "BINF AAAB SL5 SL3\n", 1) && !strcmp(inf_table_get(it_table1, "SL"), "3"); });
+EXO_TEST(inftable_update_add, { return it_update("BINF AAAB EMme@example.com\n", "BINF AAAB EMme@example.com\n", 1); });
+EXO_TEST(inftable_update_remove, { return it_update("BINF AAAB DE\n", "BINF AAAB DE\n", 1) && !inf_table_get(it_table1, "DE"); });
+EXO_TEST(inftable_update_remove_missing, { return it_update("BINF AAAB DE\n", "BINF AAAB\n", 0); });
+
+EXO_TEST(inftable_update_interned, {
+	/* The old version is still used by the other table */
+	return it_update("BINF AAAB VE++\\s0.870\n", "BINF AAAB VE++\\s0.870\n", 1) && inf_table_interned() == it_interned + 4;
+});
+
+EXO_TEST(inftable_render_update, {
+	return it_render("BINF AAAB IDGNSSMURMD7K466NGZIHU65TP3S3UZSQ6MN5B2RI NItester SL3 SS4096 VE++\\s0.870 SUTCP4,UDP4 EMme@example.com\n");
+});
+
+EXO_TEST(inftable_destroy_1, {
+	inf_table_destroy(it_table2);
+	it_table2 = 0;
+	return inf_table_interned() == it_interned + 3;
+});
+
+EXO_TEST(inftable_destroy_2, {
+	inf_table_destroy(it_table1);
+	it_table1 = 0;
+	adc_msg_free(it_info);
+	return inf_table_interned() == it_interned;
+});
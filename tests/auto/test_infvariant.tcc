@@ -0,0 +1,120 @@
+#include <uhub.h>
+
+#define VARIANT_INF "BINF AAAB NIFriend IDGNSSMURMD7K466NGZIHU65TP3S3UZSQ6MN5B2RI SUTCP4,ADC0 I4192.168.1.2 DEdescription KPSHA256/ABCDEFGH\n"
+
+static struct hub_user* var_source = 0;
+static struct hub_user* var_tls    = 0;
+static struct hub_user* var_plain  = 0;
+static struct hub_user* var_lowbw  = 0;
+
+static struct hub_user* var_create_user(sid_t sid, const char* address, const char* inf)
+{
+	struct hub_user* user = (struct hub_user*) hub_malloc_zero(sizeof(struct hub_user));
+	struct adc_message* info = adc_msg_parse(inf, strlen(inf));
+	user->id.sid = sid;
+	ip_convert_to_binary(address, &user->id.addr);
+	user_set_info(user, info);
+	adc_msg_free(info);
+	return user;
+}
+
+static void var_destroy_user(struct hub_user* user)
+{
+	user_set_info(user, NULL);
+	hub_free(user);
+}
+
+static int var_has(struct adc_message* msg, const char* prefix)
+{
+	return adc_msg_has_named_argument(msg, prefix);
+}
+
+EXO_TEST(infvariant_setup, {
+	var_source = var_create_user(1, "10.0.0.5", VARIANT_INF);
+	var_tls    = var_create_user(2, "10.0.0.6", "BINF AAAC NITls SUTCP4,ADCS\n");
+	var_plain  = var_create_user(3, "10.0.0.7", "BINF AAAD NIPlain SUTCP4\n");
+	var_lowbw  = var_create_user(4, "10.0.0.8", "BINF AAAE NILow SUADC0\n");
+	user_flag_set(var_lowbw, flag_low_bw);
+	return var_source->info && var_tls->info && var_plain->info && var_lowbw->info;
+});
+
+EXO_TEST(infvariant_tls_peer, {
+	return user_flag_get(var_source, flag_tls_peer) && user_flag_get(var_tls, flag_tls_peer) && !user_flag_get(var_plain, flag_tls_peer) && user_flag_get(var_lowbw, flag_tls_peer);
+});
+
+EXO_TEST(infvariant_classes, {
+	return user_get_info_variant(var_source, var_source) == info_variant_full &&
+		user_get_info_variant(var_source, var_tls) == info_variant_full &&
+		user_get_info_variant(var_source, var_plain) == info_variant_plain &&
+		user_get_info_variant(var_source, var_lowbw) == info_variant_low_bandwidth &&
+		user_get_info_variant(NULL, var_plain) == info_variant_plain;
+});
+
+EXO_TEST(infvariant_self, { return user_get_info(var_source, var_source) == var_source->info; });
+EXO_TEST(infvariant_full, { return user_get_info(var_source, var_tls) == var_source->info; });
+
+EXO_TEST(infvariant_plain, {
+	struct adc_message* msg = user_get_info(var_source, var_plain);
+	return msg != var_source->info && !var_has(msg, "KP") && var_has(msg, "DE") && var_has(msg, "I4");
+});
+
+EXO_TEST(infvariant_cached, {
+	return user_get_info(var_source, var_plain) == var_source->info_variants[info_variant_plain];
+});
+
+EXO_TEST(infvariant_low_bandwidth, {
+	struct adc_message* msg = user_get_info(var_source, var_lowbw);
+	return msg != var_source->info && var_has(msg, "KP") && !var_has(msg, "DE") && var_has(msg, "NI");
+});
+
+EXO_TEST(infvariant_nat, {
+	struct adc_message* msg;
+	char* address;
+	int ret;
+	user_flag_set(var_source, flag_nat);
+	user_flag_set(var_tls, flag_nat);
+	msg = user_get_info(var_source, var_tls);
+	address = adc_msg_get_named_argument(msg, "I4");
+	ret = address && !strcmp(address, "10.0.0.5") && var_has(msg, "KP");
+	hub_free(address);
+	user_flag_unset(var_source, flag_nat);
+	user_flag_unset(var_tls, flag_nat);
+	return ret;
+});
+
+EXO_TEST(infvariant_nat_other, {
+	/* Only users behind the same NAT get the rewritten address */
+	user_flag_set(var_source, flag_nat);
+	return user_get_info_variant(var_source, var_plain) == info_variant_plain;
+});
+
+EXO_TEST(infvariant_invalidate, {
+	struct adc_message* info = adc_msg_parse("BINF AAAB NIFriend SUTCP4\n", 26);
+	user_flag_unset(var_source, flag_nat);
+	user_get_info(var_source, var_plain);
+	user_set_info(var_source, info);
+	adc_msg_free(info);
+	return !var_source->info_variants[info_variant_plain] && !user_flag_get(var_source, flag_tls_peer);
+});
+
+EXO_TEST(infvariant_shared, {
+	/* Nothing to strip, the variant is the original */
+	return user_get_info(var_source, var_plain) == var_source->info;
+});
+
+EXO_TEST(infvariant_update_empty, {
+	struct adc_message* update = adc_msg_parse("BINF AAAB DEaway\n", 17);
+	struct adc_message* msg = user_info_create_variant(var_source, update, info_variant_low_bandwidth);
+	int ret = msg && adc_msg_is_empty(msg) && !adc_msg_is_empty(update);
+	adc_msg_free(msg);
+	adc_msg_free(update);
+	return ret;
+});
+
+EXO_TEST(infvariant_shutdown, {
+	var_destroy_user(var_source);
+	var_destroy_user(var_tls);
+	var_destroy_user(var_plain);
+	var_destroy_user(var_lowbw);
+	return 1;
+});
@@ -0,0 +1,96 @@
+#include <uhub.h>
+
+static struct ip_trie* iptrie;
+static int iptrie_data[3];
+
+static int iptrie_add(const char* range_str, void* data)
+{
+	struct ip_range range;
+	if (!ip_convert_address_to_range(range_str, &range))
+		return 0;
+	return ip_trie_insert_range(iptrie, &range, data) == 0;
+}
+
+static int iptrie_match(const char* addr_str, void* expect)
+{
+	struct ip_addr_encap addr;
+	void* data = NULL;
+	if (ip_convert_to_binary(addr_str, &addr) == -1)
+		return 0;
+	return ip_trie_lookup(iptrie, &addr, &data) && data == expect;
+}
+
+static int iptrie_miss(const char* addr_str)
+{
+	struct ip_addr_encap addr;
+	if (ip_convert_to_binary(addr_str, &addr) == -1)
+		return 0;
+	return !ip_trie_lookup(iptrie, &addr, NULL);
+}
+
+EXO_TEST(iptrie_prepare_network, {
+	return net_initialize() == 0;
+});
+
+EXO_TEST(iptrie_create, {
+	iptrie = ip_trie_create();
+	return iptrie && ip_trie_size(iptrie) == 0;
+});
+
+EXO_TEST(iptrie_empty_1, { return iptrie_miss("10.0.0.1"); });
+EXO_TEST(iptrie_empty_2, { return iptrie_miss("2001::1"); });
+
+EXO_TEST(iptrie_add_1, { return iptrie_add("10.0.0.0/8", &iptrie_data[0]); });
+EXO_TEST(iptrie_add_2, { return iptrie_add("10.20.0.0/16", &iptrie_data[1]); });
+EXO_TEST(iptrie_add_3, { return iptrie_add("192.168.1.10-192.168.1.20", &iptrie_data[2]); });
+EXO_TEST(iptrie_add_4, { return iptrie_add("2001::/16", &iptrie_data[0]); });
+EXO_TEST(iptrie_add_5, { return iptrie_add("2001:db8::10-2001:db8::1f", &iptrie_data[1]); });
+
+/* 192.168.1.10-20 is stored as /31, /30, /30 and /32 */
+EXO_TEST(iptrie_size_1, { return ip_trie_size(iptrie) == 8; });
+
+EXO_TEST(iptrie_ipv4_1,  { return iptrie_match("10.0.0.0",        &iptrie_data[0]); });
+EXO_TEST(iptrie_ipv4_2,  { return iptrie_match("10.255.255.255",  &iptrie_data[0]); });
+EXO_TEST(iptrie_ipv4_3,  { return iptrie_match("10.20.0.1",       &iptrie_data[1]); });
+EXO_TEST(iptrie_ipv4_4,  { return iptrie_match("10.21.0.1",       &iptrie_data[0]); });
+EXO_TEST(iptrie_ipv4_5,  { return iptrie_miss("11.0.0.0"); });
+EXO_TEST(iptrie_ipv4_6,  { return iptrie_miss("9.255.255.255"); });
+EXO_TEST(iptrie_ipv4_7,  { return iptrie_miss("192.168.1.9"); });
+EXO_TEST(iptrie_ipv4_8,  { return iptrie_match("192.168.1.10",    &iptrie_data[2]); });
+EXO_TEST(iptrie_ipv4_9,  { return iptrie_match("192.168.1.15",    &iptrie_data[2]); });
+EXO_TEST(iptrie_ipv4_10, { return iptrie_match("192.168.1.20",    &iptrie_data[2]); });
+EXO_TEST(iptrie_ipv4_11, { return iptrie_miss("192.168.1.21"); });
+
+EXO_TEST(iptrie_ipv6_1, { return iptrie_match("2001::",          &iptrie_data[0]); });
+EXO_TEST(iptrie_ipv6_2, { return iptrie_match("2001:db8::f",     &iptrie_data[0]); });
+EXO_TEST(iptrie_ipv6_3, { return iptrie_match("2001:db8::10",    &iptrie_data[1]); });
+EXO_TEST(iptrie_ipv6_4, { return iptrie_match("2001:db8::1f",    &iptrie_data[1]); });
+EXO_TEST(iptrie_ipv6_5, { return iptrie_match("2001:db8::20",    &iptrie_data[0]); });
+EXO_TEST(iptrie_ipv6_6, { return iptrie_miss("2002::"); });
+EXO_TEST(iptrie_ipv6_7, { return iptrie_miss("::ffff:10.0.0.1"); });
+
+EXO_TEST(iptrie_replace_1, { return iptrie_add("10.20.0.0/16", &iptrie_data[2]); });
+EXO_TEST(iptrie_replace_2, { return ip_trie_size(iptrie) == 8; });
+EXO_TEST(iptrie_replace_3, { return iptrie_match("10.20.0.1", &iptrie_data[2]); });
+
+EXO_TEST(iptrie_all_1, { return iptrie_add("0.0.0.0-255.255.255.255", NULL); });
+EXO_TEST(iptrie_all_2, { return ip_trie_size(iptrie) == 9; });
+EXO_TEST(iptrie_all_3, { return iptrie_match("11.0.0.0", NULL); });
+EXO_TEST(iptrie_all_4, { return iptrie_match("10.0.0.1", &iptrie_data[0]); });
+EXO_TEST(iptrie_all_5, { return iptrie_miss("2002::"); });
+
+EXO_TEST(iptrie_invalid_1, {
+	struct ip_range range;
+	ip_convert_address_to_range("10.0.0.0/8", &range);
+	return ip_trie_insert(iptrie, &range.lo, 33, NULL) == -1;
+});
+
+EXO_TEST(iptrie_destroy, {
+	ip_trie_destroy(iptrie);
+	iptrie = NULL;
+	return 1;
+});
+
+EXO_TEST(iptrie_shutdown_network, {
+	return net_destroy() == 0;
+});
@@ -0,0 +1,248 @@
+#include <uhub.h>
+
+#include "loopback_client.h"
+
+#define LINK_CLIENTS 4
+#define LINK_CHALLENGE "LINKCHALLENGEFROMTHEOTHERNODEABCDEFGHIJ"
+
+static struct hub_config lk_config;
+static struct acl_handle lk_acl;
+static struct hub_info* lk_hub;
+static struct loopback_client lk_clients[LINK_CLIENTS];
+static struct loopback_client* lk_local = &lk_clients[0];
+static struct loopback_client* lk_peer = &lk_clients[1];
+static struct plugin_handle lk_plugin;
+static int lk_answers;      /* Correct answers to LINK_CHALLENGE */
+
+/* Stands in for mod_auth_simple, with "link peer secret" in its users file */
+static plugin_st lk_auth_get_user(struct plugin_handle* plugin, const char* nickname, struct auth_info* info)
+{
+	if (strcmp(nickname, "peer"))
+		return st_default;
+
+	memset(info, 0, sizeof(struct auth_info));
+	strcpy(info->nickname, nickname);
+	strcpy(info->password, "secret");
+	info->credentials = auth_cred_link;
+	return st_allow;
+}
+
+/* Announce a user of node 2 */
+static void lk_send_remote_info(const char* sid, const char* nick)
+{
+	char pid[64];
+	char cid[64];
+	char buf[256];
+
+	lbc_make_id(nick, 0, pid, cid);
+	snprintf(buf, sizeof(buf), "BINF %s ID%s NI%s SL1 SS0 SF0 HN1 HR0 HO0\n", sid, cid, nick);
+	lbc_send(lk_peer, buf);
+}
+
+/* The other node makes sure this hub knows its password, before linking */
+static void lk_handle_line(struct loopback_client* client)
+{
+	char hash[64];
+
+	if (!strncmp(client->line, "ILNK ", 5))
+	{
+		lbc_send(client, "IGPA " LINK_CHALLENGE "\n");
+	}
+	else if (!strncmp(client->line, "HPAS ", 5))
+	{
+		lbc_hash_password(client->password, LINK_CHALLENGE, hash);
+		if (strcmp(client->line + 5, hash))
+			return;
+
+		lk_answers++;
+		client->logged_in = 1;
+		lbc_send(client, "ILNK 2\n");
+		lk_send_remote_info("CAAB", "remote");
+	}
+}
+
+static void lk_process()
+{
+	lbc_process(lk_hub);
+}
+
+static int lk_connect(struct loopback_client* client, const char* nick, int link)
+{
+	char ip[32];
+
+	snprintf(ip, sizeof(ip), "10.1.0.%d", (int) (client - lk_clients) + 1);
+	if (!lbc_connect(lk_hub, client, ip, nick))
+		return 0;
+
+	client->link = link;
+	client->password = "secret";
+	client->on_line = lk_handle_line;
+	lbc_send_support(client);
+	lk_process();
+	return 1;
+}
+
+EXO_TEST(link_startup, {
+	net_backend_use_loopback(LOOPBACK_EPOCH);
+	return net_initialize() == 0;
+});
+
+EXO_TEST(link_hub_startup, {
+	config_defaults(&lk_config);
+	lk_config.server_port = 0;
+	lk_config.link_node_id = 1;
+	if (acl_initialize(&lk_config, &lk_acl) == -1)
+		return 0;
+	lk_hub = hub_start_service(&lk_config);
+	if (!lk_hub)
+		return 0;
+	hub_set_variables(lk_hub, &lk_acl);
+
+	lk_hub->plugins = hub_malloc_zero(sizeof(struct uhub_plugins));
+	if (!lk_hub->plugins || plugin_initialize(NULL, lk_hub) < 0)
+		return 0;
+	lk_plugin.funcs.auth_get_user = lk_auth_get_user;
+	list_append(lk_hub->plugins->loaded, &lk_plugin);
+	if (plugin_hooks_update(lk_hub->plugins) < 0)
+		return 0;
+
+	return lk_hub->links != NULL && link_get_node_count(lk_hub) == 0;
+});
+
+EXO_TEST(link_local_sid, {
+	return lk_connect(lk_local, "local", 0) && lk_local->logged_in && lk_local->sid[0] == 'B';
+});
+
+EXO_TEST(link_peer_login, {
+	return lk_connect(lk_peer, "peer", 1) && lk_peer->logged_in && lk_answers == 1 && link_get_node_count(lk_hub) == 1;
+});
+
+EXO_TEST(link_peer_gets_users, {
+	char line[16];
+	snprintf(line, sizeof(line), "BINF %s ", lk_local->sid);
+	return lbc_received(lk_peer, line) && lk_hub->users->count == 1;
+});
+
+EXO_TEST(link_remote_join, {
+	return lbc_received(lk_local, "BINF CAAB ") && link_get_user_count(lk_hub) == 1 && link_has_nick(lk_hub, "remote") && link_has_sid(lk_hub, 65537);
+});
+
+EXO_TEST(link_broadcast_local, {
+	char line[64];
+	snprintf(line, sizeof(line), "BMSG %s hello\n", lk_local->sid);
+	lbc_send(lk_local, line);
+	lk_process();
+	return lbc_received(lk_peer, line) && lbc_received(lk_local, line);
+});
+
+EXO_TEST(link_broadcast_remote, {
+	lbc_send(lk_peer, "BMSG CAAB hi\n");
+	lk_process();
+	return lbc_received(lk_local, "BMSG CAAB hi\n");
+});
+
+EXO_TEST(link_direct_to_remote, {
+	char line[64];
+	snprintf(line, sizeof(line), "EMSG %s CAAB pm PM%s\n", lk_local->sid, lk_local->sid);
+	lbc_send(lk_local, line);
+	lk_process();
+	return lbc_received(lk_peer, line) && lbc_received(lk_local, line);
+});
+
+EXO_TEST(link_direct_to_local, {
+	char line[64];
+	snprintf(line, sizeof(line), "DMSG CAAB %s back\n", lk_local->sid);
+	lbc_send(lk_peer, line);
+	lk_process();
+	return lbc_received(lk_local, line);
+});
+
+EXO_TEST(link_not_limited, {
+	/* A link carries the traffic of all users, the send queue limit of one does not apply */
+	char line[128];
+	int messages = lk_peer->messages;
+	int n;
+
+	lk_config.max_send_buffer = 2048;
+	lk_peer->paused = 1;
+	for (n = 0; n < 1500; n++)
+	{
+		snprintf(line, sizeof(line), "BMSG %s a\\smessage\\sthat\\sfills\\sthe\\ssend\\squeue\\sof\\sthe\\slink\\swhile\\sit\\sdoes\\snot\\sread\\s%d\n", lk_local->sid, n);
+		lbc_send(lk_local, line);
+		if (n % 25 == 24)
+			lk_process();
+	}
+	lk_process();
+	lk_peer->paused = 0;
+	lk_process();
+	lk_config.max_send_buffer = 131072;
+	lbc_received(lk_local, "");
+	lbc_received(lk_peer, "");
+	return lk_peer->messages - messages == 1500 && link_get_node_count(lk_hub) == 1;
+});
+
+EXO_TEST(link_spoofed_source, {
+	lbc_send(lk_peer, "BMSG BAAC spoof\nBMSG CAAC unknown\n");
+	lk_process();
+	return !lbc_received(lk_local, "BMSG");
+});
+
+EXO_TEST(link_info_update, {
+	lbc_send(lk_peer, "BINF CAAB NIrenamed\n");
+	lk_process();
+	return lbc_received(lk_local, "BINF CAAB NIrenamed\n") && link_has_nick(lk_hub, "renamed") && !link_has_nick(lk_hub, "remote");
+});
+
+EXO_TEST(link_nick_taken, {
+	struct loopback_client* client = &lk_clients[2];
+	return lk_connect(client, "renamed", 0) && !client->logged_in && client->closed && lk_hub->users->count == 1;
+});
+
+EXO_TEST(link_remote_quit, {
+	lbc_send(lk_peer, "IQUI CAAB\n");
+	lk_process();
+	return lbc_received(lk_local, "IQUI CAAB\n") && link_get_user_count(lk_hub) == 0 && !link_has_nick(lk_hub, "renamed");
+});
+
+EXO_TEST(link_local_quit, {
+	struct loopback_client* client = &lk_clients[2];
+	char line[16];
+	if (!lk_connect(client, "other", 0) || !client->logged_in)
+		return 0;
+	snprintf(line, sizeof(line), "IQUI %s", client->sid);
+	lbc_disconnect(client);
+	lk_process();
+	return lbc_received(lk_peer, line);
+});
+
+EXO_TEST(link_refused, {
+	struct loopback_client* client = &lk_clients[3];
+	return lk_connect(client, "fake", 1) && !client->logged_in && client->closed && link_get_node_count(lk_hub) == 1 && lk_answers == 1;
+});
+
+EXO_TEST(link_drop, {
+	lk_send_remote_info("CAAD", "dropped");
+	lk_process();
+	if (link_get_user_count(lk_hub) != 1)
+		return 0;
+	lbc_disconnect(lk_peer);
+	lk_process();
+	return lbc_received(lk_local, "IQUI CAAD\n") && link_get_node_count(lk_hub) == 0 && link_get_user_count(lk_hub) == 0;
+});
+
+EXO_TEST(link_hub_shutdown, {
+	lbc_disconnect(lk_local);
+	lk_process();
+	list_remove(lk_hub->plugins->loaded, &lk_plugin);
+	hub_free_variables(lk_hub);
+	acl_shutdown(&lk_acl);
+	free_config(&lk_config);
+	hub_shutdown_service(lk_hub);
+	return 1;
+});
+
+EXO_TEST(link_shutdown, {
+	int ret = net_destroy();
+	net_backend_use_loopback(0);
+	return ret == 0;
+});
@@ -0,0 +1,305 @@
+#include <uhub.h>
+
+#include "tls_certificate.h"
+
+/*
+ * The node dialing a link (see link_peers), over TCP: it links to a hub
+ * over TLS, and refuses a node that cannot prove it knows the password
+ * or does not present the expected certificate.
+ */
+#if defined(SSL_SUPPORT) && defined(SSL_USE_OPENSSL)
+
+#define LP_PORT_ACCEPT 24532    /* Hub accepting the link */
+#define LP_PORT_DIAL   24533    /* Hub dialing both others */
+#define LP_PORT_FAKE   24534    /* Node answering the challenge wrong */
+#define LP_PORT_PINNED 24535    /* Hub expecting another certificate */
+
+struct lp_hub
+{
+	struct hub_config config;
+	struct acl_handle acl;
+	struct hub_info* hub;
+};
+
+static struct lp_hub lp_accept;
+static struct lp_hub lp_dial;
+static struct lp_hub lp_pinned;
+static struct plugin_handle lp_plugin;
+static char lp_cert[] = "/tmp/uhub-test-XXXXXX";
+static char lp_keyprint[NET_SSL_KEYPRINT_SIZE];
+static int lp_listener = -1;
+static int lp_fake = -1;
+static char lp_received[4096];
+static size_t lp_length;
+
+/* Stands in for mod_auth_simple, with "link link secret" in its users file */
+static plugin_st lp_auth_get_user(struct plugin_handle* plugin, const char* nickname, struct auth_info* info)
+{
+	if (strcmp(nickname, "link"))
+		return st_default;
+
+	memset(info, 0, sizeof(struct auth_info));
+	strcpy(info->nickname, nickname);
+	strcpy(info->password, "secret");
+	info->credentials = auth_cred_link;
+	return st_allow;
+}
+
+static void lp_process()
+{
+	int n;
+	net_backend_process_timeout(10);
+	for (n = 0; n < 20; n++)
+	{
+		net_backend_process_timeout(0);
+		event_queue_process(lp_accept.hub->queue);
+		if (lp_dial.hub)
+			event_queue_process(lp_dial.hub->queue);
+		if (lp_pinned.hub)
+			event_queue_process(lp_pinned.hub->queue);
+	}
+}
+
+static size_t lp_tls_connects()
+{
+	struct net_statistics* intermediate;
+	struct net_statistics* total;
+	net_stats_get(&intermediate, &total);
+	return total->tls_connect + intermediate->tls_connect;
+}
+
+static int lp_start_hub(struct lp_hub* lp, int node, int port, const char* peers)
+{
+	char buf[16];
+
+	config_defaults(&lp->config);
+	snprintf(buf, sizeof(buf), "%d", port);
+	apply_config(&lp->config, "server_port", buf, 1);
+	apply_config(&lp->config, "server_bind_addr", "127.0.0.1", 1);
+	snprintf(buf, sizeof(buf), "%d", node);
+	apply_config(&lp->config, "link_node_id", buf, 1);
+	apply_config(&lp->config, "link_peers", peers, 1);
+	apply_config(&lp->config, "link_password", "secret", 1);
+	apply_config(&lp->config, "tls_enable", "yes", 1);
+	apply_config(&lp->config, "tls_require", "yes", 1);
+	apply_config(&lp->config, "tls_certificate", lp_cert, 1);
+	apply_config(&lp->config, "tls_private_key", lp_cert, 1);
+	if (acl_initialize(&lp->config, &lp->acl) == -1)
+		return 0;
+
+	lp->hub = hub_start_service(&lp->config);
+	if (!lp->hub)
+		return 0;
+	hub_set_variables(lp->hub, &lp->acl);
+	return 1;
+}
+
+static void lp_stop_hub(struct lp_hub* lp)
+{
+	if (!lp->hub)
+		return;
+	lp->hub->status = hub_status_shutdown;
+	link_shutdown(lp->hub);
+	hub_disconnect_all(lp->hub);
+	event_queue_process(lp->hub->queue);
+	hub_free_variables(lp->hub);
+	acl_shutdown(&lp->acl);
+	free_config(&lp->config);
+	hub_shutdown_service(lp->hub);
+	lp->hub = NULL;
+}
+
+static int lp_listen()
+{
+	struct sockaddr_in addr;
+	int on = 1;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(LP_PORT_FAKE);
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	lp_listener = socket(AF_INET, SOCK_STREAM, 0);
+	if (lp_listener == -1)
+		return 0;
+	setsockopt(lp_listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	net_set_nonblocking(lp_listener, 1);
+	return bind(lp_listener, (struct sockaddr*) &addr, sizeof(addr)) == 0 && listen(lp_listener, 4) == 0;
+}
+
+static int lp_start()
+{
+	char peers[256];
+
+	/* The fake node closes connections the hubs still write to */
+	signal(SIGPIPE, SIG_IGN);
+	if (net_initialize() != 0 || !tls_write_certificate(lp_cert) || !tls_get_keyprint(lp_cert, lp_keyprint) || !lp_listen())
+		return 0;
+
+	if (!lp_start_hub(&lp_accept, 2, LP_PORT_ACCEPT, ""))
+		return 0;
+
+	lp_accept.hub->plugins = hub_malloc_zero(sizeof(struct uhub_plugins));
+	if (!lp_accept.hub->plugins || plugin_initialize(NULL, lp_accept.hub) < 0)
+		return 0;
+	lp_plugin.funcs.auth_get_user = lp_auth_get_user;
+	list_append(lp_accept.hub->plugins->loaded, &lp_plugin);
+	if (plugin_hooks_update(lp_accept.hub->plugins) < 0)
+		return 0;
+
+	snprintf(peers, sizeof(peers), "adcs://127.0.0.1:%d/?kp=SHA256/%s,127.0.0.1:%d", LP_PORT_ACCEPT, lp_keyprint, LP_PORT_FAKE);
+	return lp_start_hub(&lp_dial, 1, LP_PORT_DIAL, peers);
+}
+
+static int lp_linked()
+{
+	int n;
+	for (n = 0; n < 100; n++)
+	{
+		lp_process();
+		if (link_get_node_count(lp_accept.hub) == 1 && link_get_node_count(lp_dial.hub) == 1)
+			return lp_tls_connects() > 0;
+	}
+	return 0;
+}
+
+/* Wait for a line from the hub dialing the fake node, returns 0 if it closed first */
+static int lp_fake_expect(const char* prefix)
+{
+	char* line;
+	char* end;
+	ssize_t ret;
+	int n;
+
+	for (n = 0; n < 100; n++)
+	{
+		if (lp_fake == -1)
+		{
+			lp_fake = accept(lp_listener, NULL, NULL);
+			if (lp_fake != -1)
+				net_set_nonblocking(lp_fake, 1);
+		}
+
+		if (lp_fake != -1)
+		{
+			ret = recv(lp_fake, lp_received + lp_length, sizeof(lp_received) - lp_length - 1, 0);
+			if (ret == 0)
+				return 0;
+			if (ret > 0)
+			{
+				lp_length += ret;
+				lp_received[lp_length] = 0;
+			}
+		}
+
+		for (line = lp_received; (end = strchr(line, '\n')); line = end + 1)
+		{
+			if (!strncmp(line, prefix, strlen(prefix)))
+			{
+				/* Forget everything up to the line */
+				lp_length -= end + 1 - lp_received;
+				memmove(lp_received, end + 1, lp_length + 1);
+				return 1;
+			}
+		}
+		lp_process();
+	}
+	return 0;
+}
+
+static void lp_fake_send(const char* msg)
+{
+	send(lp_fake, msg, strlen(msg), 0);
+}
+
+static int lp_fake_closed()
+{
+	char buf[256];
+	int n;
+
+	for (n = 0; n < 100; n++)
+	{
+		if (recv(lp_fake, buf, sizeof(buf), 0) == 0)
+			return 1;
+		lp_process();
+	}
+	return 0;
+}
+
+/* Let the hub log in, then answer its challenge without knowing the password */
+static int lp_wrong_answer()
+{
+	if (!lp_fake_expect("HSUP "))
+		return 0;
+	lp_fake_send("ISUP ADBASE ADTIGR\nISID AAAB\nIINF NIfake\n");
+	if (!lp_fake_expect("BINF AAAB "))
+		return 0;
+	lp_fake_send("IGPA ABCDEFGHIJKLMNOPQRSTUVWXYZ234567ABCDEFG\n");
+	if (!lp_fake_expect("HPAS "))
+		return 0;
+	lp_fake_send("ILNK 9\n");
+	if (!lp_fake_expect("IGPA "))
+		return 0;
+	lp_fake_send("HPAS ABCDEFGHIJKLMNOPQRSTUVWXYZ234567ABCDEFG\n");
+	return lp_fake_closed() && link_get_node_count(lp_dial.hub) == 1;
+}
+
+/* The hub accepting links presents the certificate, but not the one expected */
+static int lp_wrong_keyprint()
+{
+	char peers[256];
+	size_t connects = lp_tls_connects();
+	int n;
+
+	snprintf(peers, sizeof(peers), "adcs://127.0.0.1:%d/?kp=SHA256/ABCDEFGHIJKLMNOPQRSTUVWXYZ234567ABCDEFGHIJKLMNOPQRST", LP_PORT_ACCEPT);
+	if (!lp_start_hub(&lp_pinned, 3, LP_PORT_PINNED, peers))
+		return 0;
+
+	for (n = 0; n < 100 && lp_tls_connects() == connects; n++)
+		lp_process();
+	lp_process();
+
+	return lp_tls_connects() > connects && link_get_node_count(lp_pinned.hub) == 0 && link_get_node_count(lp_accept.hub) == 1;
+}
+
+static int lp_shutdown()
+{
+	if (lp_fake != -1)
+		close(lp_fake);
+	close(lp_listener);
+	lp_stop_hub(&lp_pinned);
+	lp_stop_hub(&lp_dial);
+	lp_process();
+	list_remove(lp_accept.hub->plugins->loaded, &lp_plugin);
+	lp_stop_hub(&lp_accept);
+	unlink(lp_cert);
+	return net_destroy() == 0;
+}
+
+#else
+static int lp_start() { return 1; }
+static int lp_linked() { return 1; }
+static int lp_wrong_answer() { return 1; }
+static int lp_wrong_keyprint() { return 1; }
+static int lp_shutdown() { return 1; }
+#endif
+
+EXO_TEST(linkpeer_start, {
+	return lp_start();
+});
+
+EXO_TEST(linkpeer_tls, {
+	return lp_linked();
+});
+
+EXO_TEST(linkpeer_wrong_answer, {
+	return lp_wrong_answer();
+});
+
+EXO_TEST(linkpeer_wrong_keyprint, {
+	return lp_wrong_keyprint();
+});
+
+EXO_TEST(linkpeer_shutdown, {
+	return lp_shutdown();
+});
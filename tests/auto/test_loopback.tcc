@@ -0,0 +1,156 @@
+#include <uhub.h>
+
+#include "loopback_client.h"
+
+#define LOOPBACK_USERS 200
+
+static struct hub_config lb_config;
+static struct acl_handle lb_acl;
+static struct hub_info* lb_hub;
+static struct loopback_client lb_clients[LOOPBACK_USERS + 1];
+
+static void lb_process()
+{
+	lbc_process(lb_hub);
+}
+
+static int lb_connect(int index)
+{
+	char ip[32];
+	char nick[32];
+
+	snprintf(ip, sizeof(ip), "10.0.%d.%d", index / 250, index % 250 + 1);
+	snprintf(nick, sizeof(nick), "loopback-%d", index);
+	return lbc_connect(lb_hub, &lb_clients[index], ip, nick);
+}
+
+static int lb_count(int logged_in, int messages, int closed)
+{
+	int n, count = 0;
+	for (n = 0; n < LOOPBACK_USERS; n++)
+	{
+		if (lb_clients[n].logged_in == logged_in && lb_clients[n].messages == messages && lb_clients[n].closed == closed)
+			count++;
+	}
+	return count;
+}
+
+EXO_TEST(loopback_startup, {
+	net_backend_use_loopback(LOOPBACK_EPOCH);
+	return net_initialize() == 0 && net_get_time() == LOOPBACK_EPOCH;
+});
+
+EXO_TEST(loopback_hub_startup, {
+	config_defaults(&lb_config);
+	lb_config.server_port = 0;
+	lb_config.max_users = LOOPBACK_USERS * 2;
+	if (acl_initialize(&lb_config, &lb_acl) == -1)
+		return 0;
+	lb_hub = hub_start_service(&lb_config);
+	if (!lb_hub)
+		return 0;
+	hub_set_variables(lb_hub, &lb_acl);
+	return 1;
+});
+
+EXO_TEST(loopback_connect, {
+	int n;
+	for (n = 0; n < LOOPBACK_USERS; n++)
+	{
+		if (!lb_connect(n))
+			return 0;
+		lbc_send_support(&lb_clients[n]);
+	}
+	return 1;
+});
+
+EXO_TEST(loopback_login, {
+	lb_process();
+	return lb_count(1, 0, 0) == LOOPBACK_USERS && lb_hub->users->count == LOOPBACK_USERS;
+});
+
+EXO_TEST(loopback_chat, {
+	char buf[64];
+	snprintf(buf, sizeof(buf), "BMSG %s hello\n", lb_clients[0].sid);
+	lbc_send(&lb_clients[0], buf);
+	lb_process();
+	return lb_count(1, 1, 0) == LOOPBACK_USERS;
+});
+
+EXO_TEST(loopback_handshake_timeout, {
+	struct loopback_client* client = &lb_clients[LOOPBACK_USERS];
+	if (!lb_connect(LOOPBACK_USERS))
+		return 0;
+	lb_process();
+	if (client->closed)
+		return 0;
+	net_backend_advance_time(TIMEOUT_HANDSHAKE);
+	lb_process();
+	return client->closed && net_get_time() == LOOPBACK_EPOCH + TIMEOUT_HANDSHAKE;
+});
+
+EXO_TEST(loopback_bad_cid, {
+	struct loopback_client* client = &lb_clients[LOOPBACK_USERS];
+	if (!lb_connect(LOOPBACK_USERS))
+		return 0;
+	client->bad_cid = 1;
+	lbc_send_support(client);
+	lb_process();
+	return client->closed && !client->logged_in && list_size(lb_hub->login_queue) == 0;
+});
+
+EXO_TEST(loopback_users_survive_timeout, {
+	return lb_count(1, 1, 0) == LOOPBACK_USERS && lb_hub->users->count == LOOPBACK_USERS;
+});
+
+EXO_TEST(loopback_read_budget, {
+	char buf[64];
+	int n;
+	size_t deferred = lb_hub->stats.read_deferred;
+	for (n = 0; n < 250; n++)
+	{
+		snprintf(buf, sizeof(buf), "BMSG %s batch\n", lb_clients[1].sid);
+		lbc_send(&lb_clients[1], buf);
+	}
+	lb_process();
+	return lb_clients[0].messages == 251 && lb_clients[LOOPBACK_USERS - 1].messages == 251 && lb_hub->stats.read_deferred == deferred + 2;
+});
+
+EXO_TEST(loopback_mass_quit, {
+	int n;
+	for (n = LOOPBACK_USERS / 2; n < LOOPBACK_USERS; n++)
+	{
+		lbc_disconnect(&lb_clients[n]);
+	}
+	lb_process();
+	for (n = 0; n < LOOPBACK_USERS / 2; n++)
+	{
+		if (lb_clients[n].quits != LOOPBACK_USERS / 2)
+			return 0;
+	}
+	return lb_hub->users->count == LOOPBACK_USERS / 2 && !lb_hub->users->quits;
+});
+
+EXO_TEST(loopback_disconnect, {
+	int n;
+	for (n = 0; n < LOOPBACK_USERS / 2; n++)
+	{
+		lbc_disconnect(&lb_clients[n]);
+	}
+	lb_process();
+	return lb_hub->users->count == 0;
+});
+
+EXO_TEST(loopback_hub_shutdown, {
+	hub_free_variables(lb_hub);
+	acl_shutdown(&lb_acl);
+	free_config(&lb_config);
+	hub_shutdown_service(lb_hub);
+	return 1;
+});
+
+EXO_TEST(loopback_shutdown, {
+	int ret = net_destroy();
+	net_backend_use_loopback(0);
+	return ret == 0;
+});
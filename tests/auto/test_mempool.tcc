@@ -0,0 +1,64 @@
+#include <uhub.h>
+
+struct pool_object
+{
+	char data[40];
+};
+
+static struct mem_pool g_pool;
+static struct pool_object* g_objs[8];
+
+EXO_TEST(mempool_init, {
+	mem_pool_init(&g_pool, "test", sizeof(struct pool_object));
+	return g_pool.size == sizeof(struct pool_object) && g_pool.in_use == 0;
+});
+
+EXO_TEST(mempool_alloc_zeroed, {
+	g_objs[0] = mem_pool_alloc(&g_pool);
+	return g_objs[0] && g_objs[0]->data[0] == 0 && g_objs[0]->data[39] == 0 && g_pool.in_use == 1;
+});
+
+EXO_TEST(mempool_reuse, {
+	struct pool_object* obj = g_objs[0];
+	memset(obj, 0xff, sizeof(struct pool_object));
+	mem_pool_free(&g_pool, obj);
+	g_objs[0] = mem_pool_alloc(&g_pool);
+	return g_objs[0] == obj && g_objs[0]->data[0] == 0 && g_objs[0]->data[39] == 0 && g_pool.reused == 1;
+});
+
+EXO_TEST(mempool_max_free, {
+	int n;
+	g_pool.max_free = 2;
+	for (n = 1; n < 8; n++)
+		g_objs[n] = mem_pool_alloc(&g_pool);
+	for (n = 0; n < 8; n++)
+		mem_pool_free(&g_pool, g_objs[n]);
+	return g_pool.free_heap_count == 2 && g_pool.in_use == 0 && g_pool.peak == 8;
+});
+
+EXO_TEST(mempool_prewarm, {
+	mem_pool_prewarm(&g_pool, 4);
+	return g_pool.free_slab_count == 4 && g_pool.max_free == 4 && g_pool.slabs;
+});
+
+EXO_TEST(mempool_prewarm_contiguous, {
+	int n;
+	int ok = 1;
+	for (n = 0; n < 4; n++)
+		g_objs[n] = mem_pool_alloc(&g_pool);
+	for (n = 1; n < 4; n++)
+		ok = ok && (char*) g_objs[n] - (char*) g_objs[n - 1] == (ptrdiff_t) sizeof(struct pool_object);
+	return ok && g_pool.free_slab_count == 0 && g_pool.free_heap_count == 2;
+});
+
+EXO_TEST(mempool_prewarm_returns_to_slab, {
+	int n;
+	for (n = 0; n < 4; n++)
+		mem_pool_free(&g_pool, g_objs[n]);
+	return g_pool.free_slab_count == 4 && g_pool.free_heap_count == 2 && g_pool.in_use == 0;
+});
+
+EXO_TEST(mempool_destroy, {
+	mem_pool_destroy(&g_pool);
+	return !g_pool.slabs && !g_pool.free_slab && !g_pool.free_heap;
+});
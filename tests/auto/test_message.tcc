@@ -520,7 +520,7 @@ EXO_TEST(adc_message_update_3, {
 
 EXO_TEST(adc_message_update_4, {
 	user_update_info(g_user, updater2);
-	return strlen(g_user->info->cache) == 159;
+	return strlen(user_get_info(g_user, NULL)->cache) == 159;
 });
 
 EXO_TEST(adc_message_update_4_cleanup, {
@@ -528,8 +528,7 @@ EXO_TEST(adc_message_update_4_cleanup, {
 	updater1 = 0;
 	adc_msg_free(updater2);
 	updater2 = 0;
-	adc_msg_free(g_user->info);
-	g_user->info = 0;
+	user_set_info(g_user, NULL);
 	return 1;
 });
 
@@ -571,6 +570,64 @@ EXO_TEST(adc_message_construct_source_dest_1, {
 	return ok;
 });
 
+EXO_TEST(adc_message_search_1, {
+	int ok;
+	const struct plugin_search* search;
+	struct adc_message* msg = adc_msg_parse("BSCH AAAB ANfoo ANbar\\sbaz NOqux EXmp3 GE100 LE2000 TY1 TOtok\n", 62);
+	search = adc_msg_get_search(msg);
+	ok = search && search->include_count == 2 && str_match(search->include[0], "foo") && str_match(search->include[1], "bar baz")
+		&& search->exclude_count == 1 && str_match(search->exclude[0], "qux")
+		&& search->extension_count == 1 && str_match(search->extensions[0], "mp3")
+		&& search->flags == (search_size_min | search_size_max) && search->size_min == 100 && search->size_max == 2000
+		&& search->type == search_type_file && str_match(search->token, "tok") && !search->tth
+		&& adc_msg_get_search(msg) == search;
+	adc_msg_free(msg);
+	return ok;
+});
+
+EXO_TEST(adc_message_search_2, {
+	int ok;
+	const struct plugin_search* search;
+	struct adc_message* msg = adc_msg_parse("DSCH AAAB AAAC TRLWPNACQDBZRYXW3VHJVCJ64QBZNGHOHHHZWCLNQ EQ1048576\n", 67);
+	search = adc_msg_get_search(msg);
+	ok = search && str_match(search->tth, "LWPNACQDBZRYXW3VHJVCJ64QBZNGHOHHHZWCLNQ") && !search->token
+		&& search->include_count == 0 && search->flags == search_size_exact && search->size_exact == 1048576
+		&& search->type == search_type_any;
+	adc_msg_free(msg);
+	return ok;
+});
+
+EXO_TEST(adc_message_search_3, {
+	int ok;
+	const struct plugin_search* search;
+	struct adc_message* msg = adc_msg_parse("BSCH AAAB ANfoo\n", 16);
+	search = adc_msg_get_search(msg);
+	adc_msg_add_named_argument(msg, "AN", "bar");
+	search = adc_msg_get_search(msg);
+	ok = search && search->include_count == 2 && str_match(search->include[1], "bar");
+	adc_msg_free(msg);
+	return ok;
+});
+
+EXO_TEST(adc_message_search_4, {
+	int ok;
+	struct adc_message* msg = adc_msg_parse("BMSG AAAB hello\n", 16);
+	ok = adc_msg_get_search(msg) == NULL;
+	adc_msg_free(msg);
+	return ok;
+});
+
+EXO_TEST(adc_message_append_message, {
+	int ok;
+	struct adc_message* msg = adc_msg_create("IQUI AAAB");
+	struct adc_message* other = adc_msg_create("IQUI AAAC DI1");
+	ok = adc_msg_append_message(msg, other) == 0;
+	ok = ok && msg->length == 24 && !strcmp(msg->cache, "IQUI AAAB\nIQUI AAAC DI1\n") && msg->cmd == ADC_CMD_IQUI;
+	adc_msg_free(other);
+	adc_msg_free(msg);
+	return ok;
+});
+
 EXO_TEST(adc_message_last, {
 	hub_free(g_user);
 	g_user = 0;
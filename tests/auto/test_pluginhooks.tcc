@@ -0,0 +1,87 @@
+#include <uhub.h>
+
+static struct uhub_plugins ph_plugins;
+static struct plugin_handle ph_first;
+static struct plugin_handle ph_second;
+
+static plugin_st ph_chat_msg(struct plugin_handle* plugin, struct plugin_user* from, const char* message)
+{
+	return st_default;
+}
+
+static plugin_st ph_auth_get_user(struct plugin_handle* plugin, const char* nickname, struct auth_info* info)
+{
+	return st_default;
+}
+
+static plugin_st ph_search_parsed(struct plugin_handle* plugin, struct plugin_user* from, const struct plugin_search* search)
+{
+	return st_default;
+}
+
+static void ph_connection_accepted(struct plugin_handle* plugin, struct ip_addr_encap* addr)
+{
+}
+
+/* Returns 1 if exactly the given plugins (in order, NULL terminated) implement the hook */
+static int ph_hook_is(size_t hook, struct plugin_handle* a, struct plugin_handle* b)
+{
+	struct plugin_hook_list* list = &ph_plugins.hooks[hook];
+	size_t count = (a ? 1 : 0) + (b ? 1 : 0);
+
+	if (list->count != count)
+		return 0;
+	return (!a || list->plugins[0] == a) && (!b || list->plugins[1] == b);
+}
+
+EXO_TEST(pluginhooks_setup, {
+	ph_first.funcs.on_connection_accepted = ph_connection_accepted;
+	ph_first.funcs.on_chat_msg = ph_chat_msg;
+	ph_first.funcs.auth_get_user = ph_auth_get_user;
+	ph_second.funcs.on_chat_msg = ph_chat_msg;
+	ph_second.funcs.on_search_parsed = ph_search_parsed;
+
+	ph_plugins.loaded = list_create();
+	list_append(ph_plugins.loaded, &ph_first);
+	list_append(ph_plugins.loaded, &ph_second);
+	return plugin_hooks_update(&ph_plugins) == 0;
+});
+
+EXO_TEST(pluginhooks_first_member, {
+	return ph_hook_is(PLUGIN_HOOK_INDEX(on_connection_accepted), &ph_first, NULL);
+});
+
+EXO_TEST(pluginhooks_shared, {
+	return ph_hook_is(PLUGIN_HOOK_INDEX(on_chat_msg), &ph_first, &ph_second);
+});
+
+EXO_TEST(pluginhooks_auth, {
+	return ph_hook_is(PLUGIN_HOOK_INDEX(auth_get_user), &ph_first, NULL) && ph_hook_is(PLUGIN_HOOK_INDEX(auth_get_user_async), NULL, NULL);
+});
+
+EXO_TEST(pluginhooks_last_member, {
+	return ph_hook_is(PLUGIN_HOOK_INDEX(on_search_parsed), &ph_second, NULL);
+});
+
+EXO_TEST(pluginhooks_match_loaded, {
+	/* Every hook lists exactly the plugins that implement it */
+	size_t hook;
+	size_t total = 0;
+	for (hook = 0; hook < PLUGIN_HOOK_COUNT; hook++)
+		total += ph_plugins.hooks[hook].count;
+	return total == 5 && ph_hook_is(PLUGIN_HOOK_INDEX(on_user_login), NULL, NULL) && ph_hook_is(PLUGIN_HOOK_INDEX(on_private_msg), NULL, NULL);
+});
+
+EXO_TEST(pluginhooks_unload, {
+	list_remove(ph_plugins.loaded, &ph_first);
+	if (plugin_hooks_update(&ph_plugins) < 0)
+		return 0;
+	return ph_hook_is(PLUGIN_HOOK_INDEX(on_chat_msg), &ph_second, NULL) && ph_hook_is(PLUGIN_HOOK_INDEX(on_connection_accepted), NULL, NULL);
+});
+
+EXO_TEST(pluginhooks_shutdown, {
+	plugin_hooks_clear(&ph_plugins);
+	list_clear(ph_plugins.loaded, NULL);
+	list_destroy(ph_plugins.loaded);
+	return ph_plugins.hooks[PLUGIN_HOOK_INDEX(on_chat_msg)].count == 0;
+});
@@ -0,0 +1,54 @@
+#include <uhub.h>
+
+#define PTR_TABLE_TEST_SIZE (PTR_TABLE_SEGMENT_SIZE * 4)
+
+static struct ptr_table* g_table;
+static int g_values[4];
+
+EXO_TEST(ptrtable_create, {
+	g_table = ptr_table_create(PTR_TABLE_TEST_SIZE);
+	return g_table && g_table->size == PTR_TABLE_TEST_SIZE && g_table->segments == 0;
+});
+
+EXO_TEST(ptrtable_get_untouched, {
+	return !ptr_table_get(g_table, 0) && !ptr_table_get(g_table, PTR_TABLE_TEST_SIZE - 1);
+});
+
+EXO_TEST(ptrtable_set_null_untouched, {
+	return ptr_table_set(g_table, 1, 0) == 0 && g_table->segments == 0;
+});
+
+EXO_TEST(ptrtable_set_get, {
+	if (ptr_table_set(g_table, 1, &g_values[0]) == -1)
+		return 0;
+	return ptr_table_get(g_table, 1) == &g_values[0] && !ptr_table_get(g_table, 2) && g_table->segments == 1;
+});
+
+EXO_TEST(ptrtable_set_same_segment, {
+	size_t mem = ptr_table_memory(g_table);
+	if (ptr_table_set(g_table, PTR_TABLE_SEGMENT_SIZE - 1, &g_values[1]) == -1)
+		return 0;
+	return ptr_table_memory(g_table) == mem && g_table->segments == 1;
+});
+
+EXO_TEST(ptrtable_set_new_segment, {
+	size_t mem = ptr_table_memory(g_table);
+	if (ptr_table_set(g_table, PTR_TABLE_TEST_SIZE - 1, &g_values[2]) == -1)
+		return 0;
+	return ptr_table_memory(g_table) > mem && g_table->segments == 2 && ptr_table_get(g_table, PTR_TABLE_TEST_SIZE - 1) == &g_values[2];
+});
+
+EXO_TEST(ptrtable_out_of_range, {
+	return ptr_table_set(g_table, PTR_TABLE_TEST_SIZE, &g_values[3]) == -1 && !ptr_table_get(g_table, PTR_TABLE_TEST_SIZE);
+});
+
+EXO_TEST(ptrtable_clear, {
+	ptr_table_set(g_table, 1, 0);
+	return !ptr_table_get(g_table, 1) && ptr_table_get(g_table, PTR_TABLE_SEGMENT_SIZE - 1) == &g_values[1];
+});
+
+EXO_TEST(ptrtable_destroy, {
+	ptr_table_destroy(g_table);
+	g_table = 0;
+	return 1;
+});
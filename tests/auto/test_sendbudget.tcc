@@ -0,0 +1,209 @@
+#include <uhub.h>
+
+#include "loopback_client.h"
+
+#define SB_USERS 100
+#define SB_FAST 20        /* Clients 0-19 keep reading */
+#define SB_SLOW_FIRST 60  /* Clients 20-59 stop reading first, 60-99 later */
+
+static struct hub_config sb_config;
+static struct acl_handle sb_acl;
+static struct hub_info* sb_hub;
+static struct loopback_client sb_clients[SB_USERS];
+static struct loopback_client sb_list;
+static int sb_list_infos;
+
+static void sb_process()
+{
+	lbc_process(sb_hub);
+}
+
+static void sb_chat(int count)
+{
+	char buf[128];
+	int n;
+	for (n = 0; n < count; n++)
+	{
+		snprintf(buf, sizeof(buf), "BMSG %s a\\smessage\\sthat\\sfills\\sthe\\ssend\\squeues\\sof\\susers\\sthat\\sdo\\snot\\sread\\s%d\n", sb_clients[0].sid, n);
+		lbc_send(&sb_clients[0], buf);
+		if (n % 25 == 24)
+			sb_process();
+	}
+	sb_process();
+}
+
+static void sb_count_info(struct loopback_client* client)
+{
+	if (!strncmp(client->line, "BINF ", 5))
+		sb_list_infos++;
+}
+
+static int sb_is_connected(int index)
+{
+	return uman_get_user_by_sid(sb_hub->users, string_to_sid(sb_clients[index].sid)) != NULL;
+}
+
+static int sb_count_connected(int first, int last)
+{
+	int n, count = 0;
+	for (n = first; n < last; n++)
+		count += sb_is_connected(n);
+	return count;
+}
+
+EXO_TEST(sendbudget_startup, {
+	net_backend_use_loopback(LOOPBACK_EPOCH);
+	net_loopback_set_buffer_size(4096);
+	return net_initialize() == 0;
+});
+
+EXO_TEST(sendbudget_hub_startup, {
+	config_defaults(&sb_config);
+	sb_config.server_port = 0;
+	sb_config.max_users = SB_USERS * 2;
+	sb_config.max_send_buffer_total = 1;
+	if (acl_initialize(&sb_config, &sb_acl) == -1)
+		return 0;
+	sb_hub = hub_start_service(&sb_config);
+	if (!sb_hub)
+		return 0;
+	hub_set_variables(sb_hub, &sb_acl);
+	return route_get_send_budget(sb_hub) == 1024 * 1024;
+});
+
+EXO_TEST(sendbudget_login, {
+	char ip[32];
+	char nick[32];
+	int n;
+
+	for (n = 0; n < SB_USERS; n++)
+	{
+		snprintf(ip, sizeof(ip), "10.1.0.%d", n + 1);
+		snprintf(nick, sizeof(nick), "sendbudget-%d", n);
+		if (!lbc_connect(sb_hub, &sb_clients[n], ip, nick))
+			return 0;
+		lbc_send_support(&sb_clients[n]);
+		if (n % 10 == 9)
+			sb_process();
+	}
+	sb_process();
+	return sb_hub->users->count == SB_USERS;
+});
+
+EXO_TEST(sendbudget_drained, {
+	/* Everything was delivered, and the user list no longer bypasses the limits */
+	struct hub_user* user = uman_get_user_by_sid(sb_hub->users, string_to_sid(sb_clients[SB_USERS - 1].sid));
+	return sb_hub->stats.send_queued == 0 && sb_hub->stats.send_queued_peak > 0 && user && !user_flag_get(user, flag_user_list) && !user->send_backlog;
+});
+
+EXO_TEST(sendbudget_fair_share, {
+	/* 1 MiB for 100 users is less than the smallest share */
+	int n;
+	for (n = SB_FAST; n < SB_SLOW_FIRST; n++)
+		sb_clients[n].paused = 1;
+	sb_chat(300);
+	return sb_hub->stats.send_queued > 0 && sb_hub->stats.send_queued <= (SB_SLOW_FIRST - SB_FAST) * 16384 &&
+		sb_hub->stats.send_dropped > 0 && !sb_hub->stats.send_evicted;
+});
+
+EXO_TEST(sendbudget_evict, {
+	int n;
+	net_backend_advance_time(10);
+	for (n = SB_SLOW_FIRST; n < SB_USERS; n++)
+		sb_clients[n].paused = 1;
+	sb_chat(300);
+	return sb_hub->stats.send_evicted > 0 && sb_hub->stats.send_queued <= route_get_send_budget(sb_hub);
+});
+
+EXO_TEST(sendbudget_evict_slowest, {
+	/* Only users that stopped reading first were disconnected */
+	return sb_count_connected(0, SB_FAST) == SB_FAST &&
+		sb_count_connected(SB_SLOW_FIRST, SB_USERS) == SB_USERS - SB_SLOW_FIRST &&
+		sb_count_connected(SB_FAST, SB_SLOW_FIRST) == (int) (SB_SLOW_FIRST - SB_FAST - sb_hub->stats.send_evicted);
+});
+
+EXO_TEST(sendbudget_fast_users, {
+	int n;
+	for (n = 0; n < SB_FAST; n++)
+	{
+		if (sb_clients[n].messages != 600)
+			return 0;
+	}
+	return 1;
+});
+
+EXO_TEST(sendbudget_resume, {
+	int n;
+	for (n = SB_FAST; n < SB_USERS; n++)
+		sb_clients[n].paused = 0;
+	sb_process();
+	return sb_hub->stats.send_queued == 0;
+});
+
+EXO_TEST(sendbudget_user_list, {
+	/* The user list does not fit in the send queue, but is never cut short */
+	struct hub_user* user;
+	sb_config.max_send_buffer = 2048;
+	if (!lbc_connect(sb_hub, &sb_list, "10.1.1.1", "sendbudget-list"))
+		return 0;
+	sb_list.on_line = sb_count_info;
+	lbc_send_support(&sb_list);
+	sb_process();
+	user = uman_get_user_by_sid(sb_hub->users, string_to_sid(sb_list.sid));
+	return sb_list.logged_in && sb_list_infos == (int) sb_hub->users->count && sb_list_infos * 100 > 2048 + 4096 &&
+		user && !user_flag_get(user, flag_user_list);
+});
+
+EXO_TEST(sendbudget_quit_batch, {
+	/* Everyone else leaves at once, with more quits than a send queue may hold */
+	struct loopback_client* client = &sb_clients[0];
+	struct hub_user* user = uman_get_user_by_sid(sb_hub->users, string_to_sid(client->sid));
+	char buf[128];
+	int quits = client->quits;
+	int leaving = 0;
+	int n;
+
+	client->paused = 1;
+	for (n = 0; n < 60; n++)
+	{
+		snprintf(buf, sizeof(buf), "BMSG %s a\\smessage\\sto\\sfill\\sthe\\ssend\\squeue\\sbefore\\severyone\\sleaves\\s%d\n", sb_list.sid, n);
+		lbc_send(&sb_list, buf);
+		if (n % 10 == 9)
+			sb_process();
+	}
+	sb_process();
+	if (!user || !user->send_queue->size)
+		return 0;
+
+	sb_config.max_send_buffer = 512;
+	for (n = 1; n < SB_USERS; n++)
+	{
+		if (sb_is_connected(n))
+			leaving++;
+		lbc_disconnect(&sb_clients[n]);
+	}
+	sb_process();
+	client->paused = 0;
+	sb_process();
+	return leaving * 10 > 512 && client->quits - quits == leaving && sb_is_connected(0);
+});
+
+EXO_TEST(sendbudget_hub_shutdown, {
+	int n;
+	for (n = 0; n < SB_USERS; n++)
+		lbc_disconnect(&sb_clients[n]);
+	lbc_disconnect(&sb_list);
+	sb_process();
+	hub_free_variables(sb_hub);
+	acl_shutdown(&sb_acl);
+	free_config(&sb_config);
+	hub_shutdown_service(sb_hub);
+	return 1;
+});
+
+EXO_TEST(sendbudget_shutdown, {
+	int ret = net_destroy();
+	net_loopback_set_buffer_size(NET_LOOPBACK_BUFFER_SIZE);
+	net_backend_use_loopback(0);
+	return ret == 0;
+});
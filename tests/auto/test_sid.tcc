@@ -137,6 +137,125 @@ EXO_TEST(sid_destroy_pool, {
 	return sid_pool == 0;
 });
 
+#define SID_LARGE_POOL 500000
+#define SID_DELAY_EPOCH 1000000000
+
+static struct sid_pool* sid_large = 0;
+
+EXO_TEST(sid_large_alloc_all, {
+	sid_t n;
+	sid_large = sid_pool_create(SID_LARGE_POOL);
+	if (!sid_large)
+		return 0;
+	for (n = 1; n <= SID_LARGE_POOL; n++)
+	{
+		if (sid_alloc(sid_large, (struct hub_user*) sid_large) != n)
+			return 0;
+	}
+	return sid_alloc(sid_large, (struct hub_user*) sid_large) == 0;
+});
+
+EXO_TEST(sid_large_reuse_lowest, {
+	sid_free(sid_large, 400000);
+	sid_free(sid_large, 1234);
+	sid_free(sid_large, SID_LARGE_POOL);
+	if (sid_lookup(sid_large, 1234) || !sid_lookup(sid_large, 1235))
+		return 0;
+	if (sid_alloc(sid_large, (struct hub_user*) sid_large) != 1234)
+		return 0;
+	if (sid_alloc(sid_large, (struct hub_user*) sid_large) != 400000)
+		return 0;
+	return sid_alloc(sid_large, (struct hub_user*) sid_large) == SID_LARGE_POOL;
+});
+
+EXO_TEST(sid_large_destroy, {
+	sid_pool_destroy(sid_large);
+	sid_large = sid_pool_create(4);
+	return sid_large != 0;
+});
+
+EXO_TEST(sid_delay_setup, {
+	net_backend_use_loopback(SID_DELAY_EPOCH);
+	if (net_initialize() != 0)
+		return 0;
+	sid_pool_set_reuse_delay(sid_large, 10);
+	return sid_alloc(sid_large, (struct hub_user*) sid_large) == 1;
+});
+
+EXO_TEST(sid_delay_not_reused, {
+	sid_free(sid_large, 1);
+	return sid_alloc(sid_large, (struct hub_user*) sid_large) == 2;
+});
+
+EXO_TEST(sid_delay_reused_later, {
+	net_backend_advance_time(10);
+	return sid_alloc(sid_large, (struct hub_user*) sid_large) == 1;
+});
+
+EXO_TEST(sid_delay_reused_when_full, {
+	if (sid_alloc(sid_large, (struct hub_user*) sid_large) != 3)
+		return 0;
+	if (sid_alloc(sid_large, (struct hub_user*) sid_large) != 4)
+		return 0;
+	sid_free(sid_large, 2);
+	return sid_alloc(sid_large, (struct hub_user*) sid_large) == 2 && sid_alloc(sid_large, (struct hub_user*) sid_large) == 0;
+});
+
+EXO_TEST(sid_delay_disable, {
+	sid_free(sid_large, 3);
+	sid_pool_set_reuse_delay(sid_large, 0);
+	return sid_alloc(sid_large, (struct hub_user*) sid_large) == 3;
+});
+
+EXO_TEST(sid_claim_free, {
+	sid_pool_destroy(sid_large);
+	sid_large = sid_pool_create(8);
+	return sid_claim(sid_large, 5, (struct hub_user*) sid_large) == 5 && sid_lookup(sid_large, 5) == (struct hub_user*) sid_large;
+});
+
+EXO_TEST(sid_claim_used, {
+	return sid_claim(sid_large, 5, (struct hub_user*) sid_large) == 0;
+});
+
+EXO_TEST(sid_claim_out_of_range, {
+	return sid_claim(sid_large, 0, (struct hub_user*) sid_large) == 0 && sid_claim(sid_large, 9, (struct hub_user*) sid_large) == 0;
+});
+
+EXO_TEST(sid_claim_alloc_skips, {
+	int n;
+	for (n = 1; n <= 4; n++)
+	{
+		if (sid_alloc(sid_large, (struct hub_user*) sid_large) != (sid_t) n)
+			return 0;
+	}
+	return sid_alloc(sid_large, (struct hub_user*) sid_large) == 6;
+});
+
+EXO_TEST(sid_range_alloc, {
+	sid_pool_destroy(sid_large);
+	sid_large = sid_pool_create_range(32768, 4);
+	return sid_alloc(sid_large, (struct hub_user*) sid_large) == 32769 && sid_lookup(sid_large, 32769) == (struct hub_user*) sid_large && sid_lookup(sid_large, 1) == NULL;
+});
+
+EXO_TEST(sid_range_free, {
+	sid_free(sid_large, 1);
+	sid_free(sid_large, 32769);
+	return sid_lookup(sid_large, 32769) == NULL && sid_alloc(sid_large, (struct hub_user*) sid_large) == 32769;
+});
+
+EXO_TEST(sid_range_claim, {
+	return sid_claim(sid_large, 32771, (struct hub_user*) sid_large) == 32771 && sid_claim(sid_large, 3, (struct hub_user*) sid_large) == 0 && sid_claim(sid_large, 32773, (struct hub_user*) sid_large) == 0;
+});
+
+EXO_TEST(sid_delay_shutdown, {
+	int ret;
+	sid_pool_destroy(sid_large);
+	sid_large = 0;
+	ret = net_destroy();
+	net_backend_use_loopback(0);
+	return ret == 0;
+});
+
 #define SID_TO_STR(SID, EXPECT) str_match(sid_to_string(SID), EXPECT)
 EXO_TEST(sid_to_str_1,  { return SID_TO_STR(      0, "AAAA"); });
 EXO_TEST(sid_to_str_2,  { return SID_TO_STR(      7, "AAAH"); });
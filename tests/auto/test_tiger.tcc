@@ -67,3 +67,50 @@ EXO_TEST(hash_tiger_7, {
 	return test_tiger_hex("12345678901234567890123456789012345678901234567890123456789012345678901234567890", "1C14795529FD9F207A958F84C52F11E887FA0CABDFD91BFD");
 });
 
+
+#define BATCH_COUNT 201
+
+static int test_tiger_batch(size_t count, size_t length_mod)
+{
+	static uint8_t data[BATCH_COUNT][256];
+	uint64_t* str[BATCH_COUNT];
+	uint64_t length[BATCH_COUNT];
+	uint64_t res[BATCH_COUNT][3];
+	uint64_t expect[3];
+	size_t n, i;
+
+	for (n = 0; n < count; n++)
+	{
+		for (i = 0; i < sizeof(data[n]); i++)
+			data[n][i] = (uint8_t) (n * 31 + i * 7);
+		str[n] = (uint64_t*) data[n];
+		length[n] = length_mod ? n % length_mod : TIGERSIZE;
+	}
+
+	tiger_batch(str, length, res, count);
+
+	for (n = 0; n < count; n++)
+	{
+		tiger(str[n], length[n], expect);
+		if (memcmp(expect, res[n], sizeof(expect)))
+			return 0;
+	}
+	return 1;
+}
+
+EXO_TEST(hash_tiger_batch_cid, {
+	return test_tiger_batch(TIGER_LANES * 8, 0);
+});
+
+EXO_TEST(hash_tiger_batch_odd_count, {
+	return test_tiger_batch(TIGER_LANES * 2 + 1, 0);
+});
+
+EXO_TEST(hash_tiger_batch_mixed_lengths, {
+	return test_tiger_batch(BATCH_COUNT, BATCH_COUNT);
+});
+
+EXO_TEST(hash_tiger_batch_same_blocks, {
+	/* lengths 0-55 all need a single block, 56-119 need two */
+	return test_tiger_batch(BATCH_COUNT, 120);
+});
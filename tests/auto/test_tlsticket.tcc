@@ -0,0 +1,188 @@
+#include <uhub.h>
+
+#include "tls_certificate.h"
+
+/*
+ * Session tickets issued by the hub (see net_ssl_context_rotate_ticket_key()).
+ * The hub side is a regular TLS connection on one end of a socket pair,
+ * the client on the other end uses OpenSSL directly so that it can offer
+ * the tickets it got before.
+ */
+#if defined(SSL_SUPPORT) && defined(SSL_USE_OPENSSL)
+static struct ssl_context_handle* tt_ctx;
+static SSL_CTX* tt_client_ctx;
+static SSL_SESSION* tt_session;     /* Ticket made with the first key */
+static SSL_SESSION* tt_renewed;     /* Ticket renewed after one rotation */
+
+static void tt_event(struct net_connection* con, int event, void* ptr)
+{
+	char buf[64];
+	if (event & NET_EVENT_READ)
+		net_con_recv(con, buf, sizeof(buf));
+}
+
+static int tt_setup()
+{
+	char path[] = "/tmp/uhub-test-XXXXXX";
+	int ok;
+
+	if (net_initialize() != 0)
+		return 0;
+
+	tt_ctx = net_ssl_context_create("1.2", "", "");
+	tt_client_ctx = SSL_CTX_new(TLS_client_method());
+	if (!tt_ctx || !tt_client_ctx || !tls_write_certificate(path))
+		return 0;
+
+	ok = ssl_load_certificate(tt_ctx, path) && ssl_load_private_key(tt_ctx, path) && ssl_check_private_key(tt_ctx);
+	unlink(path);
+
+	/* TLS 1.2 sends the ticket during the handshake, and without a session
+	 * cache on the hub only the ticket can resume a session. */
+	SSL_CTX_set_max_proto_version(tt_client_ctx, TLS1_2_VERSION);
+	net_ssl_context_set_session_cache(tt_ctx, 0, 300);
+	return ok && net_ssl_context_set_tickets(tt_ctx, 1);
+}
+
+/*
+ * Connect to the hub, offering the ticket in 'session' if set.
+ * Returns -1 if the handshake failed, 1 if the session was resumed,
+ * and 0 after a full handshake. The new session is stored in 'out'.
+ */
+static int tt_handshake(SSL_SESSION* session, SSL_SESSION** out)
+{
+	struct net_connection* con = 0;
+	SSL* client = 0;
+	int sd[2];
+	int n, ret = -1;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sd) == -1)
+		return -1;
+	net_set_nonblocking(sd[0], 1);
+	net_set_nonblocking(sd[1], 1);
+
+	con = net_con_create();
+	if (!con || net_con_initialize(con, sd[0], tt_event, 0, NET_EVENT_READ) == -1 || net_con_ssl_handshake(con, net_con_ssl_mode_server, tt_ctx) < 0)
+		goto done;
+
+	client = SSL_new(tt_client_ctx);
+	SSL_set_fd(client, sd[1]);
+	if (session)
+		SSL_set_session(client, session);
+
+	for (n = 0; n < 100; n++)
+	{
+		if (SSL_connect(client) == 1)
+		{
+			ret = SSL_session_reused(client) ? 1 : 0;
+			break;
+		}
+		if (SSL_get_error(client, -1) != SSL_ERROR_WANT_READ)
+			break;
+		net_backend_process_timeout(0);
+	}
+
+	if (ret != -1)
+	{
+		/* Sessions closed without a shutdown cannot be resumed */
+		SSL_shutdown(client);
+		if (out)
+			*out = SSL_get1_session(client);
+	}
+
+done:
+	SSL_free(client);
+	close(sd[1]);
+	if (con)
+		net_con_close(con);
+	else
+		close(sd[0]);
+	net_backend_process_timeout(0);
+	return ret;
+}
+
+static int tt_same_ticket(SSL_SESSION* a, SSL_SESSION* b)
+{
+	const unsigned char* ticket_a;
+	const unsigned char* ticket_b;
+	size_t length_a, length_b;
+
+	SSL_SESSION_get0_ticket(a, &ticket_a, &length_a);
+	SSL_SESSION_get0_ticket(b, &ticket_b, &length_b);
+	return length_a == length_b && !memcmp(ticket_a, ticket_b, length_a);
+}
+
+static int tt_full_handshake()
+{
+	return tt_setup() && tt_handshake(0, &tt_session) == 0 && SSL_SESSION_has_ticket(tt_session);
+}
+
+static int tt_resume_current()
+{
+	return tt_handshake(tt_session, 0) == 1;
+}
+
+/* The ticket is accepted, and replaced by one made with the current key */
+static int tt_resume_previous()
+{
+	if (!net_ssl_context_rotate_ticket_key(tt_ctx))
+		return 0;
+	return tt_handshake(tt_session, &tt_renewed) == 1 && !tt_same_ticket(tt_session, tt_renewed);
+}
+
+static int tt_resume_renewed()
+{
+	return tt_handshake(tt_renewed, 0) == 1;
+}
+
+/* Two rotations later, the key of the renewed ticket is gone */
+static int tt_resume_expired()
+{
+	if (!net_ssl_context_rotate_ticket_key(tt_ctx) || tt_handshake(tt_renewed, 0) != 1)
+		return 0;
+	if (!net_ssl_context_rotate_ticket_key(tt_ctx))
+		return 0;
+	return tt_handshake(tt_renewed, 0) == 0 && tt_handshake(tt_session, 0) == 0;
+}
+
+static int tt_shutdown()
+{
+	SSL_SESSION_free(tt_session);
+	SSL_SESSION_free(tt_renewed);
+	SSL_CTX_free(tt_client_ctx);
+	net_ssl_context_destroy(tt_ctx);
+	return net_destroy() == 0;
+}
+
+#else
+static int tt_full_handshake() { return 1; }
+static int tt_resume_current() { return 1; }
+static int tt_resume_previous() { return 1; }
+static int tt_resume_renewed() { return 1; }
+static int tt_resume_expired() { return 1; }
+static int tt_shutdown() { return 1; }
+#endif
+
+EXO_TEST(tlsticket_full_handshake, {
+	return tt_full_handshake();
+});
+
+EXO_TEST(tlsticket_resume_current_key, {
+	return tt_resume_current();
+});
+
+EXO_TEST(tlsticket_resume_previous_key, {
+	return tt_resume_previous();
+});
+
+EXO_TEST(tlsticket_resume_renewed, {
+	return tt_resume_renewed();
+});
+
+EXO_TEST(tlsticket_older_key_full_handshake, {
+	return tt_resume_expired();
+});
+
+EXO_TEST(tlsticket_shutdown, {
+	return tt_shutdown();
+});
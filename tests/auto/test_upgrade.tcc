@@ -0,0 +1,190 @@
+#include <uhub.h>
+
+#include "loopback_client.h"
+
+static struct hub_config ug_config;
+static struct acl_handle ug_acl;
+static struct hub_info* ug_hub;
+static struct loopback_client ug_client;
+static struct hub_user* ug_user;
+static struct cbuffer* ug_state;
+
+#define UG_QUEUED "ISTA 000 queued\\sbefore\\sthe\\supgrade\n"
+#define UG_PARTIAL "BMSG AAAB half\\sa\\sm"
+
+static int ug_same_user(struct hub_user* a, struct hub_user* b)
+{
+	char addr[INET6_ADDRSTRLEN + 1];
+	struct adc_message* info_a = user_get_info(a, NULL);
+	struct adc_message* info_b = user_get_info(b, NULL);
+
+	strlcpy(addr, ip_convert_to_string(&a->id.addr), sizeof(addr));
+	return a->id.sid == b->id.sid &&
+		!strcmp(a->id.nick, b->id.nick) &&
+		!strcmp(a->id.cid, b->id.cid) &&
+		!strcmp(a->id.user_agent, b->id.user_agent) &&
+		!strcmp(addr, ip_convert_to_string(&b->id.addr)) &&
+		a->credentials == b->credentials &&
+		!((a->flags ^ b->flags) & ~(flag_choke | flag_want_read | flag_want_write | flag_user_list)) &&
+		!memcmp(&a->limits, &b->limits, sizeof(a->limits)) &&
+		info_a && info_b && info_a->length == info_b->length && !memcmp(info_a->cache, info_b->cache, info_a->length);
+}
+
+EXO_TEST(upgrade_startup, {
+	net_backend_use_loopback(LOOPBACK_EPOCH);
+	return net_initialize() == 0;
+});
+
+EXO_TEST(upgrade_hub_startup, {
+	config_defaults(&ug_config);
+	ug_config.server_port = 0;
+	if (acl_initialize(&ug_config, &ug_acl) == -1)
+		return 0;
+	ug_hub = hub_start_service(&ug_config);
+	if (!ug_hub)
+		return 0;
+	hub_set_variables(ug_hub, &ug_acl);
+	return 1;
+});
+
+EXO_TEST(upgrade_login, {
+	if (!lbc_connect(ug_hub, &ug_client, "10.4.0.1", "upgrade-alice"))
+		return 0;
+	lbc_send_support(&ug_client);
+	lbc_process(ug_hub);
+	ug_user = uman_get_user_by_sid(ug_hub->users, string_to_sid(ug_client.sid));
+	return ug_client.logged_in && ug_user;
+});
+
+EXO_TEST(upgrade_write_user, {
+	struct adc_message* msg = adc_msg_create(UG_QUEUED);
+	if (!msg)
+		return 0;
+
+	/* Data not sent yet, and half a message received */
+	ioq_send_add(ug_user->send_queue, msg);
+	adc_msg_free(msg);
+	ioq_recv_set(ug_user->recv_queue, UG_PARTIAL, strlen(UG_PARTIAL));
+	user_set_feature_cast_support(ug_user, "TCP4");
+	user_flag_set(ug_user, flag_muted | flag_low_bw);
+	ug_user->credentials = auth_cred_operator;
+
+	ug_state = cbuf_create(1024);
+	hub_upgrade_write_user(ug_state, ug_user);
+	return cbuf_size(ug_state) > 0;
+});
+
+EXO_TEST(upgrade_read_user, {
+	struct hub_user* user;
+	struct adc_message* queued;
+	sid_t sid = 0;
+	int sd[2];
+	int ok;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sd) == -1)
+		return 0;
+
+	user = hub_upgrade_read_user(ug_hub, cbuf_get(ug_state), cbuf_size(ug_state), sd[0], &sid);
+	if (!user)
+	{
+		close(sd[1]);
+		return 0;
+	}
+
+	queued = (struct adc_message*) list_get_first(user->send_queue->queue);
+	ok = ug_same_user(ug_user, user) && sid == ug_user->id.sid &&
+		user_flag_get(user, flag_muted) && user->credentials == auth_cred_operator &&
+		user_have_feature_cast_support(user, "TCP4") &&
+		queued && queued->length == strlen(UG_QUEUED) && !memcmp(queued->cache, UG_QUEUED, queued->length) &&
+		user->recv_queue->size == strlen(UG_PARTIAL) && !memcmp(user->recv_queue->buf, UG_PARTIAL, strlen(UG_PARTIAL)) &&
+		net_con_get_sd(user->connection) == sd[0];
+
+	user_destroy(user);
+	close(sd[1]);
+	return ok;
+});
+
+EXO_TEST(upgrade_read_user_truncated, {
+	sid_t sid = 0;
+	int sd[2];
+	int ok;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sd) == -1)
+		return 0;
+
+	/* The session ID is known, so the others can be told the user is gone */
+	ok = !hub_upgrade_read_user(ug_hub, cbuf_get(ug_state), cbuf_size(ug_state) - 1, sd[0], &sid) && sid == ug_user->id.sid;
+	ok = ok && fcntl(sd[0], F_GETFD) == -1;
+	close(sd[1]);
+	return ok;
+});
+
+EXO_TEST(upgrade_read_user_bad_credentials, {
+	/* Credentials unknown to this build, after the SID, nick, CID, user agent and address */
+	char* state = hub_malloc(cbuf_size(ug_state));
+	size_t offset = 4 * 5 + strlen(ug_user->id.nick) + strlen(ug_user->id.cid) + strlen(ug_user->id.user_agent) + strlen(ip_convert_to_string(&ug_user->id.addr));
+	sid_t sid = 0;
+	int sd[2];
+	int ok;
+
+	if (!state || socketpair(AF_UNIX, SOCK_STREAM, 0, sd) == -1)
+		return 0;
+
+	memcpy(state, cbuf_get(ug_state), cbuf_size(ug_state));
+	state[offset] = 0x7f;
+	ok = !hub_upgrade_read_user(ug_hub, state, cbuf_size(ug_state), sd[0], &sid) && sid == ug_user->id.sid;
+	hub_free(state);
+	close(sd[1]);
+	return ok;
+});
+
+EXO_TEST(upgrade_read_user_garbage, {
+	sid_t sid = 1;
+	int sd[2];
+	int ok;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sd) == -1)
+		return 0;
+
+	ok = !hub_upgrade_read_user(ug_hub, "xy", 2, sd[0], &sid) && sid == 0 && fcntl(sd[0], F_GETFD) == -1;
+	close(sd[1]);
+	return ok;
+});
+
+EXO_TEST(upgrade_write_user_no_info, {
+	struct adc_message* info = adc_msg_incref(user_get_info(ug_user, NULL));
+	struct cbuffer* buf = cbuf_create(1024);
+	sid_t sid = 0;
+	int sd[2];
+	int ok;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sd) == -1)
+		return 0;
+
+	user_set_info(ug_user, NULL);
+	hub_upgrade_write_user(buf, ug_user);
+	user_set_info(ug_user, info);
+	adc_msg_free(info);
+
+	ok = !hub_upgrade_read_user(ug_hub, cbuf_get(buf), cbuf_size(buf), sd[0], &sid) && sid == ug_user->id.sid;
+	cbuf_destroy(buf);
+	close(sd[1]);
+	return ok;
+});
+
+EXO_TEST(upgrade_hub_shutdown, {
+	cbuf_destroy(ug_state);
+	lbc_disconnect(&ug_client);
+	lbc_process(ug_hub);
+	hub_free_variables(ug_hub);
+	acl_shutdown(&ug_acl);
+	free_config(&ug_config);
+	hub_shutdown_service(ug_hub);
+	return 1;
+});
+
+EXO_TEST(upgrade_shutdown, {
+	int ret = net_destroy();
+	net_backend_use_loopback(0);
+	return ret == 0;
+});
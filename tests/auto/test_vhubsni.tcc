@@ -0,0 +1,323 @@
+#include <uhub.h>
+
+#include "tls_certificate.h"
+#include <poll.h>
+
+/*
+ * A virtual hub sharing the port of the main hub (see tls_sni_name).
+ * The clients connect over TCP and use OpenSSL directly, so that they
+ * can ask for a server name.
+ */
+#if defined(SSL_SUPPORT) && defined(SSL_USE_OPENSSL)
+
+#define VSNI_CONFIG "vsni-hub.conf"
+#define VSNI_LIST "vsni-hubs.conf"
+#define VSNI_PORT "24531"
+
+struct vsni_client
+{
+	int sd;
+	SSL* ssl;
+	char received[8192];
+	size_t length;
+	int closed;
+};
+
+static struct hub_config vsni_config;
+static struct acl_handle vsni_acl;
+static struct hub_info* vsni_hub;
+static SSL_CTX* vsni_client_ctx;
+static char vsni_cert[] = "/tmp/uhub-test-XXXXXX";
+static struct vsni_client vsni_clients[4];
+
+static int vsni_write_file(const char* filename, const char* data)
+{
+	FILE* fp = fopen(filename, "w");
+	if (!fp)
+		return 0;
+	fputs(data, fp);
+	fclose(fp);
+	return 1;
+}
+
+/* Data sent over the loopback interface can take a moment to arrive */
+static void vsni_poll(struct vsni_client* client)
+{
+	struct pollfd pfd;
+	pfd.fd = client->sd;
+	pfd.events = POLLIN;
+	pfd.revents = 0;
+	poll(&pfd, 1, 10);
+}
+
+static void vsni_process()
+{
+	int n;
+	net_backend_process_timeout(10);
+	for (n = 0; n < 20; n++)
+	{
+		net_backend_process_timeout(0);
+		event_queue_process(vsni_hub->queue);
+		vhub_process(vsni_hub);
+	}
+}
+
+static void vsni_read(struct vsni_client* client)
+{
+	int ret;
+
+	vsni_poll(client);
+	while (!client->closed)
+	{
+		ERR_clear_error();
+		ret = SSL_read(client->ssl, client->received + client->length, sizeof(client->received) - client->length - 1);
+		if (ret > 0)
+		{
+			client->length += ret;
+			client->received[client->length] = 0;
+			continue;
+		}
+		if (SSL_get_error(client->ssl, ret) != SSL_ERROR_WANT_READ)
+			client->closed = 1;
+		break;
+	}
+}
+
+/* Wait for the text, returns 0 if the connection was closed first */
+static int vsni_wait(struct vsni_client* client, const char* text)
+{
+	int n;
+	for (n = 0; n < 50; n++)
+	{
+		vsni_process();
+		vsni_read(client);
+		if (strstr(client->received, text))
+			return 1;
+		if (client->closed)
+			return 0;
+	}
+	return 0;
+}
+
+static int vsni_wait_closed(struct vsni_client* client)
+{
+	int n;
+	for (n = 0; n < 50 && !client->closed; n++)
+	{
+		vsni_process();
+		vsni_read(client);
+	}
+	return client->closed;
+}
+
+/* Connect, and send the ClientHello asking for the server name, if any */
+static int vsni_connect(struct vsni_client* client, const char* server_name)
+{
+	struct sockaddr_in addr;
+
+	memset(client, 0, sizeof(struct vsni_client));
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(uhub_atoi(VSNI_PORT));
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	client->sd = socket(AF_INET, SOCK_STREAM, 0);
+	if (client->sd == -1 || connect(client->sd, (struct sockaddr*) &addr, sizeof(addr)) == -1)
+		return 0;
+	net_set_nonblocking(client->sd, 1);
+
+	client->ssl = SSL_new(vsni_client_ctx);
+	SSL_set_fd(client->ssl, client->sd);
+	if (server_name)
+		SSL_set_tlsext_host_name(client->ssl, server_name);
+	ERR_clear_error();
+	return SSL_connect(client->ssl) == -1 && SSL_get_error(client->ssl, -1) == SSL_ERROR_WANT_READ;
+}
+
+static int vsni_handshake(struct vsni_client* client)
+{
+	int n, ret;
+	for (n = 0; n < 50; n++)
+	{
+		ERR_clear_error();
+		ret = SSL_connect(client->ssl);
+		if (ret == 1)
+			return 1;
+		if (SSL_get_error(client->ssl, ret) != SSL_ERROR_WANT_READ)
+			break;
+		vsni_process();
+		vsni_poll(client);
+	}
+	client->closed = 1;
+	return 0;
+}
+
+static void vsni_send(struct vsni_client* client, const char* msg)
+{
+	if (SSL_write(client->ssl, msg, strlen(msg)) <= 0)
+		client->closed = 1;
+}
+
+static void vsni_close(struct vsni_client* client)
+{
+	if (client->ssl)
+		SSL_free(client->ssl);
+	if (client->sd > 0)
+		close(client->sd);
+	memset(client, 0, sizeof(struct vsni_client));
+}
+
+static int vsni_start()
+{
+	char buf[512];
+
+	/* Clients write to connections the hub has closed */
+	signal(SIGPIPE, SIG_IGN);
+	if (net_initialize() != 0 || !tls_write_certificate(vsni_cert))
+		return 0;
+
+	snprintf(buf, sizeof(buf), "server_port = " VSNI_PORT "\nserver_bind_addr = 127.0.0.1\nhub_name = virtual\ntls_enable = yes\n"
+		"tls_certificate = %s\ntls_private_key = %s\ntls_sni_name = vhub.test\n", vsni_cert, vsni_cert);
+	if (!vsni_write_file(VSNI_CONFIG, buf) || !vsni_write_file(VSNI_LIST, VSNI_CONFIG "\n"))
+		return 0;
+
+	config_defaults(&vsni_config);
+	apply_config(&vsni_config, "server_port", VSNI_PORT, 1);
+	apply_config(&vsni_config, "server_bind_addr", "127.0.0.1", 1);
+	apply_config(&vsni_config, "hub_name", "main", 1);
+	apply_config(&vsni_config, "tls_enable", "yes", 1);
+	apply_config(&vsni_config, "tls_certificate", vsni_cert, 1);
+	apply_config(&vsni_config, "tls_private_key", vsni_cert, 1);
+	apply_config(&vsni_config, "file_virtual_hubs", VSNI_LIST, 1);
+	if (acl_initialize(&vsni_config, &vsni_acl) == -1)
+		return 0;
+
+	vsni_hub = hub_start_service(&vsni_config);
+	if (!vsni_hub)
+		return 0;
+	hub_set_variables(vsni_hub, &vsni_acl);
+
+	vsni_client_ctx = SSL_CTX_new(TLS_client_method());
+	return vsni_client_ctx && vhub_start(vsni_hub) == 1;
+}
+
+/* The client asking for the name of the virtual hub gets its hub name */
+static int vsni_handover()
+{
+	struct vsni_client* client = &vsni_clients[0];
+	if (!vsni_connect(client, "vhub.test") || !vsni_handshake(client))
+		return 0;
+	vsni_send(client, "HSUP ADBASE ADTIGR\n");
+	return vsni_wait(client, "NIvirtual");
+}
+
+static int vsni_listener()
+{
+	struct vsni_client* client = &vsni_clients[1];
+	if (!vsni_connect(client, "other.test") || !vsni_handshake(client))
+		return 0;
+	vsni_send(client, "HSUP ADBASE ADTIGR\n");
+	return vsni_wait(client, "NImain");
+}
+
+/*
+ * Stop the virtual hub while one client has finished its handshake,
+ * but not sent anything, and another has only sent its ClientHello.
+ */
+static int vsni_stop()
+{
+	if (!vsni_connect(&vsni_clients[2], "vhub.test") || !vsni_handshake(&vsni_clients[2]))
+		return 0;
+	if (!vsni_connect(&vsni_clients[3], "vhub.test"))
+		return 0;
+	vsni_process();
+
+	if (!vsni_write_file(VSNI_LIST, "# none\n"))
+		return 0;
+	vhub_reconfigure(vsni_hub);
+	return vhub_count() == 0 && vsni_wait_closed(&vsni_clients[0]);
+}
+
+/* Neither is served by the hub listening on the port instead */
+static int vsni_stopped_after_handshake()
+{
+	struct vsni_client* client = &vsni_clients[2];
+	vsni_send(client, "HSUP ADBASE ADTIGR\n");
+	return vsni_wait_closed(client) && !strstr(client->received, "IINF");
+}
+
+static int vsni_stopped_during_handshake()
+{
+	struct vsni_client* client = &vsni_clients[3];
+	if (vsni_handshake(client))
+		vsni_send(client, "HSUP ADBASE ADTIGR\n");
+	return vsni_wait_closed(client) && !strstr(client->received, "IINF");
+}
+
+static int vsni_listener_alive()
+{
+	struct vsni_client* client = &vsni_clients[1];
+	vsni_process();
+	vsni_read(client);
+	return !client->closed;
+}
+
+static int vsni_shutdown()
+{
+	size_t n;
+	for (n = 0; n < sizeof(vsni_clients) / sizeof(vsni_clients[0]); n++)
+		vsni_close(&vsni_clients[n]);
+	vsni_process();
+
+	vhub_shutdown();
+	hub_free_variables(vsni_hub);
+	acl_shutdown(&vsni_acl);
+	free_config(&vsni_config);
+	hub_shutdown_service(vsni_hub);
+	SSL_CTX_free(vsni_client_ctx);
+	unlink(vsni_cert);
+	return remove(VSNI_CONFIG) == 0 && remove(VSNI_LIST) == 0 && net_destroy() == 0;
+}
+
+#else
+static int vsni_start() { return 1; }
+static int vsni_handover() { return 1; }
+static int vsni_listener() { return 1; }
+static int vsni_stop() { return 1; }
+static int vsni_stopped_after_handshake() { return 1; }
+static int vsni_stopped_during_handshake() { return 1; }
+static int vsni_listener_alive() { return 1; }
+static int vsni_shutdown() { return 1; }
+#endif
+
+EXO_TEST(vhubsni_start, {
+	return vsni_start();
+});
+
+EXO_TEST(vhubsni_handover, {
+	return vsni_handover();
+});
+
+EXO_TEST(vhubsni_other_name_stays, {
+	return vsni_listener();
+});
+
+EXO_TEST(vhubsni_stop, {
+	return vsni_stop();
+});
+
+EXO_TEST(vhubsni_stopped_after_handshake, {
+	return vsni_stopped_after_handshake();
+});
+
+EXO_TEST(vhubsni_stopped_during_handshake, {
+	return vsni_stopped_during_handshake();
+});
+
+EXO_TEST(vhubsni_listener_alive, {
+	return vsni_listener_alive();
+});
+
+EXO_TEST(vhubsni_shutdown, {
+	return vsni_shutdown();
+});
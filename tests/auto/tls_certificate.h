@@ -0,0 +1,72 @@
+/*
+ * Self signed certificates for the tests that run TLS connections.
+ *
+ * Include this from a test*.tcc file. All test files are built as one
+ * translation unit, so it is only defined once.
+ */
+
+#ifndef HAVE_UHUB_TEST_TLS_CERTIFICATE_H
+#define HAVE_UHUB_TEST_TLS_CERTIFICATE_H
+
+#include <uhub.h>
+
+#if defined(SSL_SUPPORT) && defined(SSL_USE_OPENSSL)
+#include <openssl/ssl.h>
+#include <openssl/pem.h>
+
+/*
+ * Write a self signed certificate and its key to a temporary file,
+ * 'path' is a mkstemp() template. Returns 1 on success, 0 otherwise.
+ */
+static int tls_write_certificate(char* path)
+{
+	EVP_PKEY* key = EVP_EC_gen("P-256");
+	X509* cert = X509_new();
+	X509_NAME* name;
+	FILE* fp = 0;
+	int sd = mkstemp(path);
+	int ok = 0;
+
+	if (key && cert && sd != -1 && (fp = fdopen(sd, "w")))
+	{
+		ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+		X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+		X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+		X509_set_pubkey(cert, key);
+		name = X509_get_subject_name(cert);
+		X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char*) "uhub-test", -1, -1, 0);
+		X509_set_issuer_name(cert, name);
+		ok = X509_sign(cert, key, EVP_sha256()) > 0 && PEM_write_X509(fp, cert) && PEM_write_PrivateKey(fp, key, 0, 0, 0, 0, 0);
+	}
+
+	if (fp)
+		fclose(fp);
+	else if (sd != -1)
+		close(sd);
+	X509_free(cert);
+	EVP_PKEY_free(key);
+	return ok;
+}
+
+/*
+ * Store the keyprint of the certificate written by tls_write_certificate(),
+ * as in an adcs:// address. Returns 1 on success, 0 otherwise.
+ */
+static int tls_get_keyprint(const char* path, char* keyprint)
+{
+	unsigned char md[EVP_MAX_MD_SIZE];
+	unsigned int length;
+	FILE* fp = fopen(path, "r");
+	X509* cert = fp ? PEM_read_X509(fp, 0, 0, 0) : 0;
+	int ok = cert && X509_digest(cert, EVP_sha256(), md, &length);
+
+	if (ok)
+		base32_encode(md, length, keyprint);
+	if (fp)
+		fclose(fp);
+	X509_free(cert);
+	return ok;
+}
+
+#endif /* SSL_SUPPORT && SSL_USE_OPENSSL */
+#endif /* HAVE_UHUB_TEST_TLS_CERTIFICATE_H */
@@ -0,0 +1,227 @@
+/*
+ * uhub - A tiny ADC p2p connection hub
+ * Copyright (C) 2007-2014, Jan Vidar Krey
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "bench.h"
+
+#include <math.h>
+
+#define BENCH_REPEAT_DEFAULT 5
+#define BENCH_REPEAT_MAX 100
+
+struct bench_suite
+{
+	const char* name;
+	void (*run)();
+};
+
+static struct bench_suite suites[] = {
+	{ "containers", bench_containers },
+	{ "hash", bench_hash },
+	{ "iptrie", bench_iptrie },
+	{ "message", bench_message },
+	{ "plugins", bench_plugins },
+	{ "route", bench_route },
+	{ "tls", bench_tls },
+	{ NULL, NULL }
+};
+
+static uint32_t random_state = 2463534242U;
+static int g_repeat = BENCH_REPEAT_DEFAULT;
+static int g_json = 0;
+static size_t g_results = 0;
+static const char* g_suite = "";
+static uint64_t g_paused_at = 0;
+static uint64_t g_paused = 0;
+
+uint64_t bench_now()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uint64_t) ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+void bench_pause()
+{
+	g_paused_at = bench_now();
+}
+
+void bench_resume()
+{
+	g_paused += bench_now() - g_paused_at;
+}
+
+void bench_note(const char* format, ...)
+{
+	va_list args;
+
+	if (g_json)
+		return;
+
+	va_start(args, format);
+	vprintf(format, args);
+	va_end(args);
+	printf("\n");
+}
+
+static int compare_double(const void* a, const void* b)
+{
+	double x = *(const double*) a;
+	double y = *(const double*) b;
+	return (x > y) - (x < y);
+}
+
+static double bench_time(bench_func func, void* ctx, size_t iterations)
+{
+	uint64_t start;
+
+	g_paused = 0;
+	start = bench_now();
+	func(ctx, iterations);
+	return (double) (bench_now() - start - g_paused) / (double) iterations;
+}
+
+void bench_run(const char* name, bench_func func, void* ctx, size_t iterations)
+{
+	double samples[BENCH_REPEAT_MAX];
+	double median, mean = 0, variance = 0;
+	int n;
+
+	bench_time(func, ctx, MAX(iterations / 10, 1));
+
+	for (n = 0; n < g_repeat; n++)
+	{
+		samples[n] = bench_time(func, ctx, iterations);
+		mean += samples[n];
+	}
+	mean /= g_repeat;
+
+	for (n = 0; n < g_repeat; n++)
+		variance += (samples[n] - mean) * (samples[n] - mean);
+	variance /= g_repeat;
+
+	qsort(samples, g_repeat, sizeof(double), compare_double);
+	median = (g_repeat & 1) ? samples[g_repeat / 2] : (samples[g_repeat / 2 - 1] + samples[g_repeat / 2]) / 2;
+
+	if (g_json)
+	{
+		printf("%s\t\t{ \"suite\": \"%s\", \"name\": \"%s\", \"iterations\": %" PRIsz ", "
+			"\"median_ns\": %.2f, \"min_ns\": %.2f, \"max_ns\": %.2f, \"stddev_ns\": %.2f }",
+			g_results ? ",\n" : "", g_suite, name, iterations,
+			median, samples[0], samples[g_repeat - 1], sqrt(variance));
+	}
+	else
+	{
+		printf("%-40s %12" PRIsz " ops %12.1f ns/op  (min %.1f, max %.1f, sd %.1f)\n",
+			name, iterations, median, samples[0], samples[g_repeat - 1], sqrt(variance));
+	}
+	g_results++;
+}
+
+uint32_t bench_random()
+{
+	/* xorshift32 */
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+	return random_state;
+}
+
+void bench_random_seed(uint32_t seed)
+{
+	random_state = seed ? seed : 2463534242U;
+}
+
+NO_RETURN static void print_usage(const char* program)
+{
+	struct bench_suite* suite;
+
+	printf("Usage: %s [-j] [-r <repeat>] [suite...]\n", program);
+	printf("\n");
+	printf("    -j          Machine readable (JSON) output.\n");
+	printf("    -r <num>    Number of measured repetitions (default: %d).\n", BENCH_REPEAT_DEFAULT);
+	printf("\n");
+	printf("Suites:");
+	for (suite = suites; suite->name; suite++)
+		printf(" %s", suite->name);
+	printf("\n");
+	exit(1);
+}
+
+static int suite_selected(const char* name, int argc, char** argv)
+{
+	int selected = -1;
+	int i;
+
+	for (i = 1; i < argc; i++)
+	{
+		if (argv[i][0] == '-')
+		{
+			if (!strcmp(argv[i], "-r"))
+				i++;
+			continue;
+		}
+
+		if (!strcmp(argv[i], name))
+			return 1;
+		selected = 0;
+	}
+
+	/* No suites given means all of them */
+	return selected;
+}
+
+int main(int argc, char** argv)
+{
+	struct bench_suite* suite;
+	int i;
+
+	for (i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "-j"))
+			g_json = 1;
+		else if (!strcmp(argv[i], "-r") && i + 1 < argc)
+		{
+			g_repeat = uhub_atoi(argv[++i]);
+			g_repeat = MIN(MAX(g_repeat, 1), BENCH_REPEAT_MAX);
+		}
+		else if (argv[i][0] == '-')
+			print_usage(argv[0]);
+	}
+
+	net_initialize();
+
+	if (g_json)
+		printf("{\n\t\"version\": \"%s\",\n\t\"repeat\": %d,\n\t\"results\": [\n", PRODUCT_STRING, g_repeat);
+
+	for (suite = suites; suite->name; suite++)
+	{
+		if (!suite_selected(suite->name, argc, argv))
+			continue;
+
+		g_suite = suite->name;
+		bench_random_seed(0);
+		suite->run();
+	}
+
+	if (g_json)
+		printf("\n\t]\n}\n");
+
+	net_destroy();
+	return 0;
+}
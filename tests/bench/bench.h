@@ -0,0 +1,71 @@
+/*
+ * uhub - A tiny ADC p2p connection hub
+ * Copyright (C) 2007-2014, Jan Vidar Krey
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef HAVE_UHUB_BENCH_H
+#define HAVE_UHUB_BENCH_H
+
+#include <uhub.h>
+
+/*
+ * Minimal micro benchmark harness.
+ * A benchmark function performs the measured operation 'iterations' times.
+ * Every benchmark is run once with a tenth of the iterations to warm up,
+ * and then repeated (see -r) to get the median, spread and deviation.
+ */
+typedef void (*bench_func)(void* ctx, size_t iterations);
+
+/**
+ * @return a monotonic time stamp in nanoseconds.
+ */
+extern uint64_t bench_now();
+
+/**
+ * Run a benchmark and report the time per operation.
+ */
+extern void bench_run(const char* name, bench_func func, void* ctx, size_t iterations);
+
+/**
+ * Exclude the time between bench_pause() and bench_resume() from the
+ * measurement, for setup or cleanup inside a benchmark function.
+ */
+extern void bench_pause();
+extern void bench_resume();
+
+/**
+ * Print additional information (not in machine readable output).
+ */
+PRINTF_ARG(1, 2)
+extern void bench_note(const char* format, ...);
+
+/**
+ * Deterministic pseudo random numbers, so results are comparable between runs.
+ */
+extern uint32_t bench_random();
+extern void bench_random_seed(uint32_t seed);
+
+/* Benchmark suites */
+extern void bench_containers();
+extern void bench_hash();
+extern void bench_iptrie();
+extern void bench_message();
+extern void bench_plugins();
+extern void bench_route();
+extern void bench_tls();
+
+#endif /* HAVE_UHUB_BENCH_H */
@@ -0,0 +1,247 @@
+/*
+ * uhub - A tiny ADC p2p connection hub
+ * Copyright (C) 2007-2014, Jan Vidar Krey
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "bench.h"
+
+#define CONTAINER_KEYS 100000
+#define CONTAINER_CALLS 1000000
+#define LIST_SIZE 10000
+#define TIMEOUT_EVENTS 10000
+#define TIMEOUT_MAX 120
+#define SID_USERS 10000
+#define SID_USERS_LARGE 500000
+#define SID_POOL_LARGE 524288
+
+struct containers_bench
+{
+	char (*keys)[16];
+	struct rb_tree* tree;
+	struct linked_list* list;
+	struct timeout_queue queue;
+	struct timeout_evt* events;
+	time_t now;
+	struct sid_pool* sids;
+	sid_t* allocated;
+	size_t users;
+	size_t found;
+};
+
+static int compare_key(const void* a, const void* b)
+{
+	return strcmp((const char*) a, (const char*) b);
+}
+
+static void bench_rb_tree_insert(void* ptr, size_t iterations)
+{
+	struct containers_bench* ctx = (struct containers_bench*) ptr;
+	size_t n;
+
+	bench_pause();
+	if (ctx->tree)
+		rb_tree_destroy(ctx->tree);
+	bench_resume();
+
+	ctx->tree = rb_tree_create(compare_key, NULL, NULL);
+	for (n = 0; n < iterations; n++)
+		rb_tree_insert(ctx->tree, ctx->keys[n % CONTAINER_KEYS], ctx->keys[n % CONTAINER_KEYS]);
+}
+
+static void bench_rb_tree_get(void* ptr, size_t iterations)
+{
+	struct containers_bench* ctx = (struct containers_bench*) ptr;
+	size_t n;
+
+	for (n = 0; n < iterations; n++)
+		ctx->found += !!rb_tree_get(ctx->tree, ctx->keys[bench_random() % CONTAINER_KEYS]);
+}
+
+static void bench_rb_tree_remove(void* ptr, size_t iterations)
+{
+	struct containers_bench* ctx = (struct containers_bench*) ptr;
+	const char* key;
+	size_t n;
+
+	/* Remove and put back, so the tree keeps its size */
+	for (n = 0; n < iterations; n++)
+	{
+		key = ctx->keys[bench_random() % CONTAINER_KEYS];
+		rb_tree_remove(ctx->tree, key);
+		rb_tree_insert(ctx->tree, key, key);
+	}
+}
+
+static void bench_list_append(void* ptr, size_t iterations)
+{
+	struct containers_bench* ctx = (struct containers_bench*) ptr;
+	size_t n;
+
+	for (n = 0; n < iterations; n++)
+	{
+		list_append(ctx->list, ctx->keys[n % CONTAINER_KEYS]);
+		list_remove_first(ctx->list, NULL);
+	}
+}
+
+static void bench_list_iterate(void* ptr, size_t iterations)
+{
+	struct containers_bench* ctx = (struct containers_bench*) ptr;
+	char* key;
+	size_t n;
+
+	for (n = 0; n < iterations; n++)
+	{
+		LIST_FOREACH(char*, key, ctx->list,
+		{
+			ctx->found += key[0];
+		});
+	}
+}
+
+static void bench_list_remove(void* ptr, size_t iterations)
+{
+	struct containers_bench* ctx = (struct containers_bench*) ptr;
+	char* key;
+	size_t n;
+
+	/* Remove an element from somewhere in the list and put it back at the end */
+	for (n = 0; n < iterations; n++)
+	{
+		key = ctx->keys[bench_random() % LIST_SIZE];
+		list_remove(ctx->list, key);
+		list_append(ctx->list, key);
+	}
+}
+
+static void timeout_callback(struct timeout_evt* evt)
+{
+	struct containers_bench* ctx = (struct containers_bench*) evt->ptr;
+	ctx->found++;
+}
+
+static void bench_timeout_reschedule(void* ptr, size_t iterations)
+{
+	struct containers_bench* ctx = (struct containers_bench*) ptr;
+	size_t n;
+
+	for (n = 0; n < iterations; n++)
+		timeout_queue_reschedule(&ctx->queue, &ctx->events[bench_random() % TIMEOUT_EVENTS], 1 + (bench_random() % (TIMEOUT_MAX - 1)));
+}
+
+static void bench_timeout_process(void* ptr, size_t iterations)
+{
+	struct containers_bench* ctx = (struct containers_bench*) ptr;
+	size_t n;
+
+	/* Advance one second at a time, and schedule every event that fired again */
+	for (n = 0; n < iterations; n++)
+	{
+		ctx->now++;
+		timeout_queue_process(&ctx->queue, ctx->now);
+		for (; ctx->found; ctx->found--)
+		{
+			struct timeout_evt* evt = &ctx->events[bench_random() % TIMEOUT_EVENTS];
+			if (!timeout_evt_is_scheduled(evt))
+				timeout_queue_insert(&ctx->queue, evt, 1 + (bench_random() % (TIMEOUT_MAX - 1)));
+		}
+	}
+}
+
+static void bench_sid_alloc(void* ptr, size_t iterations)
+{
+	struct containers_bench* ctx = (struct containers_bench*) ptr;
+	size_t n, i;
+
+	/* A user leaves and another one joins */
+	for (n = 0; n < iterations; n++)
+	{
+		i = bench_random() % ctx->users;
+		sid_free(ctx->sids, ctx->allocated[i]);
+		ctx->allocated[i] = sid_alloc(ctx->sids, (struct hub_user*) ctx);
+	}
+}
+
+static void bench_sid_lookup(void* ptr, size_t iterations)
+{
+	struct containers_bench* ctx = (struct containers_bench*) ptr;
+	size_t n;
+
+	for (n = 0; n < iterations; n++)
+		ctx->found += !!sid_lookup(ctx->sids, ctx->allocated[bench_random() % ctx->users]);
+}
+
+void bench_containers()
+{
+	struct containers_bench ctx;
+	size_t n;
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.keys = hub_malloc(sizeof(*ctx.keys) * CONTAINER_KEYS);
+	for (n = 0; n < CONTAINER_KEYS; n++)
+		snprintf(ctx.keys[n], sizeof(ctx.keys[n]), "user%08x", bench_random());
+
+	bench_run("rb_tree_insert (100k)", bench_rb_tree_insert, &ctx, CONTAINER_KEYS);
+	bench_run("rb_tree_get (100k)", bench_rb_tree_get, &ctx, CONTAINER_CALLS);
+	bench_run("rb_tree_remove+insert (100k)", bench_rb_tree_remove, &ctx, CONTAINER_CALLS);
+	rb_tree_destroy(ctx.tree);
+
+	ctx.list = list_create();
+	bench_run("list_append+remove_first", bench_list_append, &ctx, CONTAINER_CALLS);
+	for (n = 0; n < LIST_SIZE; n++)
+		list_append(ctx.list, ctx.keys[n]);
+	bench_run("list_iterate (10k)", bench_list_iterate, &ctx, 1000);
+	bench_run("list_remove+append (10k)", bench_list_remove, &ctx, 10000);
+	list_clear(ctx.list, NULL);
+	list_destroy(ctx.list);
+
+	ctx.events = hub_malloc_zero(sizeof(struct timeout_evt) * TIMEOUT_EVENTS);
+	timeout_queue_initialize(&ctx.queue, ctx.now, TIMEOUT_MAX);
+	for (n = 0; n < TIMEOUT_EVENTS; n++)
+	{
+		timeout_evt_initialize(&ctx.events[n], timeout_callback, &ctx);
+		timeout_queue_insert(&ctx.queue, &ctx.events[n], 1 + (bench_random() % (TIMEOUT_MAX - 1)));
+	}
+	ctx.found = 0;
+	bench_run("timeout_queue_reschedule (10k)", bench_timeout_reschedule, &ctx, CONTAINER_CALLS);
+	bench_run("timeout_queue_process (10k)", bench_timeout_process, &ctx, 10000);
+	timeout_queue_shutdown(&ctx.queue);
+	hub_free(ctx.events);
+
+	ctx.sids = sid_pool_create(SID_USERS * 2);
+	ctx.allocated = hub_malloc(sizeof(sid_t) * SID_USERS);
+	ctx.users = SID_USERS;
+	for (n = 0; n < SID_USERS; n++)
+		ctx.allocated[n] = sid_alloc(ctx.sids, (struct hub_user*) &ctx);
+	bench_run("sid_free+alloc (10k users)", bench_sid_alloc, &ctx, CONTAINER_CALLS);
+	bench_run("sid_lookup (10k users)", bench_sid_lookup, &ctx, CONTAINER_CALLS);
+	sid_pool_destroy(ctx.sids);
+	hub_free(ctx.allocated);
+
+	/* A nearly full pool, where a linear search for a free slot is slow */
+	ctx.sids = sid_pool_create(SID_POOL_LARGE);
+	ctx.allocated = hub_malloc(sizeof(sid_t) * SID_USERS_LARGE);
+	ctx.users = SID_USERS_LARGE;
+	for (n = 0; n < SID_USERS_LARGE; n++)
+		ctx.allocated[n] = sid_alloc(ctx.sids, (struct hub_user*) &ctx);
+	bench_run("sid_free+alloc (500k users)", bench_sid_alloc, &ctx, CONTAINER_CALLS);
+	bench_run("sid_lookup (500k users)", bench_sid_lookup, &ctx, CONTAINER_CALLS);
+	sid_pool_destroy(ctx.sids);
+	hub_free(ctx.allocated);
+
+	hub_free(ctx.keys);
+}
@@ -0,0 +1,114 @@
+/*
+ * uhub - A tiny ADC p2p connection hub
+ * Copyright (C) 2007-2014, Jan Vidar Krey
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "bench.h"
+
+#define HASH_CALLS 1000000
+#define HASH_BLOCK 1024
+#define HASH_BATCH 64
+
+struct hash_bench
+{
+	uint64_t block[HASH_BLOCK / sizeof(uint64_t)];
+	uint64_t pid[3];
+	uint64_t digest[3];
+	char encoded[MAX_CID_LEN + 1];
+	unsigned char decoded[64];
+	uint64_t batch_pid[HASH_BATCH][3];
+	uint64_t* batch_str[HASH_BATCH];
+	uint64_t batch_length[HASH_BATCH];
+	uint64_t batch_digest[HASH_BATCH][3];
+};
+
+static void bench_tiger_cid(void* ptr, size_t iterations)
+{
+	struct hash_bench* ctx = (struct hash_bench*) ptr;
+	size_t n;
+
+	/* Hashing a PID into a CID, as done for every login */
+	for (n = 0; n < iterations; n++)
+		tiger(ctx->pid, TIGERSIZE, ctx->digest);
+}
+
+static void bench_tiger_cid_batch(void* ptr, size_t iterations)
+{
+	struct hash_bench* ctx = (struct hash_bench*) ptr;
+	size_t n;
+
+	/* Same as above, but batched the way queued logins are verified */
+	for (n = 0; n < iterations; n += HASH_BATCH)
+		tiger_batch(ctx->batch_str, ctx->batch_length, ctx->batch_digest, HASH_BATCH);
+}
+
+static void bench_tiger_block(void* ptr, size_t iterations)
+{
+	struct hash_bench* ctx = (struct hash_bench*) ptr;
+	size_t n;
+
+	for (n = 0; n < iterations; n++)
+		tiger(ctx->block, HASH_BLOCK, ctx->digest);
+}
+
+static void bench_base32_encode(void* ptr, size_t iterations)
+{
+	struct hash_bench* ctx = (struct hash_bench*) ptr;
+	size_t n;
+
+	for (n = 0; n < iterations; n++)
+		base32_encode((unsigned char*) ctx->digest, TIGERSIZE, ctx->encoded);
+}
+
+static void bench_base32_decode(void* ptr, size_t iterations)
+{
+	struct hash_bench* ctx = (struct hash_bench*) ptr;
+	size_t n;
+
+	for (n = 0; n < iterations; n++)
+		base32_decode(ctx->encoded, ctx->decoded, MAX_CID_LEN);
+}
+
+void bench_hash()
+{
+	struct hash_bench* ctx = hub_malloc_zero(sizeof(struct hash_bench));
+	size_t n;
+
+	for (n = 0; n < HASH_BLOCK / sizeof(uint64_t); n++)
+		ctx->block[n] = ((uint64_t) bench_random() << 32) | bench_random();
+
+	tiger(ctx->block, HASH_BLOCK, ctx->digest);
+	memcpy(ctx->pid, ctx->digest, TIGERSIZE);
+
+	for (n = 0; n < HASH_BATCH; n++)
+	{
+		tiger(ctx->batch_pid[(n + HASH_BATCH - 1) % HASH_BATCH], TIGERSIZE, ctx->batch_pid[n]);
+		ctx->batch_str[n] = ctx->batch_pid[n];
+		ctx->batch_length[n] = TIGERSIZE;
+	}
+	base32_encode((unsigned char*) ctx->digest, TIGERSIZE, ctx->encoded);
+	ctx->encoded[MAX_CID_LEN] = '\0';
+
+	bench_run("tiger (24 bytes)", bench_tiger_cid, ctx, HASH_CALLS);
+	bench_note("tiger_batch implementation: %s", tiger_batch_impl());
+	bench_run("tiger_batch (24 bytes)", bench_tiger_cid_batch, ctx, HASH_CALLS);
+	bench_run("tiger (1024 bytes)", bench_tiger_block, ctx, HASH_CALLS / 10);
+	bench_run("base32_encode (24 bytes)", bench_base32_encode, ctx, HASH_CALLS);
+	bench_run("base32_decode (39 chars)", bench_base32_decode, ctx, HASH_CALLS);
+
+	hub_free(ctx);
+}
@@ -0,0 +1,154 @@
+/*
+ * uhub - A tiny ADC p2p connection hub
+ * Copyright (C) 2007-2014, Jan Vidar Krey
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "bench.h"
+
+#define IPTRIE_RANGES 100000
+#define IPTRIE_LOOKUPS 1000000
+#define IPTRIE_LINEAR_LOOKUPS 1000
+
+struct iptrie_bench
+{
+	struct ip_trie* trie;
+	struct ip_range* ranges;
+	struct ip_addr_encap* addrs;
+	size_t num_ranges;
+	size_t num_addrs;
+	size_t hits;
+};
+
+static void random_addr(struct ip_addr_encap* addr, int af)
+{
+	uint32_t* words = (uint32_t*) &addr->internal_ip_data.in6;
+	memset(addr, 0, sizeof(struct ip_addr_encap));
+	addr->af = af;
+	if (af == AF_INET)
+	{
+		addr->internal_ip_data.in.s_addr = bench_random();
+	}
+	else
+	{
+		/* Keep IPv6 addresses inside 2000::/4 like real blocklists */
+		words[0] = htonl(0x20000000 | (bench_random() & 0x0fffffff));
+		words[1] = bench_random();
+		words[2] = bench_random();
+		words[3] = bench_random();
+	}
+}
+
+/* Mix of CIDR blocks and arbitrary ranges, 1 in 4 is IPv6 */
+static void random_range(struct ip_range* range)
+{
+	int af = (bench_random() & 3) ? AF_INET : AF_INET6;
+	int maxbits = (af == AF_INET) ? 32 : 128;
+	int bits = (af == AF_INET) ? 16 + (bench_random() % 17) : 32 + (bench_random() % 97);
+	struct ip_addr_encap mask;
+
+	random_addr(&range->lo, af);
+	if (bench_random() & 1)
+	{
+		ip_mask_create_left(af, bits, &mask);
+		ip_mask_apply_AND(&range->lo, &mask, &range->lo);
+		ip_mask_create_right(af, maxbits - bits, &mask);
+		ip_mask_apply_OR(&range->lo, &mask, &range->hi);
+	}
+	else
+	{
+		memcpy(&range->hi, &range->lo, sizeof(struct ip_addr_encap));
+		if (af == AF_INET)
+			range->hi.internal_ip_data.in.s_addr = htonl(ntohl(range->lo.internal_ip_data.in.s_addr) | (bench_random() & 0xfff));
+		else
+			range->hi.internal_ip_data.in6.s6_addr[15] |= (uint8_t) bench_random();
+	}
+}
+
+static void bench_iptrie_build(void* ptr, size_t iterations)
+{
+	struct iptrie_bench* ctx = (struct iptrie_bench*) ptr;
+	size_t n;
+
+	bench_pause();
+	if (ctx->trie)
+		ip_trie_destroy(ctx->trie);
+	bench_resume();
+
+	ctx->trie = ip_trie_create();
+	for (n = 0; n < iterations; n++)
+		ip_trie_insert_range(ctx->trie, &ctx->ranges[n], NULL);
+}
+
+static void bench_iptrie_lookup(void* ptr, size_t iterations)
+{
+	struct iptrie_bench* ctx = (struct iptrie_bench*) ptr;
+	size_t n;
+
+	for (n = 0; n < iterations; n++)
+		ctx->hits += ip_trie_lookup(ctx->trie, &ctx->addrs[n % ctx->num_addrs], NULL);
+}
+
+static void bench_iptrie_lookup_linear(void* ptr, size_t iterations)
+{
+	struct iptrie_bench* ctx = (struct iptrie_bench*) ptr;
+	size_t n, r;
+
+	for (n = 0; n < iterations; n++)
+	{
+		for (r = 0; r < ctx->num_ranges; r++)
+		{
+			if (ip_in_range(&ctx->addrs[n % ctx->num_addrs], &ctx->ranges[r]))
+			{
+				ctx->hits++;
+				break;
+			}
+		}
+	}
+}
+
+void bench_iptrie()
+{
+	struct iptrie_bench ctx;
+	size_t n;
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.num_ranges = IPTRIE_RANGES;
+	ctx.num_addrs = 65536;
+	ctx.ranges = hub_malloc(sizeof(struct ip_range) * ctx.num_ranges);
+	ctx.addrs = hub_malloc(sizeof(struct ip_addr_encap) * ctx.num_addrs);
+
+	for (n = 0; n < ctx.num_ranges; n++)
+		random_range(&ctx.ranges[n]);
+
+	/* Half of the addresses are taken from inside a banned range */
+	for (n = 0; n < ctx.num_addrs; n++)
+	{
+		if (n & 1)
+			memcpy(&ctx.addrs[n], &ctx.ranges[bench_random() % ctx.num_ranges].hi, sizeof(struct ip_addr_encap));
+		else
+			random_addr(&ctx.addrs[n], (bench_random() & 3) ? AF_INET : AF_INET6);
+	}
+
+	bench_run("iptrie_insert_range (100k)", bench_iptrie_build, &ctx, ctx.num_ranges);
+	bench_note("%-40s %12" PRIsz " prefixes", "iptrie_size", ip_trie_size(ctx.trie));
+	bench_run("iptrie_lookup (100k ranges)", bench_iptrie_lookup, &ctx, IPTRIE_LOOKUPS);
+	bench_run("linear_lookup (100k ranges)", bench_iptrie_lookup_linear, &ctx, IPTRIE_LINEAR_LOOKUPS);
+
+	ip_trie_destroy(ctx.trie);
+	hub_free(ctx.ranges);
+	hub_free(ctx.addrs);
+}
@@ -0,0 +1,130 @@
+/*
+ * uhub - A tiny ADC p2p connection hub
+ * Copyright (C) 2007-2014, Jan Vidar Krey
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "bench.h"
+
+#define MESSAGE_CALLS 1000000
+
+static const char* bench_inf = "BINF AAAB IDGNSSMURMD7K466NGZIHU65TP3S3UZSQ6MN5B2RI PDM2V4Y4XDXFZKGNT2EJKJBJLQCDH67SQVABYGX4OI NIbench\\suser DEuhub\\sbenchmark\\sclient "
+	"I4127.0.0.1 U41511 SS1209818412 SF12345 VEuhub\\s0.5.1 US1048576 DS5242880 SL3 HN1 HR0 HO0 SUTCP4,UDP4,ADC0,SEGA\n";
+
+static const char* bench_chat = "Ärger mit den Überwachungskameras? Проблемы с камерами? 監視カメラの問題? Trouble with the cameras? \xf0\x9f\x93\xb7";
+
+static const char* bench_inf_update[2] = {
+	"BINF AAAB SS1209818413 SF12346 HN2\n",
+	"BINF AAAB SS1209818412 SF12345 HN1\n",
+};
+
+struct message_bench
+{
+	struct adc_message* msg;
+	struct inf_table* table;
+	size_t length;
+	size_t found;
+};
+
+static void bench_msg_parse(void* ptr, size_t iterations)
+{
+	struct message_bench* ctx = (struct message_bench*) ptr;
+	size_t n;
+
+	for (n = 0; n < iterations; n++)
+		adc_msg_free(adc_msg_parse(bench_inf, ctx->length));
+}
+
+static void bench_msg_get_first(void* ptr, size_t iterations)
+{
+	struct message_bench* ctx = (struct message_bench*) ptr;
+	size_t n;
+	char* arg;
+
+	for (n = 0; n < iterations; n++)
+	{
+		arg = adc_msg_get_named_argument(ctx->msg, ADC_INF_FLAG_CLIENT_ID);
+		ctx->found += !!arg;
+		hub_free(arg);
+	}
+}
+
+static void bench_msg_get_last(void* ptr, size_t iterations)
+{
+	struct message_bench* ctx = (struct message_bench*) ptr;
+	size_t n;
+	char* arg;
+
+	for (n = 0; n < iterations; n++)
+	{
+		arg = adc_msg_get_named_argument(ctx->msg, ADC_INF_FLAG_SUPPORT);
+		ctx->found += !!arg;
+		hub_free(arg);
+	}
+}
+
+static void bench_inf_table_update(void* ptr, size_t iterations)
+{
+	struct message_bench* ctx = (struct message_bench*) ptr;
+	struct adc_message* update;
+	size_t n;
+
+	for (n = 0; n < iterations; n++)
+	{
+		update = adc_msg_parse(bench_inf_update[n & 1], strlen(bench_inf_update[n & 1]));
+		ctx->found += inf_table_update(ctx->table, update);
+		adc_msg_free(update);
+	}
+}
+
+static void bench_inf_table_render(void* ptr, size_t iterations)
+{
+	struct message_bench* ctx = (struct message_bench*) ptr;
+	size_t n;
+
+	for (n = 0; n < iterations; n++)
+		adc_msg_free(inf_table_render(ctx->table));
+}
+
+static void bench_printable_utf8(void* ptr, size_t iterations)
+{
+	struct message_bench* ctx = (struct message_bench*) ptr;
+	size_t length = strlen(bench_chat);
+	size_t n;
+
+	for (n = 0; n < iterations; n++)
+		ctx->found += is_printable_utf8(bench_chat, length);
+}
+
+void bench_message()
+{
+	struct message_bench ctx;
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.length = strlen(bench_inf);
+	ctx.msg = adc_msg_parse(bench_inf, ctx.length);
+	ctx.table = inf_table_create(ctx.msg);
+
+	bench_run("adc_msg_parse (BINF)", bench_msg_parse, &ctx, MESSAGE_CALLS);
+	bench_run("adc_msg_get_named_argument (first)", bench_msg_get_first, &ctx, MESSAGE_CALLS);
+	bench_run("adc_msg_get_named_argument (last)", bench_msg_get_last, &ctx, MESSAGE_CALLS);
+	bench_run("inf_table_update (BINF)", bench_inf_table_update, &ctx, MESSAGE_CALLS);
+	bench_run("inf_table_render (BINF)", bench_inf_table_render, &ctx, MESSAGE_CALLS);
+	bench_run("is_printable_utf8 (chat)", bench_printable_utf8, &ctx, MESSAGE_CALLS);
+
+	inf_table_destroy(ctx.table);
+	adc_msg_free(ctx.msg);
+}
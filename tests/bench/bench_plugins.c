@@ -0,0 +1,164 @@
+/*
+ * uhub - A tiny ADC p2p connection hub
+ * Copyright (C) 2007-2014, Jan Vidar Krey
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "bench.h"
+
+#define PLUGINS_LOADED 10
+#define PLUGINS_CALLS 1000000
+
+struct plugins_bench
+{
+	struct hub_info hub;
+	struct uhub_plugins plugins;
+	struct plugin_handle handles[PLUGINS_LOADED];
+	struct hub_user user;
+	struct adc_message* search;
+	size_t calls;
+};
+
+static struct plugins_bench* g_ctx;
+
+static plugin_st bench_on_search(struct plugin_handle* plugin, struct plugin_user* from, const char* data)
+{
+	g_ctx->calls++;
+	return st_default;
+}
+
+static plugin_st bench_on_chat_msg(struct plugin_handle* plugin, struct plugin_user* from, const char* message)
+{
+	g_ctx->calls++;
+	return st_default;
+}
+
+/* The dispatch used before per hook tables, for comparison. */
+#define LIST_INVOKE_STATUS(HUB, FUNCNAME, ...) \
+	do { \
+		plugin_st status = st_default; \
+		struct plugin_handle* plugin; \
+		LIST_FOREACH(struct plugin_handle*, plugin, HUB->plugins->loaded, \
+		{ \
+			if (plugin->funcs.FUNCNAME) \
+			{ \
+				status = plugin->funcs.FUNCNAME(plugin, __VA_ARGS__); \
+				if (status != st_default) \
+					break; \
+			} \
+		}); \
+		return status; \
+	} while (0)
+
+static plugin_st list_handle_search(struct hub_info* hub, struct hub_user* user, const char* data)
+{
+	LIST_INVOKE_STATUS(hub, on_search, (struct plugin_user*) user, data);
+}
+
+static plugin_st list_handle_chat_message(struct hub_info* hub, struct hub_user* user, const char* message)
+{
+	LIST_INVOKE_STATUS(hub, on_chat_msg, (struct plugin_user*) user, message);
+}
+
+static plugin_st list_handle_connect(struct hub_info* hub, struct hub_user* from, struct hub_user* to)
+{
+	LIST_INVOKE_STATUS(hub, on_p2p_connect, (struct plugin_user*) from, (struct plugin_user*) to);
+}
+
+static void bench_hooks_search(void* ptr, size_t iterations)
+{
+	struct plugins_bench* ctx = (struct plugins_bench*) ptr;
+	size_t n;
+	for (n = 0; n < iterations; n++)
+		plugin_handle_search(&ctx->hub, &ctx->user, ctx->search);
+}
+
+static void bench_list_search(void* ptr, size_t iterations)
+{
+	struct plugins_bench* ctx = (struct plugins_bench*) ptr;
+	size_t n;
+	for (n = 0; n < iterations; n++)
+		list_handle_search(&ctx->hub, &ctx->user, ctx->search->cache);
+}
+
+static void bench_hooks_chat(void* ptr, size_t iterations)
+{
+	struct plugins_bench* ctx = (struct plugins_bench*) ptr;
+	size_t n;
+	for (n = 0; n < iterations; n++)
+		plugin_handle_chat_message(&ctx->hub, &ctx->user, "hello", 0);
+}
+
+static void bench_list_chat(void* ptr, size_t iterations)
+{
+	struct plugins_bench* ctx = (struct plugins_bench*) ptr;
+	size_t n;
+	for (n = 0; n < iterations; n++)
+		list_handle_chat_message(&ctx->hub, &ctx->user, "hello");
+}
+
+static void bench_hooks_connect(void* ptr, size_t iterations)
+{
+	struct plugins_bench* ctx = (struct plugins_bench*) ptr;
+	size_t n;
+	for (n = 0; n < iterations; n++)
+		plugin_handle_connect(&ctx->hub, &ctx->user, &ctx->user);
+}
+
+static void bench_list_connect(void* ptr, size_t iterations)
+{
+	struct plugins_bench* ctx = (struct plugins_bench*) ptr;
+	size_t n;
+	for (n = 0; n < iterations; n++)
+		list_handle_connect(&ctx->hub, &ctx->user, &ctx->user);
+}
+
+void bench_plugins()
+{
+	struct plugins_bench* ctx = hub_malloc_zero(sizeof(struct plugins_bench));
+	size_t n;
+
+	g_ctx = ctx;
+	ctx->hub.plugins = &ctx->plugins;
+	ctx->plugins.loaded = list_create();
+	ctx->search = adc_msg_create("BSCH AAAB ANtest");
+
+	/*
+	 * 10 plugins: every one handles chat, the last one handles searches
+	 * and nobody handles connect requests.
+	 */
+	for (n = 0; n < PLUGINS_LOADED; n++)
+	{
+		ctx->handles[n].funcs.on_chat_msg = bench_on_chat_msg;
+		if (n == PLUGINS_LOADED - 1)
+			ctx->handles[n].funcs.on_search = bench_on_search;
+		list_append(ctx->plugins.loaded, &ctx->handles[n]);
+	}
+	plugin_hooks_update(&ctx->plugins);
+
+	bench_run("plugin_search (1 of 10, hooks)", bench_hooks_search, ctx, PLUGINS_CALLS);
+	bench_run("plugin_search (1 of 10, list)", bench_list_search, ctx, PLUGINS_CALLS);
+	bench_run("plugin_chat (10 of 10, hooks)", bench_hooks_chat, ctx, PLUGINS_CALLS);
+	bench_run("plugin_chat (10 of 10, list)", bench_list_chat, ctx, PLUGINS_CALLS);
+	bench_run("plugin_connect (0 of 10, hooks)", bench_hooks_connect, ctx, PLUGINS_CALLS);
+	bench_run("plugin_connect (0 of 10, list)", bench_list_connect, ctx, PLUGINS_CALLS);
+
+	plugin_hooks_clear(&ctx->plugins);
+	list_clear(ctx->plugins.loaded, NULL);
+	list_destroy(ctx->plugins.loaded);
+	adc_msg_free(ctx->search);
+	hub_free(ctx);
+}
@@ -0,0 +1,103 @@
+/*
+ * uhub - A tiny ADC p2p connection hub
+ * Copyright (C) 2007-2014, Jan Vidar Krey
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "bench.h"
+
+#define ROUTE_USERS 1000
+#define ROUTE_CALLS 10000
+#define ROUTE_QUEUED 64
+
+/*
+ * Users are flagged for pipelining, so route_to_user() only queues the
+ * message and never touches the (fake) connection. The queues are emptied
+ * every ROUTE_QUEUED messages, outside of the measured time.
+ */
+struct route_bench
+{
+	struct hub_info hub;
+	struct hub_config config;
+	struct hub_user* users;
+	struct adc_message* msg;
+};
+
+static void route_drain(struct route_bench* ctx)
+{
+	size_t n;
+
+	bench_pause();
+	for (n = 0; n < ROUTE_USERS; n++)
+	{
+		ioq_send_destroy(ctx->users[n].send_queue);
+		ctx->users[n].send_queue = ioq_send_create();
+	}
+	bench_resume();
+}
+
+static void bench_route_to_all(void* ptr, size_t iterations)
+{
+	struct route_bench* ctx = (struct route_bench*) ptr;
+	size_t n;
+
+	for (n = 0; n < iterations; n++)
+	{
+		route_to_all(&ctx->hub, ctx->msg);
+		if ((n % ROUTE_QUEUED) == ROUTE_QUEUED - 1)
+			route_drain(ctx);
+	}
+	route_drain(ctx);
+}
+
+void bench_route()
+{
+	struct route_bench* ctx = hub_malloc_zero(sizeof(struct route_bench));
+	struct hub_user* user;
+	size_t n;
+
+	ctx->config.max_send_buffer = INT_MAX;
+	ctx->config.max_send_buffer_soft = INT_MAX;
+	ctx->hub.config = &ctx->config;
+	ctx->hub.users = uman_init();
+	ctx->users = hub_malloc_zero(sizeof(struct hub_user) * ROUTE_USERS);
+
+	for (n = 0; n < ROUTE_USERS; n++)
+	{
+		user = &ctx->users[n];
+		snprintf(user->id.nick, sizeof(user->id.nick), "user%d", (int) n);
+		snprintf(user->id.cid, sizeof(user->id.cid), "%039d", (int) n);
+		user->connection = (struct net_connection*) ctx; /* never dereferenced */
+		user->send_queue = ioq_send_create();
+		user_flag_set(user, flag_pipeline);
+		uman_get_free_sid(ctx->hub.users, user);
+		uman_add(ctx->hub.users, user);
+	}
+
+	ctx->msg = adc_msg_create("BMSG AAAB hello\\sworld");
+
+	bench_run("route_to_all (1k users)", bench_route_to_all, ctx, ROUTE_CALLS);
+
+	for (n = 0; n < ROUTE_USERS; n++)
+	{
+		uman_remove(ctx->hub.users, &ctx->users[n]);
+		ioq_send_destroy(ctx->users[n].send_queue);
+	}
+	uman_shutdown(ctx->hub.users);
+	adc_msg_free(ctx->msg);
+	hub_free(ctx->users);
+	hub_free(ctx);
+}
@@ -0,0 +1,325 @@
+/*
+ * uhub - A tiny ADC p2p connection hub
+ * Copyright (C) 2007-2014, Jan Vidar Krey
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "bench.h"
+
+#if defined(SSL_SUPPORT) && defined(SSL_USE_OPENSSL)
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#include <openssl/evp.h>
+#include <pthread.h>
+
+#define TLS_CHUNK 16384
+#define TLS_CHUNKS 20000
+
+/*
+ * Measures sending TLS records over a TCP loopback connection, with the
+ * encryption done by OpenSSL in user space, and by the kernel (kTLS) if
+ * available. A thread on the other end decrypts and discards the data.
+ */
+struct tls_bench
+{
+	SSL_CTX* server_ctx;
+	SSL_CTX* client_ctx;
+	SSL* server;
+	SSL* client;
+	int server_sd;
+	int client_sd;
+	int ktls;
+	pthread_t reader;
+	char buf[TLS_CHUNK];
+};
+
+static EVP_PKEY* tls_bench_key;
+static X509* tls_bench_cert;
+
+static int tls_bench_make_cert()
+{
+	X509_NAME* name;
+
+	tls_bench_key = EVP_EC_gen("P-256");
+	tls_bench_cert = X509_new();
+	if (!tls_bench_key || !tls_bench_cert)
+		return 0;
+
+	ASN1_INTEGER_set(X509_get_serialNumber(tls_bench_cert), 1);
+	X509_gmtime_adj(X509_getm_notBefore(tls_bench_cert), 0);
+	X509_gmtime_adj(X509_getm_notAfter(tls_bench_cert), 3600);
+	X509_set_pubkey(tls_bench_cert, tls_bench_key);
+	name = X509_get_subject_name(tls_bench_cert);
+	X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char*) "uhub-bench", -1, -1, 0);
+	X509_set_issuer_name(tls_bench_cert, name);
+	return X509_sign(tls_bench_cert, tls_bench_key, EVP_sha256()) > 0;
+}
+
+static int tls_bench_socket_pair(int* server_sd, int* client_sd)
+{
+	struct sockaddr_in addr;
+	socklen_t len = sizeof(addr);
+	int listen_sd = socket(AF_INET, SOCK_STREAM, 0);
+	int ok = 0;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	if (listen_sd != -1 && bind(listen_sd, (struct sockaddr*) &addr, sizeof(addr)) == 0 && listen(listen_sd, 1) == 0 &&
+		getsockname(listen_sd, (struct sockaddr*) &addr, &len) == 0)
+	{
+		*client_sd = socket(AF_INET, SOCK_STREAM, 0);
+		if (*client_sd != -1 && connect(*client_sd, (struct sockaddr*) &addr, sizeof(addr)) == 0)
+		{
+			*server_sd = accept(listen_sd, 0, 0);
+			ok = (*server_sd != -1);
+		}
+	}
+	if (listen_sd != -1)
+		close(listen_sd);
+	return ok;
+}
+
+static void* tls_bench_handshake(void* ptr)
+{
+	struct tls_bench* ctx = (struct tls_bench*) ptr;
+	return (void*) (intptr_t) (SSL_connect(ctx->client) == 1);
+}
+
+static void* tls_bench_read(void* ptr)
+{
+	struct tls_bench* ctx = (struct tls_bench*) ptr;
+	char buf[TLS_CHUNK];
+	while (SSL_read(ctx->client, buf, sizeof(buf)) > 0)
+		;
+	return 0;
+}
+
+static int tls_bench_setup(struct tls_bench* ctx, int ktls)
+{
+	pthread_t thread;
+	void* connected = 0;
+	int accepted;
+
+	memset(ctx, 0, sizeof(struct tls_bench));
+	memset(ctx->buf, 'x', sizeof(ctx->buf));
+	ctx->server_ctx = SSL_CTX_new(TLS_server_method());
+	ctx->client_ctx = SSL_CTX_new(TLS_client_method());
+	if (!ctx->server_ctx || !ctx->client_ctx)
+		return 0;
+
+	SSL_CTX_use_certificate(ctx->server_ctx, tls_bench_cert);
+	SSL_CTX_use_PrivateKey(ctx->server_ctx, tls_bench_key);
+#ifdef SSL_OP_ENABLE_KTLS
+	if (ktls)
+		SSL_CTX_set_options(ctx->server_ctx, SSL_OP_ENABLE_KTLS);
+#endif
+
+	if (!tls_bench_socket_pair(&ctx->server_sd, &ctx->client_sd))
+		return 0;
+
+	ctx->server = SSL_new(ctx->server_ctx);
+	ctx->client = SSL_new(ctx->client_ctx);
+	SSL_set_fd(ctx->server, ctx->server_sd);
+	SSL_set_fd(ctx->client, ctx->client_sd);
+
+	pthread_create(&thread, 0, tls_bench_handshake, ctx);
+	accepted = SSL_accept(ctx->server);
+	pthread_join(thread, &connected);
+	if (accepted != 1 || !connected)
+		return 0;
+
+#if defined(SSL_OP_ENABLE_KTLS) && !defined(OPENSSL_NO_KTLS)
+	ctx->ktls = BIO_get_ktls_send(SSL_get_wbio(ctx->server));
+#endif
+	pthread_create(&ctx->reader, 0, tls_bench_read, ctx);
+	return 1;
+}
+
+static void tls_bench_teardown(struct tls_bench* ctx)
+{
+	if (ctx->reader)
+	{
+		shutdown(ctx->server_sd, SHUT_RDWR);
+		pthread_join(ctx->reader, 0);
+	}
+	if (ctx->server)
+		SSL_free(ctx->server);
+	if (ctx->client)
+		SSL_free(ctx->client);
+	if (ctx->server_sd > 0)
+		close(ctx->server_sd);
+	if (ctx->client_sd > 0)
+		close(ctx->client_sd);
+	SSL_CTX_free(ctx->server_ctx);
+	SSL_CTX_free(ctx->client_ctx);
+}
+
+static void bench_tls_ssl_write(void* ptr, size_t iterations)
+{
+	struct tls_bench* ctx = (struct tls_bench*) ptr;
+	size_t n;
+	for (n = 0; n < iterations; n++)
+		SSL_write(ctx->server, ctx->buf, TLS_CHUNK);
+}
+
+/*
+ * Full and resumed handshakes, over an in-memory BIO pair so only the
+ * cryptography is measured.
+ */
+struct tls_handshake_bench
+{
+	SSL_CTX* server_ctx;
+	SSL_CTX* client_ctx;
+	SSL_SESSION* session;
+};
+
+static int tls_bench_handshake_once(struct tls_handshake_bench* ctx, SSL_SESSION** session_out)
+{
+	SSL* server = SSL_new(ctx->server_ctx);
+	SSL* client = SSL_new(ctx->client_ctx);
+	BIO* server_bio;
+	BIO* client_bio;
+	char buf[64];
+	int server_done = 0;
+	int client_done = 0;
+	int rounds;
+	int reused;
+
+	BIO_new_bio_pair(&server_bio, 0, &client_bio, 0);
+	SSL_set_bio(server, server_bio, server_bio);
+	SSL_set_bio(client, client_bio, client_bio);
+	SSL_set_accept_state(server);
+	SSL_set_connect_state(client);
+	if (ctx->session)
+		SSL_set_session(client, ctx->session);
+
+	for (rounds = 0; rounds < 10 && !(server_done && client_done); rounds++)
+	{
+		if (!client_done)
+			client_done = (SSL_do_handshake(client) == 1);
+		if (!server_done)
+			server_done = (SSL_do_handshake(server) == 1);
+	}
+
+	/* TLS 1.3 tickets arrive after the handshake */
+	SSL_read(client, buf, sizeof(buf));
+	reused = SSL_session_reused(client);
+	if (session_out)
+		*session_out = SSL_get1_session(client);
+
+	/* Like the hub does, sessions not shut down are dropped from the cache */
+	SSL_shutdown(server);
+	SSL_shutdown(client);
+	SSL_free(server);
+	SSL_free(client);
+	return server_done && client_done ? 1 + reused : 0;
+}
+
+static void bench_tls_handshake(void* ptr, size_t iterations)
+{
+	struct tls_handshake_bench* ctx = (struct tls_handshake_bench*) ptr;
+	SSL_SESSION* session;
+	size_t n;
+	for (n = 0; n < iterations; n++)
+	{
+		if (!ctx->session)
+		{
+			tls_bench_handshake_once(ctx, 0);
+			continue;
+		}
+
+		/* Reconnect with the latest session, TLS 1.3 tickets are meant to be used once */
+		session = 0;
+		tls_bench_handshake_once(ctx, &session);
+		SSL_SESSION_free(ctx->session);
+		ctx->session = session;
+	}
+}
+
+static void tls_bench_handshakes(int tickets)
+{
+	struct tls_handshake_bench ctx;
+	SSL_SESSION* session = 0;
+
+	memset(&ctx, 0, sizeof(ctx));
+	ctx.server_ctx = SSL_CTX_new(TLS_server_method());
+	ctx.client_ctx = SSL_CTX_new(TLS_client_method());
+	SSL_CTX_use_certificate(ctx.server_ctx, tls_bench_cert);
+	SSL_CTX_use_PrivateKey(ctx.server_ctx, tls_bench_key);
+	SSL_CTX_set_session_id_context(ctx.server_ctx, (const unsigned char*) "bench", 5);
+	SSL_CTX_set_quiet_shutdown(ctx.server_ctx, 1);
+	SSL_CTX_set_quiet_shutdown(ctx.client_ctx, 1);
+	if (!tickets)
+		SSL_CTX_set_options(ctx.server_ctx, SSL_OP_NO_TICKET);
+
+	if (!tickets)
+		bench_run("handshake_full", bench_tls_handshake, &ctx, 200);
+
+	if (tls_bench_handshake_once(&ctx, &ctx.session) && tls_bench_handshake_once(&ctx, &session) == 2)
+		bench_run(tickets ? "handshake_resume_ticket" : "handshake_resume_cache", bench_tls_handshake, &ctx, 2000);
+	else
+		bench_note("tls: session was not resumed");
+
+	if (session)
+		SSL_SESSION_free(session);
+	if (ctx.session)
+		SSL_SESSION_free(ctx.session);
+	SSL_CTX_free(ctx.server_ctx);
+	SSL_CTX_free(ctx.client_ctx);
+}
+
+void bench_tls()
+{
+	struct tls_bench ctx;
+
+	if (!tls_bench_make_cert())
+	{
+		bench_note("tls: unable to create a certificate");
+		return;
+	}
+
+	if (tls_bench_setup(&ctx, 0))
+	{
+		bench_note("tls: %s, 16 KB writes", SSL_get_cipher(ctx.server));
+		bench_run("ssl_write_16k", bench_tls_ssl_write, &ctx, TLS_CHUNKS);
+	}
+	else
+		bench_note("tls: handshake failed");
+	tls_bench_teardown(&ctx);
+
+	if (tls_bench_setup(&ctx, 1) && ctx.ktls)
+		bench_run("ktls_write_16k", bench_tls_ssl_write, &ctx, TLS_CHUNKS);
+	else
+		bench_note("tls: kernel TLS is not available, skipping ktls_write_16k");
+	tls_bench_teardown(&ctx);
+
+	tls_bench_handshakes(0);
+	tls_bench_handshakes(1);
+
+	X509_free(tls_bench_cert);
+	EVP_PKEY_free(tls_bench_key);
+}
+
+#else /* !SSL_SUPPORT */
+
+void bench_tls()
+{
+	bench_note("tls: built without OpenSSL");
+}
+
+#endif /* SSL_SUPPORT */
@@ -0,0 +1,51 @@
+#!/usr/bin/env python
+"""
+  uhub - A tiny ADC p2p connection hub
+  Copyright (C) 2007-2014, Jan Vidar Krey
+
+  Compare two uhub-bench -j reports, for instance from two commits:
+    uhub-bench -j > base.json
+    (rebuild)
+    uhub-bench -j > new.json
+    compare.py base.json new.json
+"""
+
+import argparse
+import json
+import sys
+
+def load(filename):
+	with open(filename) as f:
+		report = json.load(f)
+	return report, dict(((r["suite"], r["name"]), r) for r in report["results"])
+
+def main():
+	parser = argparse.ArgumentParser(description = "Compare two uhub-bench reports")
+	parser.add_argument("base")
+	parser.add_argument("new")
+	parser.add_argument("--threshold", type = float, default = 10.0, help = "Percentage a median may increase before it is a regression (default: 10)")
+	args = parser.parse_args()
+
+	base_report, base = load(args.base)
+	new_report, new = load(args.new)
+	regressions = 0
+
+	print("%-52s %12s %12s %8s" % (base_report["version"] + " -> " + new_report["version"], "base ns/op", "new ns/op", "change"))
+	for key in sorted(new):
+		if key not in base:
+			print("%-52s %12s %12.1f %8s" % ("%s/%s" % key, "-", new[key]["median_ns"], "new"))
+			continue
+
+		old = base[key]["median_ns"]
+		cur = new[key]["median_ns"]
+		change = ((cur - old) / old * 100.0) if old else 0.0
+		mark = ""
+		if change > args.threshold:
+			mark = " <-- regression"
+			regressions += 1
+		print("%-52s %12.1f %12.1f %+7.1f%%%s" % ("%s/%s" % key, old, cur, change, mark))
+
+	return 1 if regressions else 0
+
+if __name__ == "__main__":
+	sys.exit(main())